@@ -17,4 +17,5 @@ include "Walnut/Build-Walnut-External.lua"
 group "App"
     include "Cubed-Common/Build-Cubed-Common.lua"
     include "Cubed-Client/Build-Cubed-Client.lua"
+    include "Cubed-Tests/Build-Cubed-Tests.lua"
 group ""
\ No newline at end of file
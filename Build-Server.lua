@@ -22,4 +22,8 @@ include "Walnut/Build-Walnut-Headless-External.lua"
 group "App"
     include "Cubed-Common/Build-Cubed-Common-Headless.lua"
     include "Cubed-Server/Build-Cubed-Server-Headless.lua"
+    -- Only has a configuration for the Linux CI builders
+    if os.target() == "linux" then
+        include "Cubed-Bench/Build-Cubed-Bench.lua"
+    end
 group ""
\ No newline at end of file
@@ -0,0 +1,81 @@
+project "Cubed-Bench"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++20"
+   targetdir "bin/%{cfg.buildcfg}"
+   staticruntime "off"
+
+   -- The client's renderer and asset code, built without its window layer.
+   -- Nothing links the GUI Walnut library (GLFW, the ImGui backends): WL_HEADLESS
+   -- compiles the Walnut Application fallbacks out, and the few pieces still
+   -- needed - logging, ImGui's core for the renderer's debug UI, the terrain
+   -- generator - are built straight into the executable.
+   --
+   -- Only the GPU-less Linux CI builders build it, as part of the headless
+   -- workspace that scripts/Setup.sh generates from Build-Server.lua. Vulkan,
+   -- assimp and stb (stb_image_write.h, which Model.cpp implements) come from
+   -- the system packages through pkg-config; stb_image is Walnut's copy.
+   files
+   {
+      "Source/**.h",
+      "Source/**.cpp",
+
+      "../Cubed-Client/Source/Renderer/**.h",
+      "../Cubed-Client/Source/Renderer/**.cpp",
+      "../Cubed-Client/Source/Assets/**.h",
+      "../Cubed-Client/Source/Assets/**.cpp",
+
+      "../Cubed-Common/Source/World/**.h",
+      "../Cubed-Common/Source/World/**.cpp",
+
+      "../Walnut/Walnut/Source/Walnut/Core/Log.cpp",
+
+      "../Walnut/vendor/imgui/imgui.cpp",
+      "../Walnut/vendor/imgui/imgui_draw.cpp",
+      "../Walnut/vendor/imgui/imgui_tables.cpp",
+      "../Walnut/vendor/imgui/imgui_widgets.cpp"
+   }
+
+   defines { "WL_HEADLESS" }
+
+   includedirs
+   {
+      "Source",
+      "../Cubed-Client/Source",
+      "../Cubed-Common/Source",
+
+      "../Walnut/vendor/imgui",
+      "../Walnut/vendor/glm",
+      "../Walnut/vendor/spdlog/include",
+      "../Walnut/vendor/stb_image",
+
+      "../Walnut/Walnut/Source",
+      "../Walnut/Walnut/Platform/Headless"
+   }
+
+   targetdir ("../bin/" .. outputdir .. "/%{prj.name}")
+   objdir ("../bin-int/" .. outputdir .. "/%{prj.name}")
+
+   -- The system Vulkan loader, running on lavapipe or SwiftShader
+   filter "system:linux"
+      defines { "WL_PLATFORM_LINUX" }
+      buildoptions { "`pkg-config --cflags vulkan assimp stb`" }
+      linkoptions { "`pkg-config --libs vulkan assimp`" }
+      links { "dl", "pthread" }
+
+   filter "configurations:Debug"
+      defines { "WL_DEBUG" }
+      runtime "Debug"
+      symbols "On"
+
+   filter "configurations:Release"
+      defines { "WL_RELEASE" }
+      runtime "Release"
+      optimize "On"
+      symbols "On"
+
+   filter "configurations:Dist"
+      defines { "WL_DIST" }
+      runtime "Release"
+      optimize "On"
+      symbols "Off"
@@ -0,0 +1,155 @@
+#include "RenderBenchmark.h"
+
+#include "Walnut/Core/Log.h"
+
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string_view>
+
+//
+// Cubed-Bench - renders a fixed flight over generated terrain offscreen and
+// prints frame time percentiles. Needs no window, so it runs on build
+// machines with a software Vulkan driver (lavapipe, SwiftShader).
+//
+//   Cubed-Bench [--frames N] [--warmup N] [--width W] [--height H] [--radius R]
+//               [--seed S] [--gpu-budget MS] [--frames-in-flight N] [--device I] [--validation]
+//               [--assets DIR] [--dump DIR] [--dump-every N] [--csv FILE]
+//
+
+static void PrintUsage()
+{
+	std::printf(
+		"Usage: Cubed-Bench [options]\n"
+		"  --frames N            measured frames (600)\n"
+		"  --warmup N            frames rendered before measuring (60)\n"
+		"  --width W --height H  render target size (1280x720)\n"
+		"  --radius R            chunks around the origin, (2R+1)^2 in total (6)\n"
+		"  --seed S              world seed\n"
+		"  --gpu-budget MS       scale the resolution to hold this GPU frame time (off)\n"
+		"  --frames-in-flight N  (2)\n"
+		"  --device I            physical device index, default prefers a discrete GPU\n"
+		"  --validation          enable the Khronos validation layer\n"
+		"  --assets DIR          client asset directory (../Cubed-Client/Assets)\n"
+		"  --dump DIR            write every Nth measured frame to DIR as PNG\n"
+		"  --dump-every N        (60)\n"
+		"  --csv FILE            write per-frame times\n");
+}
+
+template<typename T>
+static bool ParseNumber(const char* text, T& value)
+{
+	const char* end = text + std::strlen(text);
+	auto [ptr, error] = std::from_chars(text, end, value);
+	return error == std::errc() && ptr == end;
+}
+
+static bool ParseArguments(int argc, char** argv, Cubed::RenderBenchmarkSettings& settings)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string_view arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		bool ok = true;
+		if (arg == "--validation")
+		{
+			settings.Device.Validation = true;
+			continue;
+		}
+		else if (!value)
+			ok = false;
+		else if (arg == "--frames")
+			ok = ParseNumber(value, settings.Frames);
+		else if (arg == "--warmup")
+			ok = ParseNumber(value, settings.WarmupFrames);
+		else if (arg == "--width")
+			ok = ParseNumber(value, settings.Device.Width);
+		else if (arg == "--height")
+			ok = ParseNumber(value, settings.Device.Height);
+		else if (arg == "--radius")
+			ok = ParseNumber(value, settings.ChunkRadius);
+		else if (arg == "--seed")
+			ok = ParseNumber(value, settings.Seed);
+		else if (arg == "--gpu-budget")
+			ok = ParseNumber(value, settings.GpuBudgetMs);
+		else if (arg == "--frames-in-flight")
+			ok = ParseNumber(value, settings.Device.FrameCount) && settings.Device.FrameCount > 0;
+		else if (arg == "--device")
+			ok = ParseNumber(value, settings.Device.DeviceIndex);
+		else if (arg == "--assets")
+			settings.AssetDirectory = value;
+		else if (arg == "--dump")
+			settings.DumpDirectory = value;
+		else if (arg == "--dump-every")
+			ok = ParseNumber(value, settings.DumpInterval);
+		else if (arg == "--csv")
+			settings.CsvPath = value;
+		else
+			ok = false;
+
+		if (!ok)
+		{
+			std::fprintf(stderr, "Bad argument: %s\n", argv[i]);
+			return false;
+		}
+		i++;
+	}
+
+	return settings.Device.Width > 0 && settings.Device.Height > 0 && settings.Frames > 0;
+}
+
+static void PrintTimings(const char* name, const Cubed::TimingSummary& timing)
+{
+	if (timing.Samples == 0)
+	{
+		std::printf("%-10s n/a\n", name);
+		return;
+	}
+
+	std::printf("%-10s mean %7.3f  p50 %7.3f  p90 %7.3f  p99 %7.3f  max %7.3f ms\n",
+		name, timing.Mean, timing.P50, timing.P90, timing.P99, timing.Max);
+}
+
+int main(int argc, char** argv)
+{
+	Cubed::RenderBenchmarkSettings settings;
+	if (!ParseArguments(argc, argv, settings))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	Walnut::Log::Init();
+
+	Cubed::RenderBenchmarkResult result;
+	try
+	{
+		Cubed::RenderBenchmark benchmark(settings);
+		result = benchmark.Run();
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "Benchmark failed: %s\n", e.what());
+		Walnut::Log::Shutdown();
+		return 1;
+	}
+
+	std::printf("%s, %ux%u, %u chunks, %u models\n", result.DeviceName.c_str(), result.Width, result.Height, result.Chunks, result.Models);
+	std::printf("%u frames in %.3fs\n", result.Frames, result.Seconds);
+	PrintTimings("Frame", result.FrameMs);
+	PrintTimings("Scene CPU", result.SceneCpuMs);
+	PrintTimings("GPU", result.GpuMs);
+
+	const Cubed::Renderer::CullStats& cull = result.LastCullStats;
+	std::printf("Last frame: %u/%u chunks, %u/%u meshes visible, %u chunks and %u meshes occluded\n",
+		cull.ChunksVisible, cull.ChunksTested, cull.MeshesVisible, cull.MeshesTested, cull.ChunksOccluded, cull.MeshesOccluded);
+	if (settings.GpuBudgetMs > 0.0f)
+		std::printf("Dynamic resolution: %.0f%% at the end, %u changes\n", result.Resolution.Scale * 100.0f, result.Resolution.Changes);
+	if (!settings.DumpDirectory.empty())
+		std::printf("%u images written to %s\n", result.ImagesWritten, settings.DumpDirectory.string().c_str());
+
+	Walnut::Log::Shutdown();
+	return 0;
+}
@@ -0,0 +1,242 @@
+#include "RenderBenchmark.h"
+
+#include "Assets/ModelManager.h"
+#include "Renderer/ChunkMesher.h"
+
+#include "World/Chunk.h"
+#include "World/LightEngine.h"
+
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+namespace Cubed {
+
+	// One lap of the orbit, in frames
+	static constexpr uint32_t s_OrbitFrames = 720;
+	static constexpr float s_CameraHeight = TerrainGenerator::SEA_LEVEL + 24.0f;
+	static constexpr float s_CameraBob = 6.0f;
+
+	RenderBenchmark::RenderBenchmark(const RenderBenchmarkSettings& settings)
+		: m_Settings(settings)
+	{
+		m_Settings.ChunkRadius = std::max(m_Settings.ChunkRadius, 0);
+		m_Settings.DumpInterval = std::max(m_Settings.DumpInterval, 1u);
+	}
+
+	Camera RenderBenchmark::GetCamera(uint32_t frame, int chunkRadius)
+	{
+		// Circles the generated area two thirds of the way out, looking along the
+		// direction of travel, so chunks enter and leave the frustum every frame
+		const float degrees = 360.0f * (float)(frame % s_OrbitFrames) / (float)s_OrbitFrames;
+		const float angle = glm::radians(degrees);
+		const float radius = std::max(chunkRadius * CHUNK_SIZE * 2.0f / 3.0f, 8.0f);
+
+		Camera camera;
+		camera.Position = { std::cos(angle) * radius, s_CameraHeight + std::sin(angle * 3.0f) * s_CameraBob, -std::sin(angle) * radius };
+		camera.Rotation = { 0.0f, degrees, 0.0f };
+		return camera;
+	}
+
+	void RenderBenchmark::BuildTerrain(Renderer& renderer)
+	{
+		TerrainGenerator terrain(m_Settings.Seed);
+		LightEngine light(m_World);
+
+		const int radius = m_Settings.ChunkRadius;
+		for (int z = -radius; z <= radius; z++)
+		{
+			for (int x = -radius; x <= radius; x++)
+			{
+				auto chunk = std::make_unique<Chunk>(ChunkCoord{ x, z });
+				terrain.Generate(*chunk);
+				m_World.AddChunk(std::move(chunk));
+				light.LightChunk({ x, z });
+			}
+		}
+
+		// Meshed once all neighbours exist so the borders match the client's
+		ChunkMeshData mesh;
+		for (int z = -radius; z <= radius; z++)
+		{
+			for (int x = -radius; x <= radius; x++)
+			{
+				if (ChunkMesher::Build(m_World, { x, z }, mesh))
+					renderer.UploadChunkMesh({ x, z }, mesh);
+			}
+		}
+	}
+
+	void RenderBenchmark::LoadModels(Renderer& renderer)
+	{
+		struct ModelPlacement
+		{
+			const char* File;
+			float Size;
+			glm::vec3 Position;
+		};
+
+		static const ModelPlacement placements[] = {
+			{ "cube.obj", 1.0f, { 0.0f, TerrainGenerator::SEA_LEVEL + 16.0f, 0.0f } },
+			{ "miyako.glb", 1.6f, { 3.0f, TerrainGenerator::SEA_LEVEL + 16.0f, 0.0f } },
+		};
+
+		for (const ModelPlacement& placement : placements)
+		{
+			const std::filesystem::path path = m_Settings.AssetDirectory / "Models" / placement.File;
+			if (!std::filesystem::exists(path))
+				continue;
+
+			auto model = ModelManager::Load(path, (uint32_t)m_Models.size());
+			model->SetSizeMeters(placement.Size);
+			model->SetPosition(placement.Position);
+			renderer.AddModel(model);
+			m_Models.push_back(std::move(model));
+		}
+	}
+
+	bool RenderBenchmark::WriteImage(HeadlessDevice& device, uint32_t frameIndex, uint32_t frame)
+	{
+		device.ReadPixels(frameIndex, m_Pixels);
+
+		char name[32];
+		std::snprintf(name, sizeof(name), "frame_%05u.png", frame);
+		const std::filesystem::path path = m_Settings.DumpDirectory / name;
+		return stbi_write_png(path.string().c_str(), (int)device.GetWidth(), (int)device.GetHeight(), 4, m_Pixels.data(), (int)device.GetWidth() * 4) != 0;
+	}
+
+	RenderBenchmarkResult RenderBenchmark::Run()
+	{
+		if (!std::filesystem::is_directory(m_Settings.AssetDirectory / "Shaders"))
+			throw std::runtime_error("No shaders under asset directory " + m_Settings.AssetDirectory.string());
+		if (!m_Settings.DumpDirectory.empty())
+			std::filesystem::create_directories(m_Settings.DumpDirectory);
+
+		HeadlessDevice device(m_Settings.Device);
+		Renderer::SetAssetDirectory(m_Settings.AssetDirectory);
+
+		RenderBenchmarkResult result;
+		result.DeviceName = device.GetDeviceName();
+		result.Width = device.GetWidth();
+		result.Height = device.GetHeight();
+
+		std::vector<float> frameMs, sceneMs, gpuMs;
+		frameMs.reserve(m_Settings.Frames);
+		sceneMs.reserve(m_Settings.Frames);
+		gpuMs.reserve(m_Settings.Frames);
+
+		{
+			Renderer renderer;
+			renderer.Init(RenderTarget{ device.GetWidth(), device.GetHeight(), HeadlessDevice::ColorFormat, device.GetColorViews() });
+
+			DynamicResolutionSettings resolution = renderer.GetDynamicResolution();
+			resolution.Enabled = m_Settings.GpuBudgetMs > 0.0f;
+			if (resolution.Enabled)
+				resolution.TargetFrameMs = m_Settings.GpuBudgetMs;
+			renderer.SetDynamicResolution(resolution);
+
+			BuildTerrain(renderer);
+			LoadModels(renderer);
+			result.Chunks = (uint32_t)((2 * m_Settings.ChunkRadius + 1) * (2 * m_Settings.ChunkRadius + 1));
+			result.Models = (uint32_t)m_Models.size();
+
+			// A GPU sample shows up when its slot comes round again, so the last
+			// frames in flight are rendered once more to collect theirs
+			const uint32_t latency = m_Settings.Device.FrameCount;
+			const uint32_t measureStart = m_Settings.WarmupFrames;
+			const uint32_t measureEnd = measureStart + m_Settings.Frames;
+			const uint32_t totalFrames = measureEnd + latency;
+
+			const auto runStart = std::chrono::steady_clock::now();
+			for (uint32_t frame = 0; frame < totalFrames; frame++)
+			{
+				const auto frameStart = std::chrono::steady_clock::now();
+
+				HeadlessFrame target = device.BeginFrame();
+				renderer.BeginScene(GetCamera(frame, m_Settings.ChunkRadius), target.CommandBuffer, target.Index);
+				renderer.RenderChunks();
+				renderer.RenderModels();
+				renderer.EndScene();
+				device.EndFrame();
+
+				const float elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+
+				if (frame >= measureStart && frame < measureEnd)
+				{
+					frameMs.push_back(elapsed);
+					if (const ProfilerScope* scene = renderer.GetProfiler().FindScope("Scene", false))
+						sceneMs.push_back(scene->Last);
+					result.LastCullStats = renderer.GetCullStats();
+				}
+
+				// What was read back this frame belongs to the frame 'latency' ago
+				if (frame >= measureStart + latency)
+				{
+					if (const float gpu = renderer.GetProfiler().GetReadBackTime("Frame"); gpu > 0.0f)
+						gpuMs.push_back(gpu);
+				}
+
+				// Read back outside the timed part of the frame
+				const bool dump = !m_Settings.DumpDirectory.empty() && frame >= measureStart && frame < measureEnd
+					&& (frame - measureStart) % m_Settings.DumpInterval == 0;
+				if (dump && WriteImage(device, target.Index, frame - measureStart))
+					result.ImagesWritten++;
+			}
+			result.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+			result.Resolution = renderer.GetDynamicResolutionStats();
+
+			device.WaitIdle();
+			m_Models.clear();
+			renderer.Shutdown();
+		}
+
+		if (!m_Settings.CsvPath.empty())
+		{
+			std::ofstream csv(m_Settings.CsvPath);
+			csv << "frame,frame_ms,scene_cpu_ms,gpu_ms\n";
+			for (size_t i = 0; i < frameMs.size(); i++)
+			{
+				csv << i << ',' << frameMs[i] << ',';
+				if (i < sceneMs.size()) csv << sceneMs[i];
+				csv << ',';
+				if (i < gpuMs.size()) csv << gpuMs[i];
+				csv << '\n';
+			}
+		}
+
+		result.Frames = (uint32_t)frameMs.size();
+		result.FrameMs = Summarize(std::move(frameMs));
+		result.SceneCpuMs = Summarize(std::move(sceneMs));
+		result.GpuMs = Summarize(std::move(gpuMs));
+		return result;
+	}
+
+	TimingSummary Summarize(std::vector<float> samples)
+	{
+		TimingSummary summary;
+		if (samples.empty())
+			return summary;
+
+		std::sort(samples.begin(), samples.end());
+		auto percentile = [&](float p)
+		{
+			const size_t index = std::min(samples.size() - 1, (size_t)std::ceil(p * samples.size()) - (p > 0.0f ? 1 : 0));
+			return samples[index];
+		};
+
+		summary.Samples = (uint32_t)samples.size();
+		summary.Mean = std::accumulate(samples.begin(), samples.end(), 0.0f) / samples.size();
+		summary.P50 = percentile(0.50f);
+		summary.P90 = percentile(0.90f);
+		summary.P99 = percentile(0.99f);
+		summary.Max = samples.back();
+		return summary;
+	}
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Renderer/HeadlessDevice.h"
+#include "Renderer/Renderer.h"
+
+#include "World/TerrainGenerator.h"
+#include "World/World.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace Cubed {
+
+	struct RenderBenchmarkSettings
+	{
+		HeadlessSettings Device;
+		uint32_t Frames = 600;
+		uint32_t WarmupFrames = 60;      // rendered, not measured
+		int ChunkRadius = 6;             // (2r+1)^2 chunks around the origin
+		uint32_t Seed = DEFAULT_WORLD_SEED;
+		float GpuBudgetMs = 0.0f;        // above 0 turns on dynamic resolution, otherwise every frame is full size
+
+		std::filesystem::path AssetDirectory = "../Cubed-Client/Assets";
+		std::filesystem::path DumpDirectory;   // empty writes no images
+		uint32_t DumpInterval = 60;            // every Nth measured frame
+		std::filesystem::path CsvPath;         // per-frame times, empty writes none
+	};
+
+	struct TimingSummary
+	{
+		uint32_t Samples = 0;
+		float Mean = 0.0f, P50 = 0.0f, P90 = 0.0f, P99 = 0.0f, Max = 0.0f;
+	};
+
+	struct RenderBenchmarkResult
+	{
+		std::string DeviceName;
+		uint32_t Width = 0, Height = 0;
+		uint32_t Frames = 0;
+		uint32_t Chunks = 0, Models = 0;
+		double Seconds = 0.0;
+
+		TimingSummary FrameMs;       // BeginFrame to EndFrame on the CPU, including any wait on the GPU
+		TimingSummary SceneCpuMs;    // the renderer's "Scene" scope, BeginScene to EndScene
+		TimingSummary GpuMs;         // the renderer's "Frame" timestamp scope, empty without timestamps
+
+		Renderer::CullStats LastCullStats;
+		DynamicResolutionStats Resolution;   // at the end of the run
+		uint32_t ImagesWritten = 0;
+	};
+
+	//
+	// RenderBenchmark - renders a generated terrain with the client's renderer
+	// on a HeadlessDevice, flying the camera along a fixed orbit so every run
+	// draws the same frames. Used for regression tracking on machines without
+	// a display, including CI runners with a software Vulkan driver.
+	//
+	// GPU times come back through the profiler's timestamp queries, which are
+	// read one frame in flight late; the last few frames are flushed before
+	// the summary is taken so every measured frame has its GPU sample.
+	//
+	class RenderBenchmark
+	{
+	public:
+		explicit RenderBenchmark(const RenderBenchmarkSettings& settings);
+
+		// Throws std::runtime_error when there is no usable device or the assets are missing
+		RenderBenchmarkResult Run();
+
+		// The camera for a frame of the flight path
+		static Camera GetCamera(uint32_t frame, int chunkRadius);
+	private:
+		void BuildTerrain(Renderer& renderer);
+		void LoadModels(Renderer& renderer);
+		bool WriteImage(HeadlessDevice& device, uint32_t frameIndex, uint32_t frame);
+	private:
+		RenderBenchmarkSettings m_Settings;
+		World m_World;
+		std::vector<std::shared_ptr<Model>> m_Models;
+		std::vector<uint8_t> m_Pixels;
+	};
+
+	TimingSummary Summarize(std::vector<float> samples);
+
+}
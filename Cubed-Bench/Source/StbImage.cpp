@@ -0,0 +1,3 @@
+// The client gets stb_image's implementation from the Walnut library, which the bench doesn't link
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
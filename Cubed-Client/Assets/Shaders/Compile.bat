@@ -5,6 +5,15 @@ if not exist bin (
 )
 
 call glslangValidator -V -o bin/basic.frag.spirv basic.frag.glsl
+call glslangValidator -V -DNONUNIFORM_TEXTURES -o bin/basic.nonuniform.frag.spirv basic.frag.glsl
 call glslangValidator -V -o bin/basic.vert.spirv basic.vert.glsl
+call glslangValidator -V -o bin/hiz.comp.spirv hiz.comp.glsl
+call glslangValidator -V -o bin/indirect.vert.spirv indirect.vert.glsl
+call glslangValidator -V -o bin/instanced.vert.spirv instanced.vert.glsl
+call glslangValidator -V -o bin/outline.frag.spirv outline.frag.glsl
+call glslangValidator -V -o bin/upscale.frag.spirv upscale.frag.glsl
+call glslangValidator -V -o bin/upscale.vert.spirv upscale.vert.glsl
+call glslangValidator -V -o bin/voxel.frag.spirv voxel.frag.glsl
+call glslangValidator -V -o bin/voxel.vert.spirv voxel.vert.glsl
 
 pause
@@ -1,31 +1,34 @@
 // basic.frag
 #version 460 core
 
+// Built a second time as basic.nonuniform.frag, for instances that pick different
+// textures within one draw; only used when the device enabled the feature
+#ifdef NONUNIFORM_TEXTURES
+#extension GL_EXT_nonuniform_qualifier : require
+#define TEXTURE_INDEX(i) nonuniformEXT(i)
+#else
+#define TEXTURE_INDEX(i) (i)
+#endif
+
 layout(location = 1) in vec3 in_normal;
 layout(location = 2) in vec2 in_uv;
 layout(location = 3) flat in int in_texIndex;
-layout(location = 4) flat in int in_isOutline;
 
 layout(location = 0) out vec4 out_color;
 
-layout(set = 0, binding = 0) uniform sampler2D u_Textures[100];
+// Sized by the renderer to its texture table, see TextureTable
+layout(constant_id = 0) const int TEXTURE_COUNT = 1024;
+layout(set = 0, binding = 0) uniform sampler2D u_Textures[TEXTURE_COUNT];
 
 const vec3 lightDir = normalize(vec3(0.5, 1.0, 1.0));
 
 void main()
 {
-    // For outlines: draw only back faces and make them solid black.
-    if (in_isOutline != 0) {
-        if (gl_FrontFacing) discard;      // emulate front-face culling (no pipeline change)
-        out_color = vec4(0.0, 0.0, 0.0, 1.0);
-        return;
-    }
-
-    int idx = clamp(in_texIndex, 0, 99);
+    int idx = clamp(in_texIndex, 0, TEXTURE_COUNT - 1);
     vec3 N = normalize(in_normal);
 
     float intensity = max(dot(N, lightDir), 0.35);
-    vec4 tex = texture(u_Textures[idx], in_uv);
+    vec4 tex = texture(u_Textures[TEXTURE_INDEX(idx)], in_uv);
 
     out_color = vec4(tex.rgb * intensity, tex.a);
 }
@@ -0,0 +1,32 @@
+// hiz.comp
+#version 460 core
+
+// One level of the Hi-Z pyramid: each texel is the farthest depth of the source
+// texels it covers. Sizes halve rounding down, so a texel on an odd edge covers
+// three source texels on that axis and none are skipped.
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(set = 0, binding = 0) uniform sampler2D u_Source;   // the depth attachment, or the level above
+layout(set = 0, binding = 1, r32f) uniform writeonly image2D u_Destination;
+
+layout(push_constant) uniform PushConstants {
+    ivec2 SourceSize;
+    ivec2 DestinationSize;
+} u_Push;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, u_Push.DestinationSize)))
+        return;
+
+    ivec2 begin = texel * u_Push.SourceSize / u_Push.DestinationSize;
+    ivec2 end = ((texel + 1) * u_Push.SourceSize + u_Push.DestinationSize - 1) / u_Push.DestinationSize;
+
+    float depth = 0.0;
+    for (int y = begin.y; y < end.y; y++)
+        for (int x = begin.x; x < end.x; x++)
+            depth = max(depth, texelFetch(u_Source, ivec2(x, y), 0).r);
+
+    imageStore(u_Destination, texel, vec4(depth));
+}
@@ -0,0 +1,51 @@
+// indirect.vert
+#version 460 core
+
+layout(location = 0) in vec3 a_Position;
+layout(location = 1) in vec3 a_Normal;
+layout(location = 2) in vec2 a_UV;
+
+layout(location = 1) out vec3 out_normal;
+layout(location = 2) out vec2 out_uv;
+layout(location = 3) flat out int out_texIndex;
+
+layout(set = 1, binding = 0) uniform CameraUBO {
+    mat4 ViewProjection;
+} u_Camera;
+
+// Renderer::ModelDrawData, one entry per draw
+struct DrawData {
+    uint  TransformIndex;
+    int   TexIndex;
+};
+
+// Renderer::ModelTransform, one entry per visible model, computed by the scene graph
+struct Transform {
+    mat4 World;
+    vec4 Normal[3];   // inverse transpose of World's upper 3x3, by column
+};
+
+layout(std430, set = 2, binding = 0) readonly buffer DrawBuffer {
+    DrawData u_Draws[];
+};
+
+layout(std430, set = 2, binding = 1) readonly buffer TransformBuffer {
+    Transform u_Transforms[];
+};
+
+void main()
+{
+    // firstInstance is the draw's slot in u_Draws; draws of the same range merged
+    // into one instanced draw have consecutive slots
+    DrawData draw = u_Draws[gl_InstanceIndex];
+    Transform transform = u_Transforms[draw.TransformIndex];
+
+    mat3 nMat        = mat3(transform.Normal[0].xyz, transform.Normal[1].xyz, transform.Normal[2].xyz);
+    vec4 worldPos    = transform.World * vec4(a_Position, 1.0);
+
+    gl_Position = u_Camera.ViewProjection * worldPos;
+
+    out_normal    = normalize(nMat * a_Normal);
+    out_uv        = a_UV;
+    out_texIndex  = draw.TexIndex;
+}
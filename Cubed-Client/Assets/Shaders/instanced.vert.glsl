@@ -0,0 +1,31 @@
+// instanced.vert
+#version 460 core
+
+layout(location = 0) in vec3 a_Position;
+layout(location = 1) in vec3 a_Normal;
+layout(location = 2) in vec2 a_UV;
+
+// Per-instance, see Renderer::InstanceData
+layout(location = 3) in mat4 i_Transform;   // locations 3-6
+layout(location = 7) in uint i_TexIndex;
+
+layout(location = 1) out vec3 out_normal;
+layout(location = 2) out vec2 out_uv;
+layout(location = 3) flat out int out_texIndex;
+
+layout(set = 1, binding = 0) uniform CameraUBO {
+    mat4 ViewProjection;
+} u_Camera;
+
+void main()
+{
+    gl_Position = u_Camera.ViewProjection * i_Transform * vec4(a_Position, 1.0);
+
+    // Inverse transpose up to scale, see basic.vert
+    mat3 m    = mat3(i_Transform);
+    mat3 nMat = mat3(cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]));
+    nMat     *= sign(dot(m[0], nMat[0]));
+    out_normal    = normalize(nMat * a_Normal);
+    out_uv        = a_UV;
+    out_texIndex  = int(i_TexIndex);
+}
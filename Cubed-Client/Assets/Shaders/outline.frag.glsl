@@ -0,0 +1,11 @@
+// outline.frag
+#version 460 core
+
+layout(location = 0) out vec4 out_color;
+
+// Outline hulls are drawn with front faces culled, so only their back faces
+// show around the silhouette of the mesh they enclose
+void main()
+{
+    out_color = vec4(0.0, 0.0, 0.0, 1.0);
+}
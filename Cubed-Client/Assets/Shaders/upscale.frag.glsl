@@ -0,0 +1,19 @@
+// upscale.frag
+#version 460 core
+
+layout(location = 0) in vec2 in_uv;
+
+layout(location = 0) out vec4 out_color;
+
+// The scene image is as big as the output, only its top-left corner was rendered
+layout(set = 0, binding = 0) uniform sampler2D u_Scene;
+
+layout(push_constant) uniform PushConstants {
+    vec2 UVScale;   // rendered size / image size
+    vec2 UVMax;     // half a texel inside the rendered area, so the filter never reads past it
+} u_Push;
+
+void main()
+{
+    out_color = texture(u_Scene, min(in_uv * u_Push.UVScale, u_Push.UVMax));
+}
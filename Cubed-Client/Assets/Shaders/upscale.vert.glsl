@@ -0,0 +1,13 @@
+// upscale.vert
+#version 460 core
+
+layout(location = 0) out vec2 out_uv;
+
+// One triangle covering the output, no vertex buffer: vertices 0, 1, 2 land
+// on (0, 0), (2, 0) and (0, 2) in uv
+void main()
+{
+    vec2 uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    out_uv = uv;
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,29 @@
+// voxel.frag
+#version 460 core
+
+layout(location = 1) in vec3 in_normal;
+layout(location = 2) in vec2 in_uv;
+layout(location = 3) flat in uint in_layer;
+layout(location = 4) in vec2 in_light;
+
+layout(location = 0) out vec4 out_color;
+
+// One layer per block type, see Renderer::CreateBlockTextures. The layer may
+// differ within a draw, unlike an index into an array of samplers.
+layout(set = 2, binding = 0) uniform sampler2DArray u_BlockTextures;
+
+const vec3 lightDir = normalize(vec3(0.5, 1.0, 1.0));
+
+void main()
+{
+    vec3 N = normalize(in_normal);
+
+    // Each light level is 80% as bright as the one above it
+    float level = max(in_light.x, in_light.y) * 15.0;
+    float light = max(pow(0.8, 15.0 - level), 0.05);
+
+    float intensity = max(dot(N, lightDir), 0.35) * light;
+    vec4 tex = texture(u_BlockTextures, vec3(in_uv, float(in_layer)));
+
+    out_color = vec4(tex.rgb * intensity, tex.a);
+}
@@ -0,0 +1,46 @@
+// voxel.vert
+#version 460 core
+
+// See ChunkVertex in ChunkMesher.h for the layout
+layout(location = 0) in uvec2 a_Packed;
+
+layout(location = 1) out vec3 out_normal;
+layout(location = 2) out vec2 out_uv;
+layout(location = 3) flat out uint out_layer;
+layout(location = 4) out vec2 out_light;
+
+layout(set = 1, binding = 0) uniform CameraUBO {
+    mat4 ViewProjection;
+} u_Camera;
+
+layout(push_constant) uniform PushConstants {
+    vec4 ChunkOrigin;   // world-space position of the chunk's (0, 0, 0) block
+} u_Push;
+
+// Same face order as kFaces in ChunkMesher.cpp
+const vec3 c_Normals[6] = vec3[6](
+    vec3( 1.0,  0.0,  0.0), vec3(-1.0,  0.0,  0.0),
+    vec3( 0.0,  1.0,  0.0), vec3( 0.0, -1.0,  0.0),
+    vec3( 0.0,  0.0,  1.0), vec3( 0.0,  0.0, -1.0)
+);
+
+const vec2 c_CornerUVs[4] = vec2[4](
+    vec2(0.0, 1.0), vec2(1.0, 1.0), vec2(1.0, 0.0), vec2(0.0, 0.0)
+);
+
+void main()
+{
+    uint position = a_Packed.x;
+    uint attributes = a_Packed.y;
+
+    vec3 local = vec3(float(position & 31u), float((position >> 5) & 255u), float((position >> 13) & 31u));
+    uint face = (position >> 18) & 7u;
+    uint corner = (position >> 21) & 3u;
+
+    gl_Position = u_Camera.ViewProjection * vec4(u_Push.ChunkOrigin.xyz + local, 1.0);
+
+    out_normal   = c_Normals[face];
+    out_uv       = c_CornerUVs[corner];
+    out_layer    = attributes & 0xfffu;
+    out_light    = vec2(float((attributes >> 12) & 15u), float((attributes >> 16) & 15u)) / 15.0;
+}
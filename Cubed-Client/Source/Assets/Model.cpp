@@ -1,6 +1,5 @@
 ﻿#include "Model.h"
 
-#include "Walnut/Application.h"
 #include "Walnut/Core/Log.h"
 
 #include <algorithm>
@@ -17,6 +16,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/component_wise.hpp>
 
+#include "../Renderer/GeometryPool.h"
+#include "../Renderer/MeshSimplifier.h"
+
 // If you have stb in Walnut vendor (same as Renderer used), include the writer:
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image_write.h>
@@ -31,6 +33,13 @@ namespace Cubed
     // Toggle dumping embedded textures for debugging
     static constexpr bool kDumpEmbeddedTextures = true;
 
+    // Levels of detail built at import, as fractions of the full triangle count.
+    // Each level is simplified from the full mesh, not the one before it.
+    static constexpr float kLodRatios[] = { 0.5f, 0.25f, 0.125f, 0.0625f };
+    static_assert(std::size(kLodRatios) < MaxMeshLods);
+    static constexpr uint32_t kLodMinTriangles = 512;   // smaller meshes keep just the one level
+    static constexpr float kLodMaxError = 0.05f;        // surface deviation, relative to the mesh extent
+
     static std::filesystem::path GetTempDir()
     {
 #if defined(_WIN32)
@@ -176,31 +185,6 @@ namespace Cubed
         return TextureManager::GetDefaultChecker();
     }
 
-    // Host-visible buffer creation (mirrors your Renderer utility)
-    static void CreateOrResizeBuffer(Buffer& buffer, uint64_t newSize)
-    {
-        VkDevice device = GetVulkanInfo()->Device;
-        if (buffer.Handle)  vkDestroyBuffer(device, buffer.Handle, nullptr);
-        if (buffer.Memory)  vkFreeMemory(device, buffer.Memory, nullptr);
-
-        VkBufferCreateInfo bi{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-        bi.size = newSize;
-        bi.usage = buffer.Usage;
-        bi.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        VK_CHECK(vkCreateBuffer(device, &bi, nullptr, &buffer.Handle));
-
-        VkMemoryRequirements req{};
-        vkGetBufferMemoryRequirements(device, buffer.Handle, &req);
-
-        VkMemoryAllocateInfo mai{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
-        mai.allocationSize = req.size;
-        mai.memoryTypeIndex = GetVulkanMemoryType(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, req.memoryTypeBits);
-        VK_CHECK(vkAllocateMemory(device, &mai, nullptr, &buffer.Memory));
-        VK_CHECK(vkBindBufferMemory(device, buffer.Handle, buffer.Memory, 0));
-
-        buffer.Size = req.size;
-    }
-
 } // namespace Cubed
 
 // ---------------------------------------------
@@ -210,6 +194,14 @@ namespace Cubed
     Model::Model(const std::filesystem::path& path)
     {
         LoadModel(path);
+        m_Node = SceneGraph::GetModelScene().Create();
+    }
+
+    Model::~Model()
+    {
+        // Both the geometry and the textures are freed once the frames in flight are done
+        DestroyGPU();
+        SceneGraph::GetModelScene().Destroy(m_Node);
     }
 
     void Model::LoadModel(const std::filesystem::path& path)
@@ -254,6 +246,13 @@ namespace Cubed
         m_Meshes.clear();
         processNode(scene->mRootNode, scene, glm::mat4(1.0f));
 
+        m_Bounds = {};
+        for (size_t i = 0; i < m_Meshes.size(); ++i)
+        {
+            if (i == 0) m_Bounds = m_Meshes[i].LocalBounds;
+            else        m_Bounds.Merge(m_Meshes[i].LocalBounds);
+        }
+
         // Optional summary
         WL_INFO("[Model Info] Mesh count: {}", (int)m_Meshes.size());
         for (size_t i = 0; i < m_Meshes.size(); ++i)
@@ -266,39 +265,37 @@ namespace Cubed
     // Uniform scale so that the model’s largest dimension = meters.
     void Model::SetSizeMeters(float meters)
     {
-        glm::vec3 minBounds(FLT_MAX);
-        glm::vec3 maxBounds(-FLT_MAX);
-
-        for (const auto& mesh : m_Meshes)
-        {
-            for (const auto& v : mesh.Vertices)
-            {
-                minBounds = glm::min(minBounds, v.Position);
-                maxBounds = glm::max(maxBounds, v.Position);
-            }
-        }
-
-        glm::vec3 size = maxBounds - minBounds;
+        glm::vec3 size = m_Bounds.Max - m_Bounds.Min;
         float maxDim = glm::compMax(size);
         if (maxDim <= 1e-6f) return;
 
-        float s = meters / maxDim;
-
-        // preserve current rotation/translation; replace scale
-        // Decompose current transform roughly: we’ll just rebuild as S * R * T with same R,T.
-        // Since we don’t store R/T separately, simplest is: new = scale * old (uniform scale ok).
-        m_Transform = glm::scale(glm::mat4(1.0f), glm::vec3(s)) * m_Transform;
+        SceneGraph::GetModelScene().SetScale(m_Node, glm::vec3(meters / maxDim));
     }
 
     void Model::SetRotation(float degrees, const glm::vec3& axis)
     {
-        m_Transform = glm::rotate(glm::mat4(1.0f), glm::radians(degrees), axis) * m_Transform;
+        SceneGraph& scene = SceneGraph::GetModelScene();
+        scene.SetRotation(m_Node, glm::angleAxis(glm::radians(degrees), glm::normalize(axis)) * scene.GetRotation(m_Node));
+    }
+
+    void Model::SetRotation(const glm::quat& rotation)
+    {
+        SceneGraph::GetModelScene().SetRotation(m_Node, rotation);
     }
 
     void Model::SetPosition(const glm::vec3& position)
     {
-        // Keep current rotation/scale, just set translation column
-        m_Transform[3] = glm::vec4(position, 1.0f);
+        SceneGraph::GetModelScene().SetTranslation(m_Node, position);
+    }
+
+    void Model::SetParent(const Model* parent)
+    {
+        SceneGraph::GetModelScene().SetParent(m_Node, parent ? parent->m_Node : InvalidSceneNode);
+    }
+
+    const glm::mat4& Model::GetWorldTransform() const
+    {
+        return SceneGraph::GetModelScene().GetWorldMatrix(m_Node);
     }
 
     void Model::ProcessMesh(aiMesh* mesh,
@@ -365,6 +362,28 @@ namespace Cubed
                 indices.push_back(f.mIndices[j]);
         }
 
+        // ---- levels of detail, appended after the full-resolution indices ----
+        const uint32_t fullIndexCount = (uint32_t)indices.size();
+        std::vector<MeshLod> lods{ MeshLod{ 0, fullIndexCount, 0.0f } };
+        if (fullIndexCount / 3 >= kLodMinTriangles)
+        {
+            for (float ratio : kLodRatios)
+            {
+                const size_t target = (size_t)(fullIndexCount / 3 * ratio) * 3;
+                SimplifyResult lod = SimplifyMesh(&vertices.data()->Position, sizeof(Vertex), vertices.size(),
+                    indices.data(), fullIndexCount, target, kLodMaxError);
+
+                // Locked borders/seams or the error limit stopped it short of a worthwhile step
+                if (lod.Indices.size() > lods.back().IndexCount * 3 / 4)
+                    break;
+
+                lods.push_back({ (uint32_t)indices.size(), (uint32_t)lod.Indices.size(), lod.Error });
+                indices.insert(indices.end(), lod.Indices.begin(), lod.Indices.end());
+            }
+        }
+        WL_INFO("[model] Mesh '{}' has {} LODs, {} -> {} triangles", mesh->mName.C_Str(), lods.size(),
+            fullIndexCount / 3, lods.back().IndexCount / 3);
+
         // ---- texture resolve (base/diffuse first, then fallbacks) ----
         uint32_t texIndex = TextureManager::GetDefaultChecker();
 
@@ -416,32 +435,15 @@ namespace Cubed
         // ---- pack mesh ----
         Mesh out{};
         out.Name = mesh->mName.C_Str();
-        out.IndexCount = (uint32_t)indices.size();
+        out.IsOutline = out.Name.find("outline") != std::string::npos;
+        out.IndexCount = fullIndexCount;
+        out.Lods = std::move(lods);
         out.TextureIndex = texIndex;
-        out.Vertices = vertices; // keep CPU copy for bounds/meters
-
-        // ---- GPU buffers ----
-        out.VertexBuffer.Usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-        CreateOrResizeBuffer(out.VertexBuffer, vertices.size() * sizeof(Vertex));
+        out.LocalBounds = Bounds::FromPoints(&vertices.data()->Position, vertices.size(), sizeof(Vertex));
 
-        out.IndexBuffer.Usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-        CreateOrResizeBuffer(out.IndexBuffer, indices.size() * sizeof(uint32_t));
-
-        // Upload data
-        {
-            void* vbMem = nullptr;
-            vkMapMemory(GetVulkanInfo()->Device, out.VertexBuffer.Memory, 0,
-                vertices.size() * sizeof(Vertex), 0, &vbMem);
-            std::memcpy(vbMem, vertices.data(), vertices.size() * sizeof(Vertex));
-            vkUnmapMemory(GetVulkanInfo()->Device, out.VertexBuffer.Memory);
-        }
-        {
-            void* ibMem = nullptr;
-            vkMapMemory(GetVulkanInfo()->Device, out.IndexBuffer.Memory, 0,
-                indices.size() * sizeof(uint32_t), 0, &ibMem);
-            std::memcpy(ibMem, indices.data(), indices.size() * sizeof(uint32_t));
-            vkUnmapMemory(GetVulkanInfo()->Device, out.IndexBuffer.Memory);
-        }
+        // ---- GPU upload (sub-allocated in the shared model pool) ----
+        out.Geometry = GeometryPool::GetModelPool().Allocate(vertices.data(), (uint32_t)vertices.size(),
+            indices.data(), (uint32_t)indices.size());
 
         m_Meshes.push_back(std::move(out));
     }
@@ -467,13 +469,11 @@ namespace Cubed
 
     void Model::DestroyGPU()
     {
-        VkDevice device = GetVulkanInfo()->Device;
+        // Textures are loaded per model; the shared defaults are never freed
         for (auto& m : m_Meshes)
         {
-            if (m.VertexBuffer.Handle) vkDestroyBuffer(device, m.VertexBuffer.Handle, nullptr);
-            if (m.VertexBuffer.Memory) vkFreeMemory(device, m.VertexBuffer.Memory, nullptr);
-            if (m.IndexBuffer.Handle)  vkDestroyBuffer(device, m.IndexBuffer.Handle, nullptr);
-            if (m.IndexBuffer.Memory)  vkFreeMemory(device, m.IndexBuffer.Memory, nullptr);
+            GeometryPool::GetModelPool().Free(m.Geometry);
+            TextureManager::Free(m.TextureIndex);
         }
         m_Meshes.clear();
     }
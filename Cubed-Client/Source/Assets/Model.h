@@ -12,13 +12,16 @@
 #include <glm/glm.hpp>
 
 #include "../Renderer/Vulkan.h"                 // Buffer, GetVulkanInfo(), GetVulkanMemoryType(...)
+#include "../Renderer/GpuAllocator.h"
+#include "../Renderer/Frustum.h"
+#include "../Renderer/SceneGraph.h"
 #include "../Assets/TextureManager.h"
 
 namespace Cubed {
 
     struct Buffer {
         VkBuffer       Handle = nullptr;
-        VkDeviceMemory Memory = nullptr;
+        GpuAllocation  Memory;
         VkDeviceSize   Size = 0;
         VkBufferUsageFlagBits Usage = VK_BUFFER_USAGE_FLAG_BITS_MAX_ENUM;
 	};
@@ -29,30 +32,48 @@ namespace Cubed {
         glm::vec2 UV{};
     };
 
-    struct Mesh {
-        Buffer   VertexBuffer{};
-        Buffer   IndexBuffer{};
+    constexpr uint32_t MaxMeshLods = 5;   // full resolution and up to four simplified levels
+
+    // One level of detail: a range of the mesh's indices over the shared vertices
+    struct MeshLod {
+        uint32_t FirstIndex = 0;   // relative to the geometry's own first index
         uint32_t IndexCount = 0;
+        float Error = 0.0f;        // simplification error, relative to the mesh extent
+    };
+
+    struct Mesh {
+        uint32_t Geometry = UINT32_MAX; // handle into GeometryPool::GetModelPool()
+        uint32_t IndexCount = 0;   // full resolution, Lods[0]
+        std::vector<MeshLod> Lods; // generated at import, each about half the triangles of the last
         uint32_t TextureIndex = 0; // index into TextureManager array
+        Bounds LocalBounds;        // model space, computed at import
+        bool IsOutline = false;    // name contains "outline"
 		std::string Name; // Optional name for the mesh, useful for debugging
-
-        std::vector<Vertex> Vertices;
     };
 
     class Model {
     public:
         explicit Model(const std::filesystem::path& path);
-        ~Model() = default;
+        ~Model();
+
+        Model(const Model&) = delete;
+        Model& operator=(const Model&) = delete;
 
         void UploadToGPU();   // (no-op; kept for API parity)
         void DestroyGPU();
 
         const std::vector<Mesh>& GetMeshes() const { return m_Meshes; }
+        const Bounds& GetBounds() const { return m_Bounds; }   // union of the mesh bounds
+
+        // The transform lives in SceneGraph::GetModelScene(), relative to the parent model if any
+        SceneNode GetNode() const { return m_Node; }
+        void SetParent(const Model* parent);
+        // As of the scene's last Update(), which Renderer::RenderModels runs
+        const glm::mat4& GetWorldTransform() const;
 
-        const glm::mat4& GetTransform() const { return m_Transform; }
-        void SetTransform(const glm::mat4& t) { m_Transform = t; }
-        void SetSizeMeters(float meters);
-        void SetRotation(float degrees, const glm::vec3& axis);
+        void SetSizeMeters(float meters);                         // replaces the scale
+        void SetRotation(float degrees, const glm::vec3& axis);   // on top of the current rotation
+        void SetRotation(const glm::quat& rotation);
         void SetPosition(const glm::vec3& position);
 		void SetID(uint32_t id) { m_ID = id; }
 		uint32_t GetID() const { return m_ID; }
@@ -69,7 +90,8 @@ namespace Cubed {
     private:
         uint32_t m_ID;
         std::vector<Mesh> m_Meshes;
-        glm::mat4         m_Transform{ 1.0f };
+        Bounds            m_Bounds;
+        SceneNode         m_Node = InvalidSceneNode;
     };
 
 } // namespace Cubed
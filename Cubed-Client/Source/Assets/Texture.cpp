@@ -1,31 +1,32 @@
 #include "Texture.h"
-#include "Walnut/Application.h"
+#include "../Renderer/DeletionQueue.h"
+#include "Walnut/Core/Log.h"
+
+#include <cstring>
 
 namespace Cubed {
 
-	Texture::Texture(uint32_t width, uint32_t height, Walnut::Buffer data) : m_Width(width), m_Height(height)
+	Texture::Texture(uint32_t width, uint32_t height, Walnut::Buffer data, uint32_t layers) : m_Width(width), m_Height(height), m_Layers(layers)
 	{
 		Init(data);
 	}
 
 	Texture::~Texture()
 	{
-		VkDevice device = Walnut::Application::GetDevice();
-
-		vkDestroySampler(device, m_Sampler, nullptr);
-		vkDestroyImageView(device, m_ImageView, nullptr);
-		vkDestroyImage(device, m_Image, nullptr);
-		vkFreeMemory(device, m_Memory, nullptr);
+		// Frames in flight may still be sampling it
+		DeletionQueue::ReleaseSampler(m_Sampler);
+		DeletionQueue::ReleaseImageView(m_ImageView);
+		DeletionQueue::ReleaseImage(m_Image, m_Memory);
 	}
 
 	void Texture::Init(Walnut::Buffer data)
 	{
 		VkDevice device = GetVulkanInfo()->Device;
 
-		size_t size = m_Width * m_Height * 4;
+		size_t size = (size_t)m_Width * m_Height * m_Layers * 4;
 		if (size != data.Size)
 		{
-			__debugbreak();
+			WL_ERROR_TAG("Texture", "{}x{}x{} texture given {} bytes of pixels", m_Width, m_Height, m_Layers, data.Size);
 			return;
 		}
 
@@ -39,7 +40,7 @@ namespace Cubed {
 			info.extent.height = m_Height;
 			info.extent.depth = 1;
 			info.mipLevels = 1;
-			info.arrayLayers = 1;
+			info.arrayLayers = m_Layers;
 			info.samples = VK_SAMPLE_COUNT_1_BIT;
 			info.tiling = VK_IMAGE_TILING_OPTIMAL;
 			info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
@@ -47,14 +48,7 @@ namespace Cubed {
 			info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 			VK_CHECK(vkCreateImage(device, &info, nullptr, &m_Image));
 
-			VkMemoryRequirements req;
-			vkGetImageMemoryRequirements(device, m_Image, &req);
-			VkMemoryAllocateInfo alloc_info = {};
-			alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-			alloc_info.allocationSize = req.size;
-			alloc_info.memoryTypeIndex = GetVulkanMemoryType(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, req.memoryTypeBits);
-			VK_CHECK(vkAllocateMemory(device, &alloc_info, nullptr, &m_Memory));
-			VK_CHECK(vkBindImageMemory(device, m_Image, m_Memory, 0));
+			m_Memory = GpuAllocator::AllocateImage(m_Image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 		}
 
 		// Create the Image View:
@@ -62,16 +56,16 @@ namespace Cubed {
 			VkImageViewCreateInfo info = {};
 			info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 			info.image = m_Image;
-			info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			info.viewType = m_Layers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
 			info.format = VK_FORMAT_R8G8B8A8_UNORM;
 			info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			info.subresourceRange.levelCount = 1;
-			info.subresourceRange.layerCount = 1;
+			info.subresourceRange.layerCount = m_Layers;
 			VK_CHECK(vkCreateImageView(device, &info, nullptr, &m_ImageView));
 		}
 
 		VkBuffer stagingBuffer = nullptr;
-		VkDeviceMemory stagingBufferMemory = nullptr;
+		GpuAllocation stagingBufferMemory;
 
 		// Create the Upload Buffer:
 		{
@@ -81,31 +75,16 @@ namespace Cubed {
 			buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
 			buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 			VK_CHECK(vkCreateBuffer(device, &buffer_info, nullptr, &stagingBuffer));
-			VkMemoryRequirements req;
-			vkGetBufferMemoryRequirements(device, stagingBuffer, &req);
-			// bd->BufferMemoryAlignment = (bd->BufferMemoryAlignment > req.alignment) ? bd->BufferMemoryAlignment : req.alignment;
-			VkMemoryAllocateInfo alloc_info = {};
-			alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-			alloc_info.allocationSize = req.size;
-			alloc_info.memoryTypeIndex = GetVulkanMemoryType(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, req.memoryTypeBits);
-			VK_CHECK(vkAllocateMemory(device, &alloc_info, nullptr, &stagingBufferMemory));
-			VK_CHECK(vkBindBufferMemory(device, stagingBuffer, stagingBufferMemory, 0));
+			stagingBufferMemory = GpuAllocator::AllocateBuffer(stagingBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
 		}
 
 		// Upload to Buffer:
 		{
-			uint8_t* map = NULL;
-			VK_CHECK(vkMapMemory(device, stagingBufferMemory, 0, size, 0, (void**)(&map)));
-			memcpy(map, data.Data, size);
-			VkMappedMemoryRange range[1] = {};
-			range[0].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-			range[0].memory = stagingBufferMemory;
-			range[0].size = size;
-			VK_CHECK(vkFlushMappedMemoryRanges(device, 1, range));
-			vkUnmapMemory(device, stagingBufferMemory);
+			memcpy(stagingBufferMemory.Mapped, data.Data, size);
+			GpuAllocator::Flush(stagingBufferMemory, 0, size);
 		}
 
-		VkCommandBuffer commandBuffer = Walnut::Application::GetCommandBuffer(true);
+		VkCommandBuffer commandBuffer = GetCommandBuffer();
 
 		// Copy to Image:
 		{
@@ -119,12 +98,12 @@ namespace Cubed {
 			copy_barrier[0].image = m_Image;
 			copy_barrier[0].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			copy_barrier[0].subresourceRange.levelCount = 1;
-			copy_barrier[0].subresourceRange.layerCount = 1;
+			copy_barrier[0].subresourceRange.layerCount = m_Layers;
 			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, copy_barrier);
 
 			VkBufferImageCopy region = {};
 			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			region.imageSubresource.layerCount = 1;
+			region.imageSubresource.layerCount = m_Layers;
 			region.imageExtent.width = m_Width;
 			region.imageExtent.height = m_Height;
 			region.imageExtent.depth = 1;
@@ -141,14 +120,14 @@ namespace Cubed {
 			use_barrier[0].image = m_Image;
 			use_barrier[0].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			use_barrier[0].subresourceRange.levelCount = 1;
-			use_barrier[0].subresourceRange.layerCount = 1;
+			use_barrier[0].subresourceRange.layerCount = m_Layers;
 			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, use_barrier);
 		}
 
-		Walnut::Application::FlushCommandBuffer(commandBuffer);
+		FlushCommandBuffer(commandBuffer);
 
 		vkDestroyBuffer(device, stagingBuffer, nullptr);
-		vkFreeMemory(device, stagingBufferMemory, nullptr);
+		GpuAllocator::Free(stagingBufferMemory);
 
 		//sampler
 		VkSamplerCreateInfo info = {};
@@ -1,13 +1,15 @@
 #pragma once
 
 #include "Walnut/Core/Buffer.h"
-#include "../Renderer/Vulkan.h"
+#include "../Renderer/GpuAllocator.h"
 
 namespace Cubed {
 
 	class Texture {
 	public:
-		Texture(uint32_t width, uint32_t height, Walnut::Buffer data);
+		// More than one layer makes a 2D array texture (a sampler2DArray), data
+		// holding the layers one after another
+		Texture(uint32_t width, uint32_t height, Walnut::Buffer data, uint32_t layers = 1);
 		~Texture();
 
 		const VkDescriptorImageInfo& GetImageInfo() const { return m_ImageInfo; }
@@ -16,9 +18,10 @@ namespace Cubed {
 	private:
 		uint32_t m_Width = 0;
 		uint32_t m_Height = 0;
+		uint32_t m_Layers = 1;
 
 		VkImage m_Image = nullptr;
-		VkDeviceMemory m_Memory = nullptr;
+		GpuAllocation m_Memory;
 		VkImageView m_ImageView = nullptr;
 		VkSampler m_Sampler = nullptr;
 
@@ -1,10 +1,13 @@
 #include "TextureManager.h"
+#include "../Renderer/TextureTable.h"
 #include "../../../Walnut/vendor/stb_image/stb_image.h"
 
 namespace Cubed {
 
 	std::unordered_map<uint32_t, std::shared_ptr<Cubed::Texture>> TextureManager::m_TextureCache;
 	uint32_t TextureManager::m_NextTextureID = 0;
+	std::vector<uint32_t> TextureManager::s_FreeTextureIDs;
+	TextureTable* TextureManager::s_TextureTable = nullptr;
 	uint32_t TextureManager::s_DefaultWhite = 0xffffffffu;
 	uint32_t TextureManager::s_DefaultChecker = 0xffffffffu;
 
@@ -14,27 +17,37 @@ namespace Cubed {
 
 		// 1x1 white
 		uint8_t wpx[4] = { 255,255,255,255 };
-		auto white = std::make_shared<Texture>(1, 1, Walnut::Buffer(wpx, 4));
-		s_DefaultWhite = m_NextTextureID++;
-		m_TextureCache[s_DefaultWhite] = white;
+		s_DefaultWhite = Add(std::make_shared<Texture>(1, 1, Walnut::Buffer(wpx, 4)));
 
 		// 2x2 checker (black/gray)
 		uint8_t chk[16] = {
 			30,30,30,255,  180,180,180,255,
 			180,180,180,255, 30,30,30,255
 		};
-		auto checker = std::make_shared<Texture>(2, 2, Walnut::Buffer(chk, 16));
-		s_DefaultChecker = m_NextTextureID++;
-		m_TextureCache[s_DefaultChecker] = checker;
+		s_DefaultChecker = Add(std::make_shared<Texture>(2, 2, Walnut::Buffer(chk, 16)));
+	}
+
+	uint32_t TextureManager::Add(std::shared_ptr<Cubed::Texture> texture)
+	{
+		uint32_t id;
+		if (!s_FreeTextureIDs.empty()) {
+			id = s_FreeTextureIDs.back();
+			s_FreeTextureIDs.pop_back();
+		}
+		else {
+			id = m_NextTextureID++;
+		}
+
+		if (s_TextureTable)
+			s_TextureTable->Write(id, texture->GetImageInfo());
+		m_TextureCache[id] = std::move(texture);
+		return id;
 	}
 
 	uint32_t TextureManager::CreateSolid(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
 		EnsureDefaults();
 		uint8_t px[4] = { r,g,b,a };
-		auto tex = std::make_shared<Texture>(1, 1, Walnut::Buffer(px, 4));
-		uint32_t id = m_NextTextureID++;
-		m_TextureCache[id] = tex;
-		return id;
+		return Add(std::make_shared<Texture>(1, 1, Walnut::Buffer(px, 4)));
 	}
 
 	uint32_t TextureManager::GetDefaultWhite() { EnsureDefaults(); return s_DefaultWhite; }
@@ -42,10 +55,7 @@ namespace Cubed {
 
 	uint32_t TextureManager::CreateFromRawRGBA(int width, int height, const void* rgba) {
 		// Directly create a Texture from raw RGBA8 pixels (no stbi)
-		auto tex = std::make_shared<Texture>(width, height, Walnut::Buffer((void*)rgba, (size_t)width * height * 4));
-		uint32_t id = m_NextTextureID++;
-		m_TextureCache[id] = tex;
-		return id;
+		return Add(std::make_shared<Texture>(width, height, Walnut::Buffer((void*)rgba, (size_t)width * height * 4)));
 	}
 
 	uint32_t TextureManager::LoadTexture(const std::filesystem::path& path)
@@ -64,10 +74,7 @@ namespace Cubed {
 
 		stbi_image_free(pixels);
 
-		uint32_t textureID = m_NextTextureID++;
-		m_TextureCache[textureID] = texture;
-
-		return textureID;
+		return Add(std::move(texture));
 	}
 
 	uint32_t TextureManager::LoadTextureFromMemory(const void* data, size_t sizeBytes) {
@@ -76,9 +83,7 @@ namespace Cubed {
 		if (!pixels) throw std::runtime_error("Failed to load texture from memory");
 		auto tex = std::make_shared<Texture>(w, h, Walnut::Buffer(pixels, (size_t)w * h * 4));
 		stbi_image_free(pixels);
-		uint32_t id = m_NextTextureID++;
-		m_TextureCache[id] = tex;
-		return id;
+		return Add(std::move(tex));
 	}
 
 	std::shared_ptr<Cubed::Texture> TextureManager::GetTexture(uint32_t textureID)
@@ -86,6 +91,33 @@ namespace Cubed {
 		return m_TextureCache.at(textureID);
 	}
 
+	void TextureManager::Free(uint32_t textureID)
+	{
+		auto it = m_TextureCache.find(textureID);
+		if (it == m_TextureCache.end() || textureID == s_DefaultWhite || textureID == s_DefaultChecker)
+			return;
+
+		// The texture defers its own destruction; frames in flight may still
+		// sample it through its slot, so the slot is only reused after them
+		m_TextureCache.erase(it);
+		SubmitResourceFree([textureID]()
+		{
+			if (s_TextureTable)
+				s_TextureTable->Remove(textureID);
+			s_FreeTextureIDs.push_back(textureID);
+		});
+	}
+
+	void TextureManager::SetTextureTable(TextureTable* table)
+	{
+		s_TextureTable = table;
+		if (!table)
+			return;
+
+		for (const auto& [id, texture] : m_TextureCache)
+			table->Write(id, texture->GetImageInfo());
+	}
+
 	void TextureManager::ClearCache()
 	{
 		m_TextureCache.clear();  // This will reduce the reference count to zero for all textures.
@@ -2,10 +2,14 @@
 #include <filesystem>
 #include <unordered_map>
 #include <memory>
+#include <vector>
 #include "Texture.h"
 
 
 namespace Cubed {
+	class TextureTable;
+
+	// Texture IDs double as slots in the renderer's TextureTable, freed IDs are reused
 	class TextureManager {
     public:
         static uint32_t LoadTexture(const std::filesystem::path& path);
@@ -19,15 +23,23 @@ namespace Cubed {
 
 
         static std::shared_ptr<Cubed::Texture> GetTexture(uint32_t textureID);
+        // The texture and its ID stay alive until the frames in flight are done with them
+        static void Free(uint32_t textureID);
         static void ClearCache();
 
+        // Writes every texture into the table, and from then on each one as it is added or freed
+        static void SetTextureTable(TextureTable* table);
+
         static size_t Count() {
             return m_TextureCache.size();
 		}
     private:
         static void EnsureDefaults();
+        static uint32_t Add(std::shared_ptr<Cubed::Texture> texture);
         static std::unordered_map<uint32_t, std::shared_ptr<Cubed::Texture>> m_TextureCache;
         static uint32_t m_NextTextureID;
+        static std::vector<uint32_t> s_FreeTextureIDs;
+        static TextureTable* s_TextureTable;
         static uint32_t s_DefaultWhite, s_DefaultChecker;
 	};
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "ClientLayer.h"
 #include "Assets/ModelManager.h"
+#include "Renderer/DeletionQueue.h"
 #include "imgui.h"
 #include "imgui_internal.h"
 #include "misc/cpp/imgui_stdlib.h"
@@ -10,6 +11,7 @@
 
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/euler_angles.hpp"
+#include "glm/gtc/quaternion.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
 #include "ServerPacket.h"
@@ -18,6 +20,10 @@ namespace Cubed {
 
 	Walnut::Buffer s_ScratchBuffer;
 
+	static const glm::vec3 s_PlayerHalfExtents = { 0.45f, 0.45f, 0.45f };
+	static constexpr int s_ChunkRadius = 4;   // matches the chunk cache PinRadius in ClientLayer.h
+	static constexpr int s_MaxChunkMeshesPerFrame = 8;
+
 	static void DrawRect(glm::vec2 position, glm::vec2 size, uint32_t color) {
 		ImDrawList* drawList = ImGui::GetBackgroundDrawList();
 		ImVec2 min = ImGui::GetWindowPos() + ImVec2(position.x, position.y);
@@ -32,6 +38,9 @@ namespace Cubed {
 
 		m_Client.SetDataReceivedCallback([this](const Walnut::Buffer buffer) { OnDataReceived(buffer); });
 
+		m_ChunkCache.SetChunkLoadedCallback([this](ChunkCoord coord) { MarkChunkDirty(coord); });
+		m_ChunkCache.SetChunkEvictedCallback([this](ChunkCoord coord) { m_Renderer.RemoveChunkMesh(coord); });
+
 		m_Renderer.Init();
 		auto cube = ModelManager::Load("C:/Users/Asus/Documents/Projects/Cubed/Cubed-Client/Assets/Models/cube.obj", m_PlayerID);
 		cube->SetSizeMeters(1.0f);
@@ -41,7 +50,6 @@ namespace Cubed {
 		anime->SetSizeMeters(1.6f);
 		m_Renderer.AddModel(anime);
 		m_PlayerModels[m_PlayerID + 1] = anime;
-		m_Renderer.UpdateTextures();
 
 	}
 
@@ -53,6 +61,9 @@ namespace Cubed {
 
 	void ClientLayer::OnUpdate(float ts)
 	{
+		StreamChunks();
+		UpdateChunkMeshes();
+
 		// --- Input ---
 		// Horizontal plane (XZ) from WASD
 		glm::vec2 dirXZ{ 0.0f, 0.0f };
@@ -82,8 +93,19 @@ namespace Cubed {
 		// If you want immediate response to keys, assign directly:
 		m_PlayerVelocity = desiredVel;
 
-		// --- Integrate ---
-		m_PlayerPosition += m_PlayerVelocity * ts;
+		// --- Server placed us, or resolved our last move differently ---
+		m_PlayerDataMutex.lock();
+		if (m_ServerPosition)
+		{
+			m_PlayerPosition = *m_ServerPosition;
+			m_ServerPosition.reset();
+			m_Spawned = true;
+		}
+		m_PlayerDataMutex.unlock();
+
+		// --- Integrate (predicted with the same collision the server resolves) ---
+		if (m_Spawned)
+			m_PlayerPosition = VoxelQuery::MoveAndSlide(m_World, m_PlayerPosition, s_PlayerHalfExtents, m_PlayerVelocity * ts).Position;
 
 		// --- Damping (only when no input) ---
 		if (desiredVel == glm::vec3(0.0f))
@@ -95,20 +117,14 @@ namespace Cubed {
 
 		m_PlayerRotation.y += 20.0f * ts;
 
-		m_PlayerTransform = glm::translate(glm::mat4(1.0f), m_PlayerPosition) *
-			glm::eulerAngleXYZ(glm::radians(m_PlayerRotation.x), glm::radians(m_PlayerRotation.y), glm::radians(m_PlayerRotation.z));
-
-		// --- Networking: keep protocol 2D (XZ) for now ---
-		if (m_Client.GetConnectionStatus() == Walnut::Client::ConnectionStatus::Connected)
+		// --- Networking: server validates the position against its world ---
+		if (m_Spawned && m_Client.GetConnectionStatus() == Walnut::Client::ConnectionStatus::Connected)
 		{
 			Walnut::BufferStreamWriter stream(s_ScratchBuffer);
 			stream.WriteRaw(PacketType::ClientUpdate);
 
-			// Send XZ only (match server/PlayerData)
-			glm::vec2 pos2{ m_PlayerPosition.x, m_PlayerPosition.z };
-			glm::vec2 vel2{ m_PlayerVelocity.x, m_PlayerVelocity.z };
-			stream.WriteRaw<glm::vec2>(pos2);
-			stream.WriteRaw<glm::vec2>(vel2);
+			stream.WriteRaw<glm::vec3>(m_PlayerPosition);
+			stream.WriteRaw<glm::vec3>(m_PlayerVelocity);
 
 			m_Client.SendBuffer(stream.GetBuffer());
 		}
@@ -145,6 +161,127 @@ namespace Cubed {
 		ImGui::DragFloat3("Camera Position", glm::value_ptr(m_Camera.Position), 0.05f);
 		ImGui::DragFloat3("Camera Rotation", glm::value_ptr(m_Camera.Rotation), 0.05f);
 
+		const ChunkCacheStats& cacheStats = m_ChunkCache.GetStats();
+		ImGui::Separator();
+		ImGui::Text("Chunks: %zu resident (%.1f MB), %zu spilled (%.1f KB), %zu on disk",
+			cacheStats.ResidentChunks, cacheStats.ResidentBytes / (1024.0f * 1024.0f),
+			cacheStats.SpilledChunks, cacheStats.SpilledBytes / 1024.0f, cacheStats.DiskChunks);
+		ImGui::Text("Cache: %llu hits, %llu misses, %llu restores, %llu evictions",
+			(unsigned long long)cacheStats.Hits, (unsigned long long)cacheStats.Misses,
+			(unsigned long long)cacheStats.Restores, (unsigned long long)cacheStats.Evictions);
+
+		const Renderer::CullStats& cullStats = m_Renderer.GetCullStats();
+		ImGui::Text("Culling: %u/%u chunks visible (%u culled), %u/%u meshes visible (%u culled)",
+			cullStats.ChunksVisible, cullStats.ChunksTested, cullStats.ChunksTested - cullStats.ChunksVisible,
+			cullStats.MeshesVisible, cullStats.MeshesTested, cullStats.MeshesTested - cullStats.MeshesVisible);
+
+		const SceneGraphStats sceneStats = SceneGraph::GetModelScene().GetStats();
+		ImGui::Text("Scene: %u nodes, %u levels, %u transforms updated",
+			sceneStats.Nodes, sceneStats.Levels, sceneStats.Updated);
+
+		if (m_Renderer.IsOcclusionCullingSupported())
+		{
+			bool occlusionCulling = m_Renderer.IsOcclusionCullingEnabled();
+			if (ImGui::Checkbox("Occlusion culling", &occlusionCulling))
+				m_Renderer.SetOcclusionCulling(occlusionCulling);
+			ImGui::SameLine();
+			const HiZStats hizStats = m_Renderer.GetHiZStats();
+			ImGui::Text("%u chunks, %u meshes occluded (Hi-Z %ux%u, %u levels, %.1f KB read back, %u frames old)",
+				cullStats.ChunksOccluded, cullStats.MeshesOccluded, hizStats.Width, hizStats.Height, hizStats.Levels,
+				hizStats.ReadbackBytes / 1024.0f, hizStats.Age);
+		}
+		else
+		{
+			ImGui::TextDisabled("Occlusion culling: depth format can't be sampled");
+		}
+
+		bool meshLod = m_Renderer.IsMeshLodEnabled();
+		if (ImGui::Checkbox("Mesh LOD", &meshLod))
+			m_Renderer.SetMeshLod(meshLod);
+		ImGui::SameLine();
+		ImGui::Text("%llu/%llu model triangles, meshes per level: %u %u %u %u %u",
+			(unsigned long long)cullStats.ModelTriangles, (unsigned long long)cullStats.ModelTrianglesFull,
+			cullStats.MeshesPerLod[0], cullStats.MeshesPerLod[1], cullStats.MeshesPerLod[2],
+			cullStats.MeshesPerLod[3], cullStats.MeshesPerLod[4]);
+
+		if (m_Renderer.IsDynamicResolutionSupported())
+		{
+			DynamicResolutionSettings resolution = m_Renderer.GetDynamicResolution();
+			bool resolutionChanged = ImGui::Checkbox("Dynamic resolution", &resolution.Enabled);
+			ImGui::SameLine();
+			const DynamicResolutionStats resolutionStats = m_Renderer.GetDynamicResolutionStats();
+			const VkExtent2D renderExtent = m_Renderer.GetRenderExtent();
+			ImGui::Text("%.0f%% (%ux%u), %.2f ms GPU average, %u changes", resolutionStats.Scale * 100.0f,
+				renderExtent.width, renderExtent.height, resolutionStats.AverageFrameMs, resolutionStats.Changes);
+			resolutionChanged |= ImGui::SliderFloat("GPU budget (ms)", &resolution.TargetFrameMs, 4.0f, 50.0f, "%.1f");
+			resolutionChanged |= ImGui::DragFloatRange2("Scale range", &resolution.MinScale, &resolution.MaxScale, 0.01f, 0.25f, 1.0f, "%.2f");
+			if (resolutionChanged)
+				m_Renderer.SetDynamicResolution(resolution);
+		}
+		else
+		{
+			ImGui::TextDisabled("Dynamic resolution: the target format can't be sampled");
+		}
+
+		const RenderQueueStats& queueStats = m_Renderer.GetRenderQueueStats();
+		ImGui::Text("Render queue: %u draws, %u pipeline binds, %u descriptor binds, %u geometry binds",
+			queueStats.Draws, queueStats.PipelineBinds, queueStats.DescriptorBinds, queueStats.GeometryBinds);
+		ImGui::Text("Indirect: %u draw calls, %u direct without multi-draw", queueStats.IndirectCalls, queueStats.DirectCalls);
+
+		bool parallelRecording = m_Renderer.IsParallelRecordingEnabled();
+		if (ImGui::Checkbox("Parallel recording", &parallelRecording))
+			m_Renderer.SetParallelRecording(parallelRecording);
+		ImGui::SameLine();
+		ImGui::Text("%u command buffers, %u threads", queueStats.Batches, m_Renderer.GetRecordingThreadCount());
+
+		const FrameRingStats ringStats = m_Renderer.GetFrameRingStats();
+		ImGui::Text("Frame ring: %.1f/%.1f KB used (peak %.1f KB), %u overflows, %u grows",
+			ringStats.Used / 1024.0f, ringStats.FrameSize / 1024.0f, ringStats.PeakUsed / 1024.0f, ringStats.Overflows, ringStats.Grows);
+
+		bool multiDraw = m_Renderer.IsMultiDrawIndirectEnabled();
+		if (!m_Renderer.IsMultiDrawIndirectSupported())
+			ImGui::TextDisabled("Multi-draw indirect: not enabled on this device");
+		else if (ImGui::Checkbox("Multi-draw indirect", &multiDraw))
+			m_Renderer.SetMultiDrawIndirect(multiDraw);
+
+		const TextureTableStats textureTable = m_Renderer.GetTextureTableStats();
+		ImGui::Text("Texture table: %u/%u slots, %u descriptor writes, %u reallocations, descriptor indexing %s",
+			textureTable.Capacity, textureTable.MaxCapacity, textureTable.Writes, textureTable.Reallocations,
+			textureTable.DescriptorIndexing ? "on" : "off");
+
+		const GeometryPoolStats chunkGeometry = m_Renderer.GetChunkGeometryStats();
+		const GeometryPoolStats modelGeometry = GeometryPool::GetModelPool().GetStats();
+		ImGui::Text("Chunk geometry: %u meshes, %llu/%llu vertices, %llu/%llu indices, %u rebuilds",
+			chunkGeometry.Allocations,
+			(unsigned long long)chunkGeometry.VerticesUsed, (unsigned long long)chunkGeometry.VertexCapacity,
+			(unsigned long long)chunkGeometry.IndicesUsed, (unsigned long long)chunkGeometry.IndexCapacity,
+			chunkGeometry.Rebuilds);
+		ImGui::Text("Model geometry: %u meshes, %llu/%llu vertices, %llu/%llu indices, %u rebuilds",
+			modelGeometry.Allocations,
+			(unsigned long long)modelGeometry.VerticesUsed, (unsigned long long)modelGeometry.VertexCapacity,
+			(unsigned long long)modelGeometry.IndicesUsed, (unsigned long long)modelGeometry.IndexCapacity,
+			modelGeometry.Rebuilds);
+
+		const GpuAllocatorStats gpuMemory = GpuAllocator::GetStats();
+		ImGui::Text("GPU memory: %.1f/%.1f MB in %u blocks, %.1f MB in %u dedicated, %u allocations, %.0f%% fragmented",
+			gpuMemory.UsedBytes / (1024.0f * 1024.0f), gpuMemory.BlockBytes / (1024.0f * 1024.0f), gpuMemory.Blocks,
+			gpuMemory.DedicatedBytes / (1024.0f * 1024.0f), gpuMemory.Dedicated, gpuMemory.Allocations,
+			gpuMemory.Fragmentation * 100.0f);
+		for (const GpuMemoryTypeStats& type : gpuMemory.Types)
+		{
+			ImGui::Text("  type %u%s%s: %.1f/%.1f MB, %u allocations, largest free %.1f MB",
+				type.MemoryType,
+				(type.Flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ? " device" : "",
+				(type.Flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? " host" : "",
+				(type.UsedBytes + type.DedicatedBytes) / (1024.0f * 1024.0f),
+				(type.BlockBytes + type.DedicatedBytes) / (1024.0f * 1024.0f),
+				type.Allocations + type.Dedicated, type.LargestFreeRegion / (1024.0f * 1024.0f));
+		}
+
+		const DeletionQueueStats deletion = DeletionQueue::GetStats();
+		ImGui::Text("Deletion queue: %u objects from %u frames pending, %llu destroyed",
+			deletion.Pending, deletion.PendingFrames, (unsigned long long)deletion.Destroyed);
+
 		ImGui::End();
 
 	}
@@ -172,6 +309,15 @@ namespace Cubed {
 			WL_INFO("We say our ID is {}", m_Client.GetID());
 			m_PlayerID = idFromServer;
 			break;
+		case PacketType::PlayerPosition:
+		{
+			glm::vec3 position;
+			stream.ReadRaw<glm::vec3>(position);
+			m_PlayerDataMutex.lock();
+			m_ServerPosition = position;
+			m_PlayerDataMutex.unlock();
+			break;
+		}
 		case PacketType::ClientDisconnect:
 			uint32_t DisconnectedPlayerID;
 			stream.ReadRaw<uint32_t>(DisconnectedPlayerID);
@@ -189,28 +335,99 @@ namespace Cubed {
 	{
 		m_Renderer.BeginScene(m_Camera);
 
-		m_PlayerModels[m_PlayerID]->SetTransform(m_PlayerTransform);
+		const glm::mat4 rotation = glm::eulerAngleXYZ(glm::radians(m_PlayerRotation.x), glm::radians(m_PlayerRotation.y), glm::radians(m_PlayerRotation.z));
+
+		Model& player = *m_PlayerModels[m_PlayerID];
+		player.SetPosition(m_PlayerPosition);
+		player.SetRotation(glm::quat_cast(rotation));
+
+		m_Renderer.RenderChunks();
 		// Example anchor cube
 		//m_Renderer.RenderCube(glm::vec3(0, 0, -5), m_PlayerRotation, 1);
 
 		// Local player: full 3D
 		//m_Renderer.RenderCube(m_PlayerPosition, m_PlayerRotation, 0)
 
-		// Remote players: map (x, y) -> (x, 0, z)
+		// Remote players, all in one instanced draw
+		m_PlayerInstances.clear();
 		m_PlayerDataMutex.lock();
-		std::map<uint32_t, PlayerData> playerData = m_PlayerData;
-		m_PlayerDataMutex.unlock();
-
-		for (const auto& [id, data] : playerData)
+		for (const auto& [id, data] : m_PlayerData)
 		{
 			if (id == m_PlayerID) continue;
-			glm::vec3 pos3{ data.Position.x, 0.0f, data.Position.y };
-			m_Renderer.RenderCube(pos3, m_PlayerRotation, 0);
+			m_PlayerInstances.push_back({ glm::translate(glm::mat4(1.0f), data.Position) * rotation, 0 });
 		}
+		m_PlayerDataMutex.unlock();
+
+		m_Renderer.RenderCubes(m_PlayerInstances);
 		m_Renderer.RenderModels();
 		m_Renderer.EndScene();
 	}
 
+	void ClientLayer::StreamChunks()
+	{
+		ChunkCoord center = World::ToChunkCoord(m_PlayerPosition);
+		for (int z = -s_ChunkRadius; z <= s_ChunkRadius; ++z)
+		{
+			for (int x = -s_ChunkRadius; x <= s_ChunkRadius; ++x)
+			{
+				ChunkCoord coord{ center.X + x, center.Z + z };
+				if (!m_ChunkCache.Acquire(coord))
+					m_ChunkGenerator.Request(coord);
+			}
+		}
+
+		m_GeneratedChunks.clear();
+		m_ChunkGenerator.Collect(m_GeneratedChunks);
+		for (auto& chunk : m_GeneratedChunks)
+		{
+			ChunkCoord coord = chunk->GetCoord();
+			m_ChunkCache.Insert(std::move(chunk));
+			m_LightEngine.LightChunk(coord);
+		}
+
+		m_ChunkCache.Trim({ m_PlayerPosition });
+
+		// Drop the player onto the terrain once the spawn chunk exists
+		if (!m_Spawned && m_World.HasChunk(center))
+		{
+			int x = (int)std::floor(m_PlayerPosition.x);
+			int z = (int)std::floor(m_PlayerPosition.z);
+			m_PlayerPosition.y = (float)m_ChunkGenerator.GetTerrain().GetHeight(x, z) + 1.0f + s_PlayerHalfExtents.y;
+			m_Camera.Position = m_PlayerPosition + glm::vec3(0.0f, 2.0f, 8.0f);
+			m_Spawned = true;
+		}
+	}
+
+	void ClientLayer::MarkChunkDirty(ChunkCoord coord)
+	{
+		m_DirtyChunks.insert(coord);
+
+		static const ChunkCoord neighbours[4] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+		for (const ChunkCoord& offset : neighbours)
+		{
+			ChunkCoord neighbour{ coord.X + offset.X, coord.Z + offset.Z };
+			if (m_World.HasChunk(neighbour))
+				m_DirtyChunks.insert(neighbour);
+		}
+	}
+
+	void ClientLayer::UpdateChunkMeshes()
+	{
+		int budget = s_MaxChunkMeshesPerFrame;
+		for (auto it = m_DirtyChunks.begin(); it != m_DirtyChunks.end() && budget > 0;)
+		{
+			ChunkCoord coord = *it;
+			it = m_DirtyChunks.erase(it);
+
+			// Evicted since it was marked
+			if (!ChunkMesher::Build(m_World, coord, m_ChunkMeshData))
+				continue;
+
+			m_Renderer.UploadChunkMesh(coord, m_ChunkMeshData);
+			budget--;
+		}
+	}
+
 	void ClientLayer::OnSwapchainRecreated() {
 		m_Renderer.OnSwapchainRecreated();
 	}
@@ -8,9 +8,16 @@
 #include <glm\glm.hpp>
 #include <map>
 #include <mutex>
+#include <optional>
+#include <unordered_set>
 
 #include "Renderer/Renderer.h"
 
+#include "World/ChunkCache.h"
+#include "World/ChunkGenerator.h"
+#include "World/LightEngine.h"
+#include "World/VoxelQuery.h"
+
 namespace Cubed {
 	class ClientLayer : public Walnut::Layer
 	{
@@ -25,12 +32,14 @@ namespace Cubed {
 		virtual void OnSwapchainRecreated() override;
 	private:
 		void OnDataReceived(const Walnut::Buffer buffer);
+		void StreamChunks();
+		void MarkChunkDirty(ChunkCoord coord);
+		void UpdateChunkMeshes();
 	private:
 		Renderer m_Renderer;
 
 		glm::vec3 m_PlayerPosition{ 0, 0, 0};
 		glm::vec3 m_PlayerRotation{ 30.0f, 45.0f, 0 };
-		glm::mat4 m_PlayerTransform{ 1.0f };
 		glm::vec3 m_PlayerVelocity{ 0, 0, 0};
 
 		Camera m_Camera;
@@ -43,13 +52,28 @@ namespace Cubed {
 
 		uint32_t m_PlayerID = 0;
 
+		// Local copy of the world, generated from the shared seed and used for prediction
+		World m_World;
+		LightEngine m_LightEngine{ m_World };
+		ChunkCache m_ChunkCache{ m_World, { .ResidentBudget = 64ull * 1024 * 1024, .SpillDirectory = "Cache/Client", .PinRadius = 4 } };
+		ChunkGenerator m_ChunkGenerator{ DEFAULT_WORLD_SEED, 2 };
+		std::vector<std::unique_ptr<Chunk>> m_GeneratedChunks;
+		bool m_Spawned = false;
+
+		// Chunks whose mesh is missing or stale - a new chunk also dirties its neighbours' borders
+		std::unordered_set<ChunkCoord, ChunkCoordHash> m_DirtyChunks;
+		ChunkMeshData m_ChunkMeshData;
+
 		struct PlayerData
 		{
-			glm::vec2 Position;
-			glm::vec2 Velocity;
+			glm::vec3 Position;
+			glm::vec3 Velocity;
 		};
 
 		std::mutex m_PlayerDataMutex;
 		std::map<uint32_t, PlayerData> m_PlayerData;
+		std::vector<InstanceData> m_PlayerInstances;
+		// Our own position as the server has it, taken over by the next OnUpdate
+		std::optional<glm::vec3> m_ServerPosition;
 	};
 }
@@ -0,0 +1,123 @@
+#include "ChunkMesher.h"
+
+namespace Cubed {
+
+	namespace {
+
+		// Face order and corner order must match c_Normals / c_Corners in voxel.vert.glsl
+		struct FaceDesc
+		{
+			glm::ivec3 Normal;
+			glm::ivec3 Corners[4];   // counter-clockwise seen from outside
+		};
+
+		const FaceDesc kFaces[6] = {
+			{ {  1,  0,  0 }, { { 1, 0, 1 }, { 1, 0, 0 }, { 1, 1, 0 }, { 1, 1, 1 } } },
+			{ { -1,  0,  0 }, { { 0, 0, 0 }, { 0, 0, 1 }, { 0, 1, 1 }, { 0, 1, 0 } } },
+			{ {  0,  1,  0 }, { { 0, 1, 1 }, { 1, 1, 1 }, { 1, 1, 0 }, { 0, 1, 0 } } },
+			{ {  0, -1,  0 }, { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 0, 1 }, { 0, 0, 1 } } },
+			{ {  0,  0,  1 }, { { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 } } },
+			{ {  0,  0, -1 }, { { 1, 0, 0 }, { 0, 0, 0 }, { 0, 1, 0 }, { 1, 1, 0 } } },
+		};
+
+		struct Sample
+		{
+			bool Loaded = false;
+			Block Type = Block::Air;
+			uint8_t Light = 0;
+		};
+
+		//
+		// The chunk plus its four horizontal neighbours, addressed in local
+		// coordinates that may step one block outside the chunk.
+		//
+		class Neighbourhood
+		{
+		public:
+			Neighbourhood(const World& world, ChunkCoord coord)
+			{
+				for (int dz = -1; dz <= 1; ++dz)
+					for (int dx = -1; dx <= 1; ++dx)
+						m_Chunks[dz + 1][dx + 1] = world.GetChunk({ coord.X + dx, coord.Z + dz });
+			}
+
+			const Chunk* GetCenter() const { return m_Chunks[1][1]; }
+
+			Sample Get(int x, int y, int z) const
+			{
+				Sample sample;
+				if (y < 0)
+					return sample;
+				if (y >= CHUNK_HEIGHT)
+				{
+					sample.Loaded = true;
+					sample.Light = MAX_LIGHT_LEVEL << 4;
+					return sample;
+				}
+
+				const int cx = x < 0 ? 0 : (x >= CHUNK_SIZE ? 2 : 1);
+				const int cz = z < 0 ? 0 : (z >= CHUNK_SIZE ? 2 : 1);
+				const Chunk* chunk = m_Chunks[cz][cx];
+				if (!chunk)
+					return sample;
+
+				const int index = Chunk::Index(x - (cx - 1) * CHUNK_SIZE, y, z - (cz - 1) * CHUNK_SIZE);
+				sample.Loaded = true;
+				sample.Type = chunk->GetBlocks()[index];
+				sample.Light = chunk->GetLight()[index];
+				return sample;
+			}
+		private:
+			const Chunk* m_Chunks[3][3];
+		};
+
+	}
+
+	bool ChunkMesher::Build(const World& world, ChunkCoord coord, ChunkMeshData& out)
+	{
+		out.Clear();
+
+		Neighbourhood neighbourhood(world, coord);
+		const Chunk* chunk = neighbourhood.GetCenter();
+		if (!chunk)
+			return false;
+
+		const Block* blocks = chunk->GetBlocks();
+
+		for (int y = 0; y < CHUNK_HEIGHT; ++y)
+		{
+			for (int z = 0; z < CHUNK_SIZE; ++z)
+			{
+				for (int x = 0; x < CHUNK_SIZE; ++x)
+				{
+					const Block block = blocks[Chunk::Index(x, y, z)];
+					if (block == Block::Air)
+						continue;
+
+					for (uint32_t face = 0; face < 6; ++face)
+					{
+						const FaceDesc& desc = kFaces[face];
+						Sample neighbour = neighbourhood.Get(x + desc.Normal.x, y + desc.Normal.y, z + desc.Normal.z);
+						if (!neighbour.Loaded || IsOpaque(neighbour.Type) || neighbour.Type == block)
+							continue;
+
+						const uint8_t skyLight = neighbour.Light >> 4;
+						const uint8_t blockLight = neighbour.Light & 0xf;
+						const uint32_t base = (uint32_t)out.Vertices.size();
+
+						for (uint32_t corner = 0; corner < 4; ++corner)
+						{
+							const glm::ivec3 position = glm::ivec3(x, y, z) + desc.Corners[corner];
+							out.Vertices.push_back(ChunkVertex::Pack(position.x, position.y, position.z, face, corner, (uint32_t)block, skyLight, blockLight));
+						}
+
+						out.Indices.insert(out.Indices.end(), { base, base + 1, base + 2, base + 2, base + 3, base });
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+}
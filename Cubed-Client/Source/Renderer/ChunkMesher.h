@@ -0,0 +1,52 @@
+#pragma once
+
+#include "World/World.h"
+
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Cubed {
+
+	//
+	// ChunkVertex - 8 bytes, unpacked by voxel.vert.glsl.
+	//   Data[0]: x (5 bits) | y (8) | z (5) | face (3) | corner (2)
+	//   Data[1]: texture layer (12 bits) | sky light (4) | block light (4)
+	// Positions are chunk-local; the chunk origin comes in as a push constant.
+	// The layer is the block type, into the renderer's block texture array.
+	//
+	struct ChunkVertex
+	{
+		uint32_t Data[2];
+
+		static ChunkVertex Pack(int x, int y, int z, uint32_t face, uint32_t corner, uint32_t layer, uint8_t skyLight, uint8_t blockLight)
+		{
+			ChunkVertex vertex;
+			vertex.Data[0] = (uint32_t)x | ((uint32_t)y << 5) | ((uint32_t)z << 13) | (face << 18) | (corner << 21);
+			vertex.Data[1] = (layer & 0xfff) | ((uint32_t)(skyLight & 0xf) << 12) | ((uint32_t)(blockLight & 0xf) << 16);
+			return vertex;
+		}
+	};
+	static_assert(sizeof(ChunkVertex) == 8);
+
+	struct ChunkMeshData
+	{
+		std::vector<ChunkVertex> Vertices;
+		std::vector<uint32_t> Indices;
+
+		void Clear() { Vertices.clear(); Indices.clear(); }
+	};
+
+	//
+	// ChunkMesher - emits one quad per visible block face, wound counter-clockwise
+	// seen from outside. Each face is lit by the light stored in the block it
+	// faces, so the chunk has to have been through LightEngine before it is meshed.
+	//
+	class ChunkMesher
+	{
+	public:
+		// Returns false if the chunk isn't loaded. Faces on a border with an
+		// unloaded neighbour are skipped; remesh once the neighbour arrives.
+		static bool Build(const World& world, ChunkCoord coord, ChunkMeshData& out);
+	};
+
+}
@@ -0,0 +1,138 @@
+#include "CommandRecorder.h"
+
+#include <algorithm>
+
+namespace Cubed {
+
+	CommandRecorder::CommandRecorder(uint32_t threadCount)
+	{
+		if (threadCount == 0)
+		{
+			uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			threadCount = std::clamp(hardwareThreads > 1 ? hardwareThreads - 1 : 1, 1u, 8u);
+		}
+
+		m_Workers.resize(threadCount);
+		m_Threads.reserve(threadCount);
+		for (uint32_t i = 0; i < threadCount; ++i)
+			m_Threads.emplace_back([this, i]() { WorkerThreadFunc(i); });
+	}
+
+	CommandRecorder::~CommandRecorder()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Running = false;
+		}
+		m_Start.notify_all();
+
+		for (auto& thread : m_Threads)
+			thread.join();
+	}
+
+	const std::vector<VkCommandBuffer>& CommandRecorder::Record(uint32_t frameIndex, const VkCommandBufferInheritanceInfo& inheritance,
+		uint32_t batchCount, const RecordFunction& record)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_FrameIndex = frameIndex;
+			m_Inheritance = &inheritance;
+			m_BatchCount = batchCount;
+			m_Record = &record;
+			m_Results.assign(batchCount, VK_NULL_HANDLE);
+			m_Busy = (uint32_t)m_Threads.size();
+			m_Job++;
+		}
+		m_Start.notify_all();
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Done.wait(lock, [this]() { return m_Busy == 0; });
+		m_Record = nullptr;
+		m_Inheritance = nullptr;
+		return m_Results;
+	}
+
+	void CommandRecorder::Destroy()
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+		for (Worker& worker : m_Workers)
+		{
+			for (FramePool& frame : worker.Frames)
+				if (frame.Pool) vkDestroyCommandPool(device, frame.Pool, nullptr);
+			worker.Frames.clear();
+		}
+	}
+
+	void CommandRecorder::WorkerThreadFunc(uint32_t worker)
+	{
+		uint64_t job = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Start.wait(lock, [this, job]() { return !m_Running || m_Job != job; });
+				if (!m_Running)
+					return;
+				job = m_Job;
+			}
+
+			RecordBatches(worker);
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (--m_Busy == 0)
+				m_Done.notify_one();
+		}
+	}
+
+	void CommandRecorder::RecordBatches(uint32_t worker)
+	{
+		if (worker >= m_BatchCount)
+			return;
+
+		VkDevice device = GetVulkanInfo()->Device;
+		Worker& state = m_Workers[worker];
+		if (state.Frames.size() <= m_FrameIndex)
+			state.Frames.resize(m_FrameIndex + 1);
+
+		// The frame that last used this slot has finished, its buffers can be rerecorded
+		FramePool& frame = state.Frames[m_FrameIndex];
+		if (!frame.Pool)
+		{
+			VkCommandPoolCreateInfo poolInfo{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			poolInfo.queueFamilyIndex = GetVulkanInfo()->QueueFamily;
+			VK_CHECK(vkCreateCommandPool(device, &poolInfo, nullptr, &frame.Pool));
+		}
+		else
+		{
+			VK_CHECK(vkResetCommandPool(device, frame.Pool, 0));
+		}
+
+		const uint32_t threadCount = (uint32_t)m_Threads.size();
+		uint32_t used = 0;
+		for (uint32_t batch = worker; batch < m_BatchCount; batch += threadCount, used++)
+		{
+			if (used == frame.Buffers.size())
+			{
+				VkCommandBufferAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+				allocInfo.commandPool = frame.Pool;
+				allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+				allocInfo.commandBufferCount = 1;
+				VK_CHECK(vkAllocateCommandBuffers(device, &allocInfo, &frame.Buffers.emplace_back()));
+			}
+
+			VkCommandBuffer commandBuffer = frame.Buffers[used];
+
+			VkCommandBufferBeginInfo beginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			beginInfo.pInheritanceInfo = m_Inheritance;
+			VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+			(*m_Record)(batch, commandBuffer);
+
+			VK_CHECK(vkEndCommandBuffer(commandBuffer));
+			m_Results[batch] = commandBuffer;
+		}
+	}
+
+}
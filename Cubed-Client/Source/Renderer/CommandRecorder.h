@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Vulkan.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Cubed {
+
+	//
+	// CommandRecorder - records secondary command buffers on a pool of worker
+	// threads. Every worker has its own command pool per frame in flight,
+	// reset when that frame slot comes round again, so steady-state frames
+	// allocate nothing. Record() blocks until every batch is done and returns
+	// the buffers in batch order, ready for vkCmdExecuteCommands.
+	//
+	class CommandRecorder
+	{
+	public:
+		using RecordFunction = std::function<void(uint32_t batch, VkCommandBuffer commandBuffer)>;
+
+		// threadCount = 0 uses every hardware thread but one, up to 8
+		explicit CommandRecorder(uint32_t threadCount = 0);
+		~CommandRecorder();
+
+		CommandRecorder(const CommandRecorder&) = delete;
+		CommandRecorder& operator=(const CommandRecorder&) = delete;
+
+		// Worker w records batches w, w + threads, ... - record must be safe to call concurrently
+		const std::vector<VkCommandBuffer>& Record(uint32_t frameIndex, const VkCommandBufferInheritanceInfo& inheritance,
+			uint32_t batchCount, const RecordFunction& record);
+
+		// Releases the command pools; the device must be idle
+		void Destroy();
+
+		uint32_t GetThreadCount() const { return (uint32_t)m_Threads.size(); }
+	private:
+		void WorkerThreadFunc(uint32_t worker);
+		void RecordBatches(uint32_t worker);
+	private:
+		struct FramePool
+		{
+			VkCommandPool Pool = VK_NULL_HANDLE;
+			std::vector<VkCommandBuffer> Buffers;
+		};
+
+		// Only touched by the worker's own thread while a job runs
+		struct Worker
+		{
+			std::vector<FramePool> Frames;
+		};
+
+		std::vector<std::thread> m_Threads;
+		std::vector<Worker> m_Workers;
+		std::mutex m_Mutex;
+		std::condition_variable m_Start, m_Done;
+		bool m_Running = true;
+
+		// The job being recorded, written before m_Job is bumped
+		uint64_t m_Job = 0;
+		uint32_t m_Busy = 0;
+		uint32_t m_FrameIndex = 0;
+		const VkCommandBufferInheritanceInfo* m_Inheritance = nullptr;
+		uint32_t m_BatchCount = 0;
+		const RecordFunction* m_Record = nullptr;
+		std::vector<VkCommandBuffer> m_Results;
+	};
+
+}
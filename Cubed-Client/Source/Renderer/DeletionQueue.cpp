@@ -0,0 +1,272 @@
+#include "DeletionQueue.h"
+
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Cubed {
+
+	namespace {
+
+		// Everything released during one frame; the vectors keep their capacity when recycled
+		struct Batch
+		{
+			uint64_t Frame = 0;
+			uint32_t Count = 0;
+			std::vector<VkDescriptorSet> DescriptorSets;
+			std::vector<VkFramebuffer> Framebuffers;
+			std::vector<VkPipeline> Pipelines;
+			std::vector<VkPipelineLayout> PipelineLayouts;
+			std::vector<VkDescriptorSetLayout> SetLayouts;
+			std::vector<VkRenderPass> RenderPasses;
+			std::vector<VkImageView> ImageViews;
+			std::vector<VkSampler> Samplers;
+			std::vector<std::pair<VkImage, GpuAllocation>> Images;
+			std::vector<std::pair<VkBuffer, GpuAllocation>> Buffers;
+			std::vector<GpuAllocation> Memory;
+			std::vector<std::function<void()>> Functions;
+		};
+
+		struct QueueData
+		{
+			std::mutex Mutex;
+			std::deque<Batch> Batches;    // oldest first
+			std::vector<Batch> Spare;
+			uint64_t Frame = 0;
+			uint32_t Pending = 0;
+			uint64_t Destroyed = 0;
+		};
+
+		QueueData& GetData()
+		{
+			static QueueData s_Data;
+			return s_Data;
+		}
+
+		// The caller holds the lock
+		Batch& CurrentBatch(QueueData& data)
+		{
+			if (data.Batches.empty() || data.Batches.back().Frame != data.Frame)
+			{
+				if (data.Spare.empty())
+					data.Batches.emplace_back();
+				else
+				{
+					data.Batches.push_back(std::move(data.Spare.back()));
+					data.Spare.pop_back();
+				}
+				data.Batches.back().Frame = data.Frame;
+			}
+			return data.Batches.back();
+		}
+
+		template<typename T, typename Item>
+		void Push(std::vector<T> Batch::* list, Item&& item)
+		{
+			QueueData& data = GetData();
+			std::scoped_lock lock(data.Mutex);
+			Batch& batch = CurrentBatch(data);
+			(batch.*list).push_back(std::forward<Item>(item));
+			batch.Count++;
+			data.Pending++;
+		}
+
+		// Users before what they use: framebuffers before their views and passes, sets before their layouts
+		void Destroy(Batch& batch)
+		{
+			VkDevice device = GetVulkanInfo()->Device;
+
+			if (!batch.DescriptorSets.empty())
+				vkFreeDescriptorSets(device, GetDescriptorPool(), (uint32_t)batch.DescriptorSets.size(), batch.DescriptorSets.data());
+			for (VkFramebuffer framebuffer : batch.Framebuffers)
+				vkDestroyFramebuffer(device, framebuffer, nullptr);
+			for (VkPipeline pipeline : batch.Pipelines)
+				vkDestroyPipeline(device, pipeline, nullptr);
+			for (VkPipelineLayout layout : batch.PipelineLayouts)
+				vkDestroyPipelineLayout(device, layout, nullptr);
+			for (VkDescriptorSetLayout layout : batch.SetLayouts)
+				vkDestroyDescriptorSetLayout(device, layout, nullptr);
+			for (VkRenderPass renderPass : batch.RenderPasses)
+				vkDestroyRenderPass(device, renderPass, nullptr);
+			for (VkImageView view : batch.ImageViews)
+				vkDestroyImageView(device, view, nullptr);
+			for (VkSampler sampler : batch.Samplers)
+				vkDestroySampler(device, sampler, nullptr);
+			for (auto& [image, memory] : batch.Images)
+			{
+				if (image) vkDestroyImage(device, image, nullptr);
+				GpuAllocator::Free(memory);
+			}
+			for (auto& [buffer, memory] : batch.Buffers)
+			{
+				if (buffer) vkDestroyBuffer(device, buffer, nullptr);
+				GpuAllocator::Free(memory);
+			}
+			for (GpuAllocation& memory : batch.Memory)
+				GpuAllocator::Free(memory);
+			for (auto& func : batch.Functions)
+				func();
+
+			batch.DescriptorSets.clear();
+			batch.Framebuffers.clear();
+			batch.Pipelines.clear();
+			batch.PipelineLayouts.clear();
+			batch.SetLayouts.clear();
+			batch.RenderPasses.clear();
+			batch.ImageViews.clear();
+			batch.Samplers.clear();
+			batch.Images.clear();
+			batch.Buffers.clear();
+			batch.Memory.clear();
+			batch.Functions.clear();
+		}
+
+		// Destroys the batches up to and including 'lastFrame'. The lock is not held
+		// while destroying, a function may well release something of its own.
+		void DestroyUpTo(uint64_t lastFrame)
+		{
+			QueueData& data = GetData();
+			std::vector<Batch> ready;
+			{
+				std::scoped_lock lock(data.Mutex);
+				while (!data.Batches.empty() && data.Batches.front().Frame <= lastFrame)
+				{
+					ready.push_back(std::move(data.Batches.front()));
+					data.Batches.pop_front();
+				}
+			}
+			if (ready.empty())
+				return;
+
+			uint32_t count = 0;
+			for (Batch& batch : ready)
+			{
+				Destroy(batch);
+				count += batch.Count;
+				batch.Count = 0;
+			}
+
+			std::scoped_lock lock(data.Mutex);
+			data.Pending -= count;
+			data.Destroyed += count;
+			for (Batch& batch : ready)
+				data.Spare.push_back(std::move(batch));
+		}
+
+	}
+
+	void DeletionQueue::ReleaseBuffer(VkBuffer buffer, const GpuAllocation& memory)
+	{
+		if (buffer || memory)
+			Push(&Batch::Buffers, std::make_pair(buffer, memory));
+	}
+
+	void DeletionQueue::ReleaseImage(VkImage image, const GpuAllocation& memory)
+	{
+		if (image || memory)
+			Push(&Batch::Images, std::make_pair(image, memory));
+	}
+
+	void DeletionQueue::ReleaseImageView(VkImageView view)
+	{
+		if (view)
+			Push(&Batch::ImageViews, view);
+	}
+
+	void DeletionQueue::ReleaseSampler(VkSampler sampler)
+	{
+		if (sampler)
+			Push(&Batch::Samplers, sampler);
+	}
+
+	void DeletionQueue::ReleaseFramebuffer(VkFramebuffer framebuffer)
+	{
+		if (framebuffer)
+			Push(&Batch::Framebuffers, framebuffer);
+	}
+
+	void DeletionQueue::ReleaseRenderPass(VkRenderPass renderPass)
+	{
+		if (renderPass)
+			Push(&Batch::RenderPasses, renderPass);
+	}
+
+	void DeletionQueue::ReleasePipeline(VkPipeline pipeline)
+	{
+		if (pipeline)
+			Push(&Batch::Pipelines, pipeline);
+	}
+
+	void DeletionQueue::ReleasePipelineLayout(VkPipelineLayout layout)
+	{
+		if (layout)
+			Push(&Batch::PipelineLayouts, layout);
+	}
+
+	void DeletionQueue::ReleaseDescriptorSetLayout(VkDescriptorSetLayout layout)
+	{
+		if (layout)
+			Push(&Batch::SetLayouts, layout);
+	}
+
+	void DeletionQueue::ReleaseDescriptorSet(VkDescriptorSet set)
+	{
+		if (set)
+			Push(&Batch::DescriptorSets, set);
+	}
+
+	void DeletionQueue::ReleaseMemory(const GpuAllocation& memory)
+	{
+		if (memory)
+			Push(&Batch::Memory, memory);
+	}
+
+	void DeletionQueue::Submit(std::function<void()>&& func)
+	{
+		if (func)
+			Push(&Batch::Functions, std::move(func));
+	}
+
+	void DeletionQueue::BeginFrame(uint32_t frameCount)
+	{
+		QueueData& data = GetData();
+		uint64_t frame;
+		{
+			std::scoped_lock lock(data.Mutex);
+			frame = ++data.Frame;
+		}
+
+		// This frame reuses the slot of frame - frameCount, which has been waited on,
+		// and every frame submitted before that one has finished as well
+		if (frame >= frameCount)
+			DestroyUpTo(frame - frameCount);
+	}
+
+	void DeletionQueue::Flush()
+	{
+		QueueData& data = GetData();
+		uint64_t frame;
+		{
+			std::scoped_lock lock(data.Mutex);
+			frame = data.Frame;
+		}
+
+		// Destroying can release more, e.g. a texture dropped by a function
+		for (;;)
+		{
+			DestroyUpTo(frame);
+			std::scoped_lock lock(data.Mutex);
+			if (data.Batches.empty())
+				break;
+		}
+	}
+
+	DeletionQueueStats DeletionQueue::GetStats()
+	{
+		QueueData& data = GetData();
+		std::scoped_lock lock(data.Mutex);
+		return { data.Pending, (uint32_t)data.Batches.size(), data.Destroyed };
+	}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "GpuAllocator.h"
+#include "Vulkan.h"
+
+#include <cstdint>
+#include <functional>
+
+namespace Cubed {
+
+	struct DeletionQueueStats
+	{
+		uint32_t Pending = 0;          // objects released but not destroyed yet
+		uint32_t PendingFrames = 0;    // frames they were released in
+		uint64_t Destroyed = 0;        // since startup
+	};
+
+	//
+	// DeletionQueue - Vulkan objects that frames in flight may still reference.
+	// Releasing one only records it against the current frame number; it is
+	// destroyed by the BeginFrame that reuses the last slot that frame could
+	// have been submitted in, so nothing waits for the device to go idle.
+	//
+	// Like the per-frame rings, this counts on frames finishing in the order
+	// they were submitted. Releasing from any thread is fine; BeginFrame and
+	// Flush belong to the thread running the frame loop.
+	//
+	class DeletionQueue
+	{
+	public:
+		// Null handles (and empty allocations) are ignored
+		static void ReleaseBuffer(VkBuffer buffer, const GpuAllocation& memory = {});
+		static void ReleaseImage(VkImage image, const GpuAllocation& memory = {});
+		static void ReleaseImageView(VkImageView view);
+		static void ReleaseSampler(VkSampler sampler);
+		static void ReleaseFramebuffer(VkFramebuffer framebuffer);
+		static void ReleaseRenderPass(VkRenderPass renderPass);
+		static void ReleasePipeline(VkPipeline pipeline);
+		static void ReleasePipelineLayout(VkPipelineLayout layout);
+		static void ReleaseDescriptorSetLayout(VkDescriptorSetLayout layout);
+		// Allocated from GetDescriptorPool()
+		static void ReleaseDescriptorSet(VkDescriptorSet set);
+		static void ReleaseMemory(const GpuAllocation& memory);
+		// Anything else; runs when the objects above released alongside it are destroyed
+		static void Submit(std::function<void()>&& func);
+
+		// Once per frame, after that frame's slot has been waited on
+		static void BeginFrame(uint32_t frameCount);
+		// Destroys everything right away; the device must be idle
+		static void Flush();
+
+		static DeletionQueueStats GetStats();
+	};
+
+}
@@ -0,0 +1,73 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Cubed {
+
+	static constexpr float s_ScaleStep = 1.0f / 32.0f;
+	static constexpr float s_LowestScale = 0.25f;
+	static constexpr float s_Smoothing = 0.15f;      // weight of a new sample in the average
+	static constexpr uint32_t s_MinSamples = 8;      // in the average before it is acted on
+	static constexpr uint32_t s_SettleFrames = 4;    // skipped after a change, on top of the latency
+	static constexpr float s_RaiseBelow = 0.75f;     // of the budget, to climb back up
+	static constexpr float s_AimFor = 0.9f;          // of the budget, where a change aims
+	static constexpr float s_MaxRaise = 0.125f;      // per change; drops are not limited
+
+	void DynamicResolution::SetSettings(const DynamicResolutionSettings& settings)
+	{
+		m_Settings = settings;
+		m_Settings.TargetFrameMs = std::max(m_Settings.TargetFrameMs, 1.0f);
+		m_Settings.MaxScale = std::clamp(m_Settings.MaxScale, s_LowestScale, 1.0f);
+		m_Settings.MinScale = std::clamp(m_Settings.MinScale, s_LowestScale, m_Settings.MaxScale);
+
+		m_Scale = std::clamp(m_Scale, m_Settings.MinScale, m_Settings.MaxScale);
+		m_AverageMs = 0.0f;
+		m_Samples = 0;
+		m_Cooldown = 0;
+		m_Changes = 0;
+	}
+
+	float DynamicResolution::Update(float gpuFrameMs, uint32_t latency)
+	{
+		if (!m_Settings.Enabled)
+			return 1.0f;
+
+		if (m_Cooldown > 0)
+		{
+			m_Cooldown--;
+			return m_Scale;
+		}
+
+		// Nothing measured yet, no timestamps on this queue, or this frame's weren't ready
+		if (gpuFrameMs <= 0.0f)
+			return m_Scale;
+
+		m_AverageMs = m_Samples == 0 ? gpuFrameMs : m_AverageMs + (gpuFrameMs - m_AverageMs) * s_Smoothing;
+		if (++m_Samples < s_MinSamples)
+			return m_Scale;
+
+		const float budget = m_Settings.TargetFrameMs;
+		const bool over = m_AverageMs > budget && m_Scale > m_Settings.MinScale;
+		const bool under = m_AverageMs < budget * s_RaiseBelow && m_Scale < m_Settings.MaxScale;
+		if (!over && !under)
+			return m_Scale;
+
+		// Snapped down to a step, but always at least one step in the direction asked for
+		float scale = m_Scale * std::sqrt(budget * s_AimFor / m_AverageMs);
+		scale = std::min(scale, m_Scale + s_MaxRaise);
+		scale = std::floor(scale / s_ScaleStep) * s_ScaleStep;
+		scale = over ? std::min(scale, m_Scale - s_ScaleStep) : std::max(scale, m_Scale + s_ScaleStep);
+		scale = std::clamp(scale, m_Settings.MinScale, m_Settings.MaxScale);
+
+		if (scale != m_Scale)
+		{
+			m_Scale = scale;
+			m_Changes++;
+			m_Samples = 0;
+			m_Cooldown = latency + s_SettleFrames;
+		}
+		return m_Scale;
+	}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Cubed {
+
+	struct DynamicResolutionSettings
+	{
+		bool Enabled = true;
+		float TargetFrameMs = 16.0f;   // GPU time of the scene, the ImGui pass comes on top
+		float MinScale = 0.5f;         // of the output size, per axis
+		float MaxScale = 1.0f;
+	};
+
+	struct DynamicResolutionStats
+	{
+		float Scale = 1.0f;
+		float AverageFrameMs = 0.0f;   // smoothed GPU frame time the controller acts on
+		uint32_t Changes = 0;          // scale changes since the settings were last set
+	};
+
+	//
+	// DynamicResolution - picks the fraction of the output resolution the scene
+	// is rendered at from the measured GPU frame time. The cost of a frame is
+	// taken to grow with its pixel count, so the scale moves by the square root
+	// of budget / measured time.
+	//
+	// It drops quickly when over budget and only climbs back with headroom to
+	// spare, in steps of s_ScaleStep so the Hi-Z pyramid and similar targets
+	// sized from the rendered area are not rebuilt every frame. After a change
+	// the samples still in flight were rendered at the old scale, so it waits
+	// for those and a few fresh ones before deciding again.
+	//
+	class DynamicResolution
+	{
+	public:
+		void SetSettings(const DynamicResolutionSettings& settings);
+		const DynamicResolutionSettings& GetSettings() const { return m_Settings; }
+
+		// Once per frame with the newest GPU frame time, which is 'latency' frames old;
+		// returns the scale to render this frame at
+		float Update(float gpuFrameMs, uint32_t latency);
+
+		float GetScale() const { return m_Settings.Enabled ? m_Scale : 1.0f; }
+		DynamicResolutionStats GetStats() const { return { GetScale(), m_AverageMs, m_Changes }; }
+	private:
+		DynamicResolutionSettings m_Settings;
+		float m_Scale = 1.0f;
+		float m_AverageMs = 0.0f;
+		uint32_t m_Samples = 0;     // in m_AverageMs since the last change
+		uint32_t m_Cooldown = 0;    // frames left to skip after a change
+		uint32_t m_Changes = 0;
+	};
+
+}
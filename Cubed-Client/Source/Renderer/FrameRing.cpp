@@ -0,0 +1,93 @@
+#include "FrameRing.h"
+#include "DeletionQueue.h"
+
+#include <algorithm>
+
+namespace Cubed {
+
+	FrameRing::FrameRing(VkBufferUsageFlags usage, VkDeviceSize frameSize)
+		: m_Usage(usage), m_FrameSize(frameSize)
+	{
+	}
+
+	void FrameRing::BeginFrame(uint32_t frameIndex, uint32_t frameCount)
+	{
+		if (!m_Buffer.Handle || frameCount != m_FrameCount || m_Overflowed)
+		{
+			if (m_Overflowed)
+				m_Grows++;
+			Recreate(m_Overflowed ? m_FrameSize * 2 : m_FrameSize, frameCount);
+		}
+
+		m_FrameBase = (VkDeviceSize)frameIndex * m_FrameSize;
+		m_Head = 0;
+		m_Overflowed = false;
+	}
+
+	RingAllocation FrameRing::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+	{
+		const VkDeviceSize offset = (m_Head + alignment - 1) / alignment * alignment;
+		if (offset + size > m_FrameSize)
+		{
+			m_Overflowed = true;
+			m_Overflows++;
+			return {};
+		}
+
+		m_Head = offset + size;
+		m_PeakUsed = std::max(m_PeakUsed, m_Head);
+
+		RingAllocation allocation;
+		allocation.Buffer = m_Buffer.Handle;
+		allocation.Offset = (uint32_t)(m_FrameBase + offset);
+		allocation.Mapped = (uint8_t*)m_Buffer.Memory.Mapped + m_FrameBase + offset;
+		return allocation;
+	}
+
+	void FrameRing::Flush()
+	{
+		if (m_Head > 0)
+			GpuAllocator::Flush(m_Buffer.Memory, m_FrameBase, m_Head);
+	}
+
+	void FrameRing::Recreate(VkDeviceSize frameSize, uint32_t frameCount)
+	{
+		// Frames in flight keep reading the old buffer until they finish
+		DeletionQueue::ReleaseBuffer(m_Buffer.Handle, m_Buffer.Memory);
+		m_Buffer = {};
+
+		m_FrameSize = frameSize;
+		m_FrameCount = frameCount;
+
+		VkBufferCreateInfo bi{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+		bi.size = frameSize * frameCount;
+		bi.usage = m_Usage;
+		bi.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		VK_CHECK(vkCreateBuffer(GetVulkanInfo()->Device, &bi, nullptr, &m_Buffer.Handle));
+
+		m_Buffer.Memory = GpuAllocator::AllocateBuffer(m_Buffer.Handle, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		m_Buffer.Size = bi.size;
+		m_Generation++;
+	}
+
+	void FrameRing::Destroy()
+	{
+		if (m_Buffer.Handle) vkDestroyBuffer(GetVulkanInfo()->Device, m_Buffer.Handle, nullptr);
+		GpuAllocator::Free(m_Buffer.Memory);
+		m_Buffer = {};
+		m_FrameCount = 0;
+		m_Head = 0;
+	}
+
+	FrameRingStats FrameRing::GetStats() const
+	{
+		FrameRingStats stats;
+		stats.FrameSize = m_FrameSize;
+		stats.Used = m_Head;
+		stats.PeakUsed = m_PeakUsed;
+		stats.Overflows = m_Overflows;
+		stats.Grows = m_Grows;
+		return stats;
+	}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "../Assets/Model.h"
+
+#include <cstdint>
+
+namespace Cubed {
+
+	// Valid until the same frame slot comes round again
+	struct RingAllocation
+	{
+		VkBuffer Buffer = VK_NULL_HANDLE;
+		uint32_t Offset = 0;   // from the start of the buffer, usable as a dynamic offset
+		void* Mapped = nullptr;
+
+		explicit operator bool() const { return Mapped != nullptr; }
+	};
+
+	struct FrameRingStats
+	{
+		VkDeviceSize FrameSize = 0;
+		VkDeviceSize Used = 0;       // by the current frame
+		VkDeviceSize PeakUsed = 0;
+		uint32_t Overflows = 0;      // failed allocations
+		uint32_t Grows = 0;
+	};
+
+	//
+	// FrameRing - one persistently mapped, host-visible buffer split into a
+	// region per frame in flight. Per-frame data is bumped out of the current
+	// frame's region, which the GPU is done with by the time BeginFrame hands
+	// it out again, so nothing is overwritten while it's still being read and
+	// nothing is mapped or unmapped in the frame loop.
+	//
+	// A frame that runs out of room gets failed allocations; the next
+	// BeginFrame doubles the regions and retires the old buffer. The
+	// generation changes whenever the buffer does, so descriptors pointing
+	// at it know to be rewritten.
+	//
+	class FrameRing
+	{
+	public:
+		FrameRing(VkBufferUsageFlags usage, VkDeviceSize frameSize);
+
+		void BeginFrame(uint32_t frameIndex, uint32_t frameCount);
+		RingAllocation Allocate(VkDeviceSize size, VkDeviceSize alignment);
+		// Makes everything written this frame visible to the device
+		void Flush();
+
+		// Immediate, the device must be idle
+		void Destroy();
+
+		VkBuffer GetBuffer() const { return m_Buffer.Handle; }
+		uint32_t GetGeneration() const { return m_Generation; }
+		FrameRingStats GetStats() const;
+	private:
+		void Recreate(VkDeviceSize frameSize, uint32_t frameCount);
+	private:
+		VkBufferUsageFlags m_Usage;
+		VkDeviceSize m_FrameSize;
+		uint32_t m_FrameCount = 0;
+
+		Buffer m_Buffer;
+		uint32_t m_Generation = 0;
+
+		VkDeviceSize m_FrameBase = 0;
+		VkDeviceSize m_Head = 0;   // relative to m_FrameBase
+		bool m_Overflowed = false;
+
+		VkDeviceSize m_PeakUsed = 0;
+		uint32_t m_Overflows = 0;
+		uint32_t m_Grows = 0;
+	};
+
+}
@@ -0,0 +1,109 @@
+#include "FreeListAllocator.h"
+
+#include <algorithm>
+
+namespace Cubed {
+
+	void FreeListAllocator::Reset(uint64_t capacity)
+	{
+		m_FreeBlocks.clear();
+		m_Capacity = capacity;
+		m_FreeSpace = capacity;
+		if (capacity > 0)
+			m_FreeBlocks[0] = capacity;
+	}
+
+	void FreeListAllocator::Grow(uint64_t newCapacity)
+	{
+		if (newCapacity <= m_Capacity)
+			return;
+
+		const uint64_t oldCapacity = m_Capacity;
+		m_Capacity = newCapacity;
+		Free(oldCapacity, newCapacity - oldCapacity);
+	}
+
+	bool FreeListAllocator::Allocate(uint64_t size, uint64_t alignment, uint64_t& offset)
+	{
+		if (size == 0)
+			return false;
+		if (alignment == 0)
+			alignment = 1;
+
+		// Best fit, counting the padding alignment costs in each block
+		auto best = m_FreeBlocks.end();
+		uint64_t bestWaste = UINT64_MAX;
+		for (auto it = m_FreeBlocks.begin(); it != m_FreeBlocks.end(); ++it)
+		{
+			const uint64_t aligned = (it->first + alignment - 1) / alignment * alignment;
+			const uint64_t padding = aligned - it->first;
+			if (it->second < padding + size)
+				continue;
+
+			const uint64_t waste = it->second - size;
+			if (waste < bestWaste)
+			{
+				best = it;
+				bestWaste = waste;
+				if (waste == padding)
+					break;
+			}
+		}
+
+		if (best == m_FreeBlocks.end())
+			return false;
+
+		const uint64_t blockOffset = best->first;
+		const uint64_t blockSize = best->second;
+		const uint64_t aligned = (blockOffset + alignment - 1) / alignment * alignment;
+		const uint64_t padding = aligned - blockOffset;
+		m_FreeBlocks.erase(best);
+
+		// Padding in front and the tail both stay free
+		if (padding > 0)
+			m_FreeBlocks[blockOffset] = padding;
+		if (blockSize > padding + size)
+			m_FreeBlocks[aligned + size] = blockSize - padding - size;
+
+		m_FreeSpace -= size;
+		offset = aligned;
+		return true;
+	}
+
+	void FreeListAllocator::Free(uint64_t offset, uint64_t size)
+	{
+		if (size == 0)
+			return;
+
+		m_FreeSpace += size;
+
+		auto next = m_FreeBlocks.lower_bound(offset);
+		if (next != m_FreeBlocks.begin())
+		{
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset)
+			{
+				offset = prev->first;
+				size += prev->second;
+				m_FreeBlocks.erase(prev);
+			}
+		}
+
+		if (next != m_FreeBlocks.end() && offset + size == next->first)
+		{
+			size += next->second;
+			m_FreeBlocks.erase(next);
+		}
+
+		m_FreeBlocks[offset] = size;
+	}
+
+	uint64_t FreeListAllocator::GetLargestFreeBlock() const
+	{
+		uint64_t largest = 0;
+		for (const auto& [offset, size] : m_FreeBlocks)
+			largest = std::max(largest, size);
+		return largest;
+	}
+
+}
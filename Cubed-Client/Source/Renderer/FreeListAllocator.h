@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+namespace Cubed {
+
+	//
+	// FreeListAllocator - hands out [offset, offset + size) ranges of an
+	// abstract address space (elements, bytes, ...). Free blocks are kept
+	// sorted by offset so neighbours coalesce on Free(); Allocate() is best fit.
+	//
+	class FreeListAllocator
+	{
+	public:
+		void Reset(uint64_t capacity);
+		// Appends [capacity, newCapacity) to the free space
+		void Grow(uint64_t newCapacity);
+
+		bool Allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+		void Free(uint64_t offset, uint64_t size);
+
+		uint64_t GetCapacity() const { return m_Capacity; }
+		uint64_t GetFreeSpace() const { return m_FreeSpace; }
+		uint64_t GetUsedSpace() const { return m_Capacity - m_FreeSpace; }
+		uint64_t GetLargestFreeBlock() const;
+		size_t GetFreeBlockCount() const { return m_FreeBlocks.size(); }
+	private:
+		std::map<uint64_t, uint64_t> m_FreeBlocks;   // offset -> size
+		uint64_t m_Capacity = 0;
+		uint64_t m_FreeSpace = 0;
+	};
+
+}
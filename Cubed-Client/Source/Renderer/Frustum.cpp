@@ -0,0 +1,164 @@
+#include "Frustum.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CUBED_FRUSTUM_SSE2 1
+	#include <emmintrin.h>
+#else
+	#define CUBED_FRUSTUM_SSE2 0
+#endif
+
+namespace Cubed {
+
+	Bounds Bounds::FromPoints(const glm::vec3* points, size_t count, size_t stride)
+	{
+		Bounds bounds;
+		if (count == 0)
+			return bounds;
+
+		glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+		const uint8_t* bytes = (const uint8_t*)points;
+		for (size_t i = 0; i < count; i++)
+		{
+			const glm::vec3& p = *(const glm::vec3*)(bytes + i * stride);
+			min = glm::min(min, p);
+			max = glm::max(max, p);
+		}
+
+		bounds.Min = min;
+		bounds.Max = max;
+		bounds.Center = (min + max) * 0.5f;
+		bounds.Radius = glm::length(max - bounds.Center);
+		return bounds;
+	}
+
+	void Bounds::Merge(const Bounds& other)
+	{
+		Min = glm::min(Min, other.Min);
+		Max = glm::max(Max, other.Max);
+		Center = (Min + Max) * 0.5f;
+		Radius = glm::length(Max - Center);
+	}
+
+	Bounds Bounds::Transformed(const glm::mat4& transform) const
+	{
+		// Box: transformed center plus the absolute-value matrix applied to the extents
+		const glm::vec3 extent = (Max - Min) * 0.5f;
+		const glm::vec3 center = glm::vec3(transform * glm::vec4(Center, 1.0f));
+		glm::vec3 worldExtent(0.0f);
+		for (int column = 0; column < 3; column++)
+			worldExtent += glm::abs(glm::vec3(transform[column])) * extent[column];
+
+		// Sphere: the radius grows with the largest axis scale
+		const float scale = std::max({ glm::length(glm::vec3(transform[0])),
+			glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) });
+
+		Bounds result;
+		result.Min = center - worldExtent;
+		result.Max = center + worldExtent;
+		result.Center = center;
+		result.Radius = Radius * scale;
+		return result;
+	}
+
+	Frustum Frustum::FromMatrix(const glm::mat4& m)
+	{
+		// Rows of the matrix; glm is column major
+		const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		Frustum frustum;
+		frustum.Planes[0] = row3 + row0;
+		frustum.Planes[1] = row3 - row0;
+		frustum.Planes[2] = row3 + row1;
+		frustum.Planes[3] = row3 - row1;
+		frustum.Planes[4] = row2;          // 0 <= z
+		frustum.Planes[5] = row3 - row2;   // z <= w
+
+		for (glm::vec4& plane : frustum.Planes)
+			plane /= glm::length(glm::vec3(plane));
+		return frustum;
+	}
+
+	bool Frustum::IntersectsBox(const glm::vec3& min, const glm::vec3& max) const
+	{
+		for (const glm::vec4& plane : Planes)
+		{
+			// The corner furthest along the plane normal
+			const glm::vec3 corner(plane.x >= 0.0f ? max.x : min.x,
+				plane.y >= 0.0f ? max.y : min.y,
+				plane.z >= 0.0f ? max.z : min.z);
+			if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	size_t CullSpheres(const Frustum& frustum, const SphereBatch& spheres, std::vector<uint8_t>& visible)
+	{
+		const size_t count = spheres.Size();
+		visible.resize(count);
+
+		size_t visibleCount = 0;
+		size_t i = 0;
+
+#if CUBED_FRUSTUM_SSE2
+		__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (int p = 0; p < 6; p++)
+		{
+			planeX[p] = _mm_set1_ps(frustum.Planes[p].x);
+			planeY[p] = _mm_set1_ps(frustum.Planes[p].y);
+			planeZ[p] = _mm_set1_ps(frustum.Planes[p].z);
+			planeW[p] = _mm_set1_ps(frustum.Planes[p].w);
+		}
+
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 x = _mm_loadu_ps(&spheres.X[i]);
+			const __m128 y = _mm_loadu_ps(&spheres.Y[i]);
+			const __m128 z = _mm_loadu_ps(&spheres.Z[i]);
+			const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.Radius[i]));
+
+			// A lane survives while its distance to every plane is >= -radius
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; p++)
+			{
+				__m128 distance = _mm_add_ps(_mm_mul_ps(x, planeX[p]), _mm_mul_ps(y, planeY[p]));
+				distance = _mm_add_ps(distance, _mm_add_ps(_mm_mul_ps(z, planeZ[p]), planeW[p]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+			}
+
+			const int mask = _mm_movemask_ps(inside);
+			for (int lane = 0; lane < 4; lane++)
+			{
+				const uint8_t laneVisible = (uint8_t)((mask >> lane) & 1);
+				visible[i + lane] = laneVisible;
+				visibleCount += laneVisible;
+			}
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			bool inside = true;
+			for (const glm::vec4& plane : frustum.Planes)
+			{
+				if (plane.x * spheres.X[i] + plane.y * spheres.Y[i] + plane.z * spheres.Z[i] + plane.w < -spheres.Radius[i])
+				{
+					inside = false;
+					break;
+				}
+			}
+			visible[i] = inside ? 1 : 0;
+			visibleCount += visible[i];
+		}
+
+		return visibleCount;
+	}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Cubed {
+
+	// Local-space bounds, computed once when the geometry is built
+	struct Bounds
+	{
+		glm::vec3 Min{ 0.0f };
+		glm::vec3 Max{ 0.0f };
+		glm::vec3 Center{ 0.0f };   // sphere center, the middle of the box
+		float Radius = 0.0f;
+
+		static Bounds FromPoints(const glm::vec3* points, size_t count, size_t stride = sizeof(glm::vec3));
+		void Merge(const Bounds& other);
+
+		// Conservative world-space bounds under an affine transform
+		Bounds Transformed(const glm::mat4& transform) const;
+	};
+
+	//
+	// Frustum - the six clip planes of a view-projection matrix (zero-to-one
+	// depth), normalized so plane distances compare directly against radii.
+	//
+	struct Frustum
+	{
+		glm::vec4 Planes[6];   // left, right, bottom, top, near, far - xyz points inwards
+
+		static Frustum FromMatrix(const glm::mat4& viewProjection);
+
+		bool IntersectsBox(const glm::vec3& min, const glm::vec3& max) const;
+	};
+
+	// Spheres in structure-of-arrays form, so four go through one set of SSE registers
+	struct SphereBatch
+	{
+		std::vector<float> X, Y, Z, Radius;
+
+		void Clear() { X.clear(); Y.clear(); Z.clear(); Radius.clear(); }
+		void Add(const glm::vec3& center, float radius)
+		{
+			X.push_back(center.x); Y.push_back(center.y); Z.push_back(center.z); Radius.push_back(radius);
+		}
+		size_t Size() const { return X.size(); }
+	};
+
+	// visible[i] is 1 when sphere i touches the frustum; returns how many do
+	size_t CullSpheres(const Frustum& frustum, const SphereBatch& spheres, std::vector<uint8_t>& visible);
+
+}
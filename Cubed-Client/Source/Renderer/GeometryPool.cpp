@@ -0,0 +1,341 @@
+#include "GeometryPool.h"
+#include "DeletionQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Cubed {
+
+	namespace {
+
+		// Per pool; a bigger upload gets a one-off staging buffer instead
+		constexpr uint64_t kStagingSize = 8 * 1024 * 1024;
+		constexpr uint64_t kStagingAlignment = 16;
+
+		constexpr VkBufferUsageFlagBits kStagingUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		constexpr VkBufferUsageFlagBits kVertexUsage = (VkBufferUsageFlagBits)(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+		constexpr VkBufferUsageFlagBits kIndexUsage = (VkBufferUsageFlagBits)(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+
+		void CreateBuffer(Buffer& buffer, VkBufferUsageFlagBits usage, uint64_t size, VkMemoryPropertyFlags properties)
+		{
+			VkDevice device = GetVulkanInfo()->Device;
+
+			VkBufferCreateInfo bi{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+			bi.size = size;
+			bi.usage = usage;
+			bi.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			VK_CHECK(vkCreateBuffer(device, &bi, nullptr, &buffer.Handle));
+
+			buffer.Memory = GpuAllocator::AllocateBuffer(buffer.Handle, properties);
+			buffer.Usage = usage;
+			buffer.Size = size;
+		}
+
+		void RetireBuffer(Buffer& buffer)
+		{
+			if (!buffer.Handle)
+				return;
+
+			DeletionQueue::ReleaseBuffer(buffer.Handle, buffer.Memory);
+			buffer = {};
+		}
+
+		void DestroyBuffer(Buffer& buffer)
+		{
+			if (buffer.Handle) vkDestroyBuffer(GetVulkanInfo()->Device, buffer.Handle, nullptr);
+			GpuAllocator::Free(buffer.Memory);
+			buffer = {};
+		}
+
+		void Write(const Buffer& buffer, uint64_t offset, const void* data, uint64_t size)
+		{
+			memcpy((uint8_t*)buffer.Memory.Mapped + offset, data, size);
+			GpuAllocator::Flush(buffer.Memory, offset, size);
+		}
+
+	}
+
+	GeometryPool::GeometryPool(uint32_t vertexStride, uint64_t initialVertices, uint64_t initialIndices)
+		: m_VertexStride(vertexStride), m_InitialVertices(initialVertices), m_InitialIndices(initialIndices),
+		m_Heap(std::make_shared<Heap>())
+	{
+	}
+
+	GeometryPool& GeometryPool::GetModelPool()
+	{
+		static GeometryPool s_ModelPool(sizeof(Vertex), 256 * 1024, 768 * 1024);
+		return s_ModelPool;
+	}
+
+	GeometryHandle GeometryPool::Allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+	{
+		if (vertexCount == 0 || indexCount == 0)
+			return InvalidGeometry;
+
+		// Buffers are created on first use, the device doesn't exist yet when the pool does
+		if (!m_VertexBuffer.Handle)
+		{
+			CreateBuffer(m_StagingBuffer, kStagingUsage, kStagingSize, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+			m_Staging = std::make_shared<FreeListAllocator>();
+			m_Staging->Reset(kStagingSize);
+			Rebuild(std::max<uint64_t>(m_InitialVertices, vertexCount), std::max<uint64_t>(m_InitialIndices, indexCount));
+		}
+
+		GeometryRange range;
+		if (!Reserve(vertexCount, indexCount, range))
+		{
+			// Compact in place when that leaves a quarter of headroom, otherwise double
+			const Heap& heap = *m_Heap;
+			uint64_t vertexCapacity = heap.Vertices.GetCapacity();
+			uint64_t indexCapacity = heap.Indices.GetCapacity();
+
+			uint64_t liveVertices = vertexCount, liveIndices = indexCount;
+			for (const Entry& entry : m_Entries)
+			{
+				if (!entry.Live)
+					continue;
+				liveVertices += entry.Range.VertexCount;
+				liveIndices += entry.Range.IndexCount;
+			}
+
+			while (vertexCapacity < liveVertices + liveVertices / 4)
+				vertexCapacity *= 2;
+			while (indexCapacity < liveIndices + liveIndices / 4)
+				indexCapacity *= 2;
+
+			Rebuild(vertexCapacity, indexCapacity);
+			if (!Reserve(vertexCount, indexCount, range))
+				return InvalidGeometry;
+		}
+
+		Stage(m_VertexBuffer, (uint64_t)range.VertexOffset * m_VertexStride, vertices, (uint64_t)vertexCount * m_VertexStride);
+		Stage(m_IndexBuffer, (uint64_t)range.FirstIndex * sizeof(uint32_t), indices, (uint64_t)indexCount * sizeof(uint32_t));
+
+		GeometryHandle handle;
+		if (!m_FreeHandles.empty())
+		{
+			handle = m_FreeHandles.back();
+			m_FreeHandles.pop_back();
+		}
+		else
+		{
+			handle = (GeometryHandle)m_Entries.size();
+			m_Entries.emplace_back();
+		}
+
+		m_Entries[handle] = { range, true };
+		m_Allocations++;
+		return handle;
+	}
+
+	void GeometryPool::Free(GeometryHandle handle)
+	{
+		if (handle == InvalidGeometry || handle >= m_Entries.size() || !m_Entries[handle].Live)
+			return;
+
+		Entry& entry = m_Entries[handle];
+		entry.Live = false;
+		m_FreeHandles.push_back(handle);
+		m_Allocations--;
+
+		// Returned to the heap the range came from - if the pool has been rebuilt
+		// since, that heap is already detached and this is a no-op in effect
+		SubmitResourceFree([heap = m_Heap, range = entry.Range]()
+		{
+			heap->Vertices.Free(range.VertexOffset, range.VertexCount);
+			heap->Indices.Free(range.FirstIndex, range.IndexCount);
+		});
+	}
+
+	void GeometryPool::FlushUploads(VkCommandBuffer commandBuffer)
+	{
+		if (m_PendingUploads.empty())
+			return;
+
+		RecordUploads(commandBuffer);
+
+		// Vertex fetch and index reads of this frame wait for the copies
+		VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	void GeometryPool::Bind(VkCommandBuffer commandBuffer) const
+	{
+		VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_VertexBuffer.Handle, &offset);
+		vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer.Handle, 0, VK_INDEX_TYPE_UINT32);
+	}
+
+	void GeometryPool::Defragment()
+	{
+		if (m_VertexBuffer.Handle)
+			Rebuild(m_Heap->Vertices.GetCapacity(), m_Heap->Indices.GetCapacity());
+	}
+
+	void GeometryPool::Destroy()
+	{
+		for (Upload& upload : m_PendingUploads)
+			DestroyBuffer(upload.Oversized);
+		m_PendingUploads.clear();
+
+		DestroyBuffer(m_VertexBuffer);
+		DestroyBuffer(m_IndexBuffer);
+		DestroyBuffer(m_StagingBuffer);
+		m_Staging.reset();
+
+		m_Heap = std::make_shared<Heap>();
+		m_Entries.clear();
+		m_FreeHandles.clear();
+		m_Allocations = 0;
+	}
+
+	GeometryPoolStats GeometryPool::GetStats() const
+	{
+		GeometryPoolStats stats;
+		stats.Allocations = m_Allocations;
+		stats.VertexCapacity = m_Heap->Vertices.GetCapacity();
+		stats.VerticesUsed = m_Heap->Vertices.GetUsedSpace();
+		stats.LargestFreeVertexBlock = m_Heap->Vertices.GetLargestFreeBlock();
+		stats.IndexCapacity = m_Heap->Indices.GetCapacity();
+		stats.IndicesUsed = m_Heap->Indices.GetUsedSpace();
+		stats.LargestFreeIndexBlock = m_Heap->Indices.GetLargestFreeBlock();
+		stats.Rebuilds = m_Rebuilds;
+		stats.UploadedBytes = m_UploadedBytes;
+		stats.OversizedUploads = m_OversizedUploads;
+		return stats;
+	}
+
+	bool GeometryPool::Reserve(uint32_t vertexCount, uint32_t indexCount, GeometryRange& range)
+	{
+		Heap& heap = *m_Heap;
+
+		uint64_t vertexOffset, firstIndex;
+		if (!heap.Vertices.Allocate(vertexCount, 1, vertexOffset))
+			return false;
+		if (!heap.Indices.Allocate(indexCount, 1, firstIndex))
+		{
+			heap.Vertices.Free(vertexOffset, vertexCount);
+			return false;
+		}
+
+		range = { (uint32_t)vertexOffset, vertexCount, (uint32_t)firstIndex, indexCount };
+		return true;
+	}
+
+	void GeometryPool::Rebuild(uint64_t vertexCapacity, uint64_t indexCapacity)
+	{
+		Buffer vertexBuffer, indexBuffer;
+		CreateBuffer(vertexBuffer, kVertexUsage, vertexCapacity * m_VertexStride, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		CreateBuffer(indexBuffer, kIndexUsage, indexCapacity * sizeof(uint32_t), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		// Frees still pending go to the old heap, only live meshes carry over
+		auto heap = std::make_shared<Heap>();
+		heap->Vertices.Reset(vertexCapacity);
+		heap->Indices.Reset(indexCapacity);
+
+		// Pack live meshes front to back
+		std::vector<VkBufferCopy> vertexCopies, indexCopies;
+		for (Entry& entry : m_Entries)
+		{
+			if (!entry.Live)
+				continue;
+
+			uint64_t vertexOffset = 0, firstIndex = 0;
+			heap->Vertices.Allocate(entry.Range.VertexCount, 1, vertexOffset);
+			heap->Indices.Allocate(entry.Range.IndexCount, 1, firstIndex);
+
+			vertexCopies.push_back({ (VkDeviceSize)entry.Range.VertexOffset * m_VertexStride, vertexOffset * m_VertexStride,
+				(VkDeviceSize)entry.Range.VertexCount * m_VertexStride });
+			indexCopies.push_back({ (VkDeviceSize)entry.Range.FirstIndex * sizeof(uint32_t), firstIndex * sizeof(uint32_t),
+				(VkDeviceSize)entry.Range.IndexCount * sizeof(uint32_t) });
+
+			entry.Range.VertexOffset = (uint32_t)vertexOffset;
+			entry.Range.FirstIndex = (uint32_t)firstIndex;
+		}
+
+		if (!vertexCopies.empty())
+		{
+			VkCommandBuffer commandBuffer = GetCommandBuffer();
+
+			// Staged data still targets the old buffers, land it before packing
+			if (!m_PendingUploads.empty())
+			{
+				RecordUploads(commandBuffer);
+
+				VkMemoryBarrier barrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+					0, 1, &barrier, 0, nullptr, 0, nullptr);
+			}
+
+			vkCmdCopyBuffer(commandBuffer, m_VertexBuffer.Handle, vertexBuffer.Handle, (uint32_t)vertexCopies.size(), vertexCopies.data());
+			vkCmdCopyBuffer(commandBuffer, m_IndexBuffer.Handle, indexBuffer.Handle, (uint32_t)indexCopies.size(), indexCopies.data());
+			FlushCommandBuffer(commandBuffer);
+		}
+
+		// Draws recorded this frame may still point at the old buffers
+		RetireBuffer(m_VertexBuffer);
+		RetireBuffer(m_IndexBuffer);
+
+		m_VertexBuffer = vertexBuffer;
+		m_IndexBuffer = indexBuffer;
+		m_Heap = std::move(heap);
+		m_Rebuilds++;
+	}
+
+	void GeometryPool::Stage(const Buffer& destination, uint64_t offset, const void* data, uint64_t size)
+	{
+		Upload upload;
+		upload.Destination = destination.Handle;
+		upload.Region.dstOffset = offset;
+		upload.Region.size = size;
+
+		uint64_t stagingOffset;
+		if (m_Staging->Allocate(size, kStagingAlignment, stagingOffset))
+		{
+			Write(m_StagingBuffer, stagingOffset, data, size);
+			upload.Region.srcOffset = stagingOffset;
+		}
+		else
+		{
+			CreateBuffer(upload.Oversized, kStagingUsage, size, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+			Write(upload.Oversized, 0, data, size);
+			m_OversizedUploads++;
+		}
+
+		m_PendingUploads.push_back(upload);
+		m_UploadedBytes += size;
+	}
+
+	void GeometryPool::RecordUploads(VkCommandBuffer commandBuffer)
+	{
+		std::vector<VkBufferCopy> released;
+		for (Upload& upload : m_PendingUploads)
+		{
+			if (upload.Oversized.Handle)
+			{
+				vkCmdCopyBuffer(commandBuffer, upload.Oversized.Handle, upload.Destination, 1, &upload.Region);
+				RetireBuffer(upload.Oversized);
+				continue;
+			}
+
+			vkCmdCopyBuffer(commandBuffer, m_StagingBuffer.Handle, upload.Destination, 1, &upload.Region);
+			released.push_back(upload.Region);
+		}
+		m_PendingUploads.clear();
+
+		if (released.empty())
+			return;
+
+		SubmitResourceFree([staging = m_Staging, released = std::move(released)]()
+		{
+			for (const VkBufferCopy& region : released)
+				staging->Free(region.srcOffset, region.size);
+		});
+	}
+
+}
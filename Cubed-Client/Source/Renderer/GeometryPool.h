@@ -0,0 +1,117 @@
+#pragma once
+
+#include "../Assets/Model.h"
+#include "FreeListAllocator.h"
+
+#include <memory>
+#include <vector>
+
+namespace Cubed {
+
+	using GeometryHandle = uint32_t;
+	constexpr GeometryHandle InvalidGeometry = UINT32_MAX;
+
+	// Where a mesh lives inside the pool's buffers - feed straight into vkCmdDrawIndexed
+	struct GeometryRange
+	{
+		uint32_t VertexOffset = 0;   // vertexOffset, in vertices
+		uint32_t VertexCount = 0;
+		uint32_t FirstIndex = 0;     // firstIndex, in indices
+		uint32_t IndexCount = 0;
+	};
+
+	struct GeometryPoolStats
+	{
+		uint32_t Allocations = 0;
+		uint64_t VertexCapacity = 0, VerticesUsed = 0, LargestFreeVertexBlock = 0;
+		uint64_t IndexCapacity = 0, IndicesUsed = 0, LargestFreeIndexBlock = 0;
+		uint32_t Rebuilds = 0;   // grows and defragmentations
+		uint64_t UploadedBytes = 0;
+		uint32_t OversizedUploads = 0;   // didn't fit the staging buffer
+	};
+
+	//
+	// GeometryPool - sub-allocates meshes of one vertex layout out of a single
+	// vertex buffer and a single index buffer, so a whole pass binds once and
+	// each draw only changes firstIndex/vertexOffset. Indices stay mesh-local.
+	//
+	// When an allocation doesn't fit the pool is rebuilt: live meshes are
+	// packed into fresh buffers by a GPU copy, growing them if compaction alone
+	// wouldn't leave enough room. Handles stay valid across rebuilds, ranges don't.
+	//
+	// The buffers are device local. Allocate() only writes into a host-visible
+	// staging buffer; the copies are recorded by FlushUploads(), which has to
+	// run before the first draw that uses the new geometry.
+	//
+	class GeometryPool
+	{
+	public:
+		GeometryPool(uint32_t vertexStride, uint64_t initialVertices, uint64_t initialIndices);
+
+		GeometryHandle Allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+		// The range is only reused once the frames in flight are done with it
+		void Free(GeometryHandle handle);
+
+		const GeometryRange& GetRange(GeometryHandle handle) const { return m_Entries[handle].Range; }
+
+		// Records pending staging copies; call outside a render pass
+		void FlushUploads(VkCommandBuffer commandBuffer);
+
+		void Bind(VkCommandBuffer commandBuffer) const;
+		VkBuffer GetVertexBuffer() const { return m_VertexBuffer.Handle; }
+		VkBuffer GetIndexBuffer() const { return m_IndexBuffer.Handle; }
+
+		void Defragment();
+		// Immediate, the device must be idle
+		void Destroy();
+
+		GeometryPoolStats GetStats() const;
+
+		// Shared pool for model meshes (Vertex layout)
+		static GeometryPool& GetModelPool();
+	private:
+		bool Reserve(uint32_t vertexCount, uint32_t indexCount, GeometryRange& range);
+		void Rebuild(uint64_t vertexCapacity, uint64_t indexCapacity);
+		void Stage(const Buffer& destination, uint64_t offset, const void* data, uint64_t size);
+		void RecordUploads(VkCommandBuffer commandBuffer);
+	private:
+		struct Entry
+		{
+			GeometryRange Range;
+			bool Live = false;
+		};
+
+		struct Upload
+		{
+			VkBuffer Destination = VK_NULL_HANDLE;
+			VkBufferCopy Region{};
+			Buffer Oversized;   // one-off staging buffer when the ring was full
+		};
+
+		// Shared with pending deferred frees, which may outlive a rebuild (or the pool)
+		struct Heap
+		{
+			FreeListAllocator Vertices;
+			FreeListAllocator Indices;
+		};
+
+		uint32_t m_VertexStride;
+		uint64_t m_InitialVertices, m_InitialIndices;
+
+		Buffer m_VertexBuffer, m_IndexBuffer;
+
+		// Staging space is returned once the frame that copied out of it has finished
+		Buffer m_StagingBuffer;
+		std::shared_ptr<FreeListAllocator> m_Staging;
+		std::vector<Upload> m_PendingUploads;
+
+		std::shared_ptr<Heap> m_Heap;
+		std::vector<Entry> m_Entries;
+		std::vector<GeometryHandle> m_FreeHandles;
+		uint32_t m_Allocations = 0;
+		uint32_t m_Rebuilds = 0;
+		uint64_t m_UploadedBytes = 0;
+		uint32_t m_OversizedUploads = 0;
+	};
+
+}
@@ -0,0 +1,363 @@
+#include "GpuAllocator.h"
+#include "FreeListAllocator.h"
+
+#include "Walnut/Core/Log.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+namespace Cubed {
+
+	namespace {
+
+		constexpr VkDeviceSize kBlockSize = 64 * 1024 * 1024;
+		constexpr uint32_t kNoBlock = UINT32_MAX;
+
+		struct Block
+		{
+			VkDeviceMemory Memory = VK_NULL_HANDLE;   // VK_NULL_HANDLE marks a released slot
+			VkDeviceSize Size = 0;
+			uint8_t* Mapped = nullptr;
+			uint32_t MemoryType = 0;
+			GpuResourceKind Kind = GpuResourceKind::Linear;
+			uint32_t Allocations = 0;
+			FreeListAllocator Ranges;
+		};
+
+		struct DedicatedAllocation
+		{
+			uint32_t MemoryType = 0;
+			VkDeviceSize Size = 0;
+		};
+
+		struct AllocatorData
+		{
+			std::mutex Mutex;
+			std::vector<Block> Blocks;
+			std::unordered_map<VkDeviceMemory, DedicatedAllocation> Dedicated;
+			VkDeviceSize AtomSize = 0;
+			bool ShutDown = false;
+		};
+
+		AllocatorData& GetData()
+		{
+			static AllocatorData s_Data;
+			return s_Data;
+		}
+
+		VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		VkMemoryPropertyFlags GetFlags(uint32_t memoryType)
+		{
+			return GetVulkanMemoryProperties().memoryTypes[memoryType].propertyFlags;
+		}
+
+		bool IsNonCoherent(VkMemoryPropertyFlags flags)
+		{
+			return (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		}
+
+		VkDeviceSize GetAtomSize(AllocatorData& data)
+		{
+			if (data.AtomSize == 0)
+			{
+				VkPhysicalDeviceProperties properties;
+				vkGetPhysicalDeviceProperties(GetVulkanInfo()->PhysicalDevice, &properties);
+				data.AtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+			}
+			return data.AtomSize;
+		}
+
+		// Allocation offset and size are atom aligned, so rounding outwards stays inside it
+		VkMappedMemoryRange GetMappedRange(const GpuAllocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+		{
+			const VkDeviceSize atomSize = GetAtomSize(GetData());
+			const VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.Size : std::min(offset + size, allocation.Size);
+
+			VkMappedMemoryRange range{ VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
+			range.memory = allocation.Memory;
+			range.offset = allocation.Offset + offset / atomSize * atomSize;
+			range.size = allocation.Offset + std::min(AlignUp(end, atomSize), allocation.Size) - range.offset;
+			return range;
+		}
+
+		// Small heaps (e.g. the 256 MB BAR window) get proportionally smaller blocks
+		VkDeviceSize GetBlockSize(uint32_t memoryType, VkDeviceSize atomSize)
+		{
+			const VkPhysicalDeviceMemoryProperties& properties = GetVulkanMemoryProperties();
+			const VkDeviceSize heapSize = properties.memoryHeaps[properties.memoryTypes[memoryType].heapIndex].size;
+			return std::max(std::min(kBlockSize, heapSize / 8) / atomSize * atomSize, atomSize);
+		}
+
+		VkDeviceMemory AllocateMemory(uint32_t memoryType, VkDeviceSize size, void** mapped)
+		{
+			VkDevice device = GetVulkanInfo()->Device;
+
+			VkMemoryAllocateInfo mai{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+			mai.allocationSize = size;
+			mai.memoryTypeIndex = memoryType;
+
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VK_CHECK(vkAllocateMemory(device, &mai, nullptr, &memory));
+			if (memory && (GetFlags(memoryType) & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+				VK_CHECK(vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mapped));
+			return memory;
+		}
+
+	}
+
+	GpuAllocation GpuAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+		GpuResourceKind kind, bool dedicated)
+	{
+		AllocatorData& data = GetData();
+		std::scoped_lock lock(data.Mutex);
+
+		GpuAllocation allocation;
+		if (data.ShutDown)
+			return allocation;
+
+		const uint32_t memoryType = GetVulkanMemoryType(properties, requirements.memoryTypeBits);
+		if (memoryType == UINT32_MAX)
+		{
+			WL_ERROR("No memory type with properties {} for type bits {}", properties, requirements.memoryTypeBits);
+			return allocation;
+		}
+
+		// Non-coherent ranges are padded to whole atoms so a flush never has to reach past them
+		VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+		VkDeviceSize size = requirements.size;
+		if (IsNonCoherent(GetFlags(memoryType)))
+		{
+			const VkDeviceSize atomSize = GetAtomSize(data);
+			alignment = std::max(alignment, atomSize);
+			size = AlignUp(size, atomSize);
+		}
+
+		const VkDeviceSize blockSize = GetBlockSize(memoryType, GetAtomSize(data));
+		if (dedicated || size > blockSize / 2)
+		{
+			void* mapped = nullptr;
+			VkDeviceMemory memory = AllocateMemory(memoryType, size, &mapped);
+			if (!memory)
+				return allocation;
+
+			data.Dedicated[memory] = { memoryType, size };
+			allocation.Memory = memory;
+			allocation.Size = size;
+			allocation.Mapped = mapped;
+			allocation.MemoryType = memoryType;
+			return allocation;
+		}
+
+		uint32_t blockIndex = kNoBlock;
+		uint64_t offset = 0;
+		for (uint32_t i = 0; i < (uint32_t)data.Blocks.size(); i++)
+		{
+			Block& block = data.Blocks[i];
+			if (!block.Memory || block.MemoryType != memoryType || block.Kind != kind)
+				continue;
+			if (block.Ranges.Allocate(size, alignment, offset))
+			{
+				blockIndex = i;
+				break;
+			}
+		}
+
+		if (blockIndex == kNoBlock)
+		{
+			void* mapped = nullptr;
+			VkDeviceMemory memory = AllocateMemory(memoryType, blockSize, &mapped);
+			if (!memory)
+				return allocation;
+
+			auto slot = std::find_if(data.Blocks.begin(), data.Blocks.end(), [](const Block& block) { return !block.Memory; });
+			blockIndex = (uint32_t)(slot - data.Blocks.begin());
+			if (slot == data.Blocks.end())
+				data.Blocks.emplace_back();
+
+			Block& block = data.Blocks[blockIndex];
+			block.Memory = memory;
+			block.Size = blockSize;
+			block.Mapped = (uint8_t*)mapped;
+			block.MemoryType = memoryType;
+			block.Kind = kind;
+			block.Allocations = 0;
+			block.Ranges.Reset(blockSize);
+			block.Ranges.Allocate(size, alignment, offset);
+		}
+
+		Block& block = data.Blocks[blockIndex];
+		block.Allocations++;
+
+		allocation.Memory = block.Memory;
+		allocation.Offset = offset;
+		allocation.Size = size;
+		allocation.Mapped = block.Mapped ? block.Mapped + offset : nullptr;
+		allocation.MemoryType = memoryType;
+		allocation.Block = blockIndex;
+		return allocation;
+	}
+
+	GpuAllocation GpuAllocator::AllocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties)
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+
+		VkMemoryRequirements req{};
+		vkGetBufferMemoryRequirements(device, buffer, &req);
+
+		GpuAllocation allocation = Allocate(req, properties, GpuResourceKind::Linear);
+		if (allocation)
+			VK_CHECK(vkBindBufferMemory(device, buffer, allocation.Memory, allocation.Offset));
+		return allocation;
+	}
+
+	GpuAllocation GpuAllocator::AllocateImage(VkImage image, VkMemoryPropertyFlags properties, bool dedicated)
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+
+		VkMemoryRequirements req{};
+		vkGetImageMemoryRequirements(device, image, &req);
+
+		GpuAllocation allocation = Allocate(req, properties, GpuResourceKind::Optimal, dedicated);
+		if (allocation)
+			VK_CHECK(vkBindImageMemory(device, image, allocation.Memory, allocation.Offset));
+		return allocation;
+	}
+
+	void GpuAllocator::Free(GpuAllocation& allocation)
+	{
+		AllocatorData& data = GetData();
+		std::scoped_lock lock(data.Mutex);
+
+		if (!allocation || data.ShutDown)
+		{
+			allocation = {};
+			return;
+		}
+
+		VkDevice device = GetVulkanInfo()->Device;
+		if (allocation.Block == kNoBlock)
+		{
+			vkFreeMemory(device, allocation.Memory, nullptr);
+			data.Dedicated.erase(allocation.Memory);
+			allocation = {};
+			return;
+		}
+
+		Block& block = data.Blocks[allocation.Block];
+		block.Ranges.Free(allocation.Offset, allocation.Size);
+		allocation = {};
+
+		if (--block.Allocations > 0)
+			return;
+
+		// Keep one empty block per type around so a free/allocate pair doesn't hit the driver
+		for (const Block& other : data.Blocks)
+		{
+			if (&other == &block || !other.Memory || other.Allocations > 0)
+				continue;
+			if (other.MemoryType == block.MemoryType && other.Kind == block.Kind)
+			{
+				vkFreeMemory(device, block.Memory, nullptr);
+				block = {};
+				return;
+			}
+		}
+	}
+
+	void GpuAllocator::Flush(const GpuAllocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+	{
+		if (!allocation.Mapped || !IsNonCoherent(GetFlags(allocation.MemoryType)))
+			return;
+
+		const VkMappedMemoryRange range = GetMappedRange(allocation, offset, size);
+		VK_CHECK(vkFlushMappedMemoryRanges(GetVulkanInfo()->Device, 1, &range));
+	}
+
+	void GpuAllocator::Invalidate(const GpuAllocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+	{
+		if (!allocation.Mapped || !IsNonCoherent(GetFlags(allocation.MemoryType)))
+			return;
+
+		const VkMappedMemoryRange range = GetMappedRange(allocation, offset, size);
+		VK_CHECK(vkInvalidateMappedMemoryRanges(GetVulkanInfo()->Device, 1, &range));
+	}
+
+	GpuAllocatorStats GpuAllocator::GetStats()
+	{
+		AllocatorData& data = GetData();
+		std::scoped_lock lock(data.Mutex);
+
+		GpuMemoryTypeStats types[VK_MAX_MEMORY_TYPES]{};
+		VkDeviceSize freeBytes = 0;
+
+		for (const Block& block : data.Blocks)
+		{
+			if (!block.Memory)
+				continue;
+
+			GpuMemoryTypeStats& type = types[block.MemoryType];
+			type.Blocks++;
+			type.Allocations += block.Allocations;
+			type.BlockBytes += block.Size;
+			type.UsedBytes += block.Ranges.GetUsedSpace();
+			type.LargestFreeRegion = std::max(type.LargestFreeRegion, block.Ranges.GetLargestFreeBlock());
+			type.FreeRegions += (uint32_t)block.Ranges.GetFreeBlockCount();
+			freeBytes += block.Ranges.GetFreeSpace();
+		}
+
+		for (const auto& [memory, dedicated] : data.Dedicated)
+		{
+			GpuMemoryTypeStats& type = types[dedicated.MemoryType];
+			type.Dedicated++;
+			type.DedicatedBytes += dedicated.Size;
+		}
+
+		GpuAllocatorStats stats;
+		for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++)
+		{
+			GpuMemoryTypeStats& type = types[i];
+			if (type.Blocks == 0 && type.Dedicated == 0)
+				continue;
+
+			type.MemoryType = i;
+			type.Flags = GetFlags(i);
+
+			stats.Blocks += type.Blocks;
+			stats.Allocations += type.Allocations + type.Dedicated;
+			stats.Dedicated += type.Dedicated;
+			stats.BlockBytes += type.BlockBytes;
+			stats.UsedBytes += type.UsedBytes;
+			stats.DedicatedBytes += type.DedicatedBytes;
+			stats.LargestFreeRegion = std::max(stats.LargestFreeRegion, type.LargestFreeRegion);
+			stats.FreeRegions += type.FreeRegions;
+			stats.Types.push_back(type);
+		}
+
+		if (freeBytes > 0)
+			stats.Fragmentation = 1.0f - (float)stats.LargestFreeRegion / (float)freeBytes;
+		return stats;
+	}
+
+	void GpuAllocator::Shutdown()
+	{
+		AllocatorData& data = GetData();
+		std::scoped_lock lock(data.Mutex);
+
+		VkDevice device = GetVulkanInfo()->Device;
+		for (Block& block : data.Blocks)
+			if (block.Memory)
+				vkFreeMemory(device, block.Memory, nullptr);
+		for (const auto& [memory, dedicated] : data.Dedicated)
+			vkFreeMemory(device, memory, nullptr);
+
+		data.Blocks.clear();
+		data.Dedicated.clear();
+		data.ShutDown = true;
+	}
+
+}
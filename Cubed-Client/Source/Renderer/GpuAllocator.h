@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Vulkan.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Cubed {
+
+	// A range of device memory handed out by GpuAllocator
+	struct GpuAllocation
+	{
+		VkDeviceMemory Memory = VK_NULL_HANDLE;
+		VkDeviceSize Offset = 0;
+		VkDeviceSize Size = 0;
+		void* Mapped = nullptr;           // host-visible memory stays mapped for its whole lifetime
+		uint32_t MemoryType = UINT32_MAX;
+		uint32_t Block = UINT32_MAX;      // UINT32_MAX for dedicated allocations
+
+		explicit operator bool() const { return Memory != VK_NULL_HANDLE; }
+	};
+
+	// Buffers and optimal-tiling images never share a block, so bufferImageGranularity can be ignored
+	enum class GpuResourceKind : uint8_t
+	{
+		Linear = 0,
+		Optimal
+	};
+
+	struct GpuMemoryTypeStats
+	{
+		uint32_t MemoryType = 0;
+		VkMemoryPropertyFlags Flags = 0;
+		uint32_t Blocks = 0, Allocations = 0, Dedicated = 0;
+		VkDeviceSize BlockBytes = 0, UsedBytes = 0, DedicatedBytes = 0;
+		VkDeviceSize LargestFreeRegion = 0;
+		uint32_t FreeRegions = 0;
+	};
+
+	struct GpuAllocatorStats
+	{
+		uint32_t Blocks = 0, Allocations = 0, Dedicated = 0;
+		VkDeviceSize BlockBytes = 0, UsedBytes = 0, DedicatedBytes = 0;
+		VkDeviceSize LargestFreeRegion = 0;
+		uint32_t FreeRegions = 0;
+		float Fragmentation = 0.0f;   // 1 - largest free region / free bytes, over all blocks
+		std::vector<GpuMemoryTypeStats> Types;   // only the types in use
+	};
+
+	//
+	// GpuAllocator - sub-allocates device memory out of large blocks, one set of
+	// blocks per memory type and resource kind, instead of a vkAllocateMemory per
+	// resource. Requests too big for a block (or flagged dedicated, like render
+	// targets) get their own allocation.
+	//
+	class GpuAllocator
+	{
+	public:
+		static GpuAllocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+			GpuResourceKind kind, bool dedicated = false);
+		// Allocate and bind in one go
+		static GpuAllocation AllocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties);
+		static GpuAllocation AllocateImage(VkImage image, VkMemoryPropertyFlags properties, bool dedicated = false);
+		static void Free(GpuAllocation& allocation);
+
+		// Flushes [offset, offset + size) of the allocation; a no-op on coherent memory
+		static void Flush(const GpuAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+		// Makes device writes to the range visible to the host, after they have been waited on
+		static void Invalidate(const GpuAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+		static GpuAllocatorStats GetStats();
+
+		// Releases every block; the device must be idle. Frees arriving afterwards are ignored.
+		static void Shutdown();
+	};
+
+}
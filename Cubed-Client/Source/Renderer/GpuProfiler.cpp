@@ -0,0 +1,249 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace Cubed {
+
+	namespace {
+
+		constexpr uint32_t kQueriesPerFrame = GpuProfiler::MaxScopes * 2;
+		constexpr uint32_t kNoScope = UINT32_MAX;
+
+		// Results come back in bit order: vertex, clipping, fragment
+		constexpr VkQueryPipelineStatisticFlags kStatistics = VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT
+			| VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+		VkQueryPool CreateQueryPool(VkQueryType type, uint32_t count, VkQueryPipelineStatisticFlags statistics = 0)
+		{
+			VkQueryPoolCreateInfo info{ VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+			info.queryType = type;
+			info.queryCount = count;
+			info.pipelineStatistics = statistics;
+
+			VkQueryPool pool = VK_NULL_HANDLE;
+			VK_CHECK(vkCreateQueryPool(GetVulkanInfo()->Device, &info, nullptr, &pool));
+			return pool;
+		}
+
+		void RetireQueryPool(VkQueryPool& pool)
+		{
+			if (!pool)
+				return;
+
+			VkQueryPool handle = pool;
+			SubmitResourceFree([handle]()
+			{
+				vkDestroyQueryPool(GetVulkanInfo()->Device, handle, nullptr);
+			});
+			pool = VK_NULL_HANDLE;
+		}
+
+	}
+
+	void GpuProfiler::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t frameCount)
+	{
+		if (!m_Initialized)
+		{
+			VkPhysicalDevice physicalDevice = GetVulkanInfo()->PhysicalDevice;
+
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+			m_TimestampPeriod = properties.limits.timestampPeriod;
+
+			uint32_t familyCount = 0;
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+			std::vector<VkQueueFamilyProperties> families(familyCount);
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+			const uint32_t family = GetVulkanInfo()->QueueFamily;
+			m_TimestampValidBits = family < familyCount ? families[family].timestampValidBits : 0;
+
+			// The GPU supporting the query isn't enough, the device has to have been created with it
+			m_StatisticsSupported = GetEnabledVulkanFeatures().Core.pipelineStatisticsQuery;
+
+			m_Initialized = true;
+		}
+
+		if (frameCount != m_Frames.size())
+			Recreate(frameCount);
+		if (m_StatisticsEnabled && !m_StatisticsPool)
+			m_StatisticsPool = CreateQueryPool(VK_QUERY_TYPE_PIPELINE_STATISTICS, frameCount, kStatistics);
+
+		// This slot's last frame has finished, its results are ready
+		m_FrameIndex = frameIndex;
+		m_ReadBackCount++;
+		ReadBack(frameIndex);
+
+		FrameQueries& frame = m_Frames[frameIndex];
+		frame.Scopes.clear();
+		frame.Open.clear();
+		frame.Used = 0;
+		frame.Statistics = false;
+
+		if (m_Timestamps)
+			vkCmdResetQueryPool(commandBuffer, m_Timestamps, frameIndex * kQueriesPerFrame, kQueriesPerFrame);
+		if (m_StatisticsPool)
+			vkCmdResetQueryPool(commandBuffer, m_StatisticsPool, frameIndex, 1);
+	}
+
+	void GpuProfiler::BeginScope(VkCommandBuffer commandBuffer, const char* name)
+	{
+		if (!m_Timestamps)
+			return;
+
+		FrameQueries& frame = m_Frames[m_FrameIndex];
+		if (frame.Scopes.size() == MaxScopes)
+		{
+			frame.Open.push_back(kNoScope);
+			return;
+		}
+
+		const GpuScope scope{ name, frame.Used++, kNoScope };
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_Timestamps, m_FrameIndex * kQueriesPerFrame + scope.Begin);
+		frame.Open.push_back((uint32_t)frame.Scopes.size());
+		frame.Scopes.push_back(scope);
+	}
+
+	void GpuProfiler::EndScope(VkCommandBuffer commandBuffer)
+	{
+		if (!m_Timestamps)
+			return;
+
+		FrameQueries& frame = m_Frames[m_FrameIndex];
+		if (frame.Open.empty())
+			return;
+
+		const uint32_t index = frame.Open.back();
+		frame.Open.pop_back();
+		if (index == kNoScope)
+			return;
+
+		GpuScope& scope = frame.Scopes[index];
+		scope.End = frame.Used++;
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_Timestamps, m_FrameIndex * kQueriesPerFrame + scope.End);
+	}
+
+	void GpuProfiler::BeginStatistics(VkCommandBuffer commandBuffer)
+	{
+		if (!m_StatisticsEnabled || !m_StatisticsPool)
+			return;
+
+		vkCmdBeginQuery(commandBuffer, m_StatisticsPool, m_FrameIndex, 0);
+		m_Frames[m_FrameIndex].Statistics = true;
+	}
+
+	void GpuProfiler::EndStatistics(VkCommandBuffer commandBuffer)
+	{
+		if (m_Frames.empty() || !m_Frames[m_FrameIndex].Statistics)
+			return;
+
+		vkCmdEndQuery(commandBuffer, m_StatisticsPool, m_FrameIndex);
+	}
+
+	void GpuProfiler::RecordCpuTime(const char* name, float milliseconds)
+	{
+		Record(name, false, milliseconds);
+	}
+
+	void GpuProfiler::Destroy()
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+		if (m_Timestamps) vkDestroyQueryPool(device, m_Timestamps, nullptr);
+		if (m_StatisticsPool) vkDestroyQueryPool(device, m_StatisticsPool, nullptr);
+		m_Timestamps = VK_NULL_HANDLE;
+		m_StatisticsPool = VK_NULL_HANDLE;
+		m_Frames.clear();
+	}
+
+	void GpuProfiler::Recreate(uint32_t frameCount)
+	{
+		// Frames still in flight write into the old pools
+		RetireQueryPool(m_Timestamps);
+		RetireQueryPool(m_StatisticsPool);
+
+		m_Frames.assign(frameCount, {});
+		if (m_TimestampValidBits != 0)
+			m_Timestamps = CreateQueryPool(VK_QUERY_TYPE_TIMESTAMP, frameCount * kQueriesPerFrame);
+	}
+
+	void GpuProfiler::ReadBack(uint32_t frameIndex)
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+		const FrameQueries& frame = m_Frames[frameIndex];
+
+		if (frame.Used > 0)
+		{
+			uint64_t ticks[kQueriesPerFrame];
+			const VkResult result = vkGetQueryPoolResults(device, m_Timestamps, frameIndex * kQueriesPerFrame, frame.Used,
+				sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+			if (result == VK_SUCCESS)
+			{
+				const uint64_t mask = m_TimestampValidBits >= 64 ? UINT64_MAX : (1ull << m_TimestampValidBits) - 1;
+				for (const GpuScope& scope : frame.Scopes)
+				{
+					if (scope.End == kNoScope)
+						continue;
+					const uint64_t elapsed = (ticks[scope.End] - ticks[scope.Begin]) & mask;
+					Record(scope.Name, true, (float)(elapsed * (double)m_TimestampPeriod / 1e6));
+				}
+			}
+		}
+
+		if (frame.Statistics)
+		{
+			uint64_t statistics[3];
+			if (vkGetQueryPoolResults(device, m_StatisticsPool, frameIndex, 1, sizeof(statistics), statistics,
+				sizeof(statistics), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+			{
+				m_Statistics.VertexInvocations = statistics[0];
+				m_Statistics.ClippingPrimitives = statistics[1];
+				m_Statistics.FragmentInvocations = statistics[2];
+			}
+		}
+	}
+
+	const ProfilerScope* GpuProfiler::FindScope(std::string_view name, bool gpu) const
+	{
+		for (const ProfilerScope& scope : m_Scopes)
+		{
+			if (scope.Gpu == gpu && scope.Name == name)
+				return &scope;
+		}
+		return nullptr;
+	}
+
+	float GpuProfiler::GetReadBackTime(std::string_view name) const
+	{
+		const ProfilerScope* scope = FindScope(name, true);
+		return scope && scope->ReadBack == m_ReadBackCount ? scope->Last : 0.0f;
+	}
+
+	void GpuProfiler::Record(const char* name, bool gpu, float milliseconds)
+	{
+		ProfilerScope* scope = nullptr;
+		for (ProfilerScope& existing : m_Scopes)
+		{
+			if (existing.Gpu == gpu && existing.Name == name)
+			{
+				scope = &existing;
+				break;
+			}
+		}
+
+		if (!scope)
+		{
+			scope = &m_Scopes.emplace_back();
+			scope->Name = name;
+			scope->Gpu = gpu;
+		}
+
+		scope->History[scope->Head] = milliseconds;
+		scope->Head = (scope->Head + 1) % ProfilerScope::HistorySize;
+		scope->Samples = std::min(scope->Samples + 1, ProfilerScope::HistorySize);
+		scope->Last = milliseconds;
+		scope->ReadBack = gpu ? m_ReadBackCount : 0;
+		scope->Average = std::accumulate(scope->History.begin(), scope->History.end(), 0.0f) / scope->Samples;
+	}
+
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Vulkan.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Cubed {
+
+	// Rolling history of one named scope, in milliseconds
+	struct ProfilerScope
+	{
+		static constexpr uint32_t HistorySize = 120;
+
+		std::string Name;
+		bool Gpu = false;
+		std::array<float, HistorySize> History{};
+		uint32_t Head = 0;   // next slot to write, History is a ring
+		uint32_t Samples = 0;
+		float Last = 0.0f;
+		float Average = 0.0f;
+		uint64_t ReadBack = 0;   // GPU scopes: the BeginFrame whose read-back set Last
+	};
+
+	// Of the last frame that had them enabled
+	struct PipelineStatistics
+	{
+		uint64_t VertexInvocations = 0;
+		uint64_t FragmentInvocations = 0;
+		uint64_t ClippingPrimitives = 0;
+	};
+
+	//
+	// GpuProfiler - timestamp queries around named scopes of the frame's
+	// command buffer, with a query range per frame in flight. A range is read
+	// back when its frame slot comes round again, so results lag by the
+	// number of frames in flight but never stall. CPU timings go into the
+	// same scope list so both can be compared side by side.
+	//
+	// Timestamps can only be written outside render passes that execute
+	// secondary command buffers, so GPU scopes bracket whole passes.
+	//
+	class GpuProfiler
+	{
+	public:
+		static constexpr uint32_t MaxScopes = 32;   // GPU scopes per frame
+
+		// Reads back this slot's previous results and resets its queries; call outside a render pass
+		void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t frameCount);
+
+		void BeginScope(VkCommandBuffer commandBuffer, const char* name);
+		void EndScope(VkCommandBuffer commandBuffer);
+
+		// Needs pipelineStatisticsQuery enabled on the device; the query can't span secondary command buffers
+		bool IsPipelineStatisticsSupported() const { return m_StatisticsSupported; }
+		bool IsPipelineStatisticsEnabled() const { return m_StatisticsEnabled; }
+		void SetPipelineStatistics(bool enabled) { m_StatisticsEnabled = enabled && m_StatisticsSupported; }
+		void BeginStatistics(VkCommandBuffer commandBuffer);
+		void EndStatistics(VkCommandBuffer commandBuffer);
+
+		void RecordCpuTime(const char* name, float milliseconds);
+
+		// Releases the query pools; the device must be idle
+		void Destroy();
+
+		bool IsTimestampSupported() const { return m_TimestampValidBits != 0; }
+		const std::vector<ProfilerScope>& GetScopes() const { return m_Scopes; }
+		// Null until the scope has been recorded once
+		const ProfilerScope* FindScope(std::string_view name, bool gpu) const;
+		// GPU time of the scope read back by the latest BeginFrame, 0 if its queries had no result then
+		float GetReadBackTime(std::string_view name) const;
+		const PipelineStatistics& GetPipelineStatistics() const { return m_Statistics; }
+
+		// Times the enclosing block on the CPU
+		class CpuScope
+		{
+		public:
+			CpuScope(GpuProfiler& profiler, const char* name)
+				: m_Profiler(profiler), m_Name(name), m_Start(std::chrono::steady_clock::now()) {}
+			~CpuScope()
+			{
+				m_Profiler.RecordCpuTime(m_Name, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_Start).count());
+			}
+		private:
+			GpuProfiler& m_Profiler;
+			const char* m_Name;
+			std::chrono::steady_clock::time_point m_Start;
+		};
+	private:
+		void Recreate(uint32_t frameCount);
+		void ReadBack(uint32_t frameIndex);
+		void Record(const char* name, bool gpu, float milliseconds);
+	private:
+		struct GpuScope
+		{
+			const char* Name;
+			uint32_t Begin, End;   // query indices within the frame's range
+		};
+
+		struct FrameQueries
+		{
+			std::vector<GpuScope> Scopes;
+			std::vector<uint32_t> Open;   // indices into Scopes, innermost last
+			uint32_t Used = 0;
+			bool Statistics = false;
+		};
+
+		VkQueryPool m_Timestamps = VK_NULL_HANDLE;
+		VkQueryPool m_StatisticsPool = VK_NULL_HANDLE;
+		std::vector<FrameQueries> m_Frames;
+		uint32_t m_FrameIndex = 0;
+		uint64_t m_ReadBackCount = 0;   // BeginFrame calls so far
+		bool m_Initialized = false;
+
+		uint32_t m_TimestampValidBits = 0;
+		float m_TimestampPeriod = 1.0f;   // nanoseconds per tick
+		bool m_StatisticsSupported = false;
+		bool m_StatisticsEnabled = false;
+
+		std::vector<ProfilerScope> m_Scopes;
+		PipelineStatistics m_Statistics;
+	};
+
+}
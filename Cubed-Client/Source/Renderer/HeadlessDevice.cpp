@@ -0,0 +1,406 @@
+#include "HeadlessDevice.h"
+#include "DeletionQueue.h"
+
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace Cubed {
+
+	namespace {
+
+		constexpr const char* kValidationLayer = "VK_LAYER_KHRONOS_validation";
+
+		bool HasLayer(const char* name)
+		{
+			uint32_t count = 0;
+			vkEnumerateInstanceLayerProperties(&count, nullptr);
+			std::vector<VkLayerProperties> layers(count);
+			vkEnumerateInstanceLayerProperties(&count, layers.data());
+			for (const VkLayerProperties& layer : layers)
+				if (strcmp(layer.layerName, name) == 0)
+					return true;
+			return false;
+		}
+
+		// A family that can do both the graphics passes and the Hi-Z compute pass
+		uint32_t FindQueueFamily(VkPhysicalDevice physicalDevice)
+		{
+			uint32_t count = 0;
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &count, nullptr);
+			std::vector<VkQueueFamilyProperties> families(count);
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &count, families.data());
+
+			const VkQueueFlags required = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+			for (uint32_t i = 0; i < count; i++)
+				if ((families[i].queueFlags & required) == required)
+					return i;
+			return UINT32_MAX;
+		}
+
+	}
+
+	HeadlessDevice::HeadlessDevice(const HeadlessSettings& settings)
+		: m_Settings(settings)
+	{
+		if (m_Settings.FrameCount == 0)
+			m_Settings.FrameCount = 1;
+
+		CreateInstance();
+		CreateDevice();
+
+		// Everything from here on (GpuAllocator included) asks the host for the device
+		SetVulkanHost(this);
+
+		CreateFrames();
+		CreateColorImages();
+	}
+
+	HeadlessDevice::~HeadlessDevice()
+	{
+		VkDevice device = m_Info.Device;
+		WaitIdle();
+
+		// Whatever was released after the renderer shut down
+		DeletionQueue::Flush();
+
+		for (Frame& frame : m_Frames)
+			vkDestroyFence(device, frame.Fence, nullptr);
+		m_Frames.clear();
+
+		for (size_t i = 0; i < m_ColorImages.size(); i++)
+		{
+			vkDestroyImageView(device, m_ColorViews[i], nullptr);
+			vkDestroyImage(device, m_ColorImages[i], nullptr);
+			GpuAllocator::Free(m_ColorMemory[i]);
+		}
+
+		vkDestroyDescriptorPool(device, m_DescriptorPool, nullptr);
+		vkDestroyCommandPool(device, m_CommandPool, nullptr);
+		vkDestroyDevice(device, nullptr);
+		vkDestroyInstance(m_Info.Instance, nullptr);
+
+		SetVulkanHost(nullptr);
+	}
+
+	void HeadlessDevice::CreateInstance()
+	{
+		VkApplicationInfo appInfo{ VK_STRUCTURE_TYPE_APPLICATION_INFO };
+		appInfo.pApplicationName = "Cubed Headless";
+		appInfo.pEngineName = "Cubed";
+		appInfo.apiVersion = VK_API_VERSION_1_2;
+
+		VkInstanceCreateInfo createInfo{ VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO };
+		createInfo.pApplicationInfo = &appInfo;
+		if (m_Settings.Validation && HasLayer(kValidationLayer))
+		{
+			createInfo.enabledLayerCount = 1;
+			createInfo.ppEnabledLayerNames = &kValidationLayer;
+		}
+
+		if (vkCreateInstance(&createInfo, nullptr, &m_Info.Instance) != VK_SUCCESS)
+			throw std::runtime_error("HeadlessDevice: failed to create a Vulkan instance");
+	}
+
+	void HeadlessDevice::CreateDevice()
+	{
+		uint32_t count = 0;
+		vkEnumeratePhysicalDevices(m_Info.Instance, &count, nullptr);
+		std::vector<VkPhysicalDevice> physicalDevices(count);
+		vkEnumeratePhysicalDevices(m_Info.Instance, &count, physicalDevices.data());
+
+		// The texture table's descriptor indexing path is core from 1.2
+		auto usable = [](VkPhysicalDevice physicalDevice)
+		{
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+			return properties.apiVersion >= VK_API_VERSION_1_2 && FindQueueFamily(physicalDevice) != UINT32_MAX;
+		};
+		auto rank = [](VkPhysicalDevice physicalDevice)
+		{
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+			switch (properties.deviceType)
+			{
+			case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return 3;
+			case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return 2;
+			case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return 1;
+			default: return 0;   // CPU implementations such as lavapipe
+			}
+		};
+
+		VkPhysicalDevice chosen = VK_NULL_HANDLE;
+		if (m_Settings.DeviceIndex >= 0)
+		{
+			if ((uint32_t)m_Settings.DeviceIndex < count && usable(physicalDevices[m_Settings.DeviceIndex]))
+				chosen = physicalDevices[m_Settings.DeviceIndex];
+		}
+		else
+		{
+			for (VkPhysicalDevice physicalDevice : physicalDevices)
+				if (usable(physicalDevice) && (!chosen || rank(physicalDevice) > rank(chosen)))
+					chosen = physicalDevice;
+		}
+		if (!chosen)
+			throw std::runtime_error("HeadlessDevice: no Vulkan 1.2 device with a graphics and compute queue");
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(chosen, &properties);
+		m_DeviceName = properties.deviceName;
+
+		m_Info.PhysicalDevice = chosen;
+		m_Info.QueueFamily = FindQueueFamily(chosen);
+
+		// Every optional feature the renderer can use is enabled where supported;
+		// it checks GetEnabledFeatures before using one
+		VkPhysicalDeviceDescriptorIndexingFeatures supportedIndexing{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES };
+		VkPhysicalDeviceFeatures2 supported{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+		supported.pNext = &supportedIndexing;
+		vkGetPhysicalDeviceFeatures2(chosen, &supported);
+
+		VkPhysicalDeviceDescriptorIndexingFeatures indexing{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES };
+		indexing.descriptorBindingPartiallyBound = supportedIndexing.descriptorBindingPartiallyBound;
+		indexing.descriptorBindingVariableDescriptorCount = supportedIndexing.descriptorBindingVariableDescriptorCount;
+		indexing.descriptorBindingSampledImageUpdateAfterBind = supportedIndexing.descriptorBindingSampledImageUpdateAfterBind;
+		indexing.descriptorBindingUpdateUnusedWhilePending = supportedIndexing.descriptorBindingUpdateUnusedWhilePending;
+		indexing.shaderSampledImageArrayNonUniformIndexing = supportedIndexing.shaderSampledImageArrayNonUniformIndexing;
+
+		VkPhysicalDeviceFeatures2 features{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+		features.pNext = &indexing;
+		features.features.multiDrawIndirect = supported.features.multiDrawIndirect;
+		features.features.drawIndirectFirstInstance = supported.features.drawIndirectFirstInstance;
+		features.features.pipelineStatisticsQuery = supported.features.pipelineStatisticsQuery;
+
+		const float priority = 1.0f;
+		VkDeviceQueueCreateInfo queueInfo{ VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO };
+		queueInfo.queueFamilyIndex = m_Info.QueueFamily;
+		queueInfo.queueCount = 1;
+		queueInfo.pQueuePriorities = &priority;
+
+		VkDeviceCreateInfo createInfo{ VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
+		createInfo.pNext = &features;
+		createInfo.queueCreateInfoCount = 1;
+		createInfo.pQueueCreateInfos = &queueInfo;
+
+		if (vkCreateDevice(chosen, &createInfo, nullptr, &m_Info.Device) != VK_SUCCESS)
+			throw std::runtime_error("HeadlessDevice: failed to create a device on " + m_DeviceName);
+		m_EnabledFeatures.Core = features.features;
+		m_EnabledFeatures.DescriptorIndexing = indexing;
+		m_EnabledFeatures.DescriptorIndexing.pNext = nullptr;
+		vkGetDeviceQueue(m_Info.Device, m_Info.QueueFamily, 0, &m_Info.Queue);
+
+		// Sized like Walnut's pool
+		VkDescriptorPoolSize poolSizes[] = {
+			{ VK_DESCRIPTOR_TYPE_SAMPLER, 1000 },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000 },
+			{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1000 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1000 },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1000 },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1000 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1000 },
+		};
+		VkDescriptorPoolCreateInfo poolInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+		poolInfo.maxSets = 1000 * (uint32_t)std::size(poolSizes);
+		poolInfo.poolSizeCount = (uint32_t)std::size(poolSizes);
+		poolInfo.pPoolSizes = poolSizes;
+		VK_CHECK(vkCreateDescriptorPool(m_Info.Device, &poolInfo, nullptr, &m_DescriptorPool));
+		m_Info.DescriptorPool = m_DescriptorPool;
+
+		m_Info.MinImageCount = m_Settings.FrameCount;
+		m_Info.ImageCount = m_Settings.FrameCount;
+		m_Info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+	}
+
+	void HeadlessDevice::CreateFrames()
+	{
+		VkDevice device = m_Info.Device;
+
+		VkCommandPoolCreateInfo poolInfo{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		poolInfo.queueFamilyIndex = m_Info.QueueFamily;
+		VK_CHECK(vkCreateCommandPool(device, &poolInfo, nullptr, &m_CommandPool));
+
+		m_Frames.resize(m_Settings.FrameCount);
+		for (Frame& frame : m_Frames)
+		{
+			VkCommandBufferAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+			allocInfo.commandPool = m_CommandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = 1;
+			VK_CHECK(vkAllocateCommandBuffers(device, &allocInfo, &frame.CommandBuffer));
+
+			// Signaled, so the first BeginFrame on each slot doesn't wait
+			VkFenceCreateInfo fenceInfo{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+			fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+			VK_CHECK(vkCreateFence(device, &fenceInfo, nullptr, &frame.Fence));
+		}
+	}
+
+	void HeadlessDevice::CreateColorImages()
+	{
+		VkDevice device = m_Info.Device;
+
+		m_ColorImages.resize(m_Settings.FrameCount);
+		m_ColorMemory.resize(m_Settings.FrameCount);
+		m_ColorViews.resize(m_Settings.FrameCount);
+		for (uint32_t i = 0; i < m_Settings.FrameCount; i++)
+		{
+			VkImageCreateInfo ici{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+			ici.imageType = VK_IMAGE_TYPE_2D;
+			ici.format = ColorFormat;
+			ici.extent = { m_Settings.Width, m_Settings.Height, 1 };
+			ici.mipLevels = 1;
+			ici.arrayLayers = 1;
+			ici.samples = VK_SAMPLE_COUNT_1_BIT;
+			ici.tiling = VK_IMAGE_TILING_OPTIMAL;
+			ici.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			VK_CHECK(vkCreateImage(device, &ici, nullptr, &m_ColorImages[i]));
+			m_ColorMemory[i] = GpuAllocator::AllocateImage(m_ColorImages[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+
+			VkImageViewCreateInfo iv{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+			iv.image = m_ColorImages[i];
+			iv.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			iv.format = ColorFormat;
+			iv.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			iv.subresourceRange.levelCount = 1;
+			iv.subresourceRange.layerCount = 1;
+			VK_CHECK(vkCreateImageView(device, &iv, nullptr, &m_ColorViews[i]));
+		}
+	}
+
+	HeadlessFrame HeadlessDevice::BeginFrame()
+	{
+		Frame& frame = m_Frames[m_FrameIndex];
+		VK_CHECK(vkWaitForFences(m_Info.Device, 1, &frame.Fence, VK_TRUE, UINT64_MAX));
+		VK_CHECK(vkResetFences(m_Info.Device, 1, &frame.Fence));
+
+		VK_CHECK(vkResetCommandBuffer(frame.CommandBuffer, 0));
+		VkCommandBufferBeginInfo beginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_CHECK(vkBeginCommandBuffer(frame.CommandBuffer, &beginInfo));
+
+		return { frame.CommandBuffer, m_FrameIndex };
+	}
+
+	void HeadlessDevice::EndFrame()
+	{
+		Frame& frame = m_Frames[m_FrameIndex];
+		VK_CHECK(vkEndCommandBuffer(frame.CommandBuffer));
+
+		VkSubmitInfo submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &frame.CommandBuffer;
+		VK_CHECK(vkQueueSubmit(m_Info.Queue, 1, &submitInfo, frame.Fence));
+
+		m_FrameIndex = (m_FrameIndex + 1) % m_Settings.FrameCount;
+	}
+
+	void HeadlessDevice::WaitIdle()
+	{
+		VK_CHECK(vkDeviceWaitIdle(m_Info.Device));
+	}
+
+	void HeadlessDevice::ReadPixels(uint32_t frameIndex, std::vector<uint8_t>& rgba)
+	{
+		VkDevice device = m_Info.Device;
+		const VkDeviceSize size = (VkDeviceSize)m_Settings.Width * m_Settings.Height * 4;
+
+		VkBufferCreateInfo bufferInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+		bufferInfo.size = size;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VK_CHECK(vkCreateBuffer(device, &bufferInfo, nullptr, &buffer));
+		GpuAllocation memory = GpuAllocator::AllocateBuffer(buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+
+		// Submitted after the frame, so the barrier's first scope takes in its rendering
+		VkCommandBuffer commandBuffer = GetCommandBuffer();
+
+		VkImageMemoryBarrier toTransfer{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+		toTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		toTransfer.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toTransfer.image = m_ColorImages[frameIndex];
+		toTransfer.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+		VkBufferImageCopy region{};
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageExtent = { m_Settings.Width, m_Settings.Height, 1 };
+		vkCmdCopyImageToBuffer(commandBuffer, m_ColorImages[frameIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+
+		VkBufferMemoryBarrier toHost{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+		toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toHost.buffer = buffer;
+		toHost.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+			0, 0, nullptr, 1, &toHost, 0, nullptr);
+
+		// The render pass starts from UNDEFINED, so the image can stay in TRANSFER_SRC
+		FlushCommandBuffer(commandBuffer);
+
+		GpuAllocator::Invalidate(memory);
+		rgba.resize((size_t)size);
+		memcpy(rgba.data(), memory.Mapped, (size_t)size);
+
+		vkDestroyBuffer(device, buffer, nullptr);
+		GpuAllocator::Free(memory);
+	}
+
+	VkDescriptorSet HeadlessDevice::AllocateDescriptorSet(VkDescriptorSetLayout layout)
+	{
+		VkDescriptorSetAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+		allocInfo.descriptorPool = m_DescriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &layout;
+
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		VK_CHECK(vkAllocateDescriptorSets(m_Info.Device, &allocInfo, &set));
+		return set;
+	}
+
+	VkCommandBuffer HeadlessDevice::GetCommandBuffer()
+	{
+		VkCommandBufferAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+		allocInfo.commandPool = m_CommandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VK_CHECK(vkAllocateCommandBuffers(m_Info.Device, &allocInfo, &commandBuffer));
+
+		VkCommandBufferBeginInfo beginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+		return commandBuffer;
+	}
+
+	void HeadlessDevice::FlushCommandBuffer(VkCommandBuffer commandBuffer)
+	{
+		VkDevice device = m_Info.Device;
+		VK_CHECK(vkEndCommandBuffer(commandBuffer));
+
+		VkFenceCreateInfo fenceInfo{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+		VkFence fence = VK_NULL_HANDLE;
+		VK_CHECK(vkCreateFence(device, &fenceInfo, nullptr, &fence));
+
+		VkSubmitInfo submitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO };
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		VK_CHECK(vkQueueSubmit(m_Info.Queue, 1, &submitInfo, fence));
+		VK_CHECK(vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX));
+
+		vkDestroyFence(device, fence, nullptr);
+		vkFreeCommandBuffers(device, m_CommandPool, 1, &commandBuffer);
+	}
+
+}
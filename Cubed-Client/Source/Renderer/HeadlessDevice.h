@@ -0,0 +1,96 @@
+#pragma once
+
+#include "GpuAllocator.h"
+#include "Vulkan.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Cubed {
+
+	struct HeadlessSettings
+	{
+		uint32_t Width = 1280, Height = 720;
+		uint32_t FrameCount = 2;    // frames in flight, one color image each
+		int32_t DeviceIndex = -1;   // into vkEnumeratePhysicalDevices, -1 prefers a discrete GPU
+		bool Validation = false;    // VK_LAYER_KHRONOS_validation, if installed
+	};
+
+	// What BeginFrame hands out; pass both to Renderer::BeginScene
+	struct HeadlessFrame
+	{
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+		uint32_t Index = 0;
+	};
+
+	//
+	// HeadlessDevice - a Vulkan device with no window or swapchain, installed
+	// as the VulkanHost so the renderer runs on it unchanged. Works on software
+	// implementations (lavapipe, SwiftShader) as well as GPUs.
+	//
+	// It owns one color image per frame in flight as the render target, and a
+	// command buffer and fence per frame like the Walnut frame loop: BeginFrame
+	// waits for the slot's previous submission, EndFrame submits. Deferred
+	// frees go through the DeletionQueue, which the renderer advances.
+	//
+	class HeadlessDevice : public VulkanHost
+	{
+	public:
+		static constexpr VkFormat ColorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+		// Throws std::runtime_error when there is no usable device
+		explicit HeadlessDevice(const HeadlessSettings& settings = {});
+		~HeadlessDevice() override;
+
+		HeadlessDevice(const HeadlessDevice&) = delete;
+		HeadlessDevice& operator=(const HeadlessDevice&) = delete;
+
+		HeadlessFrame BeginFrame();
+		void EndFrame();
+		void WaitIdle();
+
+		// Blocks until the frame's image is rendered; tightly packed RGBA8, top row first
+		void ReadPixels(uint32_t frameIndex, std::vector<uint8_t>& rgba);
+
+		uint32_t GetWidth() const { return m_Settings.Width; }
+		uint32_t GetHeight() const { return m_Settings.Height; }
+		const std::vector<VkImageView>& GetColorViews() const { return m_ColorViews; }
+		const std::string& GetDeviceName() const { return m_DeviceName; }
+
+		// VulkanHost
+		ImGui_ImplVulkan_InitInfo* GetInfo() override { return &m_Info; }
+		VkDescriptorSet AllocateDescriptorSet(VkDescriptorSetLayout layout) override;
+		VkDescriptorPool GetDescriptorPool() override { return m_DescriptorPool; }
+		const VulkanFeatures& GetEnabledFeatures() override { return m_EnabledFeatures; }
+		VkCommandBuffer GetCommandBuffer() override;
+		void FlushCommandBuffer(VkCommandBuffer commandBuffer) override;
+	private:
+		void CreateInstance();
+		void CreateDevice();
+		void CreateFrames();
+		void CreateColorImages();
+	private:
+		struct Frame
+		{
+			VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+			VkFence Fence = VK_NULL_HANDLE;
+		};
+
+		HeadlessSettings m_Settings;
+		ImGui_ImplVulkan_InitInfo m_Info{};
+		std::string m_DeviceName;
+		VulkanFeatures m_EnabledFeatures;
+
+		VkCommandPool m_CommandPool = VK_NULL_HANDLE;
+		VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+
+		std::vector<Frame> m_Frames;
+		uint32_t m_FrameIndex = 0;
+
+		std::vector<VkImage> m_ColorImages;
+		std::vector<GpuAllocation> m_ColorMemory;
+		std::vector<VkImageView> m_ColorViews;
+	};
+
+}
@@ -0,0 +1,424 @@
+#include "HiZBuffer.h"
+#include "DeletionQueue.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace Cubed {
+
+	namespace {
+
+		// Levels at most this big on either side are read back, the finer ones stay on the GPU
+		constexpr uint32_t kReadbackSize = 256;
+		constexpr uint32_t kGroupSize = 8;   // local_size of hiz.comp
+
+		struct HiZPushConstants
+		{
+			int32_t SourceWidth, SourceHeight;
+			int32_t DestinationWidth, DestinationHeight;
+		};
+
+		void FreeDescriptorSet(VkDescriptorSet& set)
+		{
+			if (!set)
+				return;
+
+			DeletionQueue::ReleaseDescriptorSet(set);
+			set = VK_NULL_HANDLE;
+		}
+
+		void WriteLevelSet(VkDescriptorSet set, VkSampler sampler, VkImageView source, VkImageLayout sourceLayout, VkImageView destination)
+		{
+			VkDescriptorImageInfo sourceInfo{ sampler, source, sourceLayout };
+			VkDescriptorImageInfo destinationInfo{ VK_NULL_HANDLE, destination, VK_IMAGE_LAYOUT_GENERAL };
+
+			VkWriteDescriptorSet writes[2]{};
+			writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[0].dstSet = set;
+			writes[0].dstBinding = 0;
+			writes[0].descriptorCount = 1;
+			writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[0].pImageInfo = &sourceInfo;
+			writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[1].dstSet = set;
+			writes[1].dstBinding = 1;
+			writes[1].descriptorCount = 1;
+			writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			writes[1].pImageInfo = &destinationInfo;
+			vkUpdateDescriptorSets(GetVulkanInfo()->Device, 2, writes, 0, nullptr);
+		}
+
+	}
+
+	void HiZBuffer::Init(VkShaderModule shader, VkPipelineCache cache)
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+
+		VkDescriptorSetLayoutBinding bindings[2]{};
+		bindings[0].binding = 0;
+		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[0].descriptorCount = 1;
+		bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		bindings[1].binding = 1;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		bindings[1].descriptorCount = 1;
+		bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+		layoutInfo.bindingCount = 2;
+		layoutInfo.pBindings = bindings;
+		VK_CHECK(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_SetLayout));
+
+		VkPushConstantRange pushRange{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZPushConstants) };
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &m_SetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+		VK_CHECK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout));
+
+		VkComputePipelineCreateInfo pipelineInfo{ VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = shader;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = m_PipelineLayout;
+		VK_CHECK(vkCreateComputePipelines(device, cache, 1, &pipelineInfo, nullptr, &m_Pipeline));
+
+		// Texels are fetched, never filtered
+		VkSamplerCreateInfo samplerInfo{ VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &m_Sampler));
+	}
+
+	void HiZBuffer::Destroy()
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+		VkDescriptorPool pool = GetDescriptorPool();
+
+		for (FrameReadback& frame : m_Frames)
+		{
+			if (frame.Buffer) vkDestroyBuffer(device, frame.Buffer, nullptr);
+			GpuAllocator::Free(frame.Memory);
+			if (frame.SourceSet) vkFreeDescriptorSets(device, pool, 1, &frame.SourceSet);
+		}
+		m_Frames.clear();
+		m_Tested = {};
+
+		for (VkDescriptorSet set : m_LevelSets)
+			if (set) vkFreeDescriptorSets(device, pool, 1, &set);
+		for (VkImageView view : m_Views)
+			vkDestroyImageView(device, view, nullptr);
+		if (m_Image) vkDestroyImage(device, m_Image, nullptr);
+		GpuAllocator::Free(m_ImageMemory);
+		m_LevelSets.clear();
+		m_Views.clear();
+		m_Levels.clear();
+		m_Image = VK_NULL_HANDLE;
+		m_SourceWidth = m_SourceHeight = 0;
+
+		if (m_Sampler) { vkDestroySampler(device, m_Sampler, nullptr); m_Sampler = VK_NULL_HANDLE; }
+		if (m_Pipeline) { vkDestroyPipeline(device, m_Pipeline, nullptr); m_Pipeline = VK_NULL_HANDLE; }
+		if (m_PipelineLayout) { vkDestroyPipelineLayout(device, m_PipelineLayout, nullptr); m_PipelineLayout = VK_NULL_HANDLE; }
+		if (m_SetLayout) { vkDestroyDescriptorSetLayout(device, m_SetLayout, nullptr); m_SetLayout = VK_NULL_HANDLE; }
+	}
+
+	void HiZBuffer::BeginFrame(uint32_t frameIndex, uint32_t frameCount)
+	{
+		m_FrameNumber++;
+		if (frameCount != m_Frames.size())
+			Recreate(frameCount);
+
+		// This slot's last frame has finished, its copy has landed
+		m_FrameIndex = frameIndex;
+		const FrameReadback& frame = m_Frames[frameIndex];
+		m_Tested.Data = nullptr;
+
+		// A pyramid from before a pause in building it would be too stale to trust
+		if (!frame.Written || m_FrameNumber - frame.Frame > frameCount)
+			return;
+
+		GpuAllocator::Invalidate(frame.Memory);
+		m_Tested.Data = (const float*)frame.Memory.Mapped;
+		m_Tested.ViewProjection = frame.ViewProjection;
+		m_Tested.Levels = frame.Levels;
+		m_Tested.Frame = frame.Frame;
+	}
+
+	void HiZBuffer::Build(VkCommandBuffer commandBuffer, const HiZSource& depth, const glm::mat4& viewProjection)
+	{
+		if (!m_Pipeline || m_Frames.empty() || depth.Width < 2 || depth.Height < 2)
+			return;
+
+		if (depth.Width != m_SourceWidth || depth.Height != m_SourceHeight)
+			CreatePyramid(depth.Width, depth.Height);
+
+		VkDevice device = GetVulkanInfo()->Device;
+		FrameReadback& frame = m_Frames[m_FrameIndex];
+
+		// Grown only; frames in flight may still be copying into the old one
+		if (frame.Size < m_ReadbackSize)
+		{
+			DeletionQueue::ReleaseBuffer(frame.Buffer, frame.Memory);
+
+			VkBufferCreateInfo bufferInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+			bufferInfo.size = m_ReadbackSize;
+			bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			VK_CHECK(vkCreateBuffer(device, &bufferInfo, nullptr, &frame.Buffer));
+			frame.Memory = GpuAllocator::AllocateBuffer(frame.Buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+			frame.Size = m_ReadbackSize;
+		}
+
+		// The slot's last frame has finished, so its set is no longer in use
+		if (!frame.SourceSet)
+			frame.SourceSet = AllocateDescriptorSet(m_SetLayout);
+		WriteLevelSet(frame.SourceSet, m_Sampler, depth.View, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_Views[0]);
+
+		// Depth writes land before the reduction reads them; the whole pyramid is rewritten,
+		// after the previous frame's copy out of it
+		VkImageMemoryBarrier barriers[2]{};
+		barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[0].image = depth.Image;
+		barriers[0].subresourceRange = { depth.Aspect, 0, 1, 0, 1 };
+
+		barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barriers[1].srcAccessMask = 0;
+		barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[1].image = m_Image;
+		barriers[1].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, (uint32_t)m_Levels.size(), 0, 1 };
+
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+
+		uint32_t sourceWidth = depth.Width, sourceHeight = depth.Height;
+		for (uint32_t level = 0; level < m_Levels.size(); level++)
+		{
+			const Level& destination = m_Levels[level];
+			const VkDescriptorSet set = level == 0 ? frame.SourceSet : m_LevelSets[level];
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &set, 0, nullptr);
+
+			const HiZPushConstants push{ (int32_t)sourceWidth, (int32_t)sourceHeight, (int32_t)destination.Width, (int32_t)destination.Height };
+			vkCmdPushConstants(commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+			vkCmdDispatch(commandBuffer, (destination.Width + kGroupSize - 1) / kGroupSize, (destination.Height + kGroupSize - 1) / kGroupSize, 1);
+
+			// The next level reads this one, the copy reads the coarse ones
+			VkMemoryBarrier written{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+			written.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			written.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &written, 0, nullptr, 0, nullptr);
+
+			sourceWidth = destination.Width;
+			sourceHeight = destination.Height;
+		}
+
+		VkBufferImageCopy regions[32]{};
+		uint32_t regionCount = 0;
+		for (uint32_t level = m_FirstReadback; level < m_Levels.size(); level++)
+		{
+			VkBufferImageCopy& region = regions[regionCount++];
+			region.bufferOffset = m_Levels[level].Offset;
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+			region.imageExtent = { m_Levels[level].Width, m_Levels[level].Height, 1 };
+		}
+		vkCmdCopyImageToBuffer(commandBuffer, m_Image, VK_IMAGE_LAYOUT_GENERAL, frame.Buffer, regionCount, regions);
+
+		VkBufferMemoryBarrier copied{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+		copied.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		copied.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		copied.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		copied.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		copied.buffer = frame.Buffer;
+		copied.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+			0, 0, nullptr, 1, &copied, 0, nullptr);
+
+		frame.ViewProjection = viewProjection;
+		frame.Levels.assign(m_Levels.begin() + m_FirstReadback, m_Levels.end());
+		frame.Frame = m_FrameNumber;
+		frame.Written = true;
+	}
+
+	bool HiZBuffer::IsOccluded(const glm::vec3& min, const glm::vec3& max) const
+	{
+		if (!m_Tested.Data)
+			return false;
+
+		glm::vec2 lower(FLT_MAX), upper(-FLT_MAX);
+		float nearest = FLT_MAX;
+		for (int i = 0; i < 8; i++)
+		{
+			const glm::vec3 corner(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+			const glm::vec4 clip = m_Tested.ViewProjection * glm::vec4(corner, 1.0f);
+			if (clip.w <= 0.0f)
+				return false;
+
+			const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+			lower = glm::min(lower, glm::vec2(ndc.x, ndc.y));
+			upper = glm::max(upper, glm::vec2(ndc.x, ndc.y));
+			nearest = std::min(nearest, ndc.z);
+		}
+
+		// In front of the near plane, or entirely off screen (the frustum's call)
+		if (nearest <= 0.0f || upper.x < -1.0f || upper.y < -1.0f || lower.x > 1.0f || lower.y > 1.0f)
+			return false;
+
+		// The viewport is flipped, so +y is the first row
+		const float u0 = lower.x * 0.5f + 0.5f, u1 = upper.x * 0.5f + 0.5f;
+		const float v0 = 0.5f - upper.y * 0.5f, v1 = 0.5f - lower.y * 0.5f;
+
+		for (size_t i = 0; i < m_Tested.Levels.size(); i++)
+		{
+			const Level& level = m_Tested.Levels[i];
+			const int lastX = (int)level.Width - 1, lastY = (int)level.Height - 1;
+			const int x0 = std::clamp((int)std::floor(u0 * level.Width), 0, lastX);
+			const int x1 = std::clamp((int)std::floor(u1 * level.Width), 0, lastX);
+			const int y0 = std::clamp((int)std::floor(v0 * level.Height), 0, lastY);
+			const int y1 = std::clamp((int)std::floor(v1 * level.Height), 0, lastY);
+			if ((x1 - x0 > 1 || y1 - y0 > 1) && i + 1 < m_Tested.Levels.size())
+				continue;
+
+			const float* texels = m_Tested.Data + level.Offset / sizeof(float);
+			float farthest = 0.0f;
+			for (int y = y0; y <= y1; y++)
+				for (int x = x0; x <= x1; x++)
+					farthest = std::max(farthest, texels[y * level.Width + x]);
+			return nearest > farthest;
+		}
+		return false;
+	}
+
+	HiZStats HiZBuffer::GetStats() const
+	{
+		HiZStats stats;
+		if (!m_Levels.empty())
+		{
+			stats.Width = m_Levels[0].Width;
+			stats.Height = m_Levels[0].Height;
+		}
+		stats.Levels = (uint32_t)m_Levels.size();
+		stats.ReadbackLevels = (uint32_t)m_Levels.size() - m_FirstReadback;
+		stats.ReadbackBytes = m_ReadbackSize;
+		stats.Ready = IsReady();
+		stats.Age = stats.Ready ? (uint32_t)(m_FrameNumber - m_Tested.Frame) : 0;
+		return stats;
+	}
+
+	void HiZBuffer::CreatePyramid(uint32_t width, uint32_t height)
+	{
+		RetirePyramid();
+
+		VkDevice device = GetVulkanInfo()->Device;
+		m_SourceWidth = width;
+		m_SourceHeight = height;
+
+		// Level 0 is already half the attachment; halving down to 1x1
+		uint32_t levelWidth = std::max(width / 2, 1u), levelHeight = std::max(height / 2, 1u);
+		m_Levels.clear();
+		m_FirstReadback = UINT32_MAX;
+		m_ReadbackSize = 0;
+		while (true)
+		{
+			Level& level = m_Levels.emplace_back();
+			level.Width = levelWidth;
+			level.Height = levelHeight;
+			if (levelWidth <= kReadbackSize && levelHeight <= kReadbackSize)
+			{
+				if (m_FirstReadback == UINT32_MAX)
+					m_FirstReadback = (uint32_t)m_Levels.size() - 1;
+				level.Offset = m_ReadbackSize;
+				m_ReadbackSize += (VkDeviceSize)levelWidth * levelHeight * sizeof(float);
+			}
+
+			if (levelWidth == 1 && levelHeight == 1)
+				break;
+			levelWidth = std::max(levelWidth / 2, 1u);
+			levelHeight = std::max(levelHeight / 2, 1u);
+		}
+
+		VkImageCreateInfo ici{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+		ici.imageType = VK_IMAGE_TYPE_2D;
+		ici.format = VK_FORMAT_R32_SFLOAT;
+		ici.extent = { m_Levels[0].Width, m_Levels[0].Height, 1 };
+		ici.mipLevels = (uint32_t)m_Levels.size();
+		ici.arrayLayers = 1;
+		ici.samples = VK_SAMPLE_COUNT_1_BIT;
+		ici.tiling = VK_IMAGE_TILING_OPTIMAL;
+		ici.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		VK_CHECK(vkCreateImage(device, &ici, nullptr, &m_Image));
+
+		// Comes and goes with the swapchain, like the depth attachments
+		m_ImageMemory = GpuAllocator::AllocateImage(m_Image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+
+		m_Views.resize(m_Levels.size());
+		m_LevelSets.assign(m_Levels.size(), VK_NULL_HANDLE);
+		for (uint32_t level = 0; level < m_Levels.size(); level++)
+		{
+			VkImageViewCreateInfo iv{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+			iv.image = m_Image;
+			iv.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			iv.format = VK_FORMAT_R32_SFLOAT;
+			iv.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+			VK_CHECK(vkCreateImageView(device, &iv, nullptr, &m_Views[level]));
+
+			if (level > 0)
+			{
+				m_LevelSets[level] = AllocateDescriptorSet(m_SetLayout);
+				WriteLevelSet(m_LevelSets[level], m_Sampler, m_Views[level - 1], VK_IMAGE_LAYOUT_GENERAL, m_Views[level]);
+			}
+		}
+	}
+
+	void HiZBuffer::RetirePyramid()
+	{
+		if (!m_Image)
+			return;
+
+		// Frames still in flight may be building or copying out of it
+		for (VkDescriptorSet& set : m_LevelSets)
+			FreeDescriptorSet(set);
+
+		for (VkImageView view : m_Views)
+			DeletionQueue::ReleaseImageView(view);
+		DeletionQueue::ReleaseImage(m_Image, m_ImageMemory);
+
+		m_Image = VK_NULL_HANDLE;
+		m_ImageMemory = {};
+		m_Views.clear();
+		m_LevelSets.clear();
+	}
+
+	void HiZBuffer::Recreate(uint32_t frameCount)
+	{
+		for (FrameReadback& frame : m_Frames)
+		{
+			DeletionQueue::ReleaseBuffer(frame.Buffer, frame.Memory);
+			FreeDescriptorSet(frame.SourceSet);
+		}
+
+		m_Frames.clear();
+		m_Frames.resize(frameCount);
+		m_Tested = {};
+	}
+
+}
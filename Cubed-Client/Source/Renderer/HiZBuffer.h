@@ -0,0 +1,118 @@
+#pragma once
+
+#include "GpuAllocator.h"
+#include "Vulkan.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace Cubed {
+
+	struct HiZStats
+	{
+		uint32_t Width = 0, Height = 0;   // level 0, half the depth attachment
+		uint32_t Levels = 0;
+		uint32_t ReadbackLevels = 0;      // the coarse end of the pyramid, copied back for the CPU
+		uint64_t ReadbackBytes = 0;       // per frame
+		uint32_t Age = 0;                 // frames since the pyramid being tested against was built
+		bool Ready = false;
+	};
+
+	// A depth attachment in DEPTH_STENCIL_ATTACHMENT_OPTIMAL, left by the pass that wrote it
+	struct HiZSource
+	{
+		VkImage Image = VK_NULL_HANDLE;
+		VkImageView View = VK_NULL_HANDLE;   // depth aspect only
+		VkImageAspectFlags Aspect = VK_IMAGE_ASPECT_DEPTH_BIT;   // every aspect of the format, for the transition
+		uint32_t Width = 0, Height = 0;
+	};
+
+	//
+	// HiZBuffer - a max-depth pyramid of the frame's depth attachment, built by
+	// a compute pass after the main pass. Its coarse levels are copied into a
+	// host-visible buffer per frame in flight and read back when that frame's
+	// slot comes round again, the way GpuProfiler reads its queries: nothing
+	// stalls, but the pyramid tested against is a few frames old.
+	//
+	// Boxes are projected with the view-projection the pyramid was rendered
+	// with, so camera movement since then is accounted for. A box is occluded
+	// when its nearest depth lies behind the farthest depth over the texels its
+	// rectangle covers, read from the level where that is at most 2x2. What
+	// moved into view since the pyramid was built can still be culled for the
+	// frames in flight.
+	//
+	class HiZBuffer
+	{
+	public:
+		// The shader is only needed until Init returns
+		void Init(VkShaderModule shader, VkPipelineCache cache);
+		// Immediate, the device must be idle
+		void Destroy();
+
+		// Picks up the pyramid this slot read back last time round
+		void BeginFrame(uint32_t frameIndex, uint32_t frameCount);
+		// Call outside the render pass; leaves the depth attachment in SHADER_READ_ONLY_OPTIMAL
+		void Build(VkCommandBuffer commandBuffer, const HiZSource& depth, const glm::mat4& viewProjection);
+
+		// False whenever there is nothing to test against, or the box reaches the camera plane
+		bool IsOccluded(const glm::vec3& min, const glm::vec3& max) const;
+
+		bool IsReady() const { return m_Tested.Data != nullptr; }
+		HiZStats GetStats() const;
+	private:
+		void CreatePyramid(uint32_t width, uint32_t height);
+		void RetirePyramid();
+		void Recreate(uint32_t frameCount);
+	private:
+		struct Level
+		{
+			uint32_t Width = 0, Height = 0;
+			VkDeviceSize Offset = 0;   // into the readback buffer
+		};
+
+		struct FrameReadback
+		{
+			VkBuffer Buffer = VK_NULL_HANDLE;
+			GpuAllocation Memory;
+			VkDeviceSize Size = 0;
+			VkDescriptorSet SourceSet = VK_NULL_HANDLE;   // this frame's depth attachment -> level 0
+
+			// What the copy in flight holds
+			glm::mat4 ViewProjection{ 1.0f };
+			std::vector<Level> Levels;
+			uint64_t Frame = 0;
+			bool Written = false;
+		};
+
+		struct TestedPyramid
+		{
+			const float* Data = nullptr;   // mapped; the GPU only writes it again after this frame is submitted
+			glm::mat4 ViewProjection{ 1.0f };
+			std::vector<Level> Levels;   // finest first
+			uint64_t Frame = 0;
+		};
+
+		VkPipeline m_Pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+		VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE;
+		VkSampler m_Sampler = VK_NULL_HANDLE;
+
+		// r32f, every level a storage image in GENERAL while it is built
+		VkImage m_Image = VK_NULL_HANDLE;
+		GpuAllocation m_ImageMemory;
+		std::vector<VkImageView> m_Views;
+		std::vector<VkDescriptorSet> m_LevelSets;   // [i] reduces level i - 1 into i, [0] unused
+		std::vector<Level> m_Levels;
+		uint32_t m_SourceWidth = 0, m_SourceHeight = 0;
+		uint32_t m_FirstReadback = 0;
+		VkDeviceSize m_ReadbackSize = 0;
+
+		std::vector<FrameReadback> m_Frames;
+		uint32_t m_FrameIndex = 0;
+		uint64_t m_FrameNumber = 0;
+		TestedPyramid m_Tested;
+	};
+
+}
@@ -0,0 +1,311 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+
+namespace Cubed {
+
+	namespace {
+
+		// Sum of squared distances to a set of planes, weighted by triangle area
+		struct Quadric
+		{
+			double A2 = 0, AB = 0, AC = 0, AD = 0, B2 = 0, BC = 0, BD = 0, C2 = 0, CD = 0, D2 = 0;
+			double Weight = 0;
+
+			// Plane n.p + d = 0 with n unit length
+			static Quadric FromPlane(const glm::dvec3& n, double d, double weight)
+			{
+				Quadric q;
+				q.A2 = weight * n.x * n.x; q.AB = weight * n.x * n.y; q.AC = weight * n.x * n.z; q.AD = weight * n.x * d;
+				q.B2 = weight * n.y * n.y; q.BC = weight * n.y * n.z; q.BD = weight * n.y * d;
+				q.C2 = weight * n.z * n.z; q.CD = weight * n.z * d;
+				q.D2 = weight * d * d;
+				q.Weight = weight;
+				return q;
+			}
+
+			void Add(const Quadric& other)
+			{
+				A2 += other.A2; AB += other.AB; AC += other.AC; AD += other.AD;
+				B2 += other.B2; BC += other.BC; BD += other.BD;
+				C2 += other.C2; CD += other.CD;
+				D2 += other.D2;
+				Weight += other.Weight;
+			}
+
+			// Mean squared distance from p to the planes
+			double Evaluate(const glm::dvec3& p) const
+			{
+				const double error = A2 * p.x * p.x + B2 * p.y * p.y + C2 * p.z * p.z
+					+ 2.0 * (AB * p.x * p.y + AC * p.x * p.z + BC * p.y * p.z)
+					+ 2.0 * (AD * p.x + BD * p.y + CD * p.z) + D2;
+				return Weight > 0.0 ? std::max(error, 0.0) / Weight : 0.0;
+			}
+		};
+
+		struct Collapse
+		{
+			uint32_t From, To;   // welded representatives
+			double Cost;
+		};
+
+		// Triangles around every vertex, as offsets into one list
+		void BuildAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount,
+			std::vector<uint32_t>& offsets, std::vector<uint32_t>& triangles)
+		{
+			offsets.assign(vertexCount + 1, 0);
+			for (uint32_t index : indices)
+				offsets[index + 1]++;
+			for (size_t i = 0; i < vertexCount; i++)
+				offsets[i + 1] += offsets[i];
+
+			triangles.resize(indices.size());
+			std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+				triangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+		}
+
+	}
+
+	SimplifyResult SimplifyMesh(const glm::vec3* positions, size_t stride, size_t vertexCount,
+		const uint32_t* indices, size_t indexCount, size_t targetIndexCount, float maxError)
+	{
+		const uint8_t* bytes = (const uint8_t*)positions;
+		auto position = [bytes, stride](uint32_t vertex) -> const glm::vec3& { return *(const glm::vec3*)(bytes + vertex * stride); };
+
+		// Weld by position: remap points at the group's first vertex, wedge links the group into a cycle
+		std::vector<uint32_t> remap(vertexCount), wedge(vertexCount);
+		{
+			std::vector<uint32_t> order(vertexCount);
+			std::iota(order.begin(), order.end(), 0u);
+			auto less = [&](uint32_t a, uint32_t b)
+			{
+				const glm::vec3& pa = position(a);
+				const glm::vec3& pb = position(b);
+				if (pa.x != pb.x) return pa.x < pb.x;
+				if (pa.y != pb.y) return pa.y < pb.y;
+				return pa.z < pb.z;
+			};
+			std::sort(order.begin(), order.end(), less);
+
+			for (size_t begin = 0; begin < vertexCount;)
+			{
+				size_t end = begin + 1;
+				while (end < vertexCount && position(order[end]) == position(order[begin]))
+					end++;
+				for (size_t i = begin; i < end; i++)
+				{
+					remap[order[i]] = order[begin];
+					wedge[order[i]] = order[i + 1 < end ? i + 1 : begin];
+				}
+				begin = end;
+			}
+		}
+
+		SimplifyResult result;
+		std::vector<uint32_t>& out = result.Indices;
+		out.reserve(indexCount);
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			const uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+			if (remap[a] != remap[b] && remap[b] != remap[c] && remap[c] != remap[a])
+				out.insert(out.end(), { a, b, c });
+		}
+
+		glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+		for (uint32_t index : out)
+		{
+			min = glm::min(min, position(index));
+			max = glm::max(max, position(index));
+		}
+		const double extent = out.empty() ? 0.0 : std::max({ max.x - min.x, max.y - min.y, max.z - min.z });
+		if (extent <= 0.0)
+			return result;
+
+		// Plane quadrics, and locks on vertices of open or non-manifold edges
+		std::vector<Quadric> quadrics(vertexCount);
+		std::vector<uint8_t> locked(vertexCount, 0);
+		{
+			std::vector<uint64_t> edges;
+			edges.reserve(out.size());
+			for (size_t i = 0; i < out.size(); i += 3)
+			{
+				const uint32_t r[3] = { remap[out[i]], remap[out[i + 1]], remap[out[i + 2]] };
+				const glm::dvec3 p0(position(r[0])), p1(position(r[1])), p2(position(r[2]));
+				const glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+				const double length = glm::length(normal);
+				if (length > 0.0)
+				{
+					const glm::dvec3 n = normal / length;
+					const Quadric q = Quadric::FromPlane(n, -glm::dot(n, p0), length * 0.5);
+					for (uint32_t v : r)
+						quadrics[v].Add(q);
+				}
+
+				for (int e = 0; e < 3; e++)
+				{
+					const uint32_t a = r[e], b = r[(e + 1) % 3];
+					edges.push_back(((uint64_t)std::min(a, b) << 32) | std::max(a, b));
+				}
+			}
+
+			std::sort(edges.begin(), edges.end());
+			for (size_t begin = 0; begin < edges.size();)
+			{
+				size_t end = begin + 1;
+				while (end < edges.size() && edges[end] == edges[begin])
+					end++;
+				if (end - begin != 2)
+				{
+					locked[edges[begin] >> 32] = 1;
+					locked[edges[begin] & 0xffffffff] = 1;
+				}
+				begin = end;
+			}
+		}
+
+		const double maxCost = (double)maxError * maxError * extent * extent;
+		double worstCost = 0.0;
+
+		std::vector<uint32_t> offsets, triangles;
+		std::vector<Collapse> candidates;
+		std::vector<double> bestCost(vertexCount);
+		std::vector<uint32_t> bestTarget(vertexCount);
+		std::vector<uint32_t> collapse(vertexCount);
+		std::vector<uint8_t> touched(vertexCount);
+		std::vector<std::pair<uint32_t, uint32_t>> moves;
+
+		// Every pass collapses an independent set of vertices, cheapest first
+		while (out.size() > targetIndexCount)
+		{
+			BuildAdjacency(out, vertexCount, offsets, triangles);
+
+			std::fill(bestCost.begin(), bestCost.end(), DBL_MAX);
+			for (size_t i = 0; i < out.size(); i++)
+			{
+				const uint32_t from = remap[out[i]];
+				const uint32_t to = remap[out[i - i % 3 + (i + 1) % 3]];
+				for (int direction = 0; direction < 2; direction++)
+				{
+					const uint32_t a = direction ? to : from, b = direction ? from : to;
+					if (locked[a])
+						continue;
+
+					Quadric q = quadrics[a];
+					q.Add(quadrics[b]);
+					const double cost = q.Evaluate(glm::dvec3(position(b)));
+					if (cost < bestCost[a])
+					{
+						bestCost[a] = cost;
+						bestTarget[a] = b;
+					}
+				}
+			}
+
+			candidates.clear();
+			for (uint32_t v = 0; v < vertexCount; v++)
+				if (bestCost[v] <= maxCost)
+					candidates.push_back({ v, bestTarget[v], bestCost[v] });
+			std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) { return a.Cost < b.Cost; });
+
+			// Only the cheaper half goes per pass, so the rest is re-ranked against the changed surface
+			const size_t limit = std::max<size_t>(candidates.size() / 2, 1);
+			const size_t wanted = (out.size() - targetIndexCount + 2) / 3;
+			size_t removed = 0, applied = 0;
+
+			std::iota(collapse.begin(), collapse.end(), 0u);
+			std::fill(touched.begin(), touched.end(), 0);
+
+			for (size_t c = 0; c < candidates.size() && c < limit && removed < wanted; c++)
+			{
+				const Collapse& candidate = candidates[c];
+				if (touched[candidate.From] || touched[candidate.To])
+					continue;
+
+				// Every wedge of the moving vertex needs its own wedge of the target, in the same triangles
+				moves.clear();
+				size_t degenerate = 0;
+				bool valid = true;
+				uint32_t vertex = candidate.From;
+				do
+				{
+					uint32_t target = UINT32_MAX;
+					for (uint32_t t = offsets[vertex]; t < offsets[vertex + 1] && valid; t++)
+					{
+						const uint32_t* corners = &out[triangles[t] * 3];
+						int self = 0;
+						uint32_t other = UINT32_MAX;
+						for (int k = 0; k < 3; k++)
+						{
+							if (corners[k] == vertex)
+								self = k;
+							else if (remap[corners[k]] == candidate.To)
+								other = corners[k];
+						}
+
+						if (other != UINT32_MAX)
+						{
+							valid = target == UINT32_MAX || target == other;
+							target = other;
+							degenerate++;
+							continue;
+						}
+
+						// The triangle survives with this corner moved; it must not turn over or tilt too far
+						const glm::vec3& p1 = position(corners[(self + 1) % 3]);
+						const glm::vec3& p2 = position(corners[(self + 2) % 3]);
+						const glm::vec3 before = glm::cross(p1 - position(vertex), p2 - position(vertex));
+						const glm::vec3 after = glm::cross(p1 - position(candidate.To), p2 - position(candidate.To));
+						valid = glm::dot(before, after) > 0.25f * glm::length(before) * glm::length(after);
+					}
+
+					if (target == UINT32_MAX)
+						valid = false;
+					if (!valid)
+						break;
+
+					moves.push_back({ vertex, target });
+					vertex = wedge[vertex];
+				} while (vertex != candidate.From);
+
+				if (!valid)
+					continue;
+
+				for (const auto& [from, to] : moves)
+				{
+					collapse[from] = to;
+					for (uint32_t t = offsets[from]; t < offsets[from + 1]; t++)
+						for (int k = 0; k < 3; k++)
+							touched[remap[out[triangles[t] * 3 + k]]] = 1;
+				}
+
+				quadrics[candidate.To].Add(quadrics[candidate.From]);
+				worstCost = std::max(worstCost, candidate.Cost);
+				removed += degenerate;
+				applied++;
+			}
+
+			if (applied == 0)
+				break;
+
+			size_t write = 0;
+			for (size_t i = 0; i < out.size(); i += 3)
+			{
+				const uint32_t a = collapse[out[i]], b = collapse[out[i + 1]], c = collapse[out[i + 2]];
+				if (remap[a] == remap[b] || remap[b] == remap[c] || remap[c] == remap[a])
+					continue;
+				out[write++] = a;
+				out[write++] = b;
+				out[write++] = c;
+			}
+			out.resize(write);
+		}
+
+		result.Error = (float)(std::sqrt(worstCost) / extent);
+		return result;
+	}
+
+}
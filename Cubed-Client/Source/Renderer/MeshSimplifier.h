@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Cubed {
+
+	struct SimplifyResult
+	{
+		std::vector<uint32_t> Indices;
+		float Error = 0.0f;   // largest collapse error, relative to the mesh's extent
+	};
+
+	//
+	// SimplifyMesh - quadric error edge collapse (Garland & Heckbert) over an
+	// indexed triangle list. Vertices are only ever collapsed onto existing
+	// ones, so the result indexes the same vertex buffer and a level of detail
+	// is nothing but another index list.
+	//
+	// Vertices sharing a position (UV and normal seams) move together and only
+	// along the seam; vertices on open borders never move, so silhouettes and
+	// texture charts hold. Collapses that would flip a triangle are rejected.
+	//
+	// Stops at targetIndexCount, or earlier when the next collapse would move
+	// the surface by more than maxError (relative to the extent).
+	//
+	SimplifyResult SimplifyMesh(const glm::vec3* positions, size_t stride, size_t vertexCount,
+		const uint32_t* indices, size_t indexCount, size_t targetIndexCount, float maxError = 1.0f);
+
+}
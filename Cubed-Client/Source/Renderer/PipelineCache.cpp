@@ -0,0 +1,122 @@
+#include "PipelineCache.h"
+
+#include "Walnut/Core/Log.h"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace Cubed {
+
+	namespace {
+
+		// VK_PIPELINE_CACHE_HEADER_VERSION_ONE, at the start of every cache blob
+		struct CacheHeader
+		{
+			uint32_t Length;
+			uint32_t Version;
+			uint32_t VendorID;
+			uint32_t DeviceID;
+			uint8_t UUID[VK_UUID_SIZE];
+		};
+		static_assert(sizeof(CacheHeader) == 16 + VK_UUID_SIZE);
+
+		bool IsCompatible(const std::vector<uint8_t>& data, const VkPhysicalDeviceProperties& properties)
+		{
+			if (data.size() < sizeof(CacheHeader))
+				return false;
+
+			CacheHeader header;
+			memcpy(&header, data.data(), sizeof(header));
+			return header.Length >= sizeof(CacheHeader)
+				&& header.Version == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+				&& header.VendorID == properties.vendorID
+				&& header.DeviceID == properties.deviceID
+				&& memcmp(header.UUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+		}
+
+	}
+
+	void PipelineCache::Load(const std::filesystem::path& path)
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+		m_Path = path;
+		m_LoadedBytes = 0;
+
+		std::vector<uint8_t> data;
+		std::error_code error;
+		const size_t size = (size_t)std::filesystem::file_size(path, error);
+		if (!error && size > 0)
+		{
+			data.resize(size);
+			std::ifstream stream(path, std::ios::binary);
+			stream.read((char*)data.data(), (std::streamsize)size);
+			if (!stream)
+				data.clear();
+		}
+
+		if (!data.empty())
+		{
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(GetVulkanInfo()->PhysicalDevice, &properties);
+			if (!IsCompatible(data, properties))
+			{
+				WL_WARN("Pipeline cache {} is from another device or driver, starting empty", path.string());
+				data.clear();
+			}
+		}
+
+		VkPipelineCacheCreateInfo info{ VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+		info.initialDataSize = data.size();
+		info.pInitialData = data.empty() ? nullptr : data.data();
+		VK_CHECK(vkCreatePipelineCache(device, &info, nullptr, &m_Cache));
+		m_LoadedBytes = data.size();
+	}
+
+	void PipelineCache::Save()
+	{
+		if (!m_Cache || m_Path.empty())
+			return;
+
+		VkDevice device = GetVulkanInfo()->Device;
+		size_t size = 0;
+		VK_CHECK(vkGetPipelineCacheData(device, m_Cache, &size, nullptr));
+		std::vector<uint8_t> data(size);
+		if (size == 0 || vkGetPipelineCacheData(device, m_Cache, &size, data.data()) != VK_SUCCESS)
+			return;
+
+		std::error_code error;
+		if (m_Path.has_parent_path())
+			std::filesystem::create_directories(m_Path.parent_path(), error);
+
+		std::filesystem::path temporary = m_Path;
+		temporary += ".tmp";
+
+		bool written = false;
+		{
+			std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+			stream.write((const char*)data.data(), (std::streamsize)size);
+			stream.flush();
+			written = stream.good();
+		}
+
+		if (written)
+			std::filesystem::rename(temporary, m_Path, error);
+		if (!written || error)
+		{
+			WL_WARN("Failed to save pipeline cache to {}", m_Path.string());
+			std::filesystem::remove(temporary, error);
+			return;
+		}
+
+		WL_INFO("Saved pipeline cache ({} KB) to {}", size / 1024, m_Path.string());
+	}
+
+	void PipelineCache::Destroy()
+	{
+		if (m_Cache)
+			vkDestroyPipelineCache(GetVulkanInfo()->Device, m_Cache, nullptr);
+		m_Cache = VK_NULL_HANDLE;
+	}
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Vulkan.h"
+
+#include <cstdint>
+#include <filesystem>
+
+namespace Cubed {
+
+	//
+	// PipelineCache - a VkPipelineCache persisted between runs. Loading only
+	// seeds the cache when the file header matches this device and driver
+	// (vendor, device and pipelineCacheUUID); anything else starts it empty.
+	// Saving writes a temporary file and renames it over the old one, so an
+	// interrupted save never leaves a truncated cache behind.
+	//
+	class PipelineCache
+	{
+	public:
+		void Load(const std::filesystem::path& path);
+		void Save();
+		void Destroy();
+
+		VkPipelineCache GetHandle() const { return m_Cache; }
+		bool IsWarm() const { return m_LoadedBytes > 0; }
+		size_t GetLoadedBytes() const { return m_LoadedBytes; }
+	private:
+		VkPipelineCache m_Cache = VK_NULL_HANDLE;
+		std::filesystem::path m_Path;
+		size_t m_LoadedBytes = 0;
+	};
+
+}
@@ -0,0 +1,235 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+
+namespace Cubed {
+
+	uint64_t RenderQueue::MakeKey(uint8_t pipeline, uint8_t geometry, float depth, uint16_t material)
+	{
+		const uint64_t depthBits = (uint64_t)(std::clamp(depth, 0.0f, 1.0f) * (float)0xFFFFFF);
+		return ((uint64_t)pipeline << 56) | ((uint64_t)geometry << 48) | (depthBits << 24) | ((uint64_t)material << 8);
+	}
+
+	DrawItem& RenderQueue::Push(uint64_t key, const DrawItem& state)
+	{
+		m_Entries.push_back({ key, (uint32_t)m_Items.size() });
+		if (state.Indirect)
+			m_IndirectCount++;
+		return m_Items.emplace_back(state);
+	}
+
+	void RenderQueue::Sort()
+	{
+		// LSD radix sort, a byte per pass; passes where every key shares the byte are skipped
+		const size_t count = m_Entries.size();
+		m_Scratch.resize(count);
+
+		for (int shift = 0; shift < 64; shift += 8)
+		{
+			size_t histogram[256] = {};
+			for (const SortEntry& entry : m_Entries)
+				histogram[(entry.Key >> shift) & 0xFF]++;
+
+			if (histogram[(m_Entries[0].Key >> shift) & 0xFF] == count)
+				continue;
+
+			size_t offset = 0;
+			for (size_t& bucket : histogram)
+			{
+				const size_t size = bucket;
+				bucket = offset;
+				offset += size;
+			}
+
+			for (const SortEntry& entry : m_Entries)
+				m_Scratch[histogram[(entry.Key >> shift) & 0xFF]++] = entry;
+			m_Entries.swap(m_Scratch);
+		}
+	}
+
+	void RenderQueue::Flush(VkCommandBuffer commandBuffer, const PassBindings& bindings)
+	{
+		m_Stats = {};
+		if (m_Entries.empty())
+			return;
+
+		Sort();
+		Record(commandBuffer, bindings, 0, m_Entries.size(), 0, m_Stats);
+		m_Stats.Batches = 1;
+		Clear();
+	}
+
+	void RenderQueue::FlushParallel(VkCommandBuffer commandBuffer, const PassBindings& bindings, CommandRecorder& recorder,
+		const SecondaryPass& pass, uint32_t minBatchSize)
+	{
+		m_Stats = {};
+		if (m_Entries.empty())
+			return;
+
+		Sort();
+
+		const size_t count = m_Entries.size();
+		const uint32_t batchCount = (uint32_t)std::clamp<size_t>(count / std::max(minBatchSize, 1u), 1, recorder.GetThreadCount());
+
+		// Where each batch's indirect slots start
+		m_BatchStats.assign(batchCount, {});
+		m_BatchDrawIndex.resize(batchCount);
+		uint32_t drawIndex = 0;
+		for (uint32_t batch = 0; batch < batchCount; batch++)
+		{
+			m_BatchDrawIndex[batch] = drawIndex;
+			if (!bindings.Indirect)
+				continue;
+			for (size_t i = count * batch / batchCount; i < count * (batch + 1) / batchCount; i++)
+				drawIndex += m_Items[m_Entries[i].Item].Indirect ? 1 : 0;
+		}
+
+		VkCommandBufferInheritanceInfo inheritance{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+		inheritance.renderPass = pass.RenderPass;
+		inheritance.subpass = 0;
+		inheritance.framebuffer = pass.Framebuffer;
+
+		const std::vector<VkCommandBuffer>& commandBuffers = recorder.Record(pass.FrameIndex, inheritance, batchCount,
+			[&](uint32_t batch, VkCommandBuffer secondary)
+		{
+			vkCmdSetViewport(secondary, 0, 1, &pass.Viewport);
+			vkCmdSetScissor(secondary, 0, 1, &pass.Scissor);
+			Record(secondary, bindings, count * batch / batchCount, count * (batch + 1) / batchCount,
+				m_BatchDrawIndex[batch], m_BatchStats[batch]);
+		});
+
+		vkCmdExecuteCommands(commandBuffer, (uint32_t)commandBuffers.size(), commandBuffers.data());
+
+		for (const RenderQueueStats& stats : m_BatchStats)
+		{
+			m_Stats.Draws += stats.Draws;
+			m_Stats.PipelineBinds += stats.PipelineBinds;
+			m_Stats.DescriptorBinds += stats.DescriptorBinds;
+			m_Stats.GeometryBinds += stats.GeometryBinds;
+			m_Stats.IndirectCalls += stats.IndirectCalls;
+			m_Stats.DirectCalls += stats.DirectCalls;
+		}
+		m_Stats.Batches = batchCount;
+		Clear();
+	}
+
+	void RenderQueue::Record(VkCommandBuffer commandBuffer, const PassBindings& bindings, size_t begin, size_t end,
+		uint32_t drawIndex, RenderQueueStats& stats) const
+	{
+		const IndirectTarget* indirect = bindings.Indirect;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		const GeometryPool* geometry = nullptr;
+
+		for (size_t i = begin; i < end;)
+		{
+			const DrawItem& item = m_Items[m_Entries[i].Item];
+			if (item.Indirect && !indirect)
+			{
+				i++;
+				continue;
+			}
+
+			if (item.Pipeline != pipeline)
+			{
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, item.Pipeline);
+				pipeline = item.Pipeline;
+				stats.PipelineBinds++;
+			}
+
+			// Layouts with different push constant ranges aren't compatible, the sets have to follow
+			if (item.Layout != layout)
+			{
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, item.Layout,
+					0, bindings.SetCount, bindings.Sets, bindings.DynamicOffsetCount, bindings.DynamicOffsets);
+				if (item.Indirect)
+					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, item.Layout,
+						bindings.SetCount, 1, &indirect->Set, 0, nullptr);
+				layout = item.Layout;
+				set = VK_NULL_HANDLE;
+				stats.DescriptorBinds++;
+			}
+
+			if (!item.Indirect && item.Set != set)
+			{
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, item.Layout,
+					bindings.SetCount, 1, &item.Set, 0, nullptr);
+				set = item.Set;
+				stats.DescriptorBinds++;
+			}
+
+			if (item.Geometry != geometry)
+			{
+				item.Geometry->Bind(commandBuffer);
+				geometry = item.Geometry;
+				stats.GeometryBinds++;
+			}
+
+			if (!item.Indirect)
+			{
+				if (item.PushSize > 0)
+					vkCmdPushConstants(commandBuffer, item.Layout, item.PushStages, 0, item.PushSize, item.PushData);
+				if (item.InstanceBuffer)
+					vkCmdBindVertexBuffers(commandBuffer, 1, 1, &item.InstanceBuffer, &item.InstanceOffset);
+
+				vkCmdDrawIndexed(commandBuffer, item.Range.IndexCount, item.InstanceCount, item.Range.FirstIndex, (int32_t)item.Range.VertexOffset, 0);
+				stats.Draws++;
+				i++;
+				continue;
+			}
+
+			// Gather the run
+			const uint32_t first = drawIndex;
+			for (; i < end; i++)
+			{
+				const DrawItem& next = m_Items[m_Entries[i].Item];
+				if (!next.Indirect || next.Pipeline != item.Pipeline || next.Layout != item.Layout || next.Geometry != item.Geometry)
+					break;
+
+				memcpy(indirect->DrawData + (size_t)drawIndex * indirect->DrawDataStride, next.PushData, next.PushSize);
+				indirect->CommandData[drawIndex] = { next.Range.IndexCount, 1, next.Range.FirstIndex, (int32_t)next.Range.VertexOffset, drawIndex };
+				drawIndex++;
+			}
+
+			const uint32_t count = drawIndex - first;
+			if (indirect->MultiDraw)
+			{
+				vkCmdDrawIndexedIndirect(commandBuffer, indirect->Commands, first * sizeof(VkDrawIndexedIndirectCommand),
+					count, sizeof(VkDrawIndexedIndirectCommand));
+				stats.IndirectCalls++;
+			}
+			else
+			{
+				// firstInstance on a direct draw needs no device feature. Neighbours
+				// drawing the same range have consecutive slots, so they become one
+				// draw with an instance each.
+				for (uint32_t draw = first; draw < drawIndex;)
+				{
+					const VkDrawIndexedIndirectCommand& command = indirect->CommandData[draw];
+					uint32_t instances = 1;
+					while (draw + instances < drawIndex)
+					{
+						const VkDrawIndexedIndirectCommand& next = indirect->CommandData[draw + instances];
+						if (next.indexCount != command.indexCount || next.firstIndex != command.firstIndex || next.vertexOffset != command.vertexOffset)
+							break;
+						instances++;
+					}
+
+					vkCmdDrawIndexed(commandBuffer, command.indexCount, instances, command.firstIndex, command.vertexOffset, draw);
+					stats.DirectCalls++;
+					draw += instances;
+				}
+			}
+			stats.Draws += count;
+		}
+	}
+
+	void RenderQueue::Clear()
+	{
+		m_Items.clear();
+		m_Entries.clear();
+		m_IndirectCount = 0;
+	}
+
+}
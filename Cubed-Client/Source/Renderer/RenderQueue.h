@@ -0,0 +1,148 @@
+#pragma once
+
+#include "CommandRecorder.h"
+#include "GeometryPool.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Cubed {
+
+	struct DrawItem
+	{
+		static constexpr uint32_t MaxPushSize = 128;
+
+		VkPipeline Pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout Layout = VK_NULL_HANDLE;
+		const GeometryPool* Geometry = nullptr;
+		GeometryRange Range;
+
+		// Indirect items hand their push data to the draw buffer instead of vkCmdPushConstants
+		bool Indirect = false;
+
+		// Bound right after the shared sets, for direct items whose layout has one more
+		VkDescriptorSet Set = VK_NULL_HANDLE;
+
+		// Per-instance vertex data at binding 1, for instanced pipelines
+		VkBuffer InstanceBuffer = VK_NULL_HANDLE;
+		VkDeviceSize InstanceOffset = 0;
+		uint32_t InstanceCount = 1;
+
+		VkShaderStageFlags PushStages = 0;
+		uint32_t PushSize = 0;
+		alignas(16) uint8_t PushData[MaxPushSize];
+	};
+
+	// Per-frame destination for indirect items, sized for GetIndirectCount() before Flush
+	struct IndirectTarget
+	{
+		VkDescriptorSet Set = VK_NULL_HANDLE;   // draw buffer, bound right after the shared sets
+		uint8_t* DrawData = nullptr;
+		uint32_t DrawDataStride = 0;
+		VkBuffer Commands = VK_NULL_HANDLE;
+		VkDrawIndexedIndirectCommand* CommandData = nullptr;
+		bool MultiDraw = false;   // one vkCmdDrawIndexedIndirect per run, otherwise a direct draw each
+	};
+
+	// Bound by Flush around the items themselves
+	struct PassBindings
+	{
+		const VkDescriptorSet* Sets = nullptr;   // at set 0, whenever the pipeline layout changes
+		uint32_t SetCount = 0;
+		const uint32_t* DynamicOffsets = nullptr;
+		uint32_t DynamicOffsetCount = 0;
+		const IndirectTarget* Indirect = nullptr;
+	};
+
+	// Secondary command buffers inherit the pass but not its dynamic state
+	struct SecondaryPass
+	{
+		uint32_t FrameIndex = 0;
+		VkRenderPass RenderPass = VK_NULL_HANDLE;
+		VkFramebuffer Framebuffer = VK_NULL_HANDLE;
+		VkViewport Viewport{};
+		VkRect2D Scissor{};
+	};
+
+	struct RenderQueueStats
+	{
+		uint32_t Batches = 0;   // command buffers recorded into
+		uint32_t Draws = 0;
+		uint32_t PipelineBinds = 0;
+		uint32_t DescriptorBinds = 0;
+		uint32_t GeometryBinds = 0;
+		uint32_t IndirectCalls = 0;
+		uint32_t DirectCalls = 0;   // issued for indirect runs without multi-draw
+	};
+
+	//
+	// RenderQueue - draws are collected with a 64-bit sort key, radix sorted and
+	// recorded in key order, only binding what changed since the previous draw.
+	//
+	// Key layout, most significant first:
+	//   pipeline (8) | geometry pool (8) | depth (24) | material (16) | spare (8)
+	// Textures are push constants here, so material only breaks depth ties;
+	// depth before material keeps opaque draws front to back for early-Z.
+	//
+	// Consecutive indirect items that share pipeline, layout and geometry form a
+	// run: their data is written in sorted order and the run is drawn at once.
+	// Each draw's firstInstance is its slot, which the shader reads back through
+	// gl_InstanceIndex.
+	//
+	// FlushParallel cuts the sorted draws into contiguous batches and records
+	// each into a secondary command buffer on the CommandRecorder's threads.
+	// Every batch starts with nothing bound; indirect slots are assigned up
+	// front so the batches write disjoint parts of the draw buffer.
+	//
+	class RenderQueue
+	{
+	public:
+		// depth is normalized distance from the camera, clamped to [0, 1]
+		static uint64_t MakeKey(uint8_t pipeline, uint8_t geometry, float depth, uint16_t material);
+
+		template<typename T>
+		void Submit(uint64_t key, const DrawItem& state, const T& pushConstants, VkShaderStageFlags stages)
+		{
+			static_assert(sizeof(T) <= DrawItem::MaxPushSize, "push constants too large for a DrawItem");
+			DrawItem& item = Push(key, state);
+			item.PushStages = stages;
+			item.PushSize = sizeof(T);
+			memcpy(item.PushData, &pushConstants, sizeof(T));
+		}
+
+		// Without push constants, e.g. instanced draws
+		void Submit(uint64_t key, const DrawItem& state) { Push(key, state); }
+
+		// Sorts and records everything submitted inline, then empties the queue
+		void Flush(VkCommandBuffer commandBuffer, const PassBindings& bindings);
+		// Same, recorded in parallel batches of at least minBatchSize draws. The render pass
+		// must have begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+		void FlushParallel(VkCommandBuffer commandBuffer, const PassBindings& bindings, CommandRecorder& recorder,
+			const SecondaryPass& pass, uint32_t minBatchSize);
+
+		size_t Size() const { return m_Items.size(); }
+		uint32_t GetIndirectCount() const { return m_IndirectCount; }
+		const RenderQueueStats& GetStats() const { return m_Stats; }   // of the last Flush
+	private:
+		DrawItem& Push(uint64_t key, const DrawItem& state);
+		void Sort();
+		void Record(VkCommandBuffer commandBuffer, const PassBindings& bindings, size_t begin, size_t end,
+			uint32_t drawIndex, RenderQueueStats& stats) const;
+		void Clear();
+	private:
+		struct SortEntry
+		{
+			uint64_t Key;
+			uint32_t Item;
+		};
+
+		std::vector<DrawItem> m_Items;
+		std::vector<SortEntry> m_Entries, m_Scratch;
+		uint32_t m_IndirectCount = 0;
+		std::vector<RenderQueueStats> m_BatchStats;
+		std::vector<uint32_t> m_BatchDrawIndex;
+		RenderQueueStats m_Stats;
+	};
+
+}
@@ -1,6 +1,11 @@
 #include "Renderer.h"
+#include "DeletionQueue.h"
 
+#include <algorithm>
 #include <array>	
+#include <cfloat>
+#include <chrono>
+#include <cmath>
 #include <fstream>
 #include <vector>
 
@@ -8,8 +13,11 @@
 #include "glm/gtx/euler_angles.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
+#ifndef WL_HEADLESS
 #include "Walnut/Application.h"
+#endif
 #include "Walnut/Core/Log.h"
+#include "imgui.h"
 #include "../../../Walnut/vendor/stb_image/stb_image.h"
 #include "../Assets/TextureManager.h"
 
@@ -17,13 +25,83 @@
 
 namespace Cubed {
 
+	static std::filesystem::path s_AssetBasePath = "C:/Users/Asus/Documents/Projects/Cubed/Cubed-Client/Assets";
+	static std::filesystem::path s_ShaderBasePath = s_AssetBasePath / "Shaders/bin";
+	static const std::filesystem::path s_PipelineCachePath = "Cache/pipelines.bin";
 
+	static constexpr float s_NearPlane = 0.1f;
+	static constexpr float s_FarPlane = 1000.0f;
+	static constexpr float s_FieldOfView = 45.0f;   // vertical, degrees
+
+	// LOD i + 1 takes over once a mesh's projected radius drops below s_LodScreenSizes[i]
+	// of half the viewport height. Going back up takes s_LodHysteresis more, so a mesh
+	// sitting on a threshold doesn't flip levels every frame.
+	static constexpr float s_LodScreenSizes[] = { 0.5f, 0.25f, 0.125f, 0.0625f };
+	static constexpr float s_LodHysteresis = 0.1f;
+
+	// Below two batches' worth of draws a frame is recorded inline
+	static constexpr uint32_t s_DrawsPerBatch = 256;
+
+	// Render queue key fields - lower sorts (and draws) first
+	enum RenderPassId : uint8_t { VoxelPass = 0, ModelPass = 1, CubePass = 2, InstancedPass = 3, OutlinePass = 4 };
+	enum GeometryId : uint8_t { ChunkGeometry = 0, ModelGeometry = 1 };
+
+	// Frees a buffer once the frames that may still reference it have finished
+	static void RetireBuffer(Buffer& buffer)
+	{
+		if (!buffer.Handle && !buffer.Memory)
+			return;
+
+		DeletionQueue::ReleaseBuffer(buffer.Handle, buffer.Memory);
+		buffer.Handle = VK_NULL_HANDLE;
+		buffer.Memory = {};
+		buffer.Size = 0;
+	}
+
+	static void FlushBuffer(const Buffer& buffer)
+	{
+		GpuAllocator::Flush(buffer.Memory);
+	}
+
+#ifndef WL_HEADLESS
+	static RenderTarget GetSwapchainTarget()
+	{
+		auto* wd = Walnut::Application::GetMainWindowData();
+
+		RenderTarget target;
+		target.Width = (uint32_t)wd->Width;
+		target.Height = (uint32_t)wd->Height;
+		target.ColorFormat = wd->SurfaceFormat.format;
+		for (uint32_t i = 0; i < wd->ImageCount; ++i)
+			target.ColorViews.push_back(wd->Frames[i].BackbufferView);
+		return target;
+	}
+#endif
+
+	void Renderer::SetAssetDirectory(const std::filesystem::path& directory)
+	{
+		s_AssetBasePath = directory;
+		s_ShaderBasePath = directory / "Shaders/bin";
+	}
+
+#ifndef WL_HEADLESS
 	void Renderer::Init()
 	{
+		Init(GetSwapchainTarget());
+		m_Offscreen = false;
+	}
+#endif
+
+	void Renderer::Init(const RenderTarget& target)
+	{
+		m_Target = target;
+		m_Offscreen = true;
+
 		//// Base textures
-		const std::filesystem::path TEXTURE_BASE_PATH = "C:/Users/Asus/Documents/Projects/Cubed/Cubed-Client/Assets/Textures";
+		const std::filesystem::path TEXTURE_BASE_PATH = s_AssetBasePath / "Textures";
 		TextureManager::LoadTexture(TEXTURE_BASE_PATH / "simple.png"); // id 0
 		//TextureManager::LoadTexture(TEXTURE_BASE_PATH / "man.png");    // id 1
+		CreateBlockTextures();
 
 		//// Load model first (so we know max texture index)
 		//auto model = Cubed::ModelManager::Load(
@@ -47,64 +125,27 @@ namespace Cubed {
 		//// Log model info
 		//LogModelInfo(model);
 
-		// Find max texture ID across all models
-		uint32_t maxTexId = 0;
-		for (auto& m : m_Models)
-			for (auto& mesh : m->GetMeshes())
-				if (mesh.TextureIndex > maxTexId) maxTexId = mesh.TextureIndex;
-
-		// Create descriptor sets
-		CreateTextureDescriptorSet(maxTexId);
+		// Create descriptor sets; textures loaded from here on go straight into their slots
+		m_TextureTable.Init(TextureManager::GetTexture(TextureManager::GetDefaultChecker())->GetImageInfo());
+		TextureManager::SetTextureTable(&m_TextureTable);
 		CreateCameraDescriptorSet();
+		CreateDrawDataDescriptorSetLayout();
 
 		// Render infra
 		CreateRenderPass();
 		CreateDepthResources();
 		CreateFramebuffers();
 		InitBuffers();
-		InitPipeline();
-	}
+		m_PipelineCache.Load(s_PipelineCachePath);
+		CreatePipelines();
 
-	void Renderer::CreateTextureDescriptorSet(uint32_t maxTexId)
-	{
-		VkDevice device = GetVulkanInfo()->Device;
-		static constexpr uint32_t MAX_TEXTURES = 100;
-
-		// Layout for texture array
-		VkDescriptorSetLayoutBinding texBinding{};
-		texBinding.binding = 0;
-		texBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		texBinding.descriptorCount = MAX_TEXTURES;
-		texBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-		VkDescriptorSetLayoutCreateInfo texLayoutInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
-		texLayoutInfo.bindingCount = 1;
-		texLayoutInfo.pBindings = &texBinding;
-		VK_CHECK(vkCreateDescriptorSetLayout(device, &texLayoutInfo, nullptr, &m_TexturesDescriptorSetLayout));
-
-		m_TexturesDescriptorSet = Walnut::Application::AllocateDescriptorSet(m_TexturesDescriptorSetLayout);
-
-		// Fill descriptors
-		std::vector<VkDescriptorImageInfo> imageInfos(MAX_TEXTURES);
-		for (uint32_t i = 0; i < MAX_TEXTURES; ++i) {
-			if (i < TextureManager::Count()) {
-				imageInfos[i] = TextureManager::GetTexture(i)->GetImageInfo();
-				WL_INFO_TAG("CLIENT", "USING normal texture");
-			}
-			else
-			{ 
-				WL_INFO_TAG("CLIENT", "USING 0 texture");
-				imageInfos[i] = TextureManager::GetTexture(0)->GetImageInfo();
-			}
-		}
+		// Reduces the depth attachment after the main pass, for occlusion culling
+		VkShaderModule hizShader = loadShader(s_ShaderBasePath / "hiz.comp.spirv");
+		m_HiZ.Init(hizShader, m_PipelineCache.GetHandle());
+		vkDestroyShaderModule(GetVulkanInfo()->Device, hizShader, nullptr);
 
-		VkWriteDescriptorSet texWrite{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
-		texWrite.dstSet = m_TexturesDescriptorSet;
-		texWrite.dstBinding = 0;
-		texWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		texWrite.descriptorCount = MAX_TEXTURES;
-		texWrite.pImageInfo = imageInfos.data();
-		vkUpdateDescriptorSets(device, 1, &texWrite, 0, nullptr);
+		InitUpscaler();
+		SetDynamicResolution(m_DynamicResolution.GetSettings());
 	}
 
 	void Renderer::CreateCameraDescriptorSet()
@@ -114,7 +155,7 @@ namespace Cubed {
 		// Layout
 		VkDescriptorSetLayoutBinding camBinding{};
 		camBinding.binding = 0;
-		camBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		camBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		camBinding.descriptorCount = 1;
 		camBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
@@ -123,28 +164,141 @@ namespace Cubed {
 		camLayoutInfo.pBindings = &camBinding;
 		VK_CHECK(vkCreateDescriptorSetLayout(device, &camLayoutInfo, nullptr, &m_CameraDescriptorSetLayout));
 
-		// Buffer
-		m_CameraUBO.Usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-		CreateOrResizeBuffer(m_CameraUBO, sizeof(m_CameraData));
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(GetVulkanInfo()->PhysicalDevice, &properties);
+		m_UniformAlignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 16);
+
+		// The set itself points into the frame ring, see UpdateCameraDescriptorSet
+	}
+
+	void Renderer::UpdateCameraDescriptorSet()
+	{
+		VkDevice device = GetVulkanInfo()->Device;
 
-		// Descriptor set
-		m_CameraDescriptorSet = Walnut::Application::AllocateDescriptorSet(m_CameraDescriptorSetLayout);
+		// The old set may still be bound by a frame in flight, so it can't be rewritten in place
+		DeletionQueue::ReleaseDescriptorSet(m_CameraDescriptorSet);
+		m_CameraDescriptorSet = AllocateDescriptorSet(m_CameraDescriptorSetLayout);
+		m_CameraRingGeneration = m_FrameRing.GetGeneration();
 
-		// Write descriptor
+		// Write descriptor, the frame's offset is supplied at bind time
 		VkDescriptorBufferInfo camBufInfo{};
-		camBufInfo.buffer = m_CameraUBO.Handle;
+		camBufInfo.buffer = m_FrameRing.GetBuffer();
 		camBufInfo.offset = 0;
 		camBufInfo.range = sizeof(m_CameraData);
 
 		VkWriteDescriptorSet camWrite{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
 		camWrite.dstSet = m_CameraDescriptorSet;
 		camWrite.dstBinding = 0;
-		camWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		camWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		camWrite.descriptorCount = 1;
 		camWrite.pBufferInfo = &camBufInfo;
 		vkUpdateDescriptorSets(device, 1, &camWrite, 0, nullptr);
 	}
 
+	void Renderer::CreateDrawDataDescriptorSetLayout()
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+
+		// 0: per-draw data, 1: model transforms
+		VkDescriptorSetLayoutBinding drawBindings[2]{};
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			drawBindings[i].binding = i;
+			drawBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			drawBindings[i].descriptorCount = 1;
+			drawBindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo drawLayoutInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+		drawLayoutInfo.bindingCount = 2;
+		drawLayoutInfo.pBindings = drawBindings;
+		VK_CHECK(vkCreateDescriptorSetLayout(device, &drawLayoutInfo, nullptr, &m_DrawDataDescriptorSetLayout));
+
+		// Both features are needed for a count above one and a non-zero firstInstance
+		// in the indirect commands, and the device has to have been created with them;
+		// without them the runs are issued as direct draws. On by default when there.
+		const VkPhysicalDeviceFeatures& features = GetEnabledVulkanFeatures().Core;
+		m_MultiDrawIndirectSupported = features.multiDrawIndirect && features.drawIndirectFirstInstance;
+		m_UseMultiDrawIndirect = m_MultiDrawIndirectSupported;
+	}
+
+	void Renderer::PrepareDrawBuffers(uint32_t drawCount, uint32_t transformCount)
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+		DrawBuffers& frame = m_DrawBuffers[m_FrameIndex];
+
+		if (!frame.Set)
+			frame.Set = AllocateDescriptorSet(m_DrawDataDescriptorSetLayout);
+
+		// Grow by doubling, like the instance buffers
+		auto capacityFor = [](uint32_t count)
+		{
+			uint32_t capacity = 256;
+			while (capacity < count)
+				capacity *= 2;
+			return capacity;
+		};
+
+		VkDescriptorBufferInfo bufInfos[2]{};
+		VkWriteDescriptorSet writes[2]{};
+		uint32_t writeCount = 0;
+		auto writeBinding = [&](uint32_t binding, const Buffer& buffer)
+		{
+			bufInfos[writeCount].buffer = buffer.Handle;
+			bufInfos[writeCount].offset = 0;
+			bufInfos[writeCount].range = VK_WHOLE_SIZE;
+
+			VkWriteDescriptorSet& write = writes[writeCount];
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = frame.Set;
+			write.dstBinding = binding;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			write.descriptorCount = 1;
+			write.pBufferInfo = &bufInfos[writeCount];
+			writeCount++;
+		};
+
+		const VkDeviceSize drawsSize = (VkDeviceSize)drawCount * sizeof(ModelDrawData);
+		if (!frame.Draws.Handle || drawsSize > frame.Draws.Size)
+		{
+			const uint32_t capacity = capacityFor(drawCount);
+
+			RetireBuffer(frame.Draws);
+			RetireBuffer(frame.Commands);
+
+			frame.Draws.Usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+			CreateOrResizeBuffer(frame.Draws, (VkDeviceSize)capacity * sizeof(ModelDrawData));
+			frame.Commands.Usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+			CreateOrResizeBuffer(frame.Commands, (VkDeviceSize)capacity * sizeof(VkDrawIndexedIndirectCommand));
+			writeBinding(0, frame.Draws);
+		}
+
+		const VkDeviceSize transformsSize = (VkDeviceSize)transformCount * sizeof(ModelTransform);
+		if (!frame.Transforms.Handle || transformsSize > frame.Transforms.Size)
+		{
+			RetireBuffer(frame.Transforms);
+
+			frame.Transforms.Usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+			CreateOrResizeBuffer(frame.Transforms, (VkDeviceSize)capacityFor(transformCount) * sizeof(ModelTransform));
+			writeBinding(1, frame.Transforms);
+		}
+
+		if (writeCount > 0)
+			vkUpdateDescriptorSets(device, writeCount, writes, 0, nullptr);
+	}
+
+	void Renderer::RemoveModel(const std::shared_ptr<Cubed::Model>& model) {
+		auto it = std::find(m_Models.begin(), m_Models.end(), model);
+		if (it == m_Models.end())
+			return;
+
+		// Keyed by address, a model loaded later could reuse it. The GPU data stays:
+		// ModelManager may hand the same model out again, ~Model frees it with the last reference.
+		for (const Mesh& mesh : model->GetMeshes())
+			m_MeshLods.erase(&mesh);
+		m_Models.erase(it);
+	}
+
 	void Renderer::LogModelInfo(const std::shared_ptr<Cubed::Model>& model)
 	{
 		const auto& meshes = model->GetMeshes();
@@ -168,69 +322,126 @@ namespace Cubed {
 		VkDevice device = GetVulkanInfo()->Device;
 		vkDeviceWaitIdle(device);
 
-		DestroyPipeline();
+		m_CommandRecorder.Destroy();
+		m_Profiler.Destroy();
+		m_HiZ.Destroy();
+		RetirePipelines();
+		m_PipelineCache.Save();
+		m_PipelineCache.Destroy();
 		DestroyFramebuffers();
+		m_Upscaler.Retire();
 		DestroyDepthResources();
-		DestroyRenderPass();
+		RetireRenderPass();
+		TextureManager::SetTextureTable(nullptr);
 		TextureManager::ClearCache();
 		for (auto& model : m_Models) {
 			model->DestroyGPU();
 		}
 		ModelManager::Clear();
 
-		// Buffers
-		if (m_VertexBuffer.Handle) { vkDestroyBuffer(device, m_VertexBuffer.Handle, nullptr); m_VertexBuffer.Handle = VK_NULL_HANDLE; }
-		if (m_VertexBuffer.Memory) { vkFreeMemory(device, m_VertexBuffer.Memory, nullptr);   m_VertexBuffer.Memory = VK_NULL_HANDLE; }
-		if (m_IndexBuffer.Handle) { vkDestroyBuffer(device, m_IndexBuffer.Handle, nullptr);  m_IndexBuffer.Handle = VK_NULL_HANDLE; }
-		if (m_IndexBuffer.Memory) { vkFreeMemory(device, m_IndexBuffer.Memory, nullptr);     m_IndexBuffer.Memory = VK_NULL_HANDLE; }
-		if (m_CameraUBO.Handle) { vkDestroyBuffer(device, m_CameraUBO.Handle, nullptr);    m_CameraUBO.Handle = VK_NULL_HANDLE; }
-		if (m_CameraUBO.Memory) { vkFreeMemory(device, m_CameraUBO.Memory, nullptr);       m_CameraUBO.Memory = VK_NULL_HANDLE; }
+		// Device is idle, the pools can go right away
+		m_ChunkMeshes.clear();
+		m_ChunkGeometry.Destroy();
+		GeometryPool::GetModelPool().Destroy();
+		m_CubeGeometry = InvalidGeometry;
 
-		// Descriptor sets/layouts (optional to free sets if pool is reset elsewhere)
-		if (m_TexturesDescriptorSet) {
-			vkFreeDescriptorSets(device, Walnut::Application::GetDescriptorPool(), 1, &m_TexturesDescriptorSet);
-			m_TexturesDescriptorSet = VK_NULL_HANDLE;
+		m_FrameRing.Destroy();
+
+		for (auto& frame : m_DrawBuffers)
+		{
+			for (Buffer* buffer : { &frame.Draws, &frame.Commands, &frame.Transforms })
+			{
+				if (buffer->Handle) vkDestroyBuffer(device, buffer->Handle, nullptr);
+				GpuAllocator::Free(buffer->Memory);
+			}
+			if (frame.Set) vkFreeDescriptorSets(device, GetDescriptorPool(), 1, &frame.Set);
 		}
+		m_DrawBuffers.clear();
+
+		// Descriptor sets/layouts (optional to free sets if pool is reset elsewhere)
 		if (m_CameraDescriptorSet) {
-			vkFreeDescriptorSets(device, Walnut::Application::GetDescriptorPool(), 1, &m_CameraDescriptorSet);
+			vkFreeDescriptorSets(device, GetDescriptorPool(), 1, &m_CameraDescriptorSet);
 			m_CameraDescriptorSet = VK_NULL_HANDLE;
 		}
-		if (m_TexturesDescriptorSetLayout) { vkDestroyDescriptorSetLayout(device, m_TexturesDescriptorSetLayout, nullptr); m_TexturesDescriptorSetLayout = VK_NULL_HANDLE; }
+		if (m_BlockTextureSet) {
+			vkFreeDescriptorSets(device, GetDescriptorPool(), 1, &m_BlockTextureSet);
+			m_BlockTextureSet = VK_NULL_HANDLE;
+		}
+		m_BlockTextures.reset();
+		m_TextureTable.Destroy();
 		if (m_CameraDescriptorSetLayout) { vkDestroyDescriptorSetLayout(device, m_CameraDescriptorSetLayout, nullptr);   m_CameraDescriptorSetLayout = VK_NULL_HANDLE; }
+		if (m_DrawDataDescriptorSetLayout) { vkDestroyDescriptorSetLayout(device, m_DrawDataDescriptorSetLayout, nullptr); m_DrawDataDescriptorSetLayout = VK_NULL_HANDLE; }
+		if (m_BlockTextureSetLayout) { vkDestroyDescriptorSetLayout(device, m_BlockTextureSetLayout, nullptr); m_BlockTextureSetLayout = VK_NULL_HANDLE; }
+
+		// Last, everything that still holds device memory has been released above;
+		// the device is idle, so what was deferred can go right away
+		DeletionQueue::Flush();
+		GpuAllocator::Shutdown();
 	}
 
 
+#ifndef WL_HEADLESS
 	// In Renderer.cpp
 	void Renderer::OnSwapchainRecreated() {
-		VkDevice device = GetVulkanInfo()->Device;
-		vkDeviceWaitIdle(device);
+		if (m_Offscreen)
+			return;
+		m_Target = GetSwapchainTarget();
 
-		// Tear down swapchain-dependent stuff
-		DestroyPipeline();
-		DestroyFramebuffers();
-		DestroyDepthResources();
-		DestroyRenderPass();
+		// Usually only the size changed: viewport and scissor are dynamic, so the
+		// render pass and pipelines stay and only the size-dependent targets are rebuilt
+		if (m_Target.ColorFormat == m_ColorFormat)
+		{
+			RetireSwapchainResources();
+			CreateDepthResources();
+			CreateFramebuffers();
+			if (m_Upscaler.HasTargets())
+			{
+				RetireSceneTargets();
+				CreateSceneTargets();
+			}
+			return;
+		}
+
+		// A new surface format needs a new render pass and pipelines. Frames in
+		// flight still use the old ones, so everything goes through the deletion
+		// queue instead of waiting for the device to idle.
+		RetirePipelines();
+		RetireSceneTargets();
+		RetireSwapchainResources();
+		RetireRenderPass();
+		m_Upscaler.Retire();
 
-		// Recreate with the new wd->Width/Height/SurfaceFormat
+		// Recreate with the new size and surface format
 		CreateRenderPass();
 		CreateDepthResources();
 		CreateFramebuffers();
-		InitPipeline(); // pipeline references m_RenderPass, so rebuild it
+		CreatePipelines(); // pipeline references m_RenderPass, so rebuild it
+		InitUpscaler();
+		SetDynamicResolution(m_DynamicResolution.GetSettings());
 	}
+#endif
 
 
 	// In Renderer.cpp
-	void Renderer::DestroyPipeline() {
-		VkDevice device = GetVulkanInfo()->Device;
-		if (m_GraphicsPipeline) { vkDestroyPipeline(device, m_GraphicsPipeline, nullptr); m_GraphicsPipeline = VK_NULL_HANDLE; }
-		if (m_PipelineLayout) { vkDestroyPipelineLayout(device, m_PipelineLayout, nullptr); m_PipelineLayout = VK_NULL_HANDLE; }
+	void Renderer::RetirePipelines() {
+		for (VkPipeline* pipeline : { &m_GraphicsPipeline, &m_InstancedPipeline, &m_VoxelPipeline, &m_IndirectPipeline, &m_OutlinePipeline }) {
+			DeletionQueue::ReleasePipeline(*pipeline);
+			*pipeline = VK_NULL_HANDLE;
+		}
+		for (VkPipelineLayout* layout : { &m_PipelineLayout, &m_VoxelPipelineLayout, &m_IndirectPipelineLayout }) {
+			DeletionQueue::ReleasePipelineLayout(*layout);
+			*layout = VK_NULL_HANDLE;
+		}
 	}
 
 	void Renderer::DestroyFramebuffers() {
 		VkDevice device = GetVulkanInfo()->Device;
 		for (auto fb : m_Framebuffers)
 			if (fb) vkDestroyFramebuffer(device, fb, nullptr);
+		for (auto fb : m_SceneFramebuffers)
+			if (fb) vkDestroyFramebuffer(device, fb, nullptr);
 		m_Framebuffers.clear();
+		m_SceneFramebuffers.clear();
 	}
 
 	void Renderer::DestroyDepthResources() {
@@ -238,160 +449,591 @@ namespace Cubed {
 		for (auto& d : m_Depth) {
 			if (d.view) { vkDestroyImageView(device, d.view, nullptr);   d.view = VK_NULL_HANDLE; }
 			if (d.image) { vkDestroyImage(device, d.image, nullptr);      d.image = VK_NULL_HANDLE; }
-			if (d.memory) { vkFreeMemory(device, d.memory, nullptr);       d.memory = VK_NULL_HANDLE; }
+			GpuAllocator::Free(d.memory);
 		}
 		m_Depth.clear();
 	}
 
-	void Renderer::DestroyRenderPass() {
-		VkDevice device = GetVulkanInfo()->Device;
-		if (m_RenderPass) { vkDestroyRenderPass(device, m_RenderPass, nullptr); m_RenderPass = VK_NULL_HANDLE; }
+	void Renderer::RetireRenderPass() {
+		DeletionQueue::ReleaseRenderPass(m_RenderPass);
+		m_RenderPass = VK_NULL_HANDLE;
+	}
+
+	void Renderer::RetireSwapchainResources() {
+		// Frames still in flight may render into them, so they go once those have finished
+		for (auto fb : m_Framebuffers)
+			DeletionQueue::ReleaseFramebuffer(fb);
+		for (auto& d : m_Depth) {
+			DeletionQueue::ReleaseImageView(d.view);
+			DeletionQueue::ReleaseImage(d.image, d.memory);
+		}
+
+		m_Depth.clear();
+		m_Framebuffers.clear();
 	}
 
 
+#ifndef WL_HEADLESS
 	void Renderer::BeginScene(const Camera& camera) {
-		auto* wd = Walnut::Application::GetMainWindowData();
-		VkCommandBuffer cmd = Walnut::Application::GetActiveCommandBuffer();
-		VkDevice device = GetVulkanInfo()->Device;
+		BeginScene(camera, Walnut::Application::GetActiveCommandBuffer(), Walnut::Application::GetMainWindowData()->FrameIndex);
+	}
+#endif
+
+	void Renderer::BeginScene(const Camera& camera, VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+		VkCommandBuffer cmd = commandBuffer;
+		const uint32_t frameCount = (uint32_t)m_Target.ColorViews.size();
+		m_CommandBuffer = commandBuffer;
+		m_SceneStart = std::chrono::steady_clock::now();
 
 		// --- update camera UBO (your code) ---
-		float w = (float)wd->Width, h = (float)wd->Height;
+		float w = (float)m_Target.Width, h = (float)m_Target.Height;
 		glm::mat4 camXf = glm::translate(glm::mat4(1.0f), camera.Position) *
 			glm::eulerAngleXYZ(glm::radians(camera.Rotation.x),
 				glm::radians(camera.Rotation.y),
 				glm::radians(camera.Rotation.z));
 		m_CameraData.ViewProjection =
-			glm::perspectiveRH_ZO(glm::radians(45.0f), w / h, 0.1f, 1000.0f) * glm::inverse(camXf);
-
-		void* data;
-		vkMapMemory(device, m_CameraUBO.Memory, 0, sizeof(m_CameraData), 0, &data);
-		memcpy(data, &m_CameraData, sizeof(m_CameraData));
-		vkUnmapMemory(device, m_CameraUBO.Memory);
+			glm::perspectiveRH_ZO(glm::radians(s_FieldOfView), w / h, s_NearPlane, s_FarPlane) * glm::inverse(camXf);
+		m_LodScale = 1.0f / std::tan(glm::radians(s_FieldOfView) * 0.5f);
+		m_Frustum = Frustum::FromMatrix(m_CameraData.ViewProjection);
+		m_CameraPosition = camera.Position;
+		m_CullStats = {};
+		m_ModelTransforms.clear();
 
 		// --- begin your render pass ---
-		uint32_t frameIndex = wd->FrameIndex;
+		// This image's previous frame has retired, its part of the ring can be overwritten
+		// and what was released that many frames ago destroyed
+		m_FrameIndex = frameIndex;
+		DeletionQueue::BeginFrame(frameCount);
+		m_FrameRing.BeginFrame(frameIndex, frameCount);
+		if (m_FrameRing.GetGeneration() != m_CameraRingGeneration)
+			UpdateCameraDescriptorSet();
+		m_HiZ.BeginFrame(frameIndex, frameCount);
+
+		RingAllocation cameraData = m_FrameRing.Allocate(sizeof(m_CameraData), m_UniformAlignment);
+		memcpy(cameraData.Mapped, &m_CameraData, sizeof(m_CameraData));
+		m_CameraOffset = cameraData.Offset;
+
+		if (m_DrawBuffers.size() < frameCount)
+			m_DrawBuffers.resize(frameCount);
+
+		m_Profiler.BeginFrame(cmd, frameIndex, frameCount);
+
+		// The GPU time this slot just read back picks the resolution of this frame. A slot
+		// whose queries weren't ready passes no sample, rather than the last one again.
+		const float gpuFrameMs = m_Profiler.GetReadBackTime("Frame");
+		const float scale = m_Upscaler.HasTargets() ? m_DynamicResolution.Update(gpuFrameMs, frameCount) : 1.0f;
+		m_RenderExtent.width = std::min(std::max((uint32_t)std::lround(m_Target.Width * scale), 1u), m_Target.Width);
+		m_RenderExtent.height = std::min(std::max((uint32_t)std::lround(m_Target.Height * scale), 1u), m_Target.Height);
+
+		m_Profiler.BeginScope(cmd, "Frame");
+
+		// Geometry staged since last frame is copied in before the pass starts
+		m_Profiler.BeginScope(cmd, "Uploads");
+		GeometryPool::GetModelPool().FlushUploads(cmd);
+		m_ChunkGeometry.FlushUploads(cmd);
+		m_Profiler.EndScope(cmd);
+	}
+
+	void Renderer::EndScene() {
+		VkCommandBuffer cmd = m_CommandBuffer;
+		GpuProfiler::CpuScope cpuScope(m_Profiler, "EndScene");
+
+		// Indirect draws write their data and commands straight into this frame's buffers
+		const uint32_t indirectCount = m_RenderQueue.GetIndirectCount();
+		DrawBuffers& drawBuffers = m_DrawBuffers[m_FrameIndex];
+		IndirectTarget indirect;
+		if (indirectCount > 0)
+		{
+			PrepareDrawBuffers(indirectCount, (uint32_t)m_ModelTransforms.size());
+			memcpy(drawBuffers.Transforms.Memory.Mapped, m_ModelTransforms.data(), m_ModelTransforms.size() * sizeof(ModelTransform));
+			indirect.Set = drawBuffers.Set;
+			indirect.DrawData = (uint8_t*)drawBuffers.Draws.Memory.Mapped;
+			indirect.DrawDataStride = sizeof(ModelDrawData);
+			indirect.Commands = drawBuffers.Commands.Handle;
+			indirect.CommandData = (VkDrawIndexedIndirectCommand*)drawBuffers.Commands.Memory.Mapped;
+			indirect.MultiDraw = m_UseMultiDrawIndirect;
+		}
+
+		// Textures added since last frame get their slots written before the set is bound
+		m_TextureTable.Commit();
+		VkDescriptorSet sets[] = { m_TextureTable.GetSet(), m_CameraDescriptorSet };
+		PassBindings bindings;
+		bindings.Sets = sets;
+		bindings.SetCount = 2;
+		bindings.DynamicOffsets = &m_CameraOffset;
+		bindings.DynamicOffsetCount = 1;
+		bindings.Indirect = indirectCount > 0 ? &indirect : nullptr;
+
+		// Everything is queued by now, so the pass knows whether it holds secondary command buffers
+		const bool parallel = m_ParallelRecording && m_CommandRecorder.GetThreadCount() > 1
+			&& m_RenderQueue.Size() >= 2 * s_DrawsPerBatch;
 
 		VkClearValue clears[2];
         clears[0].color = { {0.53f, 0.81f, 0.98f, 1.0f} };
 		clears[1].depthStencil = { 1.0f, 0 };
 
+		// Below full size the scene goes into the top-left corner of the upscaler's image
+		const bool upscale = m_Upscaler.HasTargets()
+			&& (m_RenderExtent.width != m_Target.Width || m_RenderExtent.height != m_Target.Height);
+		if (!upscale)
+			m_RenderExtent = { m_Target.Width, m_Target.Height };
+		const VkFramebuffer framebuffer = upscale ? m_SceneFramebuffers[m_FrameIndex] : m_Framebuffers[m_FrameIndex];
+
 		VkRenderPassBeginInfo rp{ VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
 		rp.renderPass = m_RenderPass;
-		rp.framebuffer = m_Framebuffers[frameIndex];
+		rp.framebuffer = framebuffer;
 		rp.renderArea.offset = { 0,0 };
-		rp.renderArea.extent = { (uint32_t)wd->Width, (uint32_t)wd->Height };
+		rp.renderArea.extent = m_RenderExtent;
 		rp.clearValueCount = 2;
 		rp.pClearValues = clears;
 
-		vkCmdBeginRenderPass(cmd, &rp, VK_SUBPASS_CONTENTS_INLINE);
+		m_Profiler.BeginScope(cmd, "Main pass");
+		if (!parallel)
+			m_Profiler.BeginStatistics(cmd);
+		vkCmdBeginRenderPass(cmd, &rp, parallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
 
-		VkViewport vp{ 0, (float)wd->Height, (float)wd->Width, -(float)wd->Height, 0.0f, 1.0f };
-		vkCmdSetViewport(cmd, 0, 1, &vp);
-		VkRect2D sc{ {0,0}, { (uint32_t)wd->Width, (uint32_t)wd->Height } };
-		vkCmdSetScissor(cmd, 0, 1, &sc);
-	}
+		VkViewport vp{ 0, (float)m_RenderExtent.height, (float)m_RenderExtent.width, -(float)m_RenderExtent.height, 0.0f, 1.0f };
+		VkRect2D sc{ {0,0}, m_RenderExtent };
+
+		if (parallel)
+		{
+			SecondaryPass pass;
+			pass.FrameIndex = m_FrameIndex;
+			pass.RenderPass = m_RenderPass;
+			pass.Framebuffer = framebuffer;
+			pass.Viewport = vp;
+			pass.Scissor = sc;
+			m_RenderQueue.FlushParallel(cmd, bindings, m_CommandRecorder, pass, s_DrawsPerBatch);
+		}
+		else
+		{
+			vkCmdSetViewport(cmd, 0, 1, &vp);
+			vkCmdSetScissor(cmd, 0, 1, &sc);
+			m_RenderQueue.Flush(cmd, bindings);
+		}
 
-	void Renderer::EndScene() {
-		VkCommandBuffer cmd = Walnut::Application::GetActiveCommandBuffer();
 		vkCmdEndRenderPass(cmd);
+		m_Profiler.EndStatistics(cmd);
+		m_Profiler.EndScope(cmd);
+
+		// Tested against when this frame's slot comes round again
+		if (m_OcclusionCulling)
+		{
+			m_Profiler.BeginScope(cmd, "Hi-Z");
+			HiZSource depth;
+			depth.Image = m_Depth[m_FrameIndex].image;
+			depth.View = m_Depth[m_FrameIndex].view;
+			depth.Aspect = m_DepthFormat == VK_FORMAT_D32_SFLOAT ? VK_IMAGE_ASPECT_DEPTH_BIT
+				: VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+			depth.Width = m_RenderExtent.width;
+			depth.Height = m_RenderExtent.height;
+			m_HiZ.Build(cmd, depth, m_CameraData.ViewProjection);
+			m_Profiler.EndScope(cmd);
+		}
+
+		if (upscale)
+		{
+			m_Profiler.BeginScope(cmd, "Upscale");
+			m_Upscaler.Record(cmd, m_FrameIndex, m_RenderExtent.width, m_RenderExtent.height);
+			m_Profiler.EndScope(cmd);
+		}
+		m_Profiler.EndScope(cmd);   // Frame
+
+		if (indirectCount > 0)
+		{
+			FlushBuffer(drawBuffers.Draws);
+			FlushBuffer(drawBuffers.Commands);
+			FlushBuffer(drawBuffers.Transforms);
+		}
+
+		// One flush covers the camera and every instanced draw of the frame
+		m_FrameRing.Flush();
+
+		m_Profiler.RecordCpuTime("Scene", std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_SceneStart).count());
 	}
 
 	void Renderer::RenderCube(const glm::vec3& position, const glm::vec3& rotation, int textureIndex)
 	{
 		glm::vec3 translation = position;
 
-		m_PushConstants.Transform = glm::translate(glm::mat4(1.0f), translation) *
+		PushConstants push{};
+		push.Transform = glm::translate(glm::mat4(1.0f), translation) *
 			glm::eulerAngleXYZ(glm::radians(rotation.x), glm::radians(rotation.y), glm::radians(rotation.z));
-		m_PushConstants.TextureIndex = textureIndex;
+		push.TextureIndex = textureIndex;
+
+		const GeometryPool& pool = GeometryPool::GetModelPool();
+		DrawItem state;
+		state.Pipeline = m_GraphicsPipeline;
+		state.Layout = m_PipelineLayout;
+		state.Geometry = &pool;
+		state.Range = pool.GetRange(m_CubeGeometry);
+
+		const float depth = glm::distance(m_CameraPosition, position) / s_FarPlane;
+		m_RenderQueue.Submit(RenderQueue::MakeKey(CubePass, ModelGeometry, depth, (uint16_t)textureIndex),
+			state, push, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+	}
 
-		VkCommandBuffer commandBuffer = Walnut::Application::GetActiveCommandBuffer();
+	void Renderer::RenderCubes(const std::vector<InstanceData>& instances)
+	{
+		if (m_CubeGeometry == InvalidGeometry)
+			return;
 
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
+		const GeometryPool& pool = GeometryPool::GetModelPool();
+		DrawInstanced(pool, pool.GetRange(m_CubeGeometry), instances);
+	}
 
-		VkDescriptorSet sets[] = { m_TexturesDescriptorSet, m_CameraDescriptorSet };
-		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout,
-			0, 2, sets, 0, nullptr);
+	void Renderer::RenderMeshInstanced(const Mesh& mesh, const std::vector<InstanceData>& instances)
+	{
+		if (mesh.Geometry == InvalidGeometry || mesh.Lods.empty())
+			return;
+
+		// Instances have no identity across frames, so they pick a level without hysteresis
+		const uint32_t lodCount = m_MeshLod ? (uint32_t)mesh.Lods.size() : 1;
+		for (uint32_t lod = 0; lod < lodCount; lod++)
+			m_LodInstances[lod].clear();
+		for (const InstanceData& instance : instances)
+		{
+			const uint32_t lod = lodCount > 1 ? SelectMeshLod(mesh, mesh.LocalBounds.Transformed(instance.Transform), 0) : 0;
+			m_LodInstances[lod].push_back(instance);
+		}
+
+		const GeometryPool& pool = GeometryPool::GetModelPool();
+		const GeometryRange& range = pool.GetRange(mesh.Geometry);
+		for (uint32_t lod = 0; lod < lodCount; lod++)
+		{
+			GeometryRange lodRange = range;
+			lodRange.FirstIndex += mesh.Lods[lod].FirstIndex;
+			lodRange.IndexCount = mesh.Lods[lod].IndexCount;
+			DrawInstanced(pool, lodRange, m_LodInstances[lod]);
+
+			const uint32_t count = (uint32_t)m_LodInstances[lod].size();
+			m_CullStats.ModelTriangles += (uint64_t)count * lodRange.IndexCount / 3;
+			m_CullStats.ModelTrianglesFull += (uint64_t)count * mesh.IndexCount / 3;
+			m_CullStats.MeshesPerLod[lod] += count;
+		}
+	}
 
-		vkCmdPushConstants(commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &m_PushConstants);
+	uint32_t Renderer::SelectMeshLod(const Mesh& mesh, const Bounds& world, uint32_t current) const
+	{
+		const float distance = std::max(glm::distance(m_CameraPosition, world.Center), s_NearPlane);
+		const float screenSize = world.Radius * m_LodScale / distance;
 
-		VkDeviceSize offset{ 0 };
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_VertexBuffer.Handle, &offset);
-		vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer.Handle, offset, VK_INDEX_TYPE_UINT32);
-		vkCmdDrawIndexed(commandBuffer, (uint32_t)m_IndexBuffer.Size / 4, 1, 0, 0, 0);
+		uint32_t lod = 0;
+		while (lod + 1 < mesh.Lods.size() && lod < std::size(s_LodScreenSizes))
+		{
+			const float threshold = s_LodScreenSizes[lod] * (current > lod ? 1.0f + s_LodHysteresis : 1.0f - s_LodHysteresis);
+			if (screenSize >= threshold)
+				break;
+			lod++;
+		}
+		return lod;
 	}
 
-	void Renderer::RenderModels()
+	void Renderer::DrawInstanced(const GeometryPool& pool, const GeometryRange& range, const std::vector<InstanceData>& instances)
 	{
-		VkCommandBuffer cmd = Walnut::Application::GetActiveCommandBuffer();
+		if (instances.empty())
+			return;
+
+		// Out of room only drops this frame's draw, the ring grows for the next one
+		const VkDeviceSize size = instances.size() * sizeof(InstanceData);
+		RingAllocation instanceData = m_FrameRing.Allocate(size, 16);
+		if (!instanceData)
+			return;
+
+		memcpy(instanceData.Mapped, instances.data(), size);
+
+		DrawItem state;
+		state.Pipeline = m_InstancedPipeline;
+		state.Layout = m_PipelineLayout;
+		state.Geometry = &pool;
+		state.Range = range;
+		state.InstanceBuffer = instanceData.Buffer;
+
+		// Instances are spread out, there's no single depth to sort by
+		for (size_t first = 0; first < instances.size();)
+		{
+			size_t last = instances.size();
+			if (!m_NonUniformTextures)
+			{
+				last = first + 1;
+				while (last < instances.size() && instances[last].TextureIndex == instances[first].TextureIndex)
+					last++;
+			}
 
-		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
+			state.InstanceOffset = instanceData.Offset + first * sizeof(InstanceData);
+			state.InstanceCount = (uint32_t)(last - first);
+			m_RenderQueue.Submit(RenderQueue::MakeKey(InstancedPass, ModelGeometry, 0.0f, (uint16_t)instances[first].TextureIndex), state);
+			first = last;
+		}
+	}
+
+	void Renderer::RenderModels()
+	{
+		GpuProfiler::CpuScope cpuScope(m_Profiler, "RenderModels");
 
-		VkDescriptorSet sets[] = { m_TexturesDescriptorSet, m_CameraDescriptorSet };
+		// Only the models moved since last frame, and what hangs off them, are recomputed
+		SceneGraph& scene = SceneGraph::GetModelScene();
+		scene.Update();
 
+		m_CullSpheres.Clear();
+		m_CullBounds.clear();
+		m_CullMeshes.clear();
 		for (auto& model : m_Models)
 		{
+			const glm::mat4& transform = scene.GetWorldMatrix(model->GetNode());
 			for (const auto& mesh : model->GetMeshes())
 			{
-				// Bind descriptor sets once per draw
-				vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout,
-					0, 2, sets, 0, nullptr);
-
-				// Detect outline meshes by name
-				bool isOutline = (mesh.Name.find("outline") != std::string::npos);
-
-				// Fill push constants
-				m_PushConstants.Transform = model->GetTransform();
-				m_PushConstants.TextureIndex = static_cast<int>(mesh.TextureIndex);
-				m_PushConstants.IsOutline = isOutline ? 1 : 0;
-				m_PushConstants.OutlineThickness = isOutline ? 0.0f : 0.0f; // meters
-				m_PushConstants._pad = 0;
-
-				vkCmdPushConstants(cmd, m_PipelineLayout,
-					VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-					0, sizeof(PushConstants), &m_PushConstants);
-
-				// Bind and draw
-				VkDeviceSize offset = 0;
-				vkCmdBindVertexBuffers(cmd, 0, 1, &mesh.VertexBuffer.Handle, &offset);
-				vkCmdBindIndexBuffer(cmd, mesh.IndexBuffer.Handle, 0, VK_INDEX_TYPE_UINT32);
-				vkCmdDrawIndexed(cmd, mesh.IndexCount, 1, 0, 0, 0);
+				if (mesh.Geometry == InvalidGeometry)
+					continue;
+
+				Bounds world = mesh.LocalBounds.Transformed(transform);
+				m_CullSpheres.Add(world.Center, world.Radius);
+				m_CullBounds.push_back(world);
+				m_CullMeshes.push_back({ model.get(), &mesh });
+			}
+		}
+
+		if (!CullSpheres(m_Frustum, m_CullSpheres, m_CullVisible))
+		{
+			m_CullStats.MeshesTested += (uint32_t)m_CullMeshes.size();
+			return;
+		}
+
+		const bool occlusion = m_OcclusionCulling && m_HiZ.IsReady();
+		uint32_t visibleCount = 0;
+		for (size_t i = 0; i < m_CullMeshes.size(); i++)
+		{
+			if (m_CullVisible[i] && !m_Frustum.IntersectsBox(m_CullBounds[i].Min, m_CullBounds[i].Max))
+				m_CullVisible[i] = 0;
+			else if (m_CullVisible[i] && occlusion && m_HiZ.IsOccluded(m_CullBounds[i].Min, m_CullBounds[i].Max))
+			{
+				m_CullVisible[i] = 0;
+				m_CullStats.MeshesOccluded++;
+			}
+			visibleCount += m_CullVisible[i];
+		}
+		m_CullStats.MeshesTested += (uint32_t)m_CullMeshes.size();
+		m_CullStats.MeshesVisible += visibleCount;
+		if (visibleCount == 0)
+			return;
+
+		// Recorded in EndScene, sorted with everything else in the pass
+		const GeometryPool& pool = GeometryPool::GetModelPool();
+		DrawItem state;
+		state.Layout = m_IndirectPipelineLayout;
+		state.Geometry = &pool;
+		state.Indirect = true;
+
+		// A model's meshes are consecutive, so each visible model gets one transform slot
+		const Model* slotOwner = nullptr;
+		for (size_t i = 0; i < m_CullMeshes.size(); i++)
+		{
+			if (!m_CullVisible[i])
+				continue;
+
+			const Model* model = m_CullMeshes[i].Owner;
+			const Mesh& mesh = *m_CullMeshes[i].Draw;
+
+			if (model != slotOwner)
+			{
+				const glm::mat4& normal = scene.GetNormalMatrix(model->GetNode());
+				m_ModelTransforms.push_back({ scene.GetWorldMatrix(model->GetNode()), { normal[0], normal[1], normal[2] } });
+				slotOwner = model;
+			}
+
+			ModelDrawData push{};
+			push.TransformIndex = (uint32_t)m_ModelTransforms.size() - 1;
+			push.TextureIndex = static_cast<int>(mesh.TextureIndex);
+
+			uint32_t lod = 0;
+			if (m_MeshLod && mesh.Lods.size() > 1)
+			{
+				// A mesh seen for the first time starts from the full-resolution side
+				uint32_t& current = m_MeshLods[&mesh];
+				current = SelectMeshLod(mesh, m_CullBounds[i], current);
+				lod = current;
+			}
+
+			state.Range = pool.GetRange(mesh.Geometry);
+			if (!mesh.Lods.empty())
+			{
+				state.Range.FirstIndex += mesh.Lods[lod].FirstIndex;
+				state.Range.IndexCount = mesh.Lods[lod].IndexCount;
 			}
+			m_CullStats.ModelTriangles += state.Range.IndexCount / 3;
+			m_CullStats.ModelTrianglesFull += mesh.IndexCount / 3;
+			m_CullStats.MeshesPerLod[lod]++;
+
+			state.Pipeline = mesh.IsOutline ? m_OutlinePipeline : m_IndirectPipeline;
+			const float depth = glm::distance(m_CameraPosition, m_CullBounds[i].Center) / s_FarPlane;
+			m_RenderQueue.Submit(RenderQueue::MakeKey(mesh.IsOutline ? OutlinePass : ModelPass, ModelGeometry, depth, (uint16_t)mesh.TextureIndex),
+				state, push, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
 		}
 	}
 
 
+	void Renderer::UploadChunkMesh(ChunkCoord coord, const ChunkMeshData& data)
+	{
+		if (data.Indices.empty())
+		{
+			RemoveChunkMesh(coord);
+			return;
+		}
+
+		ChunkMesh& mesh = m_ChunkMeshes[coord];
+		m_ChunkGeometry.Free(mesh.Geometry);
+		mesh.Geometry = m_ChunkGeometry.Allocate(data.Vertices.data(), (uint32_t)data.Vertices.size(),
+			data.Indices.data(), (uint32_t)data.Indices.size());
+		mesh.Origin = glm::vec3(coord.X * CHUNK_SIZE, 0, coord.Z * CHUNK_SIZE);
+	}
+
+	void Renderer::RemoveChunkMesh(ChunkCoord coord)
+	{
+		auto it = m_ChunkMeshes.find(coord);
+		if (it == m_ChunkMeshes.end())
+			return;
+
+		m_ChunkGeometry.Free(it->second.Geometry);
+		m_ChunkMeshes.erase(it);
+	}
+
+	void Renderer::RenderChunks()
+	{
+		GpuProfiler::CpuScope cpuScope(m_Profiler, "RenderChunks");
+		if (m_ChunkMeshes.empty())
+			return;
+
+		// Chunk bounds are whole columns, the mesh never leaves them
+		const glm::vec3 chunkExtent((float)CHUNK_SIZE, (float)CHUNK_HEIGHT, (float)CHUNK_SIZE);
+		const float chunkRadius = glm::length(chunkExtent * 0.5f);
+
+		m_CullSpheres.Clear();
+		m_CullChunks.clear();
+		for (const auto& [coord, mesh] : m_ChunkMeshes)
+		{
+			if (mesh.Geometry == InvalidGeometry)
+				continue;
+			m_CullSpheres.Add(mesh.Origin + chunkExtent * 0.5f, chunkRadius);
+			m_CullChunks.push_back(&mesh);
+		}
+
+		CullSpheres(m_Frustum, m_CullSpheres, m_CullVisible);
+
+		const bool occlusion = m_OcclusionCulling && m_HiZ.IsReady();
+		uint32_t visibleCount = 0;
+		for (size_t i = 0; i < m_CullChunks.size(); i++)
+		{
+			const glm::vec3& origin = m_CullChunks[i]->Origin;
+			if (m_CullVisible[i] && !m_Frustum.IntersectsBox(origin, origin + chunkExtent))
+				m_CullVisible[i] = 0;
+			else if (m_CullVisible[i] && occlusion && m_HiZ.IsOccluded(origin, origin + chunkExtent))
+			{
+				m_CullVisible[i] = 0;
+				m_CullStats.ChunksOccluded++;
+			}
+			visibleCount += m_CullVisible[i];
+		}
+		m_CullStats.ChunksTested += (uint32_t)m_CullChunks.size();
+		m_CullStats.ChunksVisible += visibleCount;
+		if (visibleCount == 0)
+			return;
+
+		DrawItem state;
+		state.Pipeline = m_VoxelPipeline;
+		state.Layout = m_VoxelPipelineLayout;
+		state.Set = m_BlockTextureSet;
+		state.Geometry = &m_ChunkGeometry;
+
+		for (size_t i = 0; i < m_CullChunks.size(); i++)
+		{
+			if (!m_CullVisible[i])
+				continue;
+
+			const ChunkMesh& mesh = *m_CullChunks[i];
+			const VoxelPushConstants push{ glm::vec4(mesh.Origin, 0.0f) };
+
+			state.Range = m_ChunkGeometry.GetRange(mesh.Geometry);
+			const float depth = glm::distance(m_CameraPosition, mesh.Origin + chunkExtent * 0.5f) / s_FarPlane;
+			m_RenderQueue.Submit(RenderQueue::MakeKey(VoxelPass, ChunkGeometry, depth, 0),
+				state, push, VK_SHADER_STAGE_VERTEX_BIT);
+		}
+	}
+
 	void Renderer::RenderUI()
 	{
-		
+		ImGui::Begin("Profiler");
+
+		if (!m_Profiler.IsTimestampSupported())
+			ImGui::TextDisabled("GPU timestamps are not supported on this queue");
+
+		if (ImGui::BeginTable("Scopes", 4))
+		{
+			ImGui::TableSetupColumn("Scope");
+			ImGui::TableSetupColumn("Last (ms)");
+			ImGui::TableSetupColumn("Average (ms)");
+			ImGui::TableSetupColumn("History");
+			ImGui::TableHeadersRow();
+
+			for (const ProfilerScope& scope : m_Profiler.GetScopes())
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%s %s", scope.Gpu ? "GPU" : "CPU", scope.Name.c_str());
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", scope.Last);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", scope.Average);
+				ImGui::TableNextColumn();
+				ImGui::PushID(&scope);
+				ImGui::PlotLines("##History", scope.History.data(), (int)scope.History.size(), (int)scope.Head,
+					nullptr, 0.0f, FLT_MAX, ImVec2(200.0f, 30.0f));
+				ImGui::PopID();
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::Separator();
+		if (!m_Profiler.IsPipelineStatisticsSupported())
+		{
+			ImGui::TextDisabled("Pipeline statistics: not enabled on this device");
+		}
+		else
+		{
+			bool statistics = m_Profiler.IsPipelineStatisticsEnabled();
+			if (ImGui::Checkbox("Pipeline statistics (inline frames only)", &statistics))
+				m_Profiler.SetPipelineStatistics(statistics);
+
+			const PipelineStatistics& pipelineStats = m_Profiler.GetPipelineStatistics();
+			ImGui::Text("Vertex invocations: %llu", (unsigned long long)pipelineStats.VertexInvocations);
+			ImGui::Text("Fragment invocations: %llu", (unsigned long long)pipelineStats.FragmentInvocations);
+			ImGui::Text("Clipping primitives: %llu", (unsigned long long)pipelineStats.ClippingPrimitives);
+		}
+
+		ImGui::End();
 	}
 
 	void Renderer::CreateDepthResources() {
-		auto* wd = Walnut::Application::GetMainWindowData();
 		VkDevice device = GetVulkanInfo()->Device;
 
-		m_Depth.resize(wd->ImageCount);
+		m_Depth.resize(m_Target.ColorViews.size());
 
-		for (uint32_t i = 0; i < wd->ImageCount; ++i) {
+		for (size_t i = 0; i < m_Depth.size(); ++i) {
 			VkImageCreateInfo ici{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
 			ici.imageType = VK_IMAGE_TYPE_2D;
 			ici.format = m_DepthFormat;
-			ici.extent = { (uint32_t)wd->Width, (uint32_t)wd->Height, 1 };
+			ici.extent = { m_Target.Width, m_Target.Height, 1 };
 			ici.mipLevels = 1;
 			ici.arrayLayers = 1;
 			ici.samples = VK_SAMPLE_COUNT_1_BIT;
 			ici.tiling = VK_IMAGE_TILING_OPTIMAL;
 			ici.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+			if (m_OcclusionCullingSupported)
+				ici.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;   // reduced into the Hi-Z pyramid
 
 			VK_CHECK(vkCreateImage(device, &ici, nullptr, &m_Depth[i].image));
 
-			VkMemoryRequirements req{};
-			vkGetImageMemoryRequirements(device, m_Depth[i].image, &req);
-
-			VkMemoryAllocateInfo mai{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
-			mai.allocationSize = req.size;
-			mai.memoryTypeIndex = GetVulkanMemoryType(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, req.memoryTypeBits);
-			VK_CHECK(vkAllocateMemory(device, &mai, nullptr, &m_Depth[i].memory));
-			VK_CHECK(vkBindImageMemory(device, m_Depth[i].image, m_Depth[i].memory, 0));
+			// Render targets get their own allocation, they come and go with the swapchain
+			m_Depth[i].memory = GpuAllocator::AllocateImage(m_Depth[i].image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
 
 			VkImageViewCreateInfo iv{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
 			iv.image = m_Depth[i].image;
@@ -406,14 +1048,13 @@ namespace Cubed {
 
 
 	void Renderer::CreateFramebuffers() {
-		auto* wd = Walnut::Application::GetMainWindowData();
 		VkDevice device = GetVulkanInfo()->Device;
 
-		m_Framebuffers.resize(wd->ImageCount);
+		m_Framebuffers.resize(m_Target.ColorViews.size());
 
-		for (uint32_t i = 0; i < wd->ImageCount; ++i) {
+		for (size_t i = 0; i < m_Framebuffers.size(); ++i) {
 			VkImageView attachments[2] = {
-				wd->Frames[i].BackbufferView, // color
+				m_Target.ColorViews[i],       // color
 				m_Depth[i].view               // depth
 			};
 
@@ -421,8 +1062,8 @@ namespace Cubed {
 			fbi.renderPass = m_RenderPass;
 			fbi.attachmentCount = 2;
 			fbi.pAttachments = attachments;
-			fbi.width = (uint32_t)wd->Width;
-			fbi.height = (uint32_t)wd->Height;
+			fbi.width = m_Target.Width;
+			fbi.height = m_Target.Height;
 			fbi.layers = 1;
 
 			VK_CHECK(vkCreateFramebuffer(device, &fbi, nullptr, &m_Framebuffers[i]));
@@ -430,16 +1071,69 @@ namespace Cubed {
 	}
 
 
+	void Renderer::InitUpscaler() {
+		VkDevice device = GetVulkanInfo()->Device;
+
+		VkShaderModule vertexShader = loadShader(s_ShaderBasePath / "upscale.vert.spirv");
+		VkShaderModule fragmentShader = loadShader(s_ShaderBasePath / "upscale.frag.spirv");
+		if (!m_Upscaler.Init(vertexShader, fragmentShader, m_PipelineCache.GetHandle(), m_ColorFormat))
+			WL_WARN("Dynamic resolution unavailable: color format {} can't be sampled", (int)m_ColorFormat);
+		vkDestroyShaderModule(device, vertexShader, nullptr);
+		vkDestroyShaderModule(device, fragmentShader, nullptr);
+	}
+
+	void Renderer::CreateSceneTargets() {
+		m_Upscaler.CreateTargets(m_Target.Width, m_Target.Height, m_Target.ColorViews);
+		if (!m_Upscaler.HasTargets())
+			return;
+
+		// Same render pass and depth attachments as m_Framebuffers, only the color image differs
+		VkDevice device = GetVulkanInfo()->Device;
+		m_SceneFramebuffers.resize(m_Target.ColorViews.size());
+		for (size_t i = 0; i < m_SceneFramebuffers.size(); ++i) {
+			VkImageView attachments[2] = { m_Upscaler.GetSceneView((uint32_t)i), m_Depth[i].view };
+
+			VkFramebufferCreateInfo fbi{ VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
+			fbi.renderPass = m_RenderPass;
+			fbi.attachmentCount = 2;
+			fbi.pAttachments = attachments;
+			fbi.width = m_Target.Width;
+			fbi.height = m_Target.Height;
+			fbi.layers = 1;
+			VK_CHECK(vkCreateFramebuffer(device, &fbi, nullptr, &m_SceneFramebuffers[i]));
+		}
+	}
+
+	void Renderer::RetireSceneTargets() {
+		m_Upscaler.RetireTargets();
+		for (auto fb : m_SceneFramebuffers)
+			DeletionQueue::ReleaseFramebuffer(fb);
+		m_SceneFramebuffers.clear();
+	}
+
+	void Renderer::SetDynamicResolution(const DynamicResolutionSettings& settings) {
+		m_DynamicResolution.SetSettings(settings);
+
+		// Before Init there is nothing to render into yet; Init applies the settings
+		if (!m_RenderPass)
+			return;
+
+		const bool enabled = settings.Enabled && m_Upscaler.IsSupported();
+		if (enabled && !m_Upscaler.HasTargets())
+			CreateSceneTargets();
+		else if (!enabled && m_Upscaler.HasTargets())
+			RetireSceneTargets();
+	}
+
 	void Renderer::CreateRenderPass()
 	{
 		VkDevice device = GetVulkanInfo()->Device;
 
-		VkSurfaceFormatKHR surfaceFormat = Walnut::Application::GetMainWindowData()->SurfaceFormat;
-
-		// Color attachment (swapchain image format)
+		// Color attachment (swapchain or offscreen image format)
 		VkAttachmentDescription colorAttachment{};
 		// Renderer::CreateRenderPass()
-		colorAttachment.format = surfaceFormat.format;
+		m_ColorFormat = m_Target.ColorFormat;
+		colorAttachment.format = m_Target.ColorFormat;
 		colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;           // clear scene background
 		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
@@ -469,13 +1163,19 @@ namespace Cubed {
 
 		// Use depthFormat for depthAttachment.format
 
+		// The Hi-Z pass samples the depth attachment once the pass is over
+		VkFormatProperties depthProps{};
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, m_DepthFormat, &depthProps);
+		m_OcclusionCullingSupported = (depthProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+		m_OcclusionCulling = m_OcclusionCulling && m_OcclusionCullingSupported;
 
 		// Depth attachment (typical depth format)
 		VkAttachmentDescription depthAttachment{};
 		depthAttachment.format = m_DepthFormat; // Make sure this format is supported on your GPU!
 		depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;  // Clear depth at start
-		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE; // No need to store depth
+		depthAttachment.storeOp = m_OcclusionCullingSupported ? VK_ATTACHMENT_STORE_OP_STORE   // read by the Hi-Z pass
+			: VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -522,12 +1222,24 @@ namespace Cubed {
 	}
 
 
+	void Renderer::CreatePipelines()
+	{
+		m_PipelinesCreated = 0;
+		m_PipelineCreateMs = 0.0;
+
+		InitPipeline();
+		InitVoxelPipeline();
+
+		WL_INFO("Created {} pipelines in {:.2f} ms ({} pipeline cache, {} KB loaded)", m_PipelinesCreated, m_PipelineCreateMs,
+			m_PipelineCache.IsWarm() ? "warm" : "cold", m_PipelineCache.GetLoadedBytes() / 1024);
+	}
+
 	void Renderer::InitPipeline()
 	{
 
 		VkDevice device = GetVulkanInfo()->Device;
 		
-		VkDescriptorSetLayout setLayouts[2] = { m_TexturesDescriptorSetLayout, m_CameraDescriptorSetLayout };
+		VkDescriptorSetLayout setLayouts[2] = { m_TextureTable.GetLayout(), m_CameraDescriptorSetLayout };
 
 		std::array<VkPushConstantRange, 1> pushConstantRanges;
 		pushConstantRanges[0].offset = 0;
@@ -573,6 +1285,114 @@ namespace Cubed {
 		vertex_input.pVertexAttributeDescriptions = attribute_desc.data();
 
 
+		// Model geometry is wound counter-clockwise from outside, like chunk faces
+		m_GraphicsPipeline = CreateGraphicsPipeline(m_PipelineLayout, s_ShaderBasePath / "basic.vert.spirv", s_ShaderBasePath / "basic.frag.spirv",
+			vertex_input, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+
+		// Instanced variant: same layout and fragment shader, the transform and
+		// texture index come from a second, per-instance vertex binding
+		std::array<VkVertexInputBindingDescription, 2> instanced_binding_desc;
+		instanced_binding_desc[0] = binding_desc[0];
+		instanced_binding_desc[1].binding = 1;
+		instanced_binding_desc[1].stride = sizeof(InstanceData);
+		instanced_binding_desc[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+		std::array<VkVertexInputAttributeDescription, 8> instanced_attribute_desc;
+		std::copy(attribute_desc.begin(), attribute_desc.end(), instanced_attribute_desc.begin());
+
+		// Transform, one vec4 column per location
+		for (uint32_t column = 0; column < 4; ++column)
+		{
+			instanced_attribute_desc[3 + column].location = 3 + column;
+			instanced_attribute_desc[3 + column].binding = 1;
+			instanced_attribute_desc[3 + column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+			instanced_attribute_desc[3 + column].offset = (uint32_t)(offsetof(InstanceData, Transform) + column * sizeof(glm::vec4));
+		}
+
+		// Texture index
+		instanced_attribute_desc[7].location = 7;
+		instanced_attribute_desc[7].binding = 1;
+		instanced_attribute_desc[7].format = VK_FORMAT_R32_UINT;
+		instanced_attribute_desc[7].offset = offsetof(InstanceData, TextureIndex);
+
+		VkPipelineVertexInputStateCreateInfo instanced_vertex_input{ VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+		instanced_vertex_input.vertexBindingDescriptionCount = (uint32_t)instanced_binding_desc.size();
+		instanced_vertex_input.pVertexBindingDescriptions = instanced_binding_desc.data();
+		instanced_vertex_input.vertexAttributeDescriptionCount = (uint32_t)instanced_attribute_desc.size();
+		instanced_vertex_input.pVertexAttributeDescriptions = instanced_attribute_desc.data();
+
+		// Instances of one draw may use different textures: that takes non-uniform
+		// indexing, otherwise DrawInstanced splits the draw where the texture changes
+		m_NonUniformTextures = GetEnabledVulkanFeatures().DescriptorIndexing.shaderSampledImageArrayNonUniformIndexing;
+		m_InstancedPipeline = CreateGraphicsPipeline(m_PipelineLayout, s_ShaderBasePath / "instanced.vert.spirv",
+			s_ShaderBasePath / (m_NonUniformTextures ? "basic.nonuniform.frag.spirv" : "basic.frag.spirv"),
+			instanced_vertex_input, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+
+		// Indirect variant: no push constants, per-draw data comes from set 2
+		VkDescriptorSetLayout indirectSetLayouts[3] = { m_TextureTable.GetLayout(), m_CameraDescriptorSetLayout, m_DrawDataDescriptorSetLayout };
+
+		VkPipelineLayoutCreateInfo indirect_layout_info{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+		indirect_layout_info.setLayoutCount = 3;
+		indirect_layout_info.pSetLayouts = indirectSetLayouts;
+		VK_CHECK(vkCreatePipelineLayout(device, &indirect_layout_info, nullptr, &m_IndirectPipelineLayout));
+
+		// The texture index is uniform per draw: separate draws of a multi-draw are
+		// separate, and without multi-draw only draws of one mesh become instances
+		m_IndirectPipeline = CreateGraphicsPipeline(m_IndirectPipelineLayout, s_ShaderBasePath / "indirect.vert.spirv", s_ShaderBasePath / "basic.frag.spirv",
+			vertex_input, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+
+		// Outline hulls (meshes flagged IsOutline at import): only their back faces, in solid black
+		m_OutlinePipeline = CreateGraphicsPipeline(m_IndirectPipelineLayout, s_ShaderBasePath / "indirect.vert.spirv", s_ShaderBasePath / "outline.frag.spirv",
+			vertex_input, VK_CULL_MODE_FRONT_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+	}
+
+	void Renderer::InitVoxelPipeline()
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+
+		// Same shared sets as the other pipelines, then the block textures
+		VkDescriptorSetLayout setLayouts[3] = { m_TextureTable.GetLayout(), m_CameraDescriptorSetLayout, m_BlockTextureSetLayout };
+
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(VoxelPushConstants);
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+		VkPipelineLayoutCreateInfo layout_info{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+		layout_info.pPushConstantRanges = &pushConstantRange;
+		layout_info.pushConstantRangeCount = 1;
+		layout_info.setLayoutCount = 3;
+		layout_info.pSetLayouts = setLayouts;
+		VK_CHECK(vkCreatePipelineLayout(device, &layout_info, nullptr, &m_VoxelPipelineLayout));
+
+		// Single packed attribute, see ChunkVertex
+		VkVertexInputBindingDescription binding_desc{};
+		binding_desc.binding = 0;
+		binding_desc.stride = sizeof(ChunkVertex);
+		binding_desc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		VkVertexInputAttributeDescription attribute_desc{};
+		attribute_desc.location = 0;
+		attribute_desc.binding = 0;
+		attribute_desc.format = VK_FORMAT_R32G32_UINT;
+		attribute_desc.offset = offsetof(ChunkVertex, Data);
+
+		VkPipelineVertexInputStateCreateInfo vertex_input{ VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+		vertex_input.vertexBindingDescriptionCount = 1;
+		vertex_input.pVertexBindingDescriptions = &binding_desc;
+		vertex_input.vertexAttributeDescriptionCount = 1;
+		vertex_input.pVertexAttributeDescriptions = &attribute_desc;
+
+		// Chunk faces are wound counter-clockwise from outside, so hidden sides can be culled
+		m_VoxelPipeline = CreateGraphicsPipeline(m_VoxelPipelineLayout, s_ShaderBasePath / "voxel.vert.spirv", s_ShaderBasePath / "voxel.frag.spirv",
+			vertex_input, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+	}
+
+	VkPipeline Renderer::CreateGraphicsPipeline(VkPipelineLayout layout, const std::filesystem::path& vertexShader, const std::filesystem::path& fragmentShader,
+		const VkPipelineVertexInputStateCreateInfo& vertexInput, VkCullModeFlags cullMode, VkFrontFace frontFace)
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+
 		// Specify we will use triangle lists to draw geometry.
 		VkPipelineInputAssemblyStateCreateInfo input_assembly{
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
@@ -581,8 +1401,8 @@ namespace Cubed {
 		// Specify rasterization state.
 		VkPipelineRasterizationStateCreateInfo raster{
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-			.cullMode = VK_CULL_MODE_NONE,
-			.frontFace = VK_FRONT_FACE_CLOCKWISE,
+			.cullMode = cullMode,
+			.frontFace = frontFace,
 			.lineWidth = 1.0f };
 
 		// Our attachment will write to all color channels, but no blending is enabled.
@@ -625,22 +1445,24 @@ namespace Cubed {
 
 		std::array<VkPipelineShaderStageCreateInfo, 2> shader_stages{};
 
-
-		const std::filesystem::path SHADER_BASE_PATH = "C:/Users/Asus/Documents/Projects/Cubed/Cubed-Client/Assets/Shaders/bin";
-
-
 		shader_stages[0] = {
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
 			.stage = VK_SHADER_STAGE_VERTEX_BIT,
-			.module = loadShader((SHADER_BASE_PATH / "basic.vert.spirv").string()),
+			.module = loadShader(vertexShader),
 			.pName = "main"
 		};
 
+		// constant_id 0 sizes the fragment shaders' texture array to the texture table's layout
+		const uint32_t textureCount = m_TextureTable.GetMaxCapacity();
+		const VkSpecializationMapEntry textureCountEntry{ 0, 0, sizeof(uint32_t) };
+		const VkSpecializationInfo fragmentSpecialization{ 1, &textureCountEntry, sizeof(textureCount), &textureCount };
+
 		shader_stages[1] = {
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
 			.stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-			.module = loadShader((SHADER_BASE_PATH / "basic.frag.spirv").string()),
-			.pName = "main"
+			.module = loadShader(fragmentShader),
+			.pName = "main",
+			.pSpecializationInfo = &fragmentSpecialization
 		};
 
 
@@ -648,7 +1470,7 @@ namespace Cubed {
 			.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
 			.stageCount = static_cast<uint32_t>(shader_stages.size()),
 			.pStages = shader_stages.data(),
-			.pVertexInputState = &vertex_input,
+			.pVertexInputState = &vertexInput,
 			.pInputAssemblyState = &input_assembly,
 			.pViewportState = &viewport,
 			.pRasterizationState = &raster,
@@ -656,15 +1478,71 @@ namespace Cubed {
 			.pDepthStencilState = &depth_stencil,
 			.pColorBlendState = &blend,
 			.pDynamicState = &dynamic,
-			.layout = m_PipelineLayout,        // We need to specify the pipeline layout up front
+			.layout = layout,                  // We need to specify the pipeline layout up front
 			.renderPass = m_RenderPass             // We need to specify the render pass up front
 		};
 
-		VK_CHECK(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipe, nullptr, &m_GraphicsPipeline));
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		const auto start = std::chrono::steady_clock::now();
+		VK_CHECK(vkCreateGraphicsPipelines(device, m_PipelineCache.GetHandle(), 1, &pipe, nullptr, &pipeline));
+		m_PipelineCreateMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		m_PipelinesCreated++;
 
 		// Pipeline is baked, we can delete the shader modules now.
 		vkDestroyShaderModule(device, shader_stages[0].module, nullptr);
 		vkDestroyShaderModule(device, shader_stages[1].module, nullptr);
+		return pipeline;
+	}
+
+	void Renderer::CreateBlockTextures()
+	{
+		// Flat colours until there is a block atlas
+		static const uint8_t colors[(size_t)Block::Count][3] = {
+			{ 255, 255, 255 },   // Air (never meshed)
+			{ 125, 125, 125 },   // Stone
+			{ 134,  96,  67 },   // Dirt
+			{  95, 159,  53 },   // Grass
+			{ 219, 211, 160 },   // Sand
+			{  64,  96, 200 },   // Water
+			{ 102,  81,  51 },   // Wood
+			{  60, 120,  40 },   // Leaves
+			{ 250, 220, 120 },   // Glowstone
+		};
+
+		// One 1x1 layer per block type. A chunk draw picks a layer per vertex, which
+		// an array of separate textures couldn't do without non-uniform indexing.
+		uint8_t pixels[(size_t)Block::Count][4];
+		for (size_t i = 0; i < (size_t)Block::Count; ++i)
+		{
+			pixels[i][0] = colors[i][0];
+			pixels[i][1] = colors[i][1];
+			pixels[i][2] = colors[i][2];
+			pixels[i][3] = 255;
+		}
+		m_BlockTextures = std::make_unique<Texture>(1, 1, Walnut::Buffer(pixels, sizeof(pixels)), (uint32_t)Block::Count);
+
+		VkDevice device = GetVulkanInfo()->Device;
+
+		VkDescriptorSetLayoutBinding binding{};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		binding.descriptorCount = 1;
+		binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &binding;
+		VK_CHECK(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_BlockTextureSetLayout));
+
+		m_BlockTextureSet = AllocateDescriptorSet(m_BlockTextureSetLayout);
+
+		VkWriteDescriptorSet write{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+		write.dstSet = m_BlockTextureSet;
+		write.dstBinding = 0;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.descriptorCount = 1;
+		write.pImageInfo = &m_BlockTextures->GetImageInfo();
+		vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
 	}
 
 	inline glm::vec2 UVFromBlock(int blockX, int blockY, float u, float v) {
@@ -765,44 +1643,24 @@ namespace Cubed {
 		vertexData[23].Normal = glm::vec3(0.0f, -1.0f, 0.0f);
 		vertexData[23].UV = UVFromBlock(1, 1, 1, 1);
 
+		// Each face's corners go clockwise seen from outside, the triangles take them backwards
+		// so the cube is wound counter-clockwise like everything else in the model pool
 		std::array<uint32_t, 36> indices;
 		uint32_t offset = 0;
 		for (int i = 0; i < 36; i += 6)
 		{
 			indices[i + 0] = 0 + offset;
-			indices[i + 1] = 1 + offset;
-			indices[i + 2] = 2 + offset;
-			indices[i + 3] = 2 + offset;
+			indices[i + 1] = 2 + offset;
+			indices[i + 2] = 1 + offset;
+			indices[i + 3] = 0 + offset;
 			indices[i + 4] = 3 + offset;
-			indices[i + 5] = 0 + offset;
+			indices[i + 5] = 2 + offset;
 
 			offset += 4;
 		}
 
-		m_VertexBuffer.Usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-		CreateOrResizeBuffer(m_VertexBuffer, vertexData.size() * sizeof(Vertex));
-		m_IndexBuffer.Usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-		CreateOrResizeBuffer(m_IndexBuffer, indices.size() * sizeof(uint32_t));
-
-		glm::vec3* vbMemory;
-		VK_CHECK(vkMapMemory(device, m_VertexBuffer.Memory, 0, vertexData.size() * sizeof(Vertex), 0, (void**)&vbMemory));
-		memcpy(vbMemory, vertexData.data(), vertexData.size() * sizeof(Vertex));
-
-		uint32_t* ibMemory;
-		VK_CHECK(vkMapMemory(device, m_IndexBuffer.Memory, 0, indices.size() * sizeof(uint32_t), 0, (void**)&ibMemory));
-		memcpy(ibMemory, indices.data(), indices.size() * sizeof(uint32_t));
-
-		VkMappedMemoryRange range[2] = {};
-		range[0].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		range[0].memory = m_VertexBuffer.Memory;
-		range[0].size = VK_WHOLE_SIZE;
-		range[1].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		range[1].memory = m_IndexBuffer.Memory;
-		range[1].size = VK_WHOLE_SIZE;
-
-		VK_CHECK(vkFlushMappedMemoryRanges(device, 2, range));
-		vkUnmapMemory(device, m_VertexBuffer.Memory);
-		vkUnmapMemory(device, m_IndexBuffer.Memory);
+		m_CubeGeometry = GeometryPool::GetModelPool().Allocate(vertexData.data(), (uint32_t)vertexData.size(),
+			indices.data(), (uint32_t)indices.size());
 	}
 
 	VkShaderModule Renderer::loadShader(const std::filesystem::path& path)
@@ -840,8 +1698,7 @@ namespace Cubed {
 		VkDevice device = GetVulkanInfo()->Device;
 		if (buffer.Handle != VK_NULL_HANDLE)
 			vkDestroyBuffer(device, buffer.Handle, nullptr);
-		if (buffer.Memory != VK_NULL_HANDLE)
-			vkFreeMemory(device, buffer.Memory, nullptr);
+		GpuAllocator::Free(buffer.Memory);
 
 		VkBufferCreateInfo buffer_info = {};
 		buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -850,16 +1707,7 @@ namespace Cubed {
 		buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		VK_CHECK(vkCreateBuffer(device, &buffer_info, nullptr, &buffer.Handle));
 
-		VkMemoryRequirements req;
-		vkGetBufferMemoryRequirements(device, buffer.Handle, &req);
-		//bd->BufferMemoryAlignment = (bd->BufferMemoryAlignment > req.alignment) ? bd->BufferMemoryAlignment : req.alignment;
-		VkMemoryAllocateInfo alloc_info = {};
-		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		alloc_info.allocationSize = req.size;
-		alloc_info.memoryTypeIndex = GetVulkanMemoryType(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, req.memoryTypeBits);
-		VK_CHECK(vkAllocateMemory(device, &alloc_info, nullptr, &buffer.Memory));
-
-		VK_CHECK(vkBindBufferMemory(device, buffer.Handle, buffer.Memory, 0));
-		buffer.Size = req.size;
+		buffer.Memory = GpuAllocator::AllocateBuffer(buffer.Handle, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		buffer.Size = buffer.Memory.Size;
 	}
 } // namespace Cubed
\ No newline at end of file
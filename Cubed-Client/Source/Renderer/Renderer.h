@@ -3,8 +3,23 @@
 #include "../Assets/Model.h"
 #include "../Assets/ModelManager.h"
 
+#include "ChunkMesher.h"
+#include "CommandRecorder.h"
+#include "DynamicResolution.h"
+#include "GeometryPool.h"
+#include "GpuProfiler.h"
+#include "FrameRing.h"
+#include "Frustum.h"
+#include "HiZBuffer.h"
+#include "PipelineCache.h"
+#include "RenderQueue.h"
+#include "SceneGraph.h"
+#include "TextureTable.h"
+#include "Upscaler.h"
 #include "Vulkan.h"
+#include <array>
 #include <filesystem>
+#include <unordered_map>
 #include <glm/glm.hpp>
 
 
@@ -16,67 +31,215 @@ namespace Cubed {
 		glm::vec3 Rotation{ 0, 0, 0 };
 	};
 
+	// Per-instance vertex data for instanced draws, see instanced.vert.glsl
+	struct InstanceData
+	{
+		glm::mat4 Transform{ 1.0f };
+		uint32_t TextureIndex = 0;
+		uint32_t _pad[3]{};
+	};
+
+
+	// What the scene is drawn into: the Walnut swapchain, or images the caller owns
+	struct RenderTarget
+	{
+		uint32_t Width = 0, Height = 0;
+		VkFormat ColorFormat = VK_FORMAT_UNDEFINED;
+		std::vector<VkImageView> ColorViews;   // one per frame in flight, left in COLOR_ATTACHMENT_OPTIMAL
+	};
 
 	class Renderer
 	{
 	public:
+#ifndef WL_HEADLESS
+		// Draws into the swapchain of Walnut's main window; not in headless builds,
+		// like the BeginScene overload and OnSwapchainRecreated below
 		void Init();
+#endif
+		// Offscreen, with no window or swapchain: the caller owns the target
+		// and the frame loop, see HeadlessDevice
+		void Init(const RenderTarget& target);
 		void Shutdown();
 
+#ifndef WL_HEADLESS
 		void BeginScene(const Camera& camera);
+#endif
+		// Offscreen: records into commandBuffer, for the target's color view frameIndex
+		void BeginScene(const Camera& camera, VkCommandBuffer commandBuffer, uint32_t frameIndex);
 		void EndScene();
 
+		// Cubed-Client/Assets, holding Shaders/bin and Textures; set before Init
+		static void SetAssetDirectory(const std::filesystem::path& directory);
+
 		void RenderCube(const glm::vec3& position, const glm::vec3& rotation, int textureIndex);
+		// All instances in a single draw call
+		void RenderCubes(const std::vector<InstanceData>& instances);
+		void RenderMeshInstanced(const Mesh& mesh, const std::vector<InstanceData>& instances);
 		void RenderUI();
+#ifndef WL_HEADLESS
 		void OnSwapchainRecreated();
+#endif
 
 		void AddModel(std::shared_ptr<Cubed::Model> m) { m_Models.push_back(std::move(m)); }
+		// Stops drawing it; its geometry and textures go with the last reference to
+		// the model, once the frames in flight are done with them
+		void RemoveModel(const std::shared_ptr<Cubed::Model>& model);
 		void RenderModels();
 
-		void UpdateTextures() {
-			uint32_t maxTexId = 0;
-			for (auto& m : m_Models)
-				for (auto& mesh : m->GetMeshes())
-					if (mesh.TextureIndex > maxTexId) maxTexId = mesh.TextureIndex;
-			CreateTextureDescriptorSet(maxTexId);
-		}
+		// Replaces the chunk's previous mesh; an empty mesh just removes it
+		void UploadChunkMesh(ChunkCoord coord, const ChunkMeshData& mesh);
+		void RemoveChunkMesh(ChunkCoord coord);
+		void RenderChunks();
+
+		GeometryPoolStats GetChunkGeometryStats() const { return m_ChunkGeometry.GetStats(); }
+
+		// Reset every BeginScene
+		struct CullStats {
+			uint32_t MeshesTested = 0, MeshesVisible = 0;
+			uint32_t ChunksTested = 0, ChunksVisible = 0;
+			uint32_t MeshesOccluded = 0, ChunksOccluded = 0;   // passed the frustum, then failed the Hi-Z test
+			uint64_t ModelTriangles = 0, ModelTrianglesFull = 0;   // drawn, and what full resolution would have cost
+			uint32_t MeshesPerLod[MaxMeshLods]{};
+		};
+		const CullStats& GetCullStats() const { return m_CullStats; }
+		const RenderQueueStats& GetRenderQueueStats() const { return m_RenderQueue.GetStats(); }
+		FrameRingStats GetFrameRingStats() const { return m_FrameRing.GetStats(); }
+		TextureTableStats GetTextureTableStats() const { return m_TextureTable.GetStats(); }
+		const GpuProfiler& GetProfiler() const { return m_Profiler; }
+		HiZStats GetHiZStats() const { return m_HiZ.GetStats(); }
+
+		// Models go through the draw-data buffer either way; this picks one
+		// vkCmdDrawIndexedIndirect per run over direct draws. Supported means
+		// the device was created with the features, not just that the GPU has them.
+		bool IsMultiDrawIndirectSupported() const { return m_MultiDrawIndirectSupported; }
+		bool IsMultiDrawIndirectEnabled() const { return m_UseMultiDrawIndirect; }
+		void SetMultiDrawIndirect(bool enabled) { m_UseMultiDrawIndirect = enabled && m_MultiDrawIndirectSupported; }
+
+		// Model meshes drop to simpler levels of detail as their projected size shrinks
+		bool IsMeshLodEnabled() const { return m_MeshLod; }
+		void SetMeshLod(bool enabled) { m_MeshLod = enabled; }
+
+		// Meshes and chunks behind the depth of a recent frame are skipped; needs a sampleable depth format
+		bool IsOcclusionCullingSupported() const { return m_OcclusionCullingSupported; }
+		bool IsOcclusionCullingEnabled() const { return m_OcclusionCulling; }
+		void SetOcclusionCulling(bool enabled) { m_OcclusionCulling = enabled && m_OcclusionCullingSupported; }
+
+		// Large frames are recorded into secondary command buffers on worker threads
+		bool IsParallelRecordingEnabled() const { return m_ParallelRecording; }
+		void SetParallelRecording(bool enabled) { m_ParallelRecording = enabled; }
+		uint32_t GetRecordingThreadCount() const { return m_CommandRecorder.GetThreadCount(); }
+
+		// The scene drops below the output resolution while the GPU is over the
+		// frame-time budget and is scaled up into the output; needs a target
+		// format that can be sampled. Settings given before Init apply from Init.
+		bool IsDynamicResolutionSupported() const { return m_Upscaler.IsSupported(); }
+		const DynamicResolutionSettings& GetDynamicResolution() const { return m_DynamicResolution.GetSettings(); }
+		void SetDynamicResolution(const DynamicResolutionSettings& settings);
+		DynamicResolutionStats GetDynamicResolutionStats() const { return m_DynamicResolution.GetStats(); }
+		VkExtent2D GetRenderExtent() const { return m_RenderExtent; }   // of the last scene
 	private:
 		VkShaderModule loadShader(const std::filesystem::path& path);
+		void CreatePipelines();
 		void InitPipeline();
+		void InitVoxelPipeline();
+		VkPipeline CreateGraphicsPipeline(VkPipelineLayout layout, const std::filesystem::path& vertexShader, const std::filesystem::path& fragmentShader,
+			const VkPipelineVertexInputStateCreateInfo& vertexInput, VkCullModeFlags cullMode, VkFrontFace frontFace);
+		void CreateBlockTextures();
 		void CreateRenderPass();
 		void CreateDepthResources();
 		void CreateFramebuffers();
+		void InitUpscaler();
+		void CreateSceneTargets();
+		void RetireSceneTargets();
 		void InitBuffers();
 		void CreateOrResizeBuffer(Buffer& buffer, uint64_t newSize);
-		void CreateTextureDescriptorSet(uint32_t maxTexId);
+		void DrawInstanced(const GeometryPool& pool, const GeometryRange& range, const std::vector<InstanceData>& instances);
+		uint32_t SelectMeshLod(const Mesh& mesh, const Bounds& world, uint32_t current) const;
 		void CreateCameraDescriptorSet();
+		void UpdateCameraDescriptorSet();
+		void CreateDrawDataDescriptorSetLayout();
+		void PrepareDrawBuffers(uint32_t drawCount, uint32_t transformCount);
 		void LogModelInfo(const std::shared_ptr<Cubed::Model>& model);
 
-		void DestroyPipeline();
+		// Retire* release through the DeletionQueue, Destroy* need an idle device
+		void RetirePipelines();
 		void DestroyFramebuffers();
 		void DestroyDepthResources();
-		void DestroyRenderPass();
+		void RetireRenderPass();
+		void RetireSwapchainResources();
 
 		
 	private:
 		//buffers, pipelines
 		VkPipeline m_GraphicsPipeline = nullptr;
 		VkPipelineLayout m_PipelineLayout = nullptr;
+		VkPipeline m_InstancedPipeline = nullptr;
+		VkPipeline m_VoxelPipeline = nullptr;
+		VkPipelineLayout m_VoxelPipelineLayout = nullptr;
+		VkPipeline m_IndirectPipeline = nullptr;
+		VkPipelineLayout m_IndirectPipelineLayout = nullptr;
+		VkPipeline m_OutlinePipeline = nullptr;   // indirect layout, front faces culled
+		bool m_NonUniformTextures = false;   // the instanced pipeline indexes textures per instance
+
+		// Shared by every vkCreateGraphicsPipelines, timed to compare cold and warm starts
+		PipelineCache m_PipelineCache;
+		uint32_t m_PipelinesCreated = 0;
+		double m_PipelineCreateMs = 0.0;
 
-		VkDescriptorSetLayout m_TexturesDescriptorSetLayout = nullptr;
 		VkDescriptorSetLayout m_CameraDescriptorSetLayout = nullptr;
-		VkDescriptorSet m_TexturesDescriptorSet = nullptr;
+		VkDescriptorSetLayout m_DrawDataDescriptorSetLayout = nullptr;
 		VkDescriptorSet m_CameraDescriptorSet = nullptr;
 
-		Buffer m_VertexBuffer, m_IndexBuffer, m_CameraUBO;
+		// Set 0: every texture, written into its slot as TextureManager adds it
+		TextureTable m_TextureTable;
+
+		GeometryHandle m_CubeGeometry = InvalidGeometry;   // in the model pool
+
+		// Per-frame constants and instance data. The camera set is a dynamic
+		// uniform buffer into the ring, rewritten when the ring's buffer changes.
+		FrameRing m_FrameRing{ VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 1024 * 1024 };
+		uint32_t m_CameraRingGeneration = 0;
+		uint32_t m_CameraOffset = 0;   // dynamic offset of this frame's CameraUBO
+		VkDeviceSize m_UniformAlignment = 256;
+		uint32_t m_FrameIndex = 0;
+
+		RenderTarget m_Target;
+		bool m_Offscreen = false;
+		VkCommandBuffer m_CommandBuffer = VK_NULL_HANDLE;   // this scene's
+
+		// One per swapchain image: per-draw data (a ModelDrawData each, read by
+		// indirect.vert through gl_InstanceIndex), the matching draw commands, and
+		// the world and normal matrices of the frame's visible models
+		struct DrawBuffers {
+			Buffer Draws;
+			Buffer Commands;
+			Buffer Transforms;
+			VkDescriptorSet Set = VK_NULL_HANDLE;
+		};
+		std::vector<DrawBuffers> m_DrawBuffers;
+		bool m_MultiDrawIndirectSupported = false;
+		bool m_UseMultiDrawIndirect = false;
 
 		struct PushConstants {
 			glm::mat4 Transform;   // 64
-			int TextureIndex;          // 4
-			int IsOutline;         // 4  (0/1)
-			float OutlineThickness;// 4  (in world units)
-			int _pad;              // 4  (keep 16B alignment)
-		}m_PushConstants;
+			int TextureIndex;      // 4
+		};
+
+		// indirect.vert's DrawData; the matrices are shared by every mesh of a model
+		struct ModelDrawData {
+			uint32_t TransformIndex;   // into DrawBuffers::Transforms
+			int TextureIndex;
+		};
+
+		// indirect.vert's Transform, copied out of the model scene graph
+		struct ModelTransform {
+			glm::mat4 World;
+			glm::vec4 Normal[3];   // the normal matrix's columns, w unused
+		};
+
+		struct VoxelPushConstants {
+			glm::vec4 ChunkOrigin;
+		};
 
 		struct CameraUBO {
 			glm::mat4 ViewProjection;
@@ -85,16 +248,73 @@ namespace Cubed {
 
 		struct DepthResource {
 			VkImage image = VK_NULL_HANDLE;
-			VkDeviceMemory memory = VK_NULL_HANDLE;
+			GpuAllocation memory;
 			VkImageView view = VK_NULL_HANDLE;
 		};
 
 		VkRenderPass m_RenderPass = VK_NULL_HANDLE;
+		VkFormat     m_ColorFormat = VK_FORMAT_UNDEFINED;   // the render pass (and every pipeline) is built for it
 		VkFormat     m_DepthFormat = VK_FORMAT_UNDEFINED;
 		std::vector<DepthResource> m_Depth;
 		std::vector<VkFramebuffer> m_Framebuffers;
 
+		// Below full resolution the scene pass renders into the upscaler's images
+		// (m_SceneFramebuffers, same depth) and EndScene scales them into the target
+		Upscaler m_Upscaler;
+		DynamicResolution m_DynamicResolution;
+		std::vector<VkFramebuffer> m_SceneFramebuffers;
+		VkExtent2D m_RenderExtent{ 0, 0 };
+
 		std::vector<std::shared_ptr<Cubed::Model>> m_Models;
 
+		struct ChunkMesh {
+			GeometryHandle Geometry = InvalidGeometry;
+			glm::vec3 Origin{ 0.0f };
+		};
+		std::unordered_map<ChunkCoord, ChunkMesh, ChunkCoordHash> m_ChunkMeshes;
+		GeometryPool m_ChunkGeometry{ sizeof(ChunkVertex), 1024 * 1024, 1536 * 1024 };
+		// One layer per block type, sampled by voxel.frag at set 2
+		std::unique_ptr<Texture> m_BlockTextures;
+		VkDescriptorSetLayout m_BlockTextureSetLayout = nullptr;
+		VkDescriptorSet m_BlockTextureSet = nullptr;
+
+		// Frustum culling: spheres go through CullSpheres in one batch, survivors
+		// are refined against their world AABB. Scratch is reused across frames.
+		Frustum m_Frustum;
+		CullStats m_CullStats;
+		SphereBatch m_CullSpheres;
+		std::vector<Bounds> m_CullBounds;
+		std::vector<uint8_t> m_CullVisible;
+		struct MeshDraw {
+			const Model* Owner;
+			const Mesh* Draw;
+		};
+		std::vector<MeshDraw> m_CullMeshes;
+		std::vector<const ChunkMesh*> m_CullChunks;
+
+		// One entry per model with a visible mesh, uploaded in one go by EndScene
+		std::vector<ModelTransform> m_ModelTransforms;
+
+		// Occlusion culling against a depth pyramid of a frame in flight, built after the main pass
+		HiZBuffer m_HiZ;
+		bool m_OcclusionCullingSupported = false;
+		bool m_OcclusionCulling = true;
+
+		// Level of detail of every model mesh, kept across frames for the hysteresis
+		std::unordered_map<const Mesh*, uint32_t> m_MeshLods;
+		std::array<std::vector<InstanceData>, MaxMeshLods> m_LodInstances;
+		float m_LodScale = 1.0f;   // world radius / distance -> fraction of half the viewport height
+		bool m_MeshLod = true;
+
+		// Every draw is queued during the scene; EndScene begins the pass and records them sorted
+		RenderQueue m_RenderQueue;
+		glm::vec3 m_CameraPosition{ 0.0f };
+		CommandRecorder m_CommandRecorder;
+		bool m_ParallelRecording = true;
+
+		// GPU scopes bracket the frame and its passes, CPU scopes the Render* calls
+		GpuProfiler m_Profiler;
+		std::chrono::steady_clock::time_point m_SceneStart;
+
 	};
 }
\ No newline at end of file
@@ -0,0 +1,356 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CUBED_SCENE_SSE2 1
+	#include <emmintrin.h>
+#else
+	#define CUBED_SCENE_SSE2 0
+#endif
+
+namespace Cubed {
+
+	namespace {
+
+		const glm::mat4 kIdentity(1.0f);
+
+#if CUBED_SCENE_SSE2
+		inline __m128 Add3(__m128 a, __m128 b, __m128 c) { return _mm_add_ps(_mm_add_ps(a, b), c); }
+		inline __m128 Dot3(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+		{
+			return Add3(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by), _mm_mul_ps(az, bz));
+		}
+
+		// Column c of four matrices, one lane each, as its x, y and z across the lanes
+		inline void GatherColumn(const glm::mat4* const matrices[4], int c, __m128& x, __m128& y, __m128& z)
+		{
+			__m128 c0 = _mm_loadu_ps(&(*matrices[0])[c].x);
+			__m128 c1 = _mm_loadu_ps(&(*matrices[1])[c].x);
+			__m128 c2 = _mm_loadu_ps(&(*matrices[2])[c].x);
+			__m128 c3 = _mm_loadu_ps(&(*matrices[3])[c].x);
+			_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+			x = c0; y = c1; z = c2;
+		}
+
+		// The inverse of GatherColumn, for the first count lanes
+		inline void ScatterColumn(glm::mat4* const matrices[4], size_t count, int c, __m128 x, __m128 y, __m128 z, float w)
+		{
+			__m128 ww = _mm_set1_ps(w);
+			_MM_TRANSPOSE4_PS(x, y, z, ww);
+			const __m128 columns[4] = { x, y, z, ww };
+			for (size_t lane = 0; lane < count; lane++)
+				_mm_storeu_ps(&(*matrices[lane])[c].x, columns[lane]);
+		}
+#endif
+
+	}
+
+	SceneGraph& SceneGraph::GetModelScene()
+	{
+		static SceneGraph scene;
+		return scene;
+	}
+
+	SceneNode SceneGraph::Create(SceneNode parent)
+	{
+		SceneNode node;
+		if (!m_FreeNodes.empty())
+		{
+			node = m_FreeNodes.back();
+			m_FreeNodes.pop_back();
+		}
+		else
+		{
+			node = (SceneNode)m_Parent.size();
+			m_Parent.emplace_back();
+			m_Translation.emplace_back();
+			m_Rotation.emplace_back();
+			m_Scale.emplace_back();
+			m_Flags.emplace_back();
+			m_World.emplace_back();
+			m_Normal.emplace_back();
+		}
+
+		m_Parent[node] = parent;
+		m_Translation[node] = glm::vec3(0.0f);
+		m_Rotation[node] = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		m_Scale[node] = glm::vec3(1.0f);
+		m_World[node] = kIdentity;
+		m_Normal[node] = kIdentity;
+		m_Flags[node] = Alive;
+		MarkDirty(node);
+
+		m_HierarchyChanged = true;
+		m_Stats.Nodes++;
+		return node;
+	}
+
+	void SceneGraph::Destroy(SceneNode node)
+	{
+		if (node >= m_Flags.size() || !(m_Flags[node] & Alive))
+			return;
+
+		for (SceneNode child = 0; child < m_Parent.size(); child++)
+		{
+			if ((m_Flags[child] & Alive) && m_Parent[child] == node)
+			{
+				m_Parent[child] = InvalidSceneNode;
+				MarkDirty(child);
+			}
+		}
+
+		m_Flags[node] = 0;
+		m_Parent[node] = InvalidSceneNode;
+		m_FreeNodes.push_back(node);
+		m_HierarchyChanged = true;
+		m_Stats.Nodes--;
+	}
+
+	void SceneGraph::SetParent(SceneNode node, SceneNode parent)
+	{
+		for (SceneNode ancestor = parent; ancestor != InvalidSceneNode; ancestor = m_Parent[ancestor])
+		{
+			if (ancestor == node)
+				return;
+		}
+
+		if (m_Parent[node] == parent)
+			return;
+
+		m_Parent[node] = parent;
+		m_HierarchyChanged = true;
+		MarkDirty(node);
+	}
+
+	void SceneGraph::SetTranslation(SceneNode node, const glm::vec3& translation)
+	{
+		if (m_Translation[node] == translation)
+			return;
+		m_Translation[node] = translation;
+		MarkDirty(node);
+	}
+
+	void SceneGraph::SetRotation(SceneNode node, const glm::quat& rotation)
+	{
+		const glm::quat unit = glm::normalize(rotation);
+		if (m_Rotation[node] == unit)
+			return;
+		m_Rotation[node] = unit;
+		MarkDirty(node);
+	}
+
+	void SceneGraph::SetScale(SceneNode node, const glm::vec3& scale)
+	{
+		if (m_Scale[node] == scale)
+			return;
+		m_Scale[node] = scale;
+		MarkDirty(node);
+	}
+
+	void SceneGraph::MarkDirty(SceneNode node)
+	{
+		m_Flags[node] |= LocalDirty;
+		m_AnyDirty = true;
+	}
+
+	void SceneGraph::Update()
+	{
+		m_Stats.Updated = 0;
+		if (!m_AnyDirty)
+			return;
+
+		if (m_HierarchyChanged)
+			RebuildLevels();
+
+		// A level only reads the one above it, which is finished by then
+		m_Updated.clear();
+		for (size_t level = 0; level + 1 < m_LevelStart.size(); level++)
+		{
+			m_Batch.clear();
+			for (uint32_t i = m_LevelStart[level]; i < m_LevelStart[level + 1]; i++)
+			{
+				const SceneNode node = m_Order[i];
+				const SceneNode parent = m_Parent[node];
+				if ((m_Flags[node] & LocalDirty) || (parent != InvalidSceneNode && (m_Flags[parent] & WorldDirty)))
+				{
+					m_Flags[node] |= WorldDirty;
+					m_Batch.push_back(node);
+				}
+			}
+
+			ComputeMatrices(m_Batch.data(), m_Batch.size());
+			m_Updated.insert(m_Updated.end(), m_Batch.begin(), m_Batch.end());
+		}
+
+		for (SceneNode node : m_Updated)
+			m_Flags[node] &= (uint8_t)~(LocalDirty | WorldDirty);
+
+		m_Stats.Updated = (uint32_t)m_Updated.size();
+		m_AnyDirty = false;
+	}
+
+	void SceneGraph::RebuildLevels()
+	{
+		const size_t nodeCount = m_Parent.size();
+
+		// Depth by walking up to the first ancestor whose depth is known
+		constexpr uint32_t kUnknown = UINT32_MAX;
+		m_Depth.assign(nodeCount, kUnknown);
+		uint32_t levels = 0;
+		for (SceneNode node = 0; node < nodeCount; node++)
+		{
+			if (!(m_Flags[node] & Alive))
+				continue;
+
+			m_Batch.clear();
+			SceneNode top = node;
+			while (top != InvalidSceneNode && m_Depth[top] == kUnknown)
+			{
+				m_Batch.push_back(top);
+				top = m_Parent[top];
+			}
+
+			uint32_t depth = top == InvalidSceneNode ? 0 : m_Depth[top] + 1;
+			for (auto it = m_Batch.rbegin(); it != m_Batch.rend(); ++it)
+				m_Depth[*it] = depth++;
+			levels = std::max(levels, depth);
+		}
+
+		// Counting sort by depth
+		m_LevelStart.assign(levels + 1, 0);
+		for (SceneNode node = 0; node < nodeCount; node++)
+			if (m_Flags[node] & Alive)
+				m_LevelStart[m_Depth[node] + 1]++;
+		for (uint32_t level = 0; level < levels; level++)
+			m_LevelStart[level + 1] += m_LevelStart[level];
+
+		m_Order.resize(m_LevelStart[levels]);
+		m_Batch.assign(m_LevelStart.begin(), m_LevelStart.end() - 1);
+		for (SceneNode node = 0; node < nodeCount; node++)
+			if (m_Flags[node] & Alive)
+				m_Order[m_Batch[m_Depth[node]]++] = node;
+
+		m_Stats.Levels = levels;
+		m_HierarchyChanged = false;
+	}
+
+	void SceneGraph::ComputeMatrices(const SceneNode* nodes, size_t count)
+	{
+		size_t i = 0;
+
+#if CUBED_SCENE_SSE2
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 two = _mm_set1_ps(2.0f);
+
+		for (; i < count; i += 4)
+		{
+			// A short last batch repeats its last node in the spare lanes and doesn't store them
+			const size_t lanes = std::min<size_t>(count - i, 4);
+			SceneNode node[4];
+			const glm::mat4* parent[4];
+			glm::mat4* world[4];
+			glm::mat4* normal[4];
+			for (size_t lane = 0; lane < 4; lane++)
+			{
+				node[lane] = nodes[i + std::min(lane, lanes - 1)];
+				const SceneNode p = m_Parent[node[lane]];
+				parent[lane] = p == InvalidSceneNode ? &kIdentity : &m_World[p];
+				world[lane] = &m_World[node[lane]];
+				normal[lane] = &m_Normal[node[lane]];
+			}
+
+			const glm::vec3* t[4] = { &m_Translation[node[0]], &m_Translation[node[1]], &m_Translation[node[2]], &m_Translation[node[3]] };
+			const glm::quat* r[4] = { &m_Rotation[node[0]], &m_Rotation[node[1]], &m_Rotation[node[2]], &m_Rotation[node[3]] };
+			const glm::vec3* s[4] = { &m_Scale[node[0]], &m_Scale[node[1]], &m_Scale[node[2]], &m_Scale[node[3]] };
+
+			const __m128 tx = _mm_setr_ps(t[0]->x, t[1]->x, t[2]->x, t[3]->x);
+			const __m128 ty = _mm_setr_ps(t[0]->y, t[1]->y, t[2]->y, t[3]->y);
+			const __m128 tz = _mm_setr_ps(t[0]->z, t[1]->z, t[2]->z, t[3]->z);
+			const __m128 qx = _mm_setr_ps(r[0]->x, r[1]->x, r[2]->x, r[3]->x);
+			const __m128 qy = _mm_setr_ps(r[0]->y, r[1]->y, r[2]->y, r[3]->y);
+			const __m128 qz = _mm_setr_ps(r[0]->z, r[1]->z, r[2]->z, r[3]->z);
+			const __m128 qw = _mm_setr_ps(r[0]->w, r[1]->w, r[2]->w, r[3]->w);
+			const __m128 sx = _mm_setr_ps(s[0]->x, s[1]->x, s[2]->x, s[3]->x);
+			const __m128 sy = _mm_setr_ps(s[0]->y, s[1]->y, s[2]->y, s[3]->y);
+			const __m128 sz = _mm_setr_ps(s[0]->z, s[1]->z, s[2]->z, s[3]->z);
+
+			// Local = T * R * S: rotation columns scaled, translation last
+			const __m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+			const __m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+			const __m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+			__m128 local[3][3];
+			local[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+			local[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+			local[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+			local[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+			local[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+			local[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+			local[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+			local[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+			local[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+
+			// Parents are affine, so only their upper 3x4 matters
+			__m128 p[4][3];
+			for (int c = 0; c < 4; c++)
+				GatherColumn(parent, c, p[c][0], p[c][1], p[c][2]);
+
+			__m128 w[4][3];
+			for (int c = 0; c < 3; c++)
+				for (int row = 0; row < 3; row++)
+					w[c][row] = Add3(_mm_mul_ps(p[0][row], local[c][0]), _mm_mul_ps(p[1][row], local[c][1]), _mm_mul_ps(p[2][row], local[c][2]));
+			for (int row = 0; row < 3; row++)
+				w[3][row] = _mm_add_ps(Add3(_mm_mul_ps(p[0][row], tx), _mm_mul_ps(p[1][row], ty), _mm_mul_ps(p[2][row], tz)), p[3][row]);
+
+			// Inverse transpose of the upper 3x3: the cofactor columns over the determinant
+			__m128 n[3][3];
+			for (int c = 0; c < 3; c++)
+			{
+				const __m128* a = w[(c + 1) % 3];
+				const __m128* b = w[(c + 2) % 3];
+				n[c][0] = _mm_sub_ps(_mm_mul_ps(a[1], b[2]), _mm_mul_ps(a[2], b[1]));
+				n[c][1] = _mm_sub_ps(_mm_mul_ps(a[2], b[0]), _mm_mul_ps(a[0], b[2]));
+				n[c][2] = _mm_sub_ps(_mm_mul_ps(a[0], b[1]), _mm_mul_ps(a[1], b[0]));
+			}
+			const __m128 determinant = Dot3(w[0][0], w[0][1], w[0][2], n[0][0], n[0][1], n[0][2]);
+			const __m128 invertible = _mm_cmpneq_ps(determinant, zero);
+			const __m128 scale = _mm_or_ps(_mm_and_ps(invertible, _mm_div_ps(one, determinant)), _mm_andnot_ps(invertible, one));
+
+			for (int c = 0; c < 4; c++)
+				ScatterColumn(world, lanes, c, w[c][0], w[c][1], w[c][2], c == 3 ? 1.0f : 0.0f);
+			for (int c = 0; c < 3; c++)
+				ScatterColumn(normal, lanes, c, _mm_mul_ps(n[c][0], scale), _mm_mul_ps(n[c][1], scale), _mm_mul_ps(n[c][2], scale), 0.0f);
+			for (size_t lane = 0; lane < lanes; lane++)
+				(*normal[lane])[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			const SceneNode node = nodes[i];
+			const SceneNode parent = m_Parent[node];
+
+			glm::mat4 local = glm::mat4_cast(m_Rotation[node]);
+			local[0] *= m_Scale[node].x;
+			local[1] *= m_Scale[node].y;
+			local[2] *= m_Scale[node].z;
+			local[3] = glm::vec4(m_Translation[node], 1.0f);
+
+			const glm::mat4& world = m_World[node] = parent == InvalidSceneNode ? local : m_World[parent] * local;
+
+			const glm::vec3 w0(world[0]), w1(world[1]), w2(world[2]);
+			const glm::vec3 n0 = glm::cross(w1, w2), n1 = glm::cross(w2, w0), n2 = glm::cross(w0, w1);
+			const float determinant = glm::dot(w0, n0);
+			const float scale = determinant != 0.0f ? 1.0f / determinant : 1.0f;
+
+			glm::mat4& normal = m_Normal[node];
+			normal[0] = glm::vec4(n0 * scale, 0.0f);
+			normal[1] = glm::vec4(n1 * scale, 0.0f);
+			normal[2] = glm::vec4(n2 * scale, 0.0f);
+			normal[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		}
+	}
+
+}
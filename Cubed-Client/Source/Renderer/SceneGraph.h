@@ -0,0 +1,96 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace Cubed {
+
+	using SceneNode = uint32_t;
+	constexpr SceneNode InvalidSceneNode = UINT32_MAX;
+
+	struct SceneGraphStats
+	{
+		uint32_t Nodes = 0;
+		uint32_t Levels = 0;     // depth of the deepest node + 1
+		uint32_t Updated = 0;    // world matrices recomputed by the last Update()
+	};
+
+	//
+	// SceneGraph - nodes with a parent and a local translation, rotation and
+	// scale, each component in its own array. Setting a component flags the
+	// node; Update() walks the hierarchy a level at a time (parents before
+	// children) and recomputes the world matrix, and the normal matrix (the
+	// inverse transpose of its upper 3x3), of every flagged node and everything
+	// below it. The recomputation runs over four nodes at a time with SSE.
+	//
+	// Handles are indices and stay valid until the node is destroyed; freed
+	// slots are reused.
+	//
+	class SceneGraph
+	{
+	public:
+		// Every Model has a node in here, see Model::GetNode()
+		static SceneGraph& GetModelScene();
+
+		SceneNode Create(SceneNode parent = InvalidSceneNode);
+		// Its children become roots and keep their local transforms
+		void Destroy(SceneNode node);
+
+		// Ignored when it would make the node its own ancestor
+		void SetParent(SceneNode node, SceneNode parent);
+		SceneNode GetParent(SceneNode node) const { return m_Parent[node]; }
+
+		void SetTranslation(SceneNode node, const glm::vec3& translation);
+		void SetRotation(SceneNode node, const glm::quat& rotation);
+		void SetScale(SceneNode node, const glm::vec3& scale);
+		const glm::vec3& GetTranslation(SceneNode node) const { return m_Translation[node]; }
+		const glm::quat& GetRotation(SceneNode node) const { return m_Rotation[node]; }
+		const glm::vec3& GetScale(SceneNode node) const { return m_Scale[node]; }
+
+		void Update();
+
+		// As of the last Update(); the normal matrix's fourth column is unused
+		const glm::mat4& GetWorldMatrix(SceneNode node) const { return m_World[node]; }
+		const glm::mat4& GetNormalMatrix(SceneNode node) const { return m_Normal[node]; }
+
+		SceneGraphStats GetStats() const { return m_Stats; }
+	private:
+		void MarkDirty(SceneNode node);
+		void RebuildLevels();
+		// World = parent world * local, and its normal matrix, for every node in the list
+		void ComputeMatrices(const SceneNode* nodes, size_t count);
+	private:
+		enum NodeFlags : uint8_t
+		{
+			Alive = 1 << 0,
+			LocalDirty = 1 << 1,   // set by the setters
+			WorldDirty = 1 << 2    // recomputed this Update(), so the children are too
+		};
+
+		std::vector<SceneNode> m_Parent;
+		std::vector<glm::vec3> m_Translation;
+		std::vector<glm::quat> m_Rotation;
+		std::vector<glm::vec3> m_Scale;
+		std::vector<uint8_t> m_Flags;
+		std::vector<glm::mat4> m_World;
+		std::vector<glm::mat4> m_Normal;
+		std::vector<SceneNode> m_FreeNodes;
+
+		// Live nodes ordered by depth; level i is [m_LevelStart[i], m_LevelStart[i + 1])
+		std::vector<SceneNode> m_Order;
+		std::vector<uint32_t> m_LevelStart;
+		bool m_HierarchyChanged = false;
+		bool m_AnyDirty = false;
+
+		// Scratch for Update()
+		std::vector<uint32_t> m_Depth;
+		std::vector<SceneNode> m_Batch;
+		std::vector<SceneNode> m_Updated;
+
+		SceneGraphStats m_Stats;
+	};
+
+}
@@ -0,0 +1,252 @@
+#include "TextureTable.h"
+
+#include "Walnut/Core/Log.h"
+
+#include <algorithm>
+
+namespace Cubed {
+
+	namespace {
+
+		constexpr uint32_t kInitialCapacity = 256;   // first set with descriptor indexing, doubled as needed
+		constexpr uint32_t kMaxTextures = 16384;     // cap on the device limit, it sizes the shaders' array
+		constexpr uint32_t kFixedTextures = 1024;    // without descriptor indexing every slot is written each time
+		constexpr uint32_t kMaxSets = 8;             // the current set and the retired ones still in flight
+
+		// Fills maxCapacity from the limits of whichever path the device has enabled
+		bool QueryDescriptorIndexing(uint32_t& maxCapacity)
+		{
+			VkPhysicalDevice physicalDevice = GetVulkanInfo()->PhysicalDevice;
+			const VkPhysicalDeviceDescriptorIndexingFeatures& indexing = GetEnabledVulkanFeatures().DescriptorIndexing;
+
+			VkPhysicalDeviceDescriptorIndexingProperties indexingLimits{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES };
+			VkPhysicalDeviceProperties2 properties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+			properties.pNext = &indexingLimits;
+			vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+			// A combined image sampler counts against both the sampler and the sampled image limits
+			const bool enabled = indexing.descriptorBindingPartiallyBound && indexing.descriptorBindingVariableDescriptorCount
+				&& indexing.descriptorBindingSampledImageUpdateAfterBind && indexing.descriptorBindingUpdateUnusedWhilePending;
+			if (enabled)
+			{
+				maxCapacity = std::min({ indexingLimits.maxPerStageDescriptorUpdateAfterBindSamplers,
+					indexingLimits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+					indexingLimits.maxDescriptorSetUpdateAfterBindSamplers,
+					indexingLimits.maxDescriptorSetUpdateAfterBindSampledImages, kMaxTextures });
+			}
+			else
+			{
+				const VkPhysicalDeviceLimits& limits = properties.properties.limits;
+				maxCapacity = std::min({ limits.maxPerStageDescriptorSamplers, limits.maxPerStageDescriptorSampledImages,
+					limits.maxDescriptorSetSamplers, limits.maxDescriptorSetSampledImages, kFixedTextures });
+			}
+			return enabled;
+		}
+
+	}
+
+	void TextureTable::Init(const VkDescriptorImageInfo& fallback)
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+		m_Fallback = fallback;
+		m_DescriptorIndexing = QueryDescriptorIndexing(m_MaxCapacity);
+
+		VkDescriptorSetLayoutBinding binding{};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		binding.descriptorCount = m_MaxCapacity;
+		binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		const VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+			| VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT
+			| VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
+		VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO };
+		flagsInfo.bindingCount = 1;
+		flagsInfo.pBindingFlags = &bindingFlags;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &binding;
+		if (m_DescriptorIndexing)
+		{
+			layoutInfo.pNext = &flagsInfo;
+			layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+		}
+		VK_CHECK(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_Layout));
+
+		// Growing sets double, so with descriptor indexing the retired ones add up to less than the current one
+		VkDescriptorPoolSize poolSize{};
+		poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSize.descriptorCount = (m_DescriptorIndexing ? 2 : kMaxSets) * m_MaxCapacity;
+
+		VkDescriptorPoolCreateInfo poolInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+		if (m_DescriptorIndexing)
+			poolInfo.flags |= VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+		poolInfo.maxSets = kMaxSets;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+
+		m_Pool = std::make_shared<VkDescriptorPool>(VkDescriptorPool(VK_NULL_HANDLE));
+		VK_CHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, m_Pool.get()));
+
+		if (!Reallocate(m_DescriptorIndexing ? std::min(kInitialCapacity, m_MaxCapacity) : m_MaxCapacity))
+			throw std::runtime_error("Failed to allocate the texture descriptor set");
+
+		WL_INFO_TAG("Renderer", "Texture table: {} slots, descriptor indexing {}", m_MaxCapacity,
+			m_DescriptorIndexing ? "on" : "off");
+	}
+
+	void TextureTable::Destroy()
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+		if (m_Pool && *m_Pool)
+		{
+			vkDestroyDescriptorPool(device, *m_Pool, nullptr);
+			*m_Pool = VK_NULL_HANDLE;
+		}
+		if (m_Layout) vkDestroyDescriptorSetLayout(device, m_Layout, nullptr);
+
+		m_Pool.reset();
+		m_Layout = VK_NULL_HANDLE;
+		m_Set = VK_NULL_HANDLE;
+		m_Capacity = 0;
+		m_Images.clear();
+		m_Dirty.clear();
+	}
+
+	void TextureTable::Write(uint32_t slot, const VkDescriptorImageInfo& image)
+	{
+		if (slot >= m_MaxCapacity)
+		{
+			// The shaders clamp to the last slot, the texture just won't show
+			WL_WARN_TAG("Renderer", "Texture {} doesn't fit the {} slot texture table", slot, m_MaxCapacity);
+			return;
+		}
+
+		if (slot >= m_Images.size())
+			m_Images.resize(slot + 1, VkDescriptorImageInfo{});
+		m_Images[slot] = image;
+		m_Dirty.push_back(slot);
+	}
+
+	void TextureTable::Remove(uint32_t slot)
+	{
+		if (slot < m_Images.size())
+			Write(slot, VkDescriptorImageInfo{});
+	}
+
+	void TextureTable::Commit()
+	{
+		if (m_Dirty.empty() || !m_Set)
+			return;
+
+		VkDevice device = GetVulkanInfo()->Device;
+		const uint32_t used = (uint32_t)m_Images.size();
+
+		// Only the variable count grows, the layout already allows the most the device does
+		uint32_t capacity = m_Capacity;
+		while (capacity < used)
+			capacity *= 2;
+		capacity = std::min(capacity, m_MaxCapacity);
+
+		if (!m_DescriptorIndexing || capacity != m_Capacity)
+		{
+			// Out of pool space until frames in flight let go of their sets, tried again next frame
+			if (Reallocate(capacity))
+				m_Dirty.clear();
+			return;
+		}
+
+		std::sort(m_Dirty.begin(), m_Dirty.end());
+		m_Dirty.erase(std::unique(m_Dirty.begin(), m_Dirty.end()), m_Dirty.end());
+
+		std::vector<VkWriteDescriptorSet> writes;
+		writes.reserve(m_Dirty.size());
+		for (uint32_t slot : m_Dirty)
+			AddWrite(writes, m_Set, slot);
+		if (!writes.empty())
+			vkUpdateDescriptorSets(device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
+
+		m_Writes += (uint32_t)writes.size();
+		m_Dirty.clear();
+	}
+
+	bool TextureTable::Reallocate(uint32_t capacity)
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+
+		VkDescriptorSetVariableDescriptorCountAllocateInfo countInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO };
+		countInfo.descriptorSetCount = 1;
+		countInfo.pDescriptorCounts = &capacity;
+
+		VkDescriptorSetAllocateInfo allocInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+		allocInfo.pNext = m_DescriptorIndexing ? &countInfo : nullptr;
+		allocInfo.descriptorPool = *m_Pool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &m_Layout;
+
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS)
+			return false;
+
+		std::vector<VkWriteDescriptorSet> writes;
+		writes.reserve(m_DescriptorIndexing ? m_Images.size() : capacity);
+		for (uint32_t slot = 0; slot < (m_DescriptorIndexing ? (uint32_t)m_Images.size() : capacity); slot++)
+			AddWrite(writes, set, slot);
+		if (!writes.empty())
+			vkUpdateDescriptorSets(device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
+
+		// Frames in flight keep sampling through the old set until they finish
+		if (m_Set)
+		{
+			std::shared_ptr<VkDescriptorPool> pool = m_Pool;
+			VkDescriptorSet retired = m_Set;
+			SubmitResourceFree([pool, retired]()
+			{
+				if (*pool)
+					vkFreeDescriptorSets(GetVulkanInfo()->Device, *pool, 1, &retired);
+			});
+			m_Reallocations++;
+		}
+
+		m_Set = set;
+		m_Capacity = capacity;
+		m_Writes += (uint32_t)writes.size();
+		return true;
+	}
+
+	bool TextureTable::AddWrite(std::vector<VkWriteDescriptorSet>& writes, VkDescriptorSet set, uint32_t slot) const
+	{
+		const VkDescriptorImageInfo* image = slot < m_Images.size() && m_Images[slot].imageView ? &m_Images[slot] : nullptr;
+		if (!image)
+		{
+			// Partially bound slots may stay empty; otherwise every slot the shader could index must be valid
+			if (m_DescriptorIndexing)
+				return false;
+			image = &m_Fallback;
+		}
+
+		VkWriteDescriptorSet& write = writes.emplace_back();
+		write = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+		write.dstSet = set;
+		write.dstBinding = 0;
+		write.dstArrayElement = slot;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.descriptorCount = 1;
+		write.pImageInfo = image;
+		return true;
+	}
+
+	TextureTableStats TextureTable::GetStats() const
+	{
+		TextureTableStats stats;
+		stats.Capacity = m_Capacity;
+		stats.MaxCapacity = m_MaxCapacity;
+		stats.Writes = m_Writes;
+		stats.Reallocations = m_Reallocations;
+		stats.DescriptorIndexing = m_DescriptorIndexing;
+		return stats;
+	}
+
+}
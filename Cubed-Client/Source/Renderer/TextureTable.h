@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Vulkan.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Cubed {
+
+	struct TextureTableStats
+	{
+		uint32_t Capacity = 0;      // slots in the current set
+		uint32_t MaxCapacity = 0;   // the layout's count, from the device limits
+		uint32_t Writes = 0;
+		uint32_t Reallocations = 0;
+		bool DescriptorIndexing = false;
+	};
+
+	//
+	// TextureTable - the one descriptor set every texture lives in, indexed by
+	// texture ID in the fragment shaders (set 0, binding 0).
+	//
+	// With descriptor indexing the binding is partially bound, update-after-bind
+	// and has a variable count: a texture is written into its slot once while
+	// earlier frames are still in flight, and the set is only reallocated (and
+	// copied) when a slot past its capacity gets written, doubling it.
+	//
+	// Without it the binding has a fixed size, every slot starts out on the
+	// fallback texture, and each batch of writes goes into a fresh copy of the
+	// set while the old one is retired with the frames that still use it.
+	//
+	class TextureTable
+	{
+	public:
+		// fallback fills slots that were never written or have been removed
+		void Init(const VkDescriptorImageInfo& fallback);
+		// Immediate, the device must be idle
+		void Destroy();
+
+		// Reach the set at the next Commit()
+		void Write(uint32_t slot, const VkDescriptorImageInfo& image);
+		void Remove(uint32_t slot);
+
+		// Applies the queued writes; call before the set is bound for the frame
+		void Commit();
+
+		VkDescriptorSetLayout GetLayout() const { return m_Layout; }
+		VkDescriptorSet GetSet() const { return m_Set; }
+		// The shaders' array size, passed as specialization constant 0
+		uint32_t GetMaxCapacity() const { return m_MaxCapacity; }
+		TextureTableStats GetStats() const;
+	private:
+		bool Reallocate(uint32_t capacity);
+		// A null image view is an empty slot: skipped with descriptor indexing, the fallback without
+		bool AddWrite(std::vector<VkWriteDescriptorSet>& writes, VkDescriptorSet set, uint32_t slot) const;
+	private:
+		// Shared with retired sets, which may be freed after Destroy()
+		std::shared_ptr<VkDescriptorPool> m_Pool;
+		VkDescriptorSetLayout m_Layout = VK_NULL_HANDLE;
+		VkDescriptorSet m_Set = VK_NULL_HANDLE;
+		VkDescriptorImageInfo m_Fallback{};
+		bool m_DescriptorIndexing = false;
+
+		uint32_t m_Capacity = 0;
+		uint32_t m_MaxCapacity = 0;
+
+		// What every slot should hold, so a reallocation can rewrite the lot
+		std::vector<VkDescriptorImageInfo> m_Images;
+		std::vector<uint32_t> m_Dirty;
+
+		uint32_t m_Writes = 0;
+		uint32_t m_Reallocations = 0;
+	};
+
+}
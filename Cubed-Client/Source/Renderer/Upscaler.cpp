@@ -0,0 +1,281 @@
+#include "Upscaler.h"
+#include "DeletionQueue.h"
+
+namespace Cubed {
+
+	namespace {
+
+		struct UpscalePushConstants
+		{
+			float UVScale[2];
+			float UVMax[2];
+		};
+
+	}
+
+	bool Upscaler::Init(VkShaderModule vertexShader, VkShaderModule fragmentShader, VkPipelineCache cache, VkFormat format)
+	{
+		VkDevice device = GetVulkanInfo()->Device;
+		m_Format = format;
+
+		VkFormatProperties formatProps{};
+		vkGetPhysicalDeviceFormatProperties(GetVulkanInfo()->PhysicalDevice, format, &formatProps);
+		const VkFormatFeatureFlags features = formatProps.optimalTilingFeatures;
+		if (!(features & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT) || !(features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+			return false;
+
+		// Writes every texel of the output, so what was there before doesn't matter
+		VkAttachmentDescription output{};
+		output.format = format;
+		output.samples = VK_SAMPLE_COUNT_1_BIT;
+		output.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		output.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		output.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		output.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		output.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		output.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;   // as the scene pass leaves it
+
+		VkAttachmentReference outputRef{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+
+		VkSubpassDescription subpass{};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = &outputRef;
+
+		VkSubpassDependency dependency{};
+		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependency.dstSubpass = 0;
+		dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependency.srcAccessMask = 0;
+		dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+		VkRenderPassCreateInfo renderPassInfo{ VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
+		renderPassInfo.attachmentCount = 1;
+		renderPassInfo.pAttachments = &output;
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+		renderPassInfo.dependencyCount = 1;
+		renderPassInfo.pDependencies = &dependency;
+		VK_CHECK(vkCreateRenderPass(device, &renderPassInfo, nullptr, &m_RenderPass));
+
+		VkDescriptorSetLayoutBinding binding{};
+		binding.binding = 0;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		binding.descriptorCount = 1;
+		binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &binding;
+		VK_CHECK(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_SetLayout));
+
+		VkPushConstantRange pushRange{ VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(UpscalePushConstants) };
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &m_SetLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+		VK_CHECK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout));
+
+		// A full-screen triangle from gl_VertexIndex: no vertex input, depth or blending
+		VkPipelineShaderStageCreateInfo stages[2]{};
+		stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		stages[0].module = vertexShader;
+		stages[0].pName = "main";
+		stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		stages[1].module = fragmentShader;
+		stages[1].pName = "main";
+
+		VkPipelineVertexInputStateCreateInfo vertexInput{ VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly{ VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
+		inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+		VkPipelineViewportStateCreateInfo viewport{ VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO };
+		viewport.viewportCount = 1;
+		viewport.scissorCount = 1;
+
+		VkPipelineRasterizationStateCreateInfo raster{ VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
+		raster.cullMode = VK_CULL_MODE_NONE;
+		raster.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		raster.lineWidth = 1.0f;
+
+		VkPipelineMultisampleStateCreateInfo multisample{ VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO };
+		multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+		VkPipelineDepthStencilStateCreateInfo depthStencil{ VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO };
+
+		VkPipelineColorBlendAttachmentState blendAttachment{};
+		blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+		VkPipelineColorBlendStateCreateInfo blend{ VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO };
+		blend.attachmentCount = 1;
+		blend.pAttachments = &blendAttachment;
+
+		VkDynamicState dynamics[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+		VkPipelineDynamicStateCreateInfo dynamic{ VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
+		dynamic.dynamicStateCount = 2;
+		dynamic.pDynamicStates = dynamics;
+
+		VkGraphicsPipelineCreateInfo pipelineInfo{ VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+		pipelineInfo.stageCount = 2;
+		pipelineInfo.pStages = stages;
+		pipelineInfo.pVertexInputState = &vertexInput;
+		pipelineInfo.pInputAssemblyState = &inputAssembly;
+		pipelineInfo.pViewportState = &viewport;
+		pipelineInfo.pRasterizationState = &raster;
+		pipelineInfo.pMultisampleState = &multisample;
+		pipelineInfo.pDepthStencilState = &depthStencil;
+		pipelineInfo.pColorBlendState = &blend;
+		pipelineInfo.pDynamicState = &dynamic;
+		pipelineInfo.layout = m_PipelineLayout;
+		pipelineInfo.renderPass = m_RenderPass;
+		VK_CHECK(vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, &m_Pipeline));
+
+		// Bilinear where the format allows it, otherwise the scale shows as blocky pixels
+		const VkFilter filter = (features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+		VkSamplerCreateInfo samplerInfo{ VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+		samplerInfo.magFilter = filter;
+		samplerInfo.minFilter = filter;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		VK_CHECK(vkCreateSampler(device, &samplerInfo, nullptr, &m_Sampler));
+		return true;
+	}
+
+	void Upscaler::Retire()
+	{
+		RetireTargets();
+
+		DeletionQueue::ReleaseSampler(m_Sampler);
+		DeletionQueue::ReleasePipeline(m_Pipeline);
+		DeletionQueue::ReleasePipelineLayout(m_PipelineLayout);
+		DeletionQueue::ReleaseDescriptorSetLayout(m_SetLayout);
+		DeletionQueue::ReleaseRenderPass(m_RenderPass);
+		m_Sampler = VK_NULL_HANDLE;
+		m_Pipeline = VK_NULL_HANDLE;
+		m_PipelineLayout = VK_NULL_HANDLE;
+		m_SetLayout = VK_NULL_HANDLE;
+		m_RenderPass = VK_NULL_HANDLE;
+	}
+
+	void Upscaler::CreateTargets(uint32_t width, uint32_t height, const std::vector<VkImageView>& outputViews)
+	{
+		if (!IsSupported())
+			return;
+
+		VkDevice device = GetVulkanInfo()->Device;
+		m_Width = width;
+		m_Height = height;
+		m_Targets.resize(outputViews.size());
+
+		for (size_t i = 0; i < m_Targets.size(); ++i)
+		{
+			Target& target = m_Targets[i];
+
+			VkImageCreateInfo ici{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+			ici.imageType = VK_IMAGE_TYPE_2D;
+			ici.format = m_Format;
+			ici.extent = { width, height, 1 };
+			ici.mipLevels = 1;
+			ici.arrayLayers = 1;
+			ici.samples = VK_SAMPLE_COUNT_1_BIT;
+			ici.tiling = VK_IMAGE_TILING_OPTIMAL;
+			ici.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+			VK_CHECK(vkCreateImage(device, &ici, nullptr, &target.Image));
+
+			// Like the depth attachments, they come and go with the swapchain
+			target.Memory = GpuAllocator::AllocateImage(target.Image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+
+			VkImageViewCreateInfo iv{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+			iv.image = target.Image;
+			iv.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			iv.format = m_Format;
+			iv.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			iv.subresourceRange.levelCount = 1;
+			iv.subresourceRange.layerCount = 1;
+			VK_CHECK(vkCreateImageView(device, &iv, nullptr, &target.View));
+
+			target.Set = AllocateDescriptorSet(m_SetLayout);
+			VkDescriptorImageInfo imageInfo{ m_Sampler, target.View, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			VkWriteDescriptorSet write{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+			write.dstSet = target.Set;
+			write.dstBinding = 0;
+			write.descriptorCount = 1;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			write.pImageInfo = &imageInfo;
+			vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+			VkFramebufferCreateInfo fbi{ VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
+			fbi.renderPass = m_RenderPass;
+			fbi.attachmentCount = 1;
+			fbi.pAttachments = &outputViews[i];
+			fbi.width = width;
+			fbi.height = height;
+			fbi.layers = 1;
+			VK_CHECK(vkCreateFramebuffer(device, &fbi, nullptr, &target.Output));
+		}
+	}
+
+	void Upscaler::RetireTargets()
+	{
+		for (const Target& target : m_Targets)
+		{
+			DeletionQueue::ReleaseFramebuffer(target.Output);
+			DeletionQueue::ReleaseDescriptorSet(target.Set);
+			DeletionQueue::ReleaseImageView(target.View);
+			DeletionQueue::ReleaseImage(target.Image, target.Memory);
+		}
+
+		m_Targets.clear();
+		m_Width = m_Height = 0;
+	}
+
+	void Upscaler::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t renderedWidth, uint32_t renderedHeight)
+	{
+		const Target& target = m_Targets[frameIndex];
+
+		// The scene pass's color writes land before they are sampled
+		VkImageMemoryBarrier barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+		barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = target.Image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkRenderPassBeginInfo rp{ VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
+		rp.renderPass = m_RenderPass;
+		rp.framebuffer = target.Output;
+		rp.renderArea.extent = { m_Width, m_Height };
+		vkCmdBeginRenderPass(commandBuffer, &rp, VK_SUBPASS_CONTENTS_INLINE);
+
+		VkViewport vp{ 0.0f, 0.0f, (float)m_Width, (float)m_Height, 0.0f, 1.0f };
+		VkRect2D sc{ { 0, 0 }, { m_Width, m_Height } };
+		vkCmdSetViewport(commandBuffer, 0, 1, &vp);
+		vkCmdSetScissor(commandBuffer, 0, 1, &sc);
+
+		UpscalePushConstants push;
+		push.UVScale[0] = (float)renderedWidth / m_Width;
+		push.UVScale[1] = (float)renderedHeight / m_Height;
+		push.UVMax[0] = (renderedWidth - 0.5f) / m_Width;
+		push.UVMax[1] = (renderedHeight - 0.5f) / m_Height;
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &target.Set, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push), &push);
+		vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "GpuAllocator.h"
+#include "Vulkan.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Cubed {
+
+	//
+	// Upscaler - the scene's own color images, one per output image, for
+	// rendering below the output resolution, and a pass that stretches the
+	// rendered top-left corner of one over its whole output image with a
+	// bilinear filter. The scene images are as big as the output, so changing
+	// the scale is just a smaller viewport and nothing is reallocated.
+	//
+	// The scene images share the output's format, so the scene render pass
+	// works with either and the renderer can still draw straight into the
+	// output when rendering at full size.
+	//
+	class Upscaler
+	{
+	public:
+		// The shaders are only needed until Init returns; false when the format can't be both rendered to and sampled
+		bool Init(VkShaderModule vertexShader, VkShaderModule fragmentShader, VkPipelineCache cache, VkFormat format);
+		// Everything, targets included, goes once the frames in flight are done with it
+		void Retire();
+
+		bool IsSupported() const { return m_Pipeline != VK_NULL_HANDLE; }
+		VkFormat GetFormat() const { return m_Format; }
+
+		void CreateTargets(uint32_t width, uint32_t height, const std::vector<VkImageView>& outputViews);
+		// Freed once the frames in flight are done with them
+		void RetireTargets();
+		bool HasTargets() const { return !m_Targets.empty(); }
+		VkImageView GetSceneView(uint32_t frameIndex) const { return m_Targets[frameIndex].View; }
+
+		// Call outside a render pass once the scene pass has left the scene image in
+		// COLOR_ATTACHMENT_OPTIMAL; leaves the output image in COLOR_ATTACHMENT_OPTIMAL
+		void Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t renderedWidth, uint32_t renderedHeight);
+	private:
+		struct Target
+		{
+			VkImage Image = VK_NULL_HANDLE;
+			GpuAllocation Memory;
+			VkImageView View = VK_NULL_HANDLE;
+			VkDescriptorSet Set = VK_NULL_HANDLE;         // the scene image, sampled
+			VkFramebuffer Output = VK_NULL_HANDLE;        // the output view this one is upscaled into
+		};
+
+		VkFormat m_Format = VK_FORMAT_UNDEFINED;
+		VkRenderPass m_RenderPass = VK_NULL_HANDLE;
+		VkPipeline m_Pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+		VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE;
+		VkSampler m_Sampler = VK_NULL_HANDLE;
+
+		uint32_t m_Width = 0, m_Height = 0;
+		std::vector<Target> m_Targets;
+	};
+
+}
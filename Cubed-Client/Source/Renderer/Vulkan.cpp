@@ -1,4 +1,9 @@
 #include "Vulkan.h"
+#include "DeletionQueue.h"
+
+#ifndef WL_HEADLESS
+#include "Walnut/Application.h"
+#endif
 
 namespace vkb {
 	const std::string to_string(VkResult result)
@@ -46,19 +51,97 @@ namespace vkb {
 }
 
 namespace Cubed {
+
+#ifndef WL_HEADLESS
+	namespace {
+
+		// Walnut's Application, which enables none of the optional features
+		class WalnutHost : public VulkanHost
+		{
+		public:
+			ImGui_ImplVulkan_InitInfo* GetInfo() override
+			{
+				return ImGui::GetCurrentContext() ? (ImGui_ImplVulkan_InitInfo*)ImGui::GetIO().BackendRendererUserData : NULL;
+			}
+
+			VkDescriptorSet AllocateDescriptorSet(VkDescriptorSetLayout layout) override { return Walnut::Application::AllocateDescriptorSet(layout); }
+			VkDescriptorPool GetDescriptorPool() override { return Walnut::Application::GetDescriptorPool(); }
+			const VulkanFeatures& GetEnabledFeatures() override { return m_Features; }
+			VkCommandBuffer GetCommandBuffer() override { return Walnut::Application::GetCommandBuffer(true); }
+			void FlushCommandBuffer(VkCommandBuffer commandBuffer) override { Walnut::Application::FlushCommandBuffer(commandBuffer); }
+		private:
+			VulkanFeatures m_Features;
+		};
+
+		WalnutHost s_WalnutHost;
+
+	}
+
+	static VulkanHost* const s_DefaultHost = &s_WalnutHost;
+#else
+	// No Application to fall back on, a host has to be installed
+	static VulkanHost* const s_DefaultHost = nullptr;
+#endif
+
+	static VulkanHost* s_Host = s_DefaultHost;
+
+	void SetVulkanHost(VulkanHost* host)
+	{
+		s_Host = host ? host : s_DefaultHost;
+	}
+
 	ImGui_ImplVulkan_InitInfo* GetVulkanInfo()
 	{
-		return ImGui::GetCurrentContext() ? (ImGui_ImplVulkan_InitInfo*)ImGui::GetIO().BackendRendererUserData : NULL;
+		return s_Host ? s_Host->GetInfo() : nullptr;
+	}
+
+	const VkPhysicalDeviceMemoryProperties& GetVulkanMemoryProperties()
+	{
+		static VkPhysicalDeviceMemoryProperties s_Properties = []()
+		{
+			VkPhysicalDeviceMemoryProperties properties;
+			vkGetPhysicalDeviceMemoryProperties(Cubed::GetVulkanInfo()->PhysicalDevice, &properties);
+			return properties;
+		}();
+		return s_Properties;
 	}
 
 	uint32_t GetVulkanMemoryType(VkMemoryPropertyFlags properties, uint32_t type_bits)
 	{
-		VkPhysicalDevice physicalDevice = Cubed::GetVulkanInfo()->PhysicalDevice;
-		VkPhysicalDeviceMemoryProperties prop;
-		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &prop);
+		const VkPhysicalDeviceMemoryProperties& prop = GetVulkanMemoryProperties();
 		for (uint32_t i = 0; i < prop.memoryTypeCount; i++)
 			if ((prop.memoryTypes[i].propertyFlags & properties) == properties && type_bits & (1 << i))
 				return i;
 		return 0xFFFFFFFF; // Unable to find memoryType
 	}
-}
\ No newline at end of file
+
+	const VulkanFeatures& GetEnabledVulkanFeatures()
+	{
+		return s_Host->GetEnabledFeatures();
+	}
+
+	VkDescriptorSet AllocateDescriptorSet(VkDescriptorSetLayout layout)
+	{
+		return s_Host->AllocateDescriptorSet(layout);
+	}
+
+	VkDescriptorPool GetDescriptorPool()
+	{
+		return s_Host->GetDescriptorPool();
+	}
+
+	VkCommandBuffer GetCommandBuffer()
+	{
+		return s_Host->GetCommandBuffer();
+	}
+
+	void FlushCommandBuffer(VkCommandBuffer commandBuffer)
+	{
+		s_Host->FlushCommandBuffer(commandBuffer);
+	}
+
+	void SubmitResourceFree(std::function<void()>&& func)
+	{
+		DeletionQueue::Submit(std::move(func));
+	}
+}
@@ -2,6 +2,7 @@
 
 #include <backends/imgui_impl_vulkan.h>
 #include <vulkan/vulkan.h>
+#include <functional>
 #include <iostream>
 #include <string>
 
@@ -12,8 +13,53 @@ namespace vkb {
 }
 
 namespace Cubed {
+
+	// What the device was created with. A feature the GPU supports but the
+	// device didn't enable can't be used.
+	struct VulkanFeatures
+	{
+		VkPhysicalDeviceFeatures Core{};
+		VkPhysicalDeviceDescriptorIndexingFeatures DescriptorIndexing{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES };
+	};
+
+	//
+	// VulkanHost - whoever owns the device and runs the frame loop. That is
+	// Walnut's Application unless another host is installed, e.g. a
+	// HeadlessDevice rendering offscreen with no window or swapchain.
+	// Headless builds (WL_HEADLESS) leave Walnut's Application out, so they
+	// have to install a host before using anything here.
+	//
+	class VulkanHost
+	{
+	public:
+		virtual ~VulkanHost() = default;
+
+		virtual ImGui_ImplVulkan_InitInfo* GetInfo() = 0;
+		virtual VkDescriptorSet AllocateDescriptorSet(VkDescriptorSetLayout layout) = 0;
+		virtual VkDescriptorPool GetDescriptorPool() = 0;
+		virtual const VulkanFeatures& GetEnabledFeatures() = 0;
+		// One-time commands, submitted and waited for by FlushCommandBuffer
+		virtual VkCommandBuffer GetCommandBuffer() = 0;
+		virtual void FlushCommandBuffer(VkCommandBuffer commandBuffer) = 0;
+	};
+
+	// nullptr goes back to Walnut's Application, or to none in headless builds
+	void SetVulkanHost(VulkanHost* host);
+
 	ImGui_ImplVulkan_InitInfo* GetVulkanInfo();
+	// Queried once, the physical device doesn't change
+	const VkPhysicalDeviceMemoryProperties& GetVulkanMemoryProperties();
 	uint32_t GetVulkanMemoryType(VkMemoryPropertyFlags properties, uint32_t type_bits);
+	const VulkanFeatures& GetEnabledVulkanFeatures();
+
+	// Forwarded to the current host
+	VkDescriptorSet AllocateDescriptorSet(VkDescriptorSetLayout layout);
+	VkDescriptorPool GetDescriptorPool();
+	VkCommandBuffer GetCommandBuffer();
+	void FlushCommandBuffer(VkCommandBuffer commandBuffer);
+
+	// Runs once the frames in flight can no longer be using what it frees, see DeletionQueue
+	void SubmitResourceFree(std::function<void()>&& func);
 }
 
 #define VK_CHECK(x)                                                                    \
@@ -16,6 +16,7 @@ std::string_view PacketTypeToString(PacketType type)
 		case PacketType::MessageHistory:           return "PacketType::MessageHistory";
 		case PacketType::ServerShutdown:           return "PacketType::ServerShutdown";
 		case PacketType::ClientKick:               return "PacketType::ClientKick";
+		case PacketType::PlayerPosition:           return "PacketType::PlayerPosition";
 
 		default: return "PacketType::<Invalid>";
 	}
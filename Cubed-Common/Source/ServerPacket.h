@@ -112,6 +112,15 @@ enum class PacketType : uint16_t
 	// User has been kicked from server
 	// 1. String reason, could be empty string
 	ClientKick = 11,
+
+	// 
+	// -- PlayerPosition --
+	// 
+	// [Server->Client]
+	// Where the server has the receiving client's player: its spawn, or a
+	// requested position after the server resolved it differently
+	// 1. glm::vec3 position
+	PlayerPosition = 12,
 };
 
 std::string_view PacketTypeToString(PacketType type);
\ No newline at end of file
@@ -0,0 +1,26 @@
+#include "Block.h"
+
+namespace Cubed {
+
+	static const BlockInfo s_BlockInfo[(size_t)Block::Count] =
+	{
+		//  Solid  Opaque  Emission
+		{ false, false, 0  }, // Air
+		{ true,  true,  0  }, // Stone
+		{ true,  true,  0  }, // Dirt
+		{ true,  true,  0  }, // Grass
+		{ true,  true,  0  }, // Sand
+		{ false, false, 0  }, // Water
+		{ true,  true,  0  }, // Wood
+		{ true,  false, 0  }, // Leaves
+		{ true,  true,  15 }, // Glowstone
+	};
+
+	const BlockInfo& GetBlockInfo(Block block)
+	{
+		if ((size_t)block >= (size_t)Block::Count)
+			return s_BlockInfo[0];
+		return s_BlockInfo[(size_t)block];
+	}
+
+}
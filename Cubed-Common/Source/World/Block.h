@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Cubed {
+
+	enum class Block : uint8_t
+	{
+		Air = 0,
+		Stone,
+		Dirt,
+		Grass,
+		Sand,
+		Water,
+		Wood,
+		Leaves,
+		Glowstone,
+
+		Count
+	};
+
+	struct BlockInfo
+	{
+		bool Solid = false;    // participates in collision
+		bool Opaque = false;   // blocks light and hides neighbouring faces
+		uint8_t Emission = 0;  // block light emitted, 0..15
+	};
+
+	const BlockInfo& GetBlockInfo(Block block);
+
+	inline bool IsSolid(Block block) { return GetBlockInfo(block).Solid; }
+	inline bool IsOpaque(Block block) { return GetBlockInfo(block).Opaque; }
+
+}
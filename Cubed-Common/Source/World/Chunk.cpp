@@ -0,0 +1,12 @@
+#include "Chunk.h"
+
+namespace Cubed {
+
+	Chunk::Chunk(ChunkCoord coord)
+		: m_Coord(coord)
+	{
+		m_Blocks.fill(Block::Air);
+		m_Light.fill(0);
+	}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Block.h"
+
+#include <array>
+#include <functional>
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+
+namespace Cubed {
+
+	// Chunks are full-height columns: CHUNK_SIZE x CHUNK_HEIGHT x CHUNK_SIZE blocks.
+	static constexpr int CHUNK_SIZE = 16;
+	static constexpr int CHUNK_HEIGHT = 128;
+	static constexpr int CHUNK_VOLUME = CHUNK_SIZE * CHUNK_SIZE * CHUNK_HEIGHT;
+
+	static constexpr uint8_t MAX_LIGHT_LEVEL = 15;
+
+	struct ChunkCoord
+	{
+		int32_t X = 0;
+		int32_t Z = 0;
+
+		bool operator==(const ChunkCoord& other) const { return X == other.X && Z == other.Z; }
+		bool operator!=(const ChunkCoord& other) const { return !(*this == other); }
+	};
+
+	struct ChunkCoordHash
+	{
+		size_t operator()(const ChunkCoord& coord) const
+		{
+			uint64_t key = ((uint64_t)(uint32_t)coord.X << 32) | (uint32_t)coord.Z;
+			return std::hash<uint64_t>()(key);
+		}
+	};
+
+	class Chunk
+	{
+	public:
+		explicit Chunk(ChunkCoord coord);
+
+		ChunkCoord GetCoord() const { return m_Coord; }
+
+		// Local coordinates, x/z in [0, CHUNK_SIZE), y in [0, CHUNK_HEIGHT)
+		Block GetBlock(int x, int y, int z) const { return m_Blocks[Index(x, y, z)]; }
+		void SetBlock(int x, int y, int z, Block block) { m_Blocks[Index(x, y, z)] = block; }
+
+		const Block* GetBlocks() const { return m_Blocks.data(); }
+		Block* GetBlocks() { return m_Blocks.data(); }
+
+		// Light is packed per block: sky light in the high nibble, block light in the low nibble
+		uint8_t GetSkyLight(int x, int y, int z) const { return m_Light[Index(x, y, z)] >> 4; }
+		uint8_t GetBlockLight(int x, int y, int z) const { return m_Light[Index(x, y, z)] & 0xf; }
+		void SetSkyLight(int x, int y, int z, uint8_t level) { uint8_t& l = m_Light[Index(x, y, z)]; l = (uint8_t)((l & 0x0f) | (level << 4)); }
+		void SetBlockLight(int x, int y, int z, uint8_t level) { uint8_t& l = m_Light[Index(x, y, z)]; l = (uint8_t)((l & 0xf0) | (level & 0xf)); }
+
+		const uint8_t* GetLight() const { return m_Light.data(); }
+		uint8_t* GetLight() { return m_Light.data(); }
+
+		// World-space position of local block (0, 0, 0)
+		glm::ivec3 GetOrigin() const { return { m_Coord.X * CHUNK_SIZE, 0, m_Coord.Z * CHUNK_SIZE }; }
+
+		// x fastest, then z, then y - horizontal layers are contiguous
+		static int Index(int x, int y, int z) { return (y * CHUNK_SIZE + z) * CHUNK_SIZE + x; }
+		static bool InBounds(int x, int y, int z)
+		{
+			return x >= 0 && x < CHUNK_SIZE && z >= 0 && z < CHUNK_SIZE && y >= 0 && y < CHUNK_HEIGHT;
+		}
+	private:
+		ChunkCoord m_Coord;
+		std::array<Block, CHUNK_VOLUME> m_Blocks;
+		std::array<uint8_t, CHUNK_VOLUME> m_Light;
+	};
+
+}
@@ -0,0 +1,336 @@
+#include "ChunkCache.h"
+
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <string>
+
+namespace Cubed {
+
+	namespace {
+
+		// Credits given on insert and on every hit
+		constexpr uint8_t kMaxCredits = 3;
+
+		// Each sweep takes one extra credit per kAgeDistance chunks from the nearest player
+		constexpr int kAgeDistance = 4;
+		constexpr int kMaxAgeDistance = 64;
+
+		constexpr size_t kRawSize = 2 * (size_t)CHUNK_VOLUME;   // blocks followed by light
+
+		int DistanceToNearest(ChunkCoord coord, const std::vector<ChunkCoord>& players)
+		{
+			int nearest = INT_MAX;
+			for (const ChunkCoord& player : players)
+				nearest = std::min(nearest, std::max(std::abs(coord.X - player.X), std::abs(coord.Z - player.Z)));
+			return nearest;
+		}
+
+		void EncodeRuns(const uint8_t* data, size_t size, std::vector<uint8_t>& out)
+		{
+			size_t i = 0;
+			while (i < size)
+			{
+				const uint8_t value = data[i];
+				size_t run = 1;
+				while (i + run < size && run < 256 && data[i + run] == value)
+					++run;
+
+				out.push_back((uint8_t)(run - 1));
+				out.push_back(value);
+				i += run;
+			}
+		}
+
+	}
+
+	ChunkCache::ChunkCache(World& world, const ChunkCacheSettings& settings)
+		: m_World(world), m_Settings(settings)
+	{
+		if (!m_Settings.SpillDirectory.empty())
+		{
+			std::error_code error;
+			std::filesystem::create_directories(m_Settings.SpillDirectory, error);
+
+			// Spill files are only indexed in memory, anything left over is from an older session
+			for (const auto& file : std::filesystem::directory_iterator(m_Settings.SpillDirectory, error))
+				if (file.path().extension() == ".chunk")
+					std::filesystem::remove(file.path(), error);
+		}
+	}
+
+	bool ChunkCache::Acquire(ChunkCoord coord)
+	{
+		if (auto it = m_Resident.find(coord); it != m_Resident.end())
+		{
+			it->second.Credits = kMaxCredits;
+			m_Stats.Hits++;
+			return true;
+		}
+
+		if (Restore(coord))
+		{
+			m_Stats.Restores++;
+			UpdateStats();
+			return true;
+		}
+
+		// Count each chunk once while the caller is off generating it
+		if (m_Missing.insert(coord).second)
+			m_Stats.Misses++;
+		return false;
+	}
+
+	Chunk& ChunkCache::Insert(std::unique_ptr<Chunk> chunk)
+	{
+		ChunkCoord coord = chunk->GetCoord();
+		m_Missing.erase(coord);
+		// A copy that failed to restore is superseded by this one
+		DiscardSpilled(coord);
+		Chunk& result = m_World.AddChunk(std::move(chunk));
+		Track(coord);
+		UpdateStats();
+
+		if (m_ChunkLoadedCallback)
+			m_ChunkLoadedCallback(coord);
+		return result;
+	}
+
+	void ChunkCache::Trim(const std::vector<glm::vec3>& playerPositions)
+	{
+		std::vector<ChunkCoord> players;
+		players.reserve(playerPositions.size());
+		for (const glm::vec3& position : playerPositions)
+			players.push_back(World::ToChunkCoord(position));
+
+		// Misses the callers have stopped streaming in won't be inserted, forget them
+		std::erase_if(m_Missing, [&](ChunkCoord coord) { return DistanceToNearest(coord, players) > m_Settings.PinRadius; });
+
+		size_t pinnedInARow = 0;
+		while (m_Ring.size() * sizeof(Chunk) > m_Settings.ResidentBudget && !m_Ring.empty())
+		{
+			if (m_Hand >= m_Ring.size())
+				m_Hand = 0;
+
+			const ChunkCoord coord = m_Ring[m_Hand];
+			const int distance = DistanceToNearest(coord, players);
+
+			// Everything left is around a player - stay over budget rather than thrash
+			if (distance <= m_Settings.PinRadius)
+			{
+				if (++pinnedInARow >= m_Ring.size())
+					break;
+				m_Hand++;
+				continue;
+			}
+			pinnedInARow = 0;
+
+			ResidentEntry& entry = m_Resident[coord];
+			if (entry.Credits > 0)
+			{
+				int age = 1 + std::min(distance, kMaxAgeDistance) / kAgeDistance;
+				entry.Credits = (uint8_t)std::max(0, (int)entry.Credits - age);
+				m_Hand++;
+				continue;
+			}
+
+			// The last slot is swapped into m_Hand, so the hand stays put
+			Evict(m_Hand);
+		}
+
+		UpdateStats();
+	}
+
+	void ChunkCache::Track(ChunkCoord coord)
+	{
+		auto [it, inserted] = m_Resident.try_emplace(coord, ResidentEntry{ (uint32_t)m_Ring.size(), kMaxCredits });
+		if (!inserted)
+		{
+			it->second.Credits = kMaxCredits;
+			return;
+		}
+		m_Ring.push_back(coord);
+	}
+
+	void ChunkCache::Evict(size_t slot)
+	{
+		const ChunkCoord coord = m_Ring[slot];
+
+		m_Ring[slot] = m_Ring.back();
+		m_Resident[m_Ring[slot]].Slot = (uint32_t)slot;
+		m_Ring.pop_back();
+		m_Resident.erase(coord);
+
+		if (m_ChunkEvictedCallback)
+			m_ChunkEvictedCallback(coord);
+
+		std::unique_ptr<Chunk> chunk = m_World.ExtractChunk(coord);
+		if (!chunk)
+			return;
+
+		m_Scratch.clear();
+		Compress(*chunk, m_Scratch);
+		Spill(coord, std::vector<uint8_t>(m_Scratch.begin(), m_Scratch.end()));
+		m_Stats.Evictions++;
+	}
+
+	void ChunkCache::Spill(ChunkCoord coord, std::vector<uint8_t>&& data)
+	{
+		const uint32_t serial = m_SpillSerial++;
+		m_SpilledBytes += data.size();
+		m_Spilled[coord] = { std::move(data), serial };
+		m_SpillOrder.push_back({ coord, serial });
+
+		// Oldest spills overflow to disk first
+		while (m_SpilledBytes > m_Settings.SpillBudget && !m_SpillOrder.empty())
+		{
+			SpillRecord record = m_SpillOrder.front();
+			m_SpillOrder.pop_front();
+
+			auto it = m_Spilled.find(record.Coord);
+			if (it == m_Spilled.end() || it->second.Serial != record.Serial)
+				continue;
+
+			const std::vector<uint8_t>& spilled = it->second.Data;
+			bool written = false;
+			if (!m_Settings.SpillDirectory.empty())
+			{
+				std::ofstream stream(GetSpillPath(record.Coord), std::ios::binary | std::ios::trunc);
+				stream.write((const char*)spilled.data(), (std::streamsize)spilled.size());
+				written = stream.good();
+			}
+
+			if (written)
+			{
+				m_OnDisk.insert(record.Coord);
+				m_Stats.DiskWrites++;
+			}
+			else
+			{
+				// Terrain is deterministic, so a dropped chunk regenerates - only edits are lost
+				m_Stats.Dropped++;
+			}
+
+			m_SpilledBytes -= spilled.size();
+			m_Spilled.erase(it);
+		}
+	}
+
+	// The stored copy is only let go once it has decoded; one that fails stays
+	// until Insert() replaces it with a regenerated chunk
+	bool ChunkCache::Restore(ChunkCoord coord)
+	{
+		auto chunk = std::make_unique<Chunk>(coord);
+
+		if (auto it = m_Spilled.find(coord); it != m_Spilled.end())
+		{
+			if (!Decompress(it->second.Data.data(), it->second.Data.size(), *chunk))
+				return false;
+			m_SpilledBytes -= it->second.Data.size();
+			m_Spilled.erase(it);
+		}
+		else if (m_OnDisk.contains(coord))
+		{
+			std::filesystem::path path = GetSpillPath(coord);
+			std::error_code error;
+			size_t size = (size_t)std::filesystem::file_size(path, error);
+			if (error)
+				return false;
+
+			m_Scratch.resize(size);
+			{
+				std::ifstream stream(path, std::ios::binary);
+				stream.read((char*)m_Scratch.data(), (std::streamsize)size);
+				if (!stream)
+					return false;
+			}
+			m_Stats.DiskReads++;
+
+			if (!Decompress(m_Scratch.data(), size, *chunk))
+				return false;
+			m_OnDisk.erase(coord);
+			std::filesystem::remove(path, error);
+		}
+		else
+		{
+			return false;
+		}
+
+		m_World.AddChunk(std::move(chunk));
+		Track(coord);
+
+		if (m_ChunkLoadedCallback)
+			m_ChunkLoadedCallback(coord);
+		return true;
+	}
+
+	void ChunkCache::DiscardSpilled(ChunkCoord coord)
+	{
+		if (auto it = m_Spilled.find(coord); it != m_Spilled.end())
+		{
+			m_SpilledBytes -= it->second.Data.size();
+			m_Spilled.erase(it);
+		}
+		if (m_OnDisk.erase(coord))
+		{
+			std::error_code error;
+			std::filesystem::remove(GetSpillPath(coord), error);
+		}
+	}
+
+	void ChunkCache::UpdateStats()
+	{
+		m_Stats.ResidentChunks = m_Ring.size();
+		m_Stats.ResidentBytes = m_Ring.size() * sizeof(Chunk);
+		m_Stats.SpilledChunks = m_Spilled.size();
+		m_Stats.SpilledBytes = m_SpilledBytes;
+		m_Stats.DiskChunks = m_OnDisk.size();
+	}
+
+	std::filesystem::path ChunkCache::GetSpillPath(ChunkCoord coord) const
+	{
+		return m_Settings.SpillDirectory / (std::to_string(coord.X) + "_" + std::to_string(coord.Z) + ".chunk");
+	}
+
+	void ChunkCache::Compress(const Chunk& chunk, std::vector<uint8_t>& out)
+	{
+		// Horizontal layers are contiguous, so layered terrain collapses into long runs
+		EncodeRuns((const uint8_t*)chunk.GetBlocks(), CHUNK_VOLUME, out);
+		EncodeRuns(chunk.GetLight(), CHUNK_VOLUME, out);
+	}
+
+	bool ChunkCache::Decompress(const uint8_t* data, size_t size, Chunk& chunk)
+	{
+		if (size % 2 != 0)
+			return false;
+
+		uint8_t* blocks = (uint8_t*)chunk.GetBlocks();
+		uint8_t* light = chunk.GetLight();
+
+		size_t written = 0;
+		for (size_t i = 0; i < size; i += 2)
+		{
+			const size_t run = (size_t)data[i] + 1;
+			const uint8_t value = data[i + 1];
+			if (written + run > kRawSize)
+				return false;
+
+			for (size_t j = 0; j < run; ++j, ++written)
+			{
+				if (written < CHUNK_VOLUME)
+					blocks[written] = value;
+				else
+					light[written - CHUNK_VOLUME] = value;
+			}
+		}
+
+		if (written != kRawSize)
+			return false;
+
+		for (int i = 0; i < CHUNK_VOLUME; ++i)
+			if (blocks[i] >= (uint8_t)Block::Count)
+				return false;
+		return true;
+	}
+
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "World.h"
+
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+namespace Cubed {
+
+	struct ChunkCacheSettings
+	{
+		size_t ResidentBudget = 256ull * 1024 * 1024;   // uncompressed chunks in the World
+		size_t SpillBudget = 32ull * 1024 * 1024;       // compressed chunks kept in memory
+		std::filesystem::path SpillDirectory;           // overflow of the spill store, empty to drop instead
+		int PinRadius = 2;                              // chunks this close to a player are never evicted
+	};
+
+	struct ChunkCacheStats
+	{
+		uint64_t Hits = 0;        // chunk was already resident
+		uint64_t Misses = 0;      // chunk is unknown and has to be generated, counted once per chunk
+		uint64_t Restores = 0;    // chunk came back from the spill store or disk
+		uint64_t Evictions = 0;
+		uint64_t DiskWrites = 0;
+		uint64_t DiskReads = 0;
+		uint64_t Dropped = 0;     // spilled chunks discarded with no spill directory set
+
+		size_t ResidentChunks = 0;
+		size_t ResidentBytes = 0;
+		size_t SpilledChunks = 0;
+		size_t SpilledBytes = 0;
+		size_t DiskChunks = 0;
+	};
+
+	//
+	// ChunkCache - keeps the chunks resident in a World under a memory budget.
+	// Eviction is a clock sweep in which chunks age faster the further they
+	// are from the nearest player. Evicted chunks are RLE-compressed into an
+	// in-memory spill store, which in turn overflows to disk.
+	//
+	class ChunkCache
+	{
+	public:
+		explicit ChunkCache(World& world, const ChunkCacheSettings& settings = {});
+
+		// Makes the chunk resident if the cache has seen it before. Returns
+		// false on a miss, in which case the caller generates it and Insert()s it.
+		bool Acquire(ChunkCoord coord);
+		Chunk& Insert(std::unique_ptr<Chunk> chunk);
+
+		// Evicts until resident memory fits the budget again. Misses further than
+		// PinRadius from every player are forgotten, the callers stream no further.
+		void Trim(const std::vector<glm::vec3>& playerPositions);
+
+		// Loaded fires for both Insert() and restores, evicted just before the chunk leaves the World
+		using ChunkCallback = std::function<void(ChunkCoord)>;
+		void SetChunkLoadedCallback(const ChunkCallback& callback) { m_ChunkLoadedCallback = callback; }
+		void SetChunkEvictedCallback(const ChunkCallback& callback) { m_ChunkEvictedCallback = callback; }
+
+		const ChunkCacheSettings& GetSettings() const { return m_Settings; }
+		const ChunkCacheStats& GetStats() const { return m_Stats; }
+
+		static void Compress(const Chunk& chunk, std::vector<uint8_t>& out);
+		static bool Decompress(const uint8_t* data, size_t size, Chunk& chunk);
+	private:
+		struct ResidentEntry
+		{
+			uint32_t Slot;      // index into m_Ring
+			uint8_t Credits;    // sweeps left before eviction
+		};
+
+		struct SpilledEntry
+		{
+			std::vector<uint8_t> Data;
+			uint32_t Serial;    // matches the newest m_SpillOrder record for this chunk
+		};
+
+		struct SpillRecord
+		{
+			ChunkCoord Coord;
+			uint32_t Serial;
+		};
+
+		void Track(ChunkCoord coord);
+		void Evict(size_t slot);
+		void Spill(ChunkCoord coord, std::vector<uint8_t>&& data);
+		bool Restore(ChunkCoord coord);
+		void DiscardSpilled(ChunkCoord coord);
+		void UpdateStats();
+
+		std::filesystem::path GetSpillPath(ChunkCoord coord) const;
+	private:
+		World& m_World;
+		ChunkCacheSettings m_Settings;
+		ChunkCacheStats m_Stats;
+
+		std::vector<ChunkCoord> m_Ring;
+		std::unordered_map<ChunkCoord, ResidentEntry, ChunkCoordHash> m_Resident;
+		size_t m_Hand = 0;
+
+		std::unordered_map<ChunkCoord, SpilledEntry, ChunkCoordHash> m_Spilled;
+		std::deque<SpillRecord> m_SpillOrder;
+		uint32_t m_SpillSerial = 0;
+		size_t m_SpilledBytes = 0;
+
+		std::unordered_set<ChunkCoord, ChunkCoordHash> m_OnDisk;
+		std::unordered_set<ChunkCoord, ChunkCoordHash> m_Missing;
+
+		std::vector<uint8_t> m_Scratch;
+
+		ChunkCallback m_ChunkLoadedCallback;
+		ChunkCallback m_ChunkEvictedCallback;
+	};
+
+}
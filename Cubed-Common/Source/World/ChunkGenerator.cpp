@@ -0,0 +1,114 @@
+#include "ChunkGenerator.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace Cubed {
+
+	ChunkGenerator::ChunkGenerator(uint32_t seed, uint32_t threadCount)
+		: m_Terrain(seed)
+	{
+		if (threadCount == 0)
+		{
+			uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		m_Workers.reserve(threadCount);
+		for (uint32_t i = 0; i < threadCount; ++i)
+			m_Workers.emplace_back([this]() { WorkerThreadFunc(); });
+	}
+
+	ChunkGenerator::~ChunkGenerator()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Running = false;
+		}
+		m_Condition.notify_all();
+
+		for (auto& worker : m_Workers)
+			worker.join();
+	}
+
+	void ChunkGenerator::Request(ChunkCoord coord)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (!m_Pending.insert(coord).second)
+				return;
+			m_Queue.push_back(coord);
+		}
+		m_Condition.notify_one();
+	}
+
+	void ChunkGenerator::Collect(std::vector<std::unique_ptr<Chunk>>& out)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (auto& chunk : m_Completed)
+		{
+			m_Pending.erase(chunk->GetCoord());
+			out.push_back(std::move(chunk));
+		}
+		m_Completed.clear();
+	}
+
+	size_t ChunkGenerator::GetPendingCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Pending.size();
+	}
+
+	void ChunkGenerator::WorkerThreadFunc()
+	{
+		while (true)
+		{
+			ChunkCoord coord;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Condition.wait(lock, [this]() { return !m_Running || !m_Queue.empty(); });
+				if (!m_Running)
+					return;
+
+				coord = m_Queue.front();
+				m_Queue.pop_front();
+			}
+
+			auto chunk = std::make_unique<Chunk>(coord);
+			m_Terrain.Generate(*chunk);
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Completed.push_back(std::move(chunk));
+		}
+	}
+
+	GenerationBenchmark ChunkGenerator::RunBenchmark(uint32_t seed, int radius, uint32_t threadCount)
+	{
+		GenerationBenchmark result;
+
+		ChunkGenerator generator(seed, threadCount);
+		result.Threads = generator.GetThreadCount();
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (int z = -radius; z <= radius; ++z)
+			for (int x = -radius; x <= radius; ++x)
+				generator.Request({ x, z });
+
+		const uint32_t total = (uint32_t)((2 * radius + 1) * (2 * radius + 1));
+		std::vector<std::unique_ptr<Chunk>> chunks;
+		chunks.reserve(total);
+		while (chunks.size() < total)
+		{
+			generator.Collect(chunks);
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+
+		result.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		result.Chunks = total;
+		result.ChunksPerSecond = result.Seconds > 0.0 ? total / result.Seconds : 0.0;
+		result.ChunksPerSecondPerCore = result.ChunksPerSecond / std::max(1u, result.Threads);
+		return result;
+	}
+
+}
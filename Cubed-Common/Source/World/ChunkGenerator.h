@@ -0,0 +1,64 @@
+#pragma once
+
+#include "TerrainGenerator.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace Cubed {
+
+	struct GenerationBenchmark
+	{
+		uint32_t Chunks = 0;
+		uint32_t Threads = 0;
+		double Seconds = 0.0;
+		double ChunksPerSecond = 0.0;
+		double ChunksPerSecondPerCore = 0.0;
+	};
+
+	//
+	// ChunkGenerator - runs TerrainGenerator on a pool of worker threads.
+	// Request() from the owning thread, then Collect() finished chunks and add
+	// them to the World from that same thread.
+	//
+	class ChunkGenerator
+	{
+	public:
+		// threadCount = 0 uses every hardware thread but one
+		explicit ChunkGenerator(uint32_t seed = DEFAULT_WORLD_SEED, uint32_t threadCount = 0);
+		~ChunkGenerator();
+
+		ChunkGenerator(const ChunkGenerator&) = delete;
+		ChunkGenerator& operator=(const ChunkGenerator&) = delete;
+
+		// Ignored if the chunk is already queued, generating or waiting to be collected
+		void Request(ChunkCoord coord);
+		void Collect(std::vector<std::unique_ptr<Chunk>>& out);
+
+		size_t GetPendingCount() const;
+		uint32_t GetThreadCount() const { return (uint32_t)m_Workers.size(); }
+		const TerrainGenerator& GetTerrain() const { return m_Terrain; }
+
+		// Generates every chunk within radius of the origin and blocks until done
+		static GenerationBenchmark RunBenchmark(uint32_t seed, int radius, uint32_t threadCount = 0);
+	private:
+		void WorkerThreadFunc();
+	private:
+		TerrainGenerator m_Terrain;
+
+		std::vector<std::thread> m_Workers;
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		bool m_Running = true;
+
+		std::deque<ChunkCoord> m_Queue;
+		std::unordered_set<ChunkCoord, ChunkCoordHash> m_Pending;
+		std::vector<std::unique_ptr<Chunk>> m_Completed;
+	};
+
+}
@@ -0,0 +1,338 @@
+#include "LightEngine.h"
+
+#include <algorithm>
+
+namespace Cubed {
+
+	namespace {
+
+		constexpr int kColumns = CHUNK_SIZE * CHUNK_SIZE;
+
+		const glm::ivec3 kFaceOffsets[6] = {
+			{ 1, 0, 0 }, { -1, 0, 0 },
+			{ 0, 1, 0 }, { 0, -1, 0 },
+			{ 0, 0, 1 }, { 0, 0, -1 }
+		};
+		constexpr int kFaceDown = 3;
+
+		uint8_t ReadLight(uint8_t packed, LightChannel channel)
+		{
+			return channel == LightChannel::Sky ? (uint8_t)(packed >> 4) : (uint8_t)(packed & 0xf);
+		}
+
+		void WriteLight(uint8_t& packed, LightChannel channel, uint8_t level)
+		{
+			if (channel == LightChannel::Sky)
+				packed = (uint8_t)((packed & 0x0f) | (level << 4));
+			else
+				packed = (uint8_t)((packed & 0xf0) | (level & 0xf));
+		}
+
+		//
+		// Resolves world positions to (chunk, index), caching the last chunk so the
+		// flood fill only hits the hash map when it crosses a chunk border.
+		//
+		class LightCursor
+		{
+		public:
+			explicit LightCursor(World& world)
+				: m_World(world) {}
+
+			bool Seek(const glm::ivec3& position, Chunk*& chunk, int& index)
+			{
+				if (position.y < 0 || position.y >= CHUNK_HEIGHT)
+					return false;
+
+				ChunkCoord coord{ FloorDiv(position.x, CHUNK_SIZE), FloorDiv(position.z, CHUNK_SIZE) };
+				if (!m_HasChunk || coord != m_Coord)
+				{
+					m_Chunk = m_World.GetChunk(coord);
+					m_Coord = coord;
+					m_HasChunk = true;
+				}
+
+				if (!m_Chunk)
+					return false;
+
+				chunk = m_Chunk;
+				index = Chunk::Index(FloorMod(position.x, CHUNK_SIZE), position.y, FloorMod(position.z, CHUNK_SIZE));
+				return true;
+			}
+		private:
+			World& m_World;
+			Chunk* m_Chunk = nullptr;
+			ChunkCoord m_Coord;
+			bool m_HasChunk = false;
+		};
+
+	}
+
+	LightEngine::LightEngine(World& world)
+		: m_World(world)
+	{
+	}
+
+	void LightEngine::LightChunk(ChunkCoord coord)
+	{
+		Chunk* chunk = m_World.GetChunk(coord);
+		if (!chunk)
+			return;
+
+		const Block* blocks = chunk->GetBlocks();
+		uint8_t* light = chunk->GetLight();
+		std::fill(light, light + CHUNK_VOLUME, (uint8_t)0);
+
+		const glm::ivec3 origin = chunk->GetOrigin();
+		static const ChunkCoord kNeighbours[4] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+
+		// Sky light - columns are lit top down until the first opaque block,
+		// then spread sideways only below the lowest lit cell of a neighbouring column
+		int top[kColumns];
+		for (int z = 0; z < CHUNK_SIZE; ++z)
+		{
+			for (int x = 0; x < CHUNK_SIZE; ++x)
+			{
+				int y = CHUNK_HEIGHT - 1;
+				for (; y >= 0 && !IsOpaque(blocks[Chunk::Index(x, y, z)]); --y)
+					WriteLight(light[Chunk::Index(x, y, z)], LightChannel::Sky, MAX_LIGHT_LEVEL);
+				top[z * CHUNK_SIZE + x] = y + 1;
+			}
+		}
+
+		for (int z = 0; z < CHUNK_SIZE; ++z)
+		{
+			for (int x = 0; x < CHUNK_SIZE; ++x)
+			{
+				const int columnTop = top[z * CHUNK_SIZE + x];
+				int reach = columnTop;
+				if (x > 0)              reach = std::max(reach, top[z * CHUNK_SIZE + x - 1]);
+				if (x < CHUNK_SIZE - 1) reach = std::max(reach, top[z * CHUNK_SIZE + x + 1]);
+				if (z > 0)              reach = std::max(reach, top[(z - 1) * CHUNK_SIZE + x]);
+				if (z < CHUNK_SIZE - 1) reach = std::max(reach, top[(z + 1) * CHUNK_SIZE + x]);
+
+				for (int y = columnTop; y < reach; ++y)
+					m_AddQueue.push_back(origin + glm::ivec3(x, y, z));
+			}
+		}
+
+		for (const ChunkCoord& offset : kNeighbours)
+			PushBorder(LightChannel::Sky, *chunk, { coord.X + offset.X, coord.Z + offset.Z });
+		PropagateAdd(LightChannel::Sky);
+
+		// Block light - seeded from every emitter
+		for (int y = 0; y < CHUNK_HEIGHT; ++y)
+		{
+			for (int z = 0; z < CHUNK_SIZE; ++z)
+			{
+				for (int x = 0; x < CHUNK_SIZE; ++x)
+				{
+					const int index = Chunk::Index(x, y, z);
+					uint8_t emission = GetBlockInfo(blocks[index]).Emission;
+					if (emission == 0)
+						continue;
+
+					WriteLight(light[index], LightChannel::Block, emission);
+					m_AddQueue.push_back(origin + glm::ivec3(x, y, z));
+				}
+			}
+		}
+
+		for (const ChunkCoord& offset : kNeighbours)
+			PushBorder(LightChannel::Block, *chunk, { coord.X + offset.X, coord.Z + offset.Z });
+		PropagateAdd(LightChannel::Block);
+	}
+
+	void LightEngine::OnBlockChanged(const glm::ivec3& position)
+	{
+		LightCursor cursor(m_World);
+		Chunk* chunk;
+		int index;
+		if (!cursor.Seek(position, chunk, index))
+			return;
+
+		const BlockInfo& info = GetBlockInfo(chunk->GetBlocks()[index]);
+		uint8_t& packed = chunk->GetLight()[index];
+
+		for (LightChannel channel : { LightChannel::Sky, LightChannel::Block })
+		{
+			// Take out whatever light passed through the old block, then let the
+			// new block's emission and the surrounding light flow back in
+			uint8_t level = ReadLight(packed, channel);
+			if (level > 0)
+			{
+				WriteLight(packed, channel, 0);
+				m_RemoveQueue.push_back({ position, level });
+			}
+
+			if (channel == LightChannel::Block && info.Emission > 0)
+			{
+				WriteLight(packed, channel, info.Emission);
+				m_AddQueue.push_back(position);
+			}
+
+			if (!info.Opaque)
+			{
+				for (const glm::ivec3& offset : kFaceOffsets)
+					m_AddQueue.push_back(position + offset);
+
+				if (channel == LightChannel::Sky && position.y == CHUNK_HEIGHT - 1)
+				{
+					WriteLight(packed, channel, MAX_LIGHT_LEVEL);
+					m_AddQueue.push_back(position);
+				}
+			}
+
+			PropagateRemove(channel);
+			PropagateAdd(channel);
+		}
+	}
+
+	bool LightEngine::SetBlock(const glm::ivec3& position, Block block)
+	{
+		if (!m_World.SetBlock(position, block))
+			return false;
+
+		OnBlockChanged(position);
+		return true;
+	}
+
+	uint8_t LightEngine::GetLight(LightChannel channel, const glm::ivec3& position) const
+	{
+		if (position.y >= CHUNK_HEIGHT)
+			return channel == LightChannel::Sky ? MAX_LIGHT_LEVEL : 0;
+		if (position.y < 0)
+			return 0;
+
+		const Chunk* chunk = m_World.GetChunk(World::ToChunkCoord(position));
+		if (!chunk)
+			return 0;
+
+		glm::ivec3 local = World::ToLocal(position);
+		return ReadLight(chunk->GetLight()[Chunk::Index(local.x, local.y, local.z)], channel);
+	}
+
+	void LightEngine::PropagateAdd(LightChannel channel)
+	{
+		LightCursor cursor(m_World);
+
+		for (size_t head = 0; head < m_AddQueue.size(); ++head)
+		{
+			const glm::ivec3 position = m_AddQueue[head];
+
+			Chunk* chunk;
+			int index;
+			if (!cursor.Seek(position, chunk, index))
+				continue;
+
+			// Read the current level rather than the queued one - it may have been raised since
+			const uint8_t level = ReadLight(chunk->GetLight()[index], channel);
+			if (level <= 1)
+				continue;
+
+			for (int face = 0; face < 6; ++face)
+			{
+				const glm::ivec3 neighbour = position + kFaceOffsets[face];
+				if (!cursor.Seek(neighbour, chunk, index))
+					continue;
+				if (IsOpaque(chunk->GetBlocks()[index]))
+					continue;
+
+				const bool skyColumn = channel == LightChannel::Sky && face == kFaceDown && level == MAX_LIGHT_LEVEL;
+				const uint8_t target = skyColumn ? MAX_LIGHT_LEVEL : (uint8_t)(level - 1);
+
+				uint8_t& packed = chunk->GetLight()[index];
+				if (ReadLight(packed, channel) >= target)
+					continue;
+
+				WriteLight(packed, channel, target);
+				m_AddQueue.push_back(neighbour);
+			}
+		}
+
+		m_AddQueue.clear();
+	}
+
+	void LightEngine::PropagateRemove(LightChannel channel)
+	{
+		LightCursor cursor(m_World);
+
+		for (size_t head = 0; head < m_RemoveQueue.size(); ++head)
+		{
+			const RemoveNode node = m_RemoveQueue[head];
+
+			for (int face = 0; face < 6; ++face)
+			{
+				const glm::ivec3 neighbour = node.Position + kFaceOffsets[face];
+
+				Chunk* chunk;
+				int index;
+				if (!cursor.Seek(neighbour, chunk, index))
+					continue;
+
+				uint8_t& packed = chunk->GetLight()[index];
+				const uint8_t level = ReadLight(packed, channel);
+				if (level == 0)
+					continue;
+
+				const bool skyColumn = channel == LightChannel::Sky && face == kFaceDown && node.Level == MAX_LIGHT_LEVEL;
+				if (level < node.Level || (skyColumn && level == MAX_LIGHT_LEVEL))
+				{
+					// Lit (possibly) through the removed node - darken it and keep going
+					WriteLight(packed, channel, 0);
+					m_RemoveQueue.push_back({ neighbour, level });
+
+					if (channel == LightChannel::Block)
+					{
+						uint8_t emission = GetBlockInfo(chunk->GetBlocks()[index]).Emission;
+						if (emission > 0)
+						{
+							WriteLight(packed, channel, emission);
+							m_AddQueue.push_back(neighbour);
+						}
+					}
+				}
+				else
+				{
+					// Independently lit - it will re-fill the darkened area
+					m_AddQueue.push_back(neighbour);
+				}
+			}
+		}
+
+		m_RemoveQueue.clear();
+	}
+
+	void LightEngine::PushBorder(LightChannel channel, const Chunk& chunk, ChunkCoord neighbourCoord)
+	{
+		const Chunk* neighbour = m_World.GetChunk(neighbourCoord);
+		if (!neighbour)
+			return;
+
+		const ChunkCoord coord = chunk.GetCoord();
+		const int dx = neighbourCoord.X - coord.X;
+		const int dz = neighbourCoord.Z - coord.Z;
+
+		// Local coordinate of the shared face on each side
+		const int ours = (dx + dz) > 0 ? CHUNK_SIZE - 1 : 0;
+		const int theirs = CHUNK_SIZE - 1 - ours;
+
+		const glm::ivec3 origin = chunk.GetOrigin();
+		const glm::ivec3 neighbourOrigin = neighbour->GetOrigin();
+
+		for (int y = 0; y < CHUNK_HEIGHT; ++y)
+		{
+			for (int t = 0; t < CHUNK_SIZE; ++t)
+			{
+				glm::ivec3 a = dx != 0 ? glm::ivec3(ours, y, t) : glm::ivec3(t, y, ours);
+				glm::ivec3 b = dx != 0 ? glm::ivec3(theirs, y, t) : glm::ivec3(t, y, theirs);
+
+				// Both directions: light flowing in from the neighbour and out of this chunk
+				if (ReadLight(neighbour->GetLight()[Chunk::Index(b.x, b.y, b.z)], channel) > 1)
+					m_AddQueue.push_back(neighbourOrigin + b);
+				if (ReadLight(chunk.GetLight()[Chunk::Index(a.x, a.y, a.z)], channel) > 1)
+					m_AddQueue.push_back(origin + a);
+			}
+		}
+	}
+
+}
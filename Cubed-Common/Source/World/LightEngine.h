@@ -0,0 +1,58 @@
+#pragma once
+
+#include "World.h"
+
+#include <vector>
+
+namespace Cubed {
+
+	enum class LightChannel : uint8_t
+	{
+		Sky = 0,
+		Block
+	};
+
+	//
+	// LightEngine - flood-fill sky and block light over the chunks of a World.
+	// Sky light enters from the top of the world at full strength and travels
+	// straight down without falloff; everything else loses one level per block.
+	// Light only spreads into loaded chunks; when a neighbour loads later,
+	// LightChunk() exchanges light across the shared border.
+	//
+	class LightEngine
+	{
+	public:
+		explicit LightEngine(World& world);
+
+		// Full relight of a chunk that was just added to the world
+		void LightChunk(ChunkCoord coord);
+
+		// Incremental update after the block at position changed. Only the
+		// affected volume is touched - typically a few hundred blocks at most.
+		void OnBlockChanged(const glm::ivec3& position);
+
+		// World::SetBlock followed by OnBlockChanged
+		bool SetBlock(const glm::ivec3& position, Block block);
+
+		// Out of loaded chunks reads as 0, above the world as full sky light
+		uint8_t GetLight(LightChannel channel, const glm::ivec3& position) const;
+	private:
+		struct RemoveNode
+		{
+			glm::ivec3 Position;
+			uint8_t Level;
+		};
+
+		void PropagateAdd(LightChannel channel);
+		void PropagateRemove(LightChannel channel);
+		void PushBorder(LightChannel channel, const Chunk& chunk, ChunkCoord neighbourCoord);
+	private:
+		World& m_World;
+
+		// Queues are consumed front to back and cleared afterwards, so their
+		// capacity is kept between updates and edits don't allocate.
+		std::vector<glm::ivec3> m_AddQueue;
+		std::vector<RemoveNode> m_RemoveQueue;
+	};
+
+}
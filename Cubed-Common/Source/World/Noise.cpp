@@ -0,0 +1,239 @@
+#include "Noise.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CUBED_NOISE_SSE2 1
+	#include <emmintrin.h>
+#else
+	#define CUBED_NOISE_SSE2 0
+#endif
+
+namespace Cubed {
+
+	namespace {
+
+		constexpr float F2 = 0.366025403784f; // (sqrt(3) - 1) / 2
+		constexpr float G2 = 0.211324865405f; // (3 - sqrt(3)) / 6
+		constexpr float kScale = 45.0f;       // gradients are (+-1, +-2), this maps the output to about [-1, 1]
+
+		constexpr uint32_t kHashX = 0x27d4eb2du;
+		constexpr uint32_t kHashY = 0x165667b1u;
+		constexpr uint32_t kHashMix = 0x2c1b3c6du;
+
+		// Points per fractal pass, keeps the scratch buffers on the stack
+		constexpr size_t kBatchSize = 256;
+
+		uint32_t OctaveSeed(uint32_t seed, int octave) { return seed + (uint32_t)octave * 0x9e3779b9u; }
+
+#if CUBED_NOISE_SSE2
+
+		__m128i MulLo32(__m128i a, __m128i b)
+		{
+			__m128i even = _mm_mul_epu32(a, b);
+			__m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+			return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+		}
+
+		__m128 Floor4(__m128 v)
+		{
+			__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+			return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmplt_ps(v, truncated), _mm_set1_ps(1.0f)));
+		}
+
+		__m128i Hash4(__m128i i, __m128i j, __m128i seed)
+		{
+			__m128i h = _mm_xor_si128(seed, _mm_xor_si128(MulLo32(i, _mm_set1_epi32((int)kHashX)), MulLo32(j, _mm_set1_epi32((int)kHashY))));
+			h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+			h = MulLo32(h, _mm_set1_epi32((int)kHashMix));
+			return _mm_xor_si128(h, _mm_srli_epi32(h, 12));
+		}
+
+		__m128 Corner4(__m128 x, __m128 y, __m128i h)
+		{
+			__m128 t = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(0.5f), _mm_mul_ps(x, x)), _mm_mul_ps(y, y));
+			t = _mm_max_ps(t, _mm_setzero_ps());
+			t = _mm_mul_ps(t, t);
+			t = _mm_mul_ps(t, t);
+
+			// Gradient (+-1, +-2) in one of 8 directions, selected by the low 3 hash bits
+			__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(4)), _mm_set1_epi32(4)));
+			__m128 u = _mm_or_ps(_mm_and_ps(swap, y), _mm_andnot_ps(swap, x));
+			__m128 v = _mm_or_ps(_mm_and_ps(swap, x), _mm_andnot_ps(swap, y));
+			u = _mm_xor_ps(u, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), 31)));
+			v = _mm_mul_ps(v, _mm_set1_ps(2.0f));
+			v = _mm_xor_ps(v, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), 30)));
+
+			return _mm_mul_ps(t, _mm_add_ps(u, v));
+		}
+
+		__m128 Simplex4(__m128 x, __m128 y, __m128i seed)
+		{
+			__m128 s = _mm_mul_ps(_mm_add_ps(x, y), _mm_set1_ps(F2));
+			__m128 fi = Floor4(_mm_add_ps(x, s));
+			__m128 fj = Floor4(_mm_add_ps(y, s));
+			__m128 t = _mm_mul_ps(_mm_add_ps(fi, fj), _mm_set1_ps(G2));
+			__m128 x0 = _mm_sub_ps(x, _mm_sub_ps(fi, t));
+			__m128 y0 = _mm_sub_ps(y, _mm_sub_ps(fj, t));
+
+			__m128 lower = _mm_cmpgt_ps(x0, y0);
+			__m128 i1 = _mm_and_ps(lower, _mm_set1_ps(1.0f));
+			__m128 j1 = _mm_sub_ps(_mm_set1_ps(1.0f), i1);
+
+			__m128 x1 = _mm_add_ps(_mm_sub_ps(x0, i1), _mm_set1_ps(G2));
+			__m128 y1 = _mm_add_ps(_mm_sub_ps(y0, j1), _mm_set1_ps(G2));
+			__m128 x2 = _mm_add_ps(_mm_sub_ps(x0, _mm_set1_ps(1.0f)), _mm_set1_ps(2.0f * G2));
+			__m128 y2 = _mm_add_ps(_mm_sub_ps(y0, _mm_set1_ps(1.0f)), _mm_set1_ps(2.0f * G2));
+
+			__m128i i = _mm_cvttps_epi32(fi);
+			__m128i j = _mm_cvttps_epi32(fj);
+			__m128i ii1 = _mm_cvttps_epi32(i1);
+			__m128i jj1 = _mm_cvttps_epi32(j1);
+			__m128i one = _mm_set1_epi32(1);
+
+			__m128 n = Corner4(x0, y0, Hash4(i, j, seed));
+			n = _mm_add_ps(n, Corner4(x1, y1, Hash4(_mm_add_epi32(i, ii1), _mm_add_epi32(j, jj1), seed)));
+			n = _mm_add_ps(n, Corner4(x2, y2, Hash4(_mm_add_epi32(i, one), _mm_add_epi32(j, one), seed)));
+			return _mm_mul_ps(n, _mm_set1_ps(kScale));
+		}
+
+		void SimplexBatch(const float* xs, const float* ys, float* out, size_t count, uint32_t seed)
+		{
+			const __m128i seed4 = _mm_set1_epi32((int)seed);
+
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+				_mm_storeu_ps(out + i, Simplex4(_mm_loadu_ps(xs + i), _mm_loadu_ps(ys + i), seed4));
+
+			// Tail goes through the same kernel so every point is evaluated identically
+			if (i < count)
+			{
+				float tx[4] = {}, ty[4] = {}, tr[4];
+				for (size_t k = 0; k < count - i; ++k)
+				{
+					tx[k] = xs[i + k];
+					ty[k] = ys[i + k];
+				}
+				_mm_storeu_ps(tr, Simplex4(_mm_loadu_ps(tx), _mm_loadu_ps(ty), seed4));
+				for (size_t k = 0; k < count - i; ++k)
+					out[i + k] = tr[k];
+			}
+		}
+
+#else
+
+		uint32_t Hash(int32_t i, int32_t j, uint32_t seed)
+		{
+			uint32_t h = seed ^ (((uint32_t)i * kHashX) ^ ((uint32_t)j * kHashY));
+			h ^= h >> 15;
+			h *= kHashMix;
+			return h ^ (h >> 12);
+		}
+
+		float Corner(float x, float y, uint32_t h)
+		{
+			float t = 0.5f - x * x - y * y;
+			if (t <= 0.0f)
+				return 0.0f;
+			t *= t;
+			t *= t;
+
+			float u = (h & 4) ? y : x;
+			float v = (h & 4) ? x : y;
+			return t * (((h & 1) ? -u : u) + ((h & 2) ? -2.0f * v : 2.0f * v));
+		}
+
+		float Simplex(float x, float y, uint32_t seed)
+		{
+			float s = (x + y) * F2;
+			float fi = std::floor(x + s);
+			float fj = std::floor(y + s);
+			float t = (fi + fj) * G2;
+			float x0 = x - (fi - t);
+			float y0 = y - (fj - t);
+
+			int i1 = x0 > y0 ? 1 : 0;
+			int j1 = 1 - i1;
+
+			float x1 = x0 - (float)i1 + G2;
+			float y1 = y0 - (float)j1 + G2;
+			float x2 = x0 - 1.0f + 2.0f * G2;
+			float y2 = y0 - 1.0f + 2.0f * G2;
+
+			int i = (int)fi, j = (int)fj;
+			float n = Corner(x0, y0, Hash(i, j, seed));
+			n += Corner(x1, y1, Hash(i + i1, j + j1, seed));
+			n += Corner(x2, y2, Hash(i + 1, j + 1, seed));
+			return n * kScale;
+		}
+
+		void SimplexBatch(const float* xs, const float* ys, float* out, size_t count, uint32_t seed)
+		{
+			for (size_t i = 0; i < count; ++i)
+				out[i] = Simplex(xs[i], ys[i], seed);
+		}
+
+#endif
+
+	}
+
+	float Noise::Simplex2D(float x, float y) const
+	{
+		float result;
+		SimplexBatch(&x, &y, &result, 1, m_Seed);
+		return result;
+	}
+
+	void Noise::Simplex2D(const float* xs, const float* ys, float* out, size_t count) const
+	{
+		SimplexBatch(xs, ys, out, count, m_Seed);
+	}
+
+	float Noise::Fractal2D(float x, float y, const FractalSettings& settings) const
+	{
+		float result;
+		Fractal2D(&x, &y, &result, 1, settings);
+		return result;
+	}
+
+	void Noise::Fractal2D(const float* xs, const float* ys, float* out, size_t count, const FractalSettings& settings) const
+	{
+		float sx[kBatchSize], sy[kBatchSize], octave[kBatchSize];
+
+		for (size_t base = 0; base < count; base += kBatchSize)
+		{
+			const size_t n = std::min(kBatchSize, count - base);
+			std::fill(out + base, out + base + n, 0.0f);
+
+			float frequency = settings.Frequency;
+			float amplitude = 1.0f;
+			float totalAmplitude = 0.0f;
+			for (int o = 0; o < settings.Octaves; ++o)
+			{
+				for (size_t i = 0; i < n; ++i)
+				{
+					sx[i] = xs[base + i] * frequency;
+					sy[i] = ys[base + i] * frequency;
+				}
+
+				SimplexBatch(sx, sy, octave, n, OctaveSeed(m_Seed, o));
+
+				for (size_t i = 0; i < n; ++i)
+					out[base + i] += octave[i] * amplitude;
+
+				totalAmplitude += amplitude;
+				frequency *= settings.Lacunarity;
+				amplitude *= settings.Gain;
+			}
+
+			if (totalAmplitude > 0.0f)
+			{
+				const float inv = 1.0f / totalAmplitude;
+				for (size_t i = 0; i < n; ++i)
+					out[base + i] *= inv;
+			}
+		}
+	}
+
+}
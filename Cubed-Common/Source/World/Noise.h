@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Cubed {
+
+	struct FractalSettings
+	{
+		int Octaves = 4;
+		float Frequency = 1.0f / 128.0f;
+		float Lacunarity = 2.0f;
+		float Gain = 0.5f;
+	};
+
+	//
+	// Noise - seeded 2D simplex noise. Gradients come from an integer hash instead
+	// of a permutation table, so the batch path needs no gathers and runs 4 lanes
+	// at a time with SSE2. Every evaluation (including single points) goes through
+	// the same kernel, so batch and single-point results are bit-identical.
+	//
+	class Noise
+	{
+	public:
+		explicit Noise(uint32_t seed = 0)
+			: m_Seed(seed) {}
+
+		// Roughly in [-1, 1]
+		float Simplex2D(float x, float y) const;
+		void Simplex2D(const float* xs, const float* ys, float* out, size_t count) const;
+
+		// Sum of octaves normalized back to roughly [-1, 1]
+		float Fractal2D(float x, float y, const FractalSettings& settings) const;
+		void Fractal2D(const float* xs, const float* ys, float* out, size_t count, const FractalSettings& settings) const;
+	private:
+		uint32_t m_Seed;
+	};
+
+}
@@ -0,0 +1,242 @@
+#include "TerrainGenerator.h"
+
+#include "World.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Cubed {
+
+	namespace {
+
+		constexpr int kColumns = CHUNK_SIZE * CHUNK_SIZE;
+
+		// One tree candidate per kTreeCell x kTreeCell columns, jittered inside the cell
+		constexpr int kTreeCell = 6;
+		constexpr int kTreeRadius = 2;
+		constexpr int kTreeLine = 88;
+
+		const FractalSettings kContinentSettings   = { 4, 1.0f / 256.0f, 2.0f, 0.5f };
+		const FractalSettings kDetailSettings      = { 3, 1.0f / 64.0f,  2.0f, 0.5f };
+		const FractalSettings kMountainSettings    = { 2, 1.0f / 320.0f, 2.0f, 0.5f };
+		const FractalSettings kTemperatureSettings = { 2, 1.0f / 512.0f, 2.0f, 0.5f };
+		const FractalSettings kMoistureSettings    = { 2, 1.0f / 480.0f, 2.0f, 0.5f };
+
+		uint32_t HashColumn(int x, int z, uint32_t seed)
+		{
+			uint32_t h = seed ^ ((uint32_t)x * 0x8da6b343u) ^ ((uint32_t)z * 0xd8163841u);
+			h ^= h >> 16;
+			h *= 0x7feb352du;
+			h ^= h >> 15;
+			h *= 0x846ca68bu;
+			return h ^ (h >> 16);
+		}
+
+		float SmoothStep(float edge0, float edge1, float x)
+		{
+			float t = std::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+			return t * t * (3.0f - 2.0f * t);
+		}
+
+		uint32_t TreeChance(Biome biome)
+		{
+			switch (biome)
+			{
+				case Biome::Forest:    return 70;
+				case Biome::Plains:    return 12;
+				case Biome::Mountains: return 8;
+				default:               return 0;
+			}
+		}
+
+	}
+
+	TerrainGenerator::TerrainGenerator(uint32_t seed)
+		: m_Seed(seed),
+		m_ContinentNoise(seed),
+		m_DetailNoise(seed ^ 0x5bd1e995u),
+		m_MountainNoise(seed ^ 0x1b873593u),
+		m_TemperatureNoise(seed ^ 0xcc9e2d51u),
+		m_MoistureNoise(seed ^ 0xe6546b64u)
+	{
+	}
+
+	void TerrainGenerator::Generate(Chunk& chunk) const
+	{
+		const glm::ivec3 origin = chunk.GetOrigin();
+
+		float xs[kColumns], zs[kColumns];
+		for (int z = 0; z < CHUNK_SIZE; ++z)
+		{
+			for (int x = 0; x < CHUNK_SIZE; ++x)
+			{
+				xs[z * CHUNK_SIZE + x] = (float)(origin.x + x);
+				zs[z * CHUNK_SIZE + x] = (float)(origin.z + z);
+			}
+		}
+
+		int heights[kColumns];
+		Biome biomes[kColumns];
+		SampleColumns(xs, zs, kColumns, heights, biomes);
+		FillColumns(chunk, heights, biomes);
+		PlaceStructures(chunk);
+	}
+
+	int TerrainGenerator::GetHeight(int worldX, int worldZ) const
+	{
+		float x = (float)worldX, z = (float)worldZ;
+		int height;
+		Biome biome;
+		SampleColumns(&x, &z, 1, &height, &biome);
+		return height;
+	}
+
+	Biome TerrainGenerator::GetBiome(int worldX, int worldZ) const
+	{
+		float x = (float)worldX, z = (float)worldZ;
+		int height;
+		Biome biome;
+		SampleColumns(&x, &z, 1, &height, &biome);
+		return biome;
+	}
+
+	void TerrainGenerator::SampleColumns(const float* xs, const float* zs, size_t count, int* heights, Biome* biomes) const
+	{
+		float continent[kColumns], detail[kColumns], mountain[kColumns], temperature[kColumns], moisture[kColumns];
+
+		for (size_t base = 0; base < count; base += kColumns)
+		{
+			const size_t n = std::min((size_t)kColumns, count - base);
+
+			// Stage 1: noise layers, each evaluated over every column in one batch
+			m_ContinentNoise.Fractal2D(xs + base, zs + base, continent, n, kContinentSettings);
+			m_DetailNoise.Fractal2D(xs + base, zs + base, detail, n, kDetailSettings);
+			m_MountainNoise.Fractal2D(xs + base, zs + base, mountain, n, kMountainSettings);
+			m_TemperatureNoise.Fractal2D(xs + base, zs + base, temperature, n, kTemperatureSettings);
+			m_MoistureNoise.Fractal2D(xs + base, zs + base, moisture, n, kMoistureSettings);
+
+			// Stage 2: biome and surface height
+			for (size_t i = 0; i < n; ++i)
+			{
+				float mountainFactor = SmoothStep(0.15f, 0.55f, mountain[i]);
+				float height = (float)SEA_LEVEL + 2.0f
+					+ continent[i] * 12.0f
+					+ detail[i] * 6.0f
+					+ mountainFactor * (detail[i] * 0.5f + 0.5f) * 36.0f;
+				heights[base + i] = std::clamp((int)std::floor(height), 1, CHUNK_HEIGHT - 16);
+
+				Biome biome = Biome::Plains;
+				if (mountainFactor > 0.5f)
+					biome = Biome::Mountains;
+				else if (temperature[i] > 0.3f && moisture[i] < 0.1f)
+					biome = Biome::Desert;
+				else if (moisture[i] > 0.15f)
+					biome = Biome::Forest;
+				biomes[base + i] = biome;
+			}
+		}
+	}
+
+	void TerrainGenerator::FillColumns(Chunk& chunk, const int* heights, const Biome* biomes) const
+	{
+		Block* blocks = chunk.GetBlocks();
+
+		for (int z = 0; z < CHUNK_SIZE; ++z)
+		{
+			for (int x = 0; x < CHUNK_SIZE; ++x)
+			{
+				const int column = z * CHUNK_SIZE + x;
+				const int height = heights[column];
+				const Biome biome = biomes[column];
+
+				Block surface = Block::Grass;
+				Block subsurface = Block::Dirt;
+				if (biome == Biome::Desert || height <= SEA_LEVEL + 1)
+					surface = subsurface = Block::Sand;
+				else if (biome == Biome::Mountains && height > kTreeLine)
+					surface = subsurface = Block::Stone;
+
+				for (int y = 0; y < CHUNK_HEIGHT; ++y)
+				{
+					Block block = Block::Air;
+					if (y < height - 3)
+						block = Block::Stone;
+					else if (y < height)
+						block = subsurface;
+					else if (y == height)
+						block = surface;
+					else if (y <= SEA_LEVEL)
+						block = Block::Water;
+
+					blocks[Chunk::Index(x, y, z)] = block;
+				}
+			}
+		}
+	}
+
+	void TerrainGenerator::PlaceStructures(Chunk& chunk) const
+	{
+		const glm::ivec3 origin = chunk.GetOrigin();
+		const int minX = origin.x - kTreeRadius, maxX = origin.x + CHUNK_SIZE - 1 + kTreeRadius;
+		const int minZ = origin.z - kTreeRadius, maxZ = origin.z + CHUNK_SIZE - 1 + kTreeRadius;
+
+		for (int cellZ = FloorDiv(minZ, kTreeCell); cellZ <= FloorDiv(maxZ, kTreeCell); ++cellZ)
+		{
+			for (int cellX = FloorDiv(minX, kTreeCell); cellX <= FloorDiv(maxX, kTreeCell); ++cellX)
+			{
+				uint32_t hash = HashColumn(cellX, cellZ, m_Seed);
+				int treeX = cellX * kTreeCell + (int)(hash % kTreeCell);
+				int treeZ = cellZ * kTreeCell + (int)((hash >> 8) % kTreeCell);
+				if (treeX < minX || treeX > maxX || treeZ < minZ || treeZ > maxZ)
+					continue;
+
+				// The origin column may belong to a neighbouring chunk, so sample it directly
+				float x = (float)treeX, z = (float)treeZ;
+				int ground;
+				Biome biome;
+				SampleColumns(&x, &z, 1, &ground, &biome);
+
+				if ((hash >> 16) % 100 >= TreeChance(biome))
+					continue;
+				if (ground <= SEA_LEVEL + 1 || ground > kTreeLine)
+					continue;
+
+				PlaceTree(chunk, treeX, ground + 1, treeZ, hash);
+			}
+		}
+	}
+
+	void TerrainGenerator::PlaceTree(Chunk& chunk, int worldX, int groundY, int worldZ, uint32_t hash) const
+	{
+		const glm::ivec3 origin = chunk.GetOrigin();
+		const int trunkHeight = 4 + (int)((hash >> 24) % 3);
+
+		auto set = [&](int wx, int y, int wz, Block block, bool onlyAir)
+		{
+			int x = wx - origin.x, z = wz - origin.z;
+			if (!Chunk::InBounds(x, y, z))
+				return;
+			if (onlyAir && chunk.GetBlock(x, y, z) != Block::Air)
+				return;
+			chunk.SetBlock(x, y, z, block);
+		};
+
+		for (int dy = trunkHeight - 2; dy <= trunkHeight + 1; ++dy)
+		{
+			int radius = dy >= trunkHeight ? 1 : 2;
+			for (int dz = -radius; dz <= radius; ++dz)
+			{
+				for (int dx = -radius; dx <= radius; ++dx)
+				{
+					if (radius == 2 && std::abs(dx) == 2 && std::abs(dz) == 2)
+						continue;
+					set(worldX + dx, groundY + dy, worldZ + dz, Block::Leaves, true);
+				}
+			}
+		}
+
+		for (int dy = 0; dy < trunkHeight; ++dy)
+			set(worldX, groundY + dy, worldZ, Block::Wood, false);
+	}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Chunk.h"
+#include "Noise.h"
+
+namespace Cubed {
+
+	static constexpr uint32_t DEFAULT_WORLD_SEED = 1337;
+
+	enum class Biome : uint8_t
+	{
+		Plains = 0,
+		Forest,
+		Desert,
+		Mountains,
+	};
+
+	//
+	// TerrainGenerator - deterministic chunk generation from a seed.
+	//
+	// Stages:
+	//   1. Column noise   - batched simplex over all CHUNK_SIZE^2 columns at once
+	//   2. Biome + height - per column, from the noise layers
+	//   3. Fill           - stone/dirt/surface/water per column
+	//   4. Structures     - trees, placed from the column data of whichever chunk
+	//                       their origin lies in
+	//
+	// Generate() is const and keeps no shared state, so any number of worker threads
+	// can use one generator. Structures may overhang chunk borders; instead of
+	// waiting on neighbouring chunks, a chunk re-derives the origins of nearby
+	// structures from the seed and writes only the blocks that fall inside itself.
+	//
+	class TerrainGenerator
+	{
+	public:
+		static constexpr int SEA_LEVEL = 48;
+
+		explicit TerrainGenerator(uint32_t seed = DEFAULT_WORLD_SEED);
+
+		void Generate(Chunk& chunk) const;
+
+		// Height of the topmost solid block in a column
+		int GetHeight(int worldX, int worldZ) const;
+		Biome GetBiome(int worldX, int worldZ) const;
+
+		uint32_t GetSeed() const { return m_Seed; }
+	private:
+		void SampleColumns(const float* xs, const float* zs, size_t count, int* heights, Biome* biomes) const;
+		void FillColumns(Chunk& chunk, const int* heights, const Biome* biomes) const;
+		void PlaceStructures(Chunk& chunk) const;
+		void PlaceTree(Chunk& chunk, int worldX, int groundY, int worldZ, uint32_t hash) const;
+	private:
+		uint32_t m_Seed;
+
+		Noise m_ContinentNoise;
+		Noise m_DetailNoise;
+		Noise m_MountainNoise;
+		Noise m_TemperatureNoise;
+		Noise m_MoistureNoise;
+	};
+
+}
@@ -0,0 +1,289 @@
+#include "VoxelQuery.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Cubed {
+
+	namespace {
+
+		constexpr float kSkin = 1e-4f;
+
+		// Longest sweep we are willing to walk cell by cell on one axis
+		constexpr int kMaxSweepCells = 256;
+
+		//
+		// Caches the last chunk looked up so neighbouring queries skip the hash map.
+		//
+		class BlockSampler
+		{
+		public:
+			explicit BlockSampler(const World& world)
+				: m_World(world) {}
+
+			Block Get(int x, int y, int z)
+			{
+				if (y < 0 || y >= CHUNK_HEIGHT)
+					return Block::Air;
+
+				const Chunk* chunk = Find(x, z);
+				if (!chunk)
+					return Block::Air;
+				return chunk->GetBlock(FloorMod(x, CHUNK_SIZE), y, FloorMod(z, CHUNK_SIZE));
+			}
+
+			// The bottom of the world is treated as solid so nothing can fall out of it,
+			// and so are chunks that aren't loaded: nothing moves through what it can't check
+			bool IsSolidAt(int x, int y, int z)
+			{
+				if (y < 0)
+					return true;
+				if (y >= CHUNK_HEIGHT)
+					return false;
+
+				const Chunk* chunk = Find(x, z);
+				return !chunk || IsSolid(chunk->GetBlock(FloorMod(x, CHUNK_SIZE), y, FloorMod(z, CHUNK_SIZE)));
+			}
+		private:
+			const Chunk* Find(int x, int z)
+			{
+				ChunkCoord coord{ FloorDiv(x, CHUNK_SIZE), FloorDiv(z, CHUNK_SIZE) };
+				if (!m_HasChunk || coord != m_Coord)
+				{
+					m_Chunk = m_World.GetChunk(coord);
+					m_Coord = coord;
+					m_HasChunk = true;
+				}
+				return m_Chunk;
+			}
+		private:
+			const World& m_World;
+			const Chunk* m_Chunk = nullptr;
+			ChunkCoord m_Coord;
+			bool m_HasChunk = false;
+		};
+
+		int FirstCell(float value) { return (int)std::floor(value + kSkin); }
+		int LastCell(float value) { return (int)std::ceil(value - kSkin) - 1; }
+
+		// Returns how far the box can move along axis (same sign as delta, never past it).
+		// A sweep longer than kMaxSweepCells stops where the check stopped.
+		float SweepAxis(BlockSampler& sampler, const AABB& box, int axis, float delta, bool& collided)
+		{
+			collided = false;
+			if (delta == 0.0f)
+				return 0.0f;
+
+			const int a1 = (axis + 1) % 3;
+			const int a2 = (axis + 2) % 3;
+			const int lo1 = FirstCell(box.Min[a1]), hi1 = LastCell(box.Max[a1]);
+			const int lo2 = FirstCell(box.Min[a2]), hi2 = LastCell(box.Max[a2]);
+
+			auto layerBlocked = [&](int c)
+			{
+				glm::ivec3 cell;
+				cell[axis] = c;
+				for (int i = lo1; i <= hi1; ++i)
+				{
+					cell[a1] = i;
+					for (int j = lo2; j <= hi2; ++j)
+					{
+						cell[a2] = j;
+						if (sampler.IsSolidAt(cell.x, cell.y, cell.z))
+							return true;
+					}
+				}
+				return false;
+			};
+
+			if (delta > 0.0f)
+			{
+				const float front = box.Max[axis];
+				const int first = (int)std::ceil(front - kSkin);
+				const int end = (int)std::floor(front + delta - kSkin);
+				const int last = std::min(end, first + kMaxSweepCells);
+				for (int c = first; c <= last; ++c)
+				{
+					if (layerBlocked(c))
+					{
+						collided = true;
+						return std::clamp((float)c - front, 0.0f, delta);
+					}
+				}
+				// Cut off: go no further than what was checked
+				if (last < end)
+					return std::clamp((float)last - front, 0.0f, delta);
+			}
+			else
+			{
+				const float front = box.Min[axis];
+				const int first = (int)std::floor(front + kSkin) - 1;
+				const int end = (int)std::ceil(front + delta + kSkin) - 1;
+				const int last = std::max(end, first - kMaxSweepCells);
+				for (int c = first; c >= last; --c)
+				{
+					if (layerBlocked(c))
+					{
+						collided = true;
+						return std::clamp((float)(c + 1) - front, delta, 0.0f);
+					}
+				}
+				if (last > end)
+					return std::clamp((float)(last + 1) - front, delta, 0.0f);
+			}
+
+			return delta;
+		}
+
+		MoveResult SweepBox(BlockSampler& sampler, const glm::vec3& position, const glm::vec3& halfExtents, const glm::vec3& displacement)
+		{
+			MoveResult result;
+			AABB box{ position - halfExtents, position + halfExtents };
+
+			static constexpr int kAxisOrder[3] = { 1, 0, 2 };
+			static constexpr uint8_t kAxisFlag[3] = { MovementFlags_CollidedX, MovementFlags_CollidedY, MovementFlags_CollidedZ };
+
+			for (int axis : kAxisOrder)
+			{
+				bool collided;
+				float moved = SweepAxis(sampler, box, axis, displacement[axis], collided);
+				box.Min[axis] += moved;
+				box.Max[axis] += moved;
+
+				if (collided)
+				{
+					result.Flags |= kAxisFlag[axis];
+					if (axis == 1 && displacement.y < 0.0f)
+						result.Flags |= MovementFlags_Grounded;
+				}
+			}
+
+			result.Position = (box.Min + box.Max) * 0.5f;
+			return result;
+		}
+
+	}
+
+	void MovementBatch::Resize(size_t count)
+	{
+		PositionX.resize(count); PositionY.resize(count); PositionZ.resize(count);
+		DeltaX.resize(count); DeltaY.resize(count); DeltaZ.resize(count);
+		MaxDistance.resize(count);
+		Flags.resize(count);
+	}
+
+	RaycastHit VoxelQuery::Raycast(const World& world, const glm::vec3& origin, const glm::vec3& direction, float maxDistance)
+	{
+		RaycastHit hit;
+
+		float length = glm::length(direction);
+		if (length < 1e-8f)
+			return hit;
+		glm::vec3 dir = direction / length;
+
+		BlockSampler sampler(world);
+
+		glm::ivec3 cell = glm::ivec3(glm::floor(origin));
+		glm::ivec3 step{ 0 };
+		glm::vec3 tMax{ std::numeric_limits<float>::infinity() };
+		glm::vec3 tDelta{ std::numeric_limits<float>::infinity() };
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (dir[axis] > 0.0f)
+			{
+				step[axis] = 1;
+				tDelta[axis] = 1.0f / dir[axis];
+				tMax[axis] = ((float)cell[axis] + 1.0f - origin[axis]) * tDelta[axis];
+			}
+			else if (dir[axis] < 0.0f)
+			{
+				step[axis] = -1;
+				tDelta[axis] = -1.0f / dir[axis];
+				tMax[axis] = (origin[axis] - (float)cell[axis]) * tDelta[axis];
+			}
+		}
+
+		float t = 0.0f;
+		glm::ivec3 normal{ 0 };
+		while (t <= maxDistance)
+		{
+			Block block = sampler.Get(cell.x, cell.y, cell.z);
+			if (IsSolid(block))
+			{
+				hit.Hit = true;
+				hit.Type = block;
+				hit.BlockPosition = cell;
+				hit.Normal = normal;
+				hit.Distance = t;
+				return hit;
+			}
+
+			int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+			t = tMax[axis];
+			cell[axis] += step[axis];
+			tMax[axis] += tDelta[axis];
+			normal = glm::ivec3(0);
+			normal[axis] = -step[axis];
+		}
+
+		return hit;
+	}
+
+	MoveResult VoxelQuery::MoveAndSlide(const World& world, const glm::vec3& position, const glm::vec3& halfExtents, const glm::vec3& displacement)
+	{
+		BlockSampler sampler(world);
+		return SweepBox(sampler, position, halfExtents, displacement);
+	}
+
+	void VoxelQuery::ResolveMovementBatch(const World& world, MovementBatch& batch, const glm::vec3& halfExtents)
+	{
+		const size_t count = batch.Size();
+		float* dx = batch.DeltaX.data();
+		float* dy = batch.DeltaY.data();
+		float* dz = batch.DeltaZ.data();
+		const float* maxDistance = batch.MaxDistance.data();
+		uint8_t* flags = batch.Flags.data();
+
+		// Speed limit - branch-free over the SoA arrays so it vectorizes
+		for (size_t i = 0; i < count; ++i)
+		{
+			float lengthSq = dx[i] * dx[i] + dy[i] * dy[i] + dz[i] * dz[i];
+			bool clamp = lengthSq > maxDistance[i] * maxDistance[i];
+			float scale = clamp ? maxDistance[i] / std::sqrt(lengthSq) : 1.0f;
+			dx[i] *= scale;
+			dy[i] *= scale;
+			dz[i] *= scale;
+			flags[i] = clamp ? MovementFlags_Clamped : MovementFlags_None;
+		}
+
+		// Collision - one sampler for the whole batch, players tend to share chunks
+		BlockSampler sampler(world);
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (dx[i] == 0.0f && dy[i] == 0.0f && dz[i] == 0.0f)
+				continue;
+
+			glm::vec3 position{ batch.PositionX[i], batch.PositionY[i], batch.PositionZ[i] };
+			MoveResult result = SweepBox(sampler, position, halfExtents, { dx[i], dy[i], dz[i] });
+
+			batch.PositionX[i] = result.Position.x;
+			batch.PositionY[i] = result.Position.y;
+			batch.PositionZ[i] = result.Position.z;
+			flags[i] |= result.Flags;
+		}
+	}
+
+	bool VoxelQuery::Overlaps(const World& world, const AABB& box)
+	{
+		BlockSampler sampler(world);
+		for (int y = FirstCell(box.Min.y); y <= LastCell(box.Max.y); ++y)
+			for (int z = FirstCell(box.Min.z); z <= LastCell(box.Max.z); ++z)
+				for (int x = FirstCell(box.Min.x); x <= LastCell(box.Max.x); ++x)
+					if (sampler.IsSolidAt(x, y, z))
+						return true;
+		return false;
+	}
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "World.h"
+
+#include <vector>
+
+namespace Cubed {
+
+	struct AABB
+	{
+		glm::vec3 Min{ 0.0f };
+		glm::vec3 Max{ 0.0f };
+	};
+
+	struct RaycastHit
+	{
+		bool Hit = false;
+		Block Type = Block::Air;
+		glm::ivec3 BlockPosition{ 0 };
+		glm::ivec3 Normal{ 0 };   // face of the hit block the ray entered through
+		float Distance = 0.0f;
+	};
+
+	enum MovementFlags : uint8_t
+	{
+		MovementFlags_None      = 0,
+		MovementFlags_Clamped   = 1 << 0, // requested displacement exceeded the allowed distance
+		MovementFlags_CollidedX = 1 << 1,
+		MovementFlags_CollidedY = 1 << 2,
+		MovementFlags_CollidedZ = 1 << 3,
+		MovementFlags_Grounded  = 1 << 4, // collided while moving down
+	};
+
+	struct MoveResult
+	{
+		glm::vec3 Position{ 0.0f };
+		uint8_t Flags = MovementFlags_None;
+	};
+
+	//
+	// Structure-of-arrays input/output for ResolveMovementBatch, so the
+	// per-player preprocessing runs as straight loops over contiguous floats.
+	//
+	struct MovementBatch
+	{
+		std::vector<float> PositionX, PositionY, PositionZ;
+		std::vector<float> DeltaX, DeltaY, DeltaZ;
+		std::vector<float> MaxDistance;
+		std::vector<uint8_t> Flags;
+
+		void Resize(size_t count);
+		void Clear() { Resize(0); }
+		size_t Size() const { return PositionX.size(); }
+	};
+
+	//
+	// VoxelQuery - collision and picking against the blocks of a World.
+	// Shared by the server (authoritative movement) and the client (prediction).
+	//
+	class VoxelQuery
+	{
+	public:
+		// Amanatides & Woo grid traversal. Direction does not need to be normalized.
+		static RaycastHit Raycast(const World& world, const glm::vec3& origin, const glm::vec3& direction, float maxDistance);
+
+		// Sweeps the box centred on position along displacement, one axis at a time
+		// (Y, X, Z), stopping at the first solid block on each axis. Blocks of chunks
+		// that aren't loaded count as solid.
+		static MoveResult MoveAndSlide(const World& world, const glm::vec3& position, const glm::vec3& halfExtents, const glm::vec3& displacement);
+
+		// Resolves every entry of the batch in place. Displacements longer than the
+		// entry's MaxDistance are first scaled down to it (and flagged as clamped).
+		static void ResolveMovementBatch(const World& world, MovementBatch& batch, const glm::vec3& halfExtents);
+
+		static bool Overlaps(const World& world, const AABB& box);
+	};
+
+}
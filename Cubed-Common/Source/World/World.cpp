@@ -0,0 +1,80 @@
+#include "World.h"
+
+#include <cmath>
+
+namespace Cubed {
+
+	Chunk* World::GetChunk(ChunkCoord coord)
+	{
+		auto it = m_Chunks.find(coord);
+		return it != m_Chunks.end() ? it->second.get() : nullptr;
+	}
+
+	const Chunk* World::GetChunk(ChunkCoord coord) const
+	{
+		auto it = m_Chunks.find(coord);
+		return it != m_Chunks.end() ? it->second.get() : nullptr;
+	}
+
+	Chunk& World::AddChunk(std::unique_ptr<Chunk> chunk)
+	{
+		ChunkCoord coord = chunk->GetCoord();
+		auto& slot = m_Chunks[coord];
+		slot = std::move(chunk);
+		return *slot;
+	}
+
+	std::unique_ptr<Chunk> World::ExtractChunk(ChunkCoord coord)
+	{
+		auto it = m_Chunks.find(coord);
+		if (it == m_Chunks.end())
+			return nullptr;
+
+		std::unique_ptr<Chunk> chunk = std::move(it->second);
+		m_Chunks.erase(it);
+		return chunk;
+	}
+
+	Block World::GetBlock(const glm::ivec3& position) const
+	{
+		if (position.y < 0 || position.y >= CHUNK_HEIGHT)
+			return Block::Air;
+
+		const Chunk* chunk = GetChunk(ToChunkCoord(position));
+		if (!chunk)
+			return Block::Air;
+
+		glm::ivec3 local = ToLocal(position);
+		return chunk->GetBlock(local.x, local.y, local.z);
+	}
+
+	bool World::SetBlock(const glm::ivec3& position, Block block)
+	{
+		if (position.y < 0 || position.y >= CHUNK_HEIGHT)
+			return false;
+
+		Chunk* chunk = GetChunk(ToChunkCoord(position));
+		if (!chunk)
+			return false;
+
+		glm::ivec3 local = ToLocal(position);
+		chunk->SetBlock(local.x, local.y, local.z, block);
+		return true;
+	}
+
+	ChunkCoord World::ToChunkCoord(const glm::ivec3& position)
+	{
+		return { FloorDiv(position.x, CHUNK_SIZE), FloorDiv(position.z, CHUNK_SIZE) };
+	}
+
+	ChunkCoord World::ToChunkCoord(const glm::vec3& position)
+	{
+		return ToChunkCoord(glm::ivec3((int)std::floor(position.x), (int)std::floor(position.y), (int)std::floor(position.z)));
+	}
+
+	glm::ivec3 World::ToLocal(const glm::ivec3& position)
+	{
+		return { FloorMod(position.x, CHUNK_SIZE), position.y, FloorMod(position.z, CHUNK_SIZE) };
+	}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Chunk.h"
+
+#include <memory>
+#include <unordered_map>
+
+namespace Cubed {
+
+	//
+	// World - sparse map of loaded chunks. Not synchronized; the owning layer
+	//         is expected to only touch it from its update thread.
+	//
+	class World
+	{
+	public:
+		Chunk* GetChunk(ChunkCoord coord);
+		const Chunk* GetChunk(ChunkCoord coord) const;
+		bool HasChunk(ChunkCoord coord) const { return m_Chunks.find(coord) != m_Chunks.end(); }
+
+		Chunk& AddChunk(std::unique_ptr<Chunk> chunk);
+		std::unique_ptr<Chunk> ExtractChunk(ChunkCoord coord);
+		void RemoveChunk(ChunkCoord coord) { m_Chunks.erase(coord); }
+		void Clear() { m_Chunks.clear(); }
+
+		size_t GetChunkCount() const { return m_Chunks.size(); }
+		const std::unordered_map<ChunkCoord, std::unique_ptr<Chunk>, ChunkCoordHash>& GetChunks() const { return m_Chunks; }
+
+		// Blocks outside of loaded chunks (or above/below the world) read as Air
+		Block GetBlock(const glm::ivec3& position) const;
+		bool SetBlock(const glm::ivec3& position, Block block);
+
+		static ChunkCoord ToChunkCoord(const glm::ivec3& position);
+		static ChunkCoord ToChunkCoord(const glm::vec3& position);
+		static glm::ivec3 ToLocal(const glm::ivec3& position);
+	private:
+		std::unordered_map<ChunkCoord, std::unique_ptr<Chunk>, ChunkCoordHash> m_Chunks;
+	};
+
+	static inline int FloorDiv(int a, int b)
+	{
+		int q = a / b;
+		return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+	}
+
+	static inline int FloorMod(int a, int b)
+	{
+		int m = a % b;
+		return (m != 0 && ((m < 0) != (b < 0))) ? m + b : m;
+	}
+
+}
@@ -1,6 +1,8 @@
 
 #include "ServerLayer.h"
 
+#include <algorithm>
+#include <charconv>
 #include <chrono>
 
 #include "Walnut/Core/Log.h"
@@ -12,6 +14,12 @@ namespace Cubed {
 
 	static Walnut::Buffer s_ScratchBuffer;
 
+	static const glm::vec3 s_PlayerHalfExtents = { 0.45f, 0.45f, 0.45f };
+	static constexpr float s_MaxPlayerSpeed = 7.5f;      // ClientLayer: 5 m/s horizontal plus 5 m/s vertical
+	static constexpr float s_MovementTolerance = 1.5f;   // slack for jitter between client frames and server ticks
+	static constexpr int s_ChunkRadius = 2;              // chunks kept generated around each player for collision
+	static constexpr float s_CorrectionThreshold = 0.01f; // resolved positions further than this from the request are sent back
+
 	void ServerLayer::OnAttach()
 	{
 		s_ScratchBuffer.Allocate(10 * 1024 * 1024); //10MB
@@ -32,6 +40,9 @@ namespace Cubed {
 
 	void ServerLayer::OnUpdate(float ts)
 	{
+		StreamChunks();
+		ResolvePlayerMovement(ts);
+
 		Walnut::BufferStreamWriter stream(s_ScratchBuffer);
 		stream.WriteRaw(PacketType::ClientUpdate);
 		m_PlayerDataMutex.lock();
@@ -61,7 +72,20 @@ namespace Cubed {
 		if (message.starts_with('/'))
 		{
 			// command
-			std::cout << "You called the" << message << " command!\n";
+			std::string_view command = message.substr(1);
+			std::string_view args;
+			if (size_t space = command.find(' '); space != std::string_view::npos)
+			{
+				args = command.substr(space + 1);
+				command = command.substr(0, space);
+			}
+
+			if (command == "bench_terrain")
+				RunTerrainBenchmark(args);
+			else if (command == "cache_stats")
+				PrintCacheStats();
+			else
+				std::cout << "You called the" << message << " command!\n";
 		}
 	}
 
@@ -69,12 +93,23 @@ namespace Cubed {
 	{
 		WL_INFO_TAG("Server", "Client connected! ID={}", clientInfo.ID);
 
+		// The server places every player; its updates only ever request a move from here.
+		// Centred in the column so the box stays within the one whose height it takes.
+		const glm::vec3 spawn = { 0.5f, (float)m_ChunkGenerator.GetTerrain().GetHeight(0, 0) + 1.0f + s_PlayerHalfExtents.y, 0.5f };
+		m_PlayerDataMutex.lock();
+		{
+			m_PlayerData[clientInfo.ID] = PlayerData{ spawn, glm::vec3(0.0f) };
+			m_MovementRequests[clientInfo.ID] = MovementRequest{};
+		}
+		m_PlayerDataMutex.unlock();
+
 		Walnut::BufferStreamWriter stream(s_ScratchBuffer);
 
 		stream.WriteRaw(PacketType::ClientConnect);
 		stream.WriteRaw(clientInfo.ID);
 
 		m_Server.SendBufferToClient(clientInfo.ID, stream.GetBuffer());
+		SendPlayerPosition(clientInfo.ID, spawn);
 	}
 
 	void ServerLayer::OnClientDisconnected(const Walnut::ClientInfo& clientInfo)
@@ -82,6 +117,7 @@ namespace Cubed {
 		WL_INFO_TAG("Server", "Client disconnected! ID={}", clientInfo.ID);
 		m_PlayerDataMutex.lock();
 		m_PlayerData.erase(clientInfo.ID);
+		m_MovementRequests.erase(clientInfo.ID);
 		m_PlayerDataMutex.unlock();
 
 		Walnut::BufferStreamWriter stream(s_ScratchBuffer);
@@ -101,17 +137,143 @@ namespace Cubed {
 		switch (type) 
 		{
 		case PacketType::ClientUpdate:
+		{
+			glm::vec3 position, velocity;
+			stream.ReadRaw<glm::vec3>(position);
+			stream.ReadRaw<glm::vec3>(velocity);
 
 			m_PlayerDataMutex.lock();
 			{
-				PlayerData& playerData = m_PlayerData[clientInfo.ID];
-				stream.ReadRaw<glm::vec2>(playerData.Position);
-				stream.ReadRaw<glm::vec2>(playerData.Velocity);
-				//WL_INFO_TAG("Server", "PlayerID: {}; {}, {} - {}, {}", clientInfo.ID, playerData.Position.x, playerData.Position.y, playerData.Velocity.x, playerData.Velocity.y);
+				// Placed on connect, the position is only a request validated in ResolvePlayerMovement
+				auto it = m_PlayerData.find(clientInfo.ID);
+				if (it != m_PlayerData.end())
+				{
+					it->second.Velocity = velocity;
+
+					MovementRequest& request = m_MovementRequests[clientInfo.ID];
+					request.Position = position;
+					request.Pending = true;
+				}
 			}
 			m_PlayerDataMutex.unlock();
 			break;
 		}
+		}
+	}
+
+	void ServerLayer::StreamChunks()
+	{
+		m_StreamingPositions.clear();
+		m_PlayerDataMutex.lock();
+		for (const auto& [id, playerData] : m_PlayerData)
+			m_StreamingPositions.push_back(playerData.Position);
+		m_PlayerDataMutex.unlock();
+
+		for (const glm::vec3& position : m_StreamingPositions)
+		{
+			ChunkCoord center = World::ToChunkCoord(position);
+			for (int z = -s_ChunkRadius; z <= s_ChunkRadius; ++z)
+			{
+				for (int x = -s_ChunkRadius; x <= s_ChunkRadius; ++x)
+				{
+					ChunkCoord coord{ center.X + x, center.Z + z };
+					if (!m_ChunkCache.Acquire(coord))
+						m_ChunkGenerator.Request(coord);
+				}
+			}
+		}
+
+		m_GeneratedChunks.clear();
+		m_ChunkGenerator.Collect(m_GeneratedChunks);
+		for (auto& chunk : m_GeneratedChunks)
+			m_ChunkCache.Insert(std::move(chunk));
+
+		m_ChunkCache.Trim(m_StreamingPositions);
+	}
+
+	void ServerLayer::ResolvePlayerMovement(float ts)
+	{
+		m_PositionCorrections.clear();
+		m_PlayerDataMutex.lock();
+
+		m_MovementBatch.Clear();
+		m_MovementBatchIDs.clear();
+		for (auto& [id, request] : m_MovementRequests)
+		{
+			request.Elapsed += ts;
+			if (!request.Pending)
+				continue;
+
+			const PlayerData& playerData = m_PlayerData[id];
+			glm::vec3 delta = request.Position - playerData.Position;
+
+			size_t i = m_MovementBatch.Size();
+			m_MovementBatch.Resize(i + 1);
+			m_MovementBatch.PositionX[i] = playerData.Position.x;
+			m_MovementBatch.PositionY[i] = playerData.Position.y;
+			m_MovementBatch.PositionZ[i] = playerData.Position.z;
+			m_MovementBatch.DeltaX[i] = delta.x;
+			m_MovementBatch.DeltaY[i] = delta.y;
+			m_MovementBatch.DeltaZ[i] = delta.z;
+			m_MovementBatch.MaxDistance[i] = s_MaxPlayerSpeed * request.Elapsed * s_MovementTolerance;
+			m_MovementBatchIDs.push_back(id);
+
+			request.Elapsed = 0.0f;
+			request.Pending = false;
+		}
+
+		// Cells of chunks that aren't resident count as solid, so a player only
+		// moves into a chunk once it is here to check against
+		if (!m_MovementBatchIDs.empty())
+			VoxelQuery::ResolveMovementBatch(m_World, m_MovementBatch, s_PlayerHalfExtents);
+
+		for (size_t i = 0; i < m_MovementBatchIDs.size(); ++i)
+		{
+			const uint32_t id = m_MovementBatchIDs[i];
+			PlayerData& playerData = m_PlayerData[id];
+			playerData.Position = { m_MovementBatch.PositionX[i], m_MovementBatch.PositionY[i], m_MovementBatch.PositionZ[i] };
+
+			if (glm::distance(playerData.Position, m_MovementRequests[id].Position) > s_CorrectionThreshold)
+				m_PositionCorrections.emplace_back(id, playerData.Position);
+		}
+
+		m_PlayerDataMutex.unlock();
+
+		for (const auto& [id, position] : m_PositionCorrections)
+			SendPlayerPosition(id, position);
+	}
+
+	void ServerLayer::SendPlayerPosition(uint32_t clientID, const glm::vec3& position)
+	{
+		Walnut::BufferStreamWriter stream(s_ScratchBuffer);
+		stream.WriteRaw(PacketType::PlayerPosition);
+		stream.WriteRaw<glm::vec3>(position);
+
+		m_Server.SendBufferToClient(clientID, stream.GetBuffer());
+	}
+
+	void ServerLayer::RunTerrainBenchmark(std::string_view args)
+	{
+		int radius = 8;
+		if (!args.empty())
+			std::from_chars(args.data(), args.data() + args.size(), radius);
+		radius = std::max(radius, 0);
+
+		m_Console.AddTaggedMessage("Server", "Generating {0}x{0} chunks...", 2 * radius + 1);
+
+		GenerationBenchmark result = ChunkGenerator::RunBenchmark(m_ChunkGenerator.GetTerrain().GetSeed(), radius);
+		m_Console.AddTaggedMessage("Server", "{} chunks in {:.3f}s on {} threads: {:.1f} chunks/s, {:.1f} chunks/s per core",
+			result.Chunks, result.Seconds, result.Threads, result.ChunksPerSecond, result.ChunksPerSecondPerCore);
+	}
+
+	void ServerLayer::PrintCacheStats()
+	{
+		const ChunkCacheStats& stats = m_ChunkCache.GetStats();
+		m_Console.AddTaggedMessage("Server", "Chunk cache: {} resident ({:.1f} MB of {:.1f} MB), {} spilled ({:.1f} KB), {} on disk",
+			stats.ResidentChunks, stats.ResidentBytes / (1024.0 * 1024.0), m_ChunkCache.GetSettings().ResidentBudget / (1024.0 * 1024.0),
+			stats.SpilledChunks, stats.SpilledBytes / 1024.0, stats.DiskChunks);
+		m_Console.AddTaggedMessage("Server", "{} hits, {} misses, {} restores, {} evictions, {} disk writes, {} disk reads, {} dropped",
+			stats.Hits, stats.Misses, stats.Restores, stats.Evictions, stats.DiskWrites, stats.DiskReads, stats.Dropped);
 	}
 
 }
\ No newline at end of file
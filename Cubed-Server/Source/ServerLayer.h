@@ -6,6 +6,10 @@
 
 #include "Walnut/Networking/Server.h"
 
+#include "World/ChunkCache.h"
+#include "World/ChunkGenerator.h"
+#include "World/VoxelQuery.h"
+
 #include <glm\glm.hpp>
 #include <map>
 #include <mutex>
@@ -27,18 +31,44 @@ namespace Cubed {
 		void OnClientConnected(const Walnut::ClientInfo& clientInfo);
 		void OnClientDisconnected(const Walnut::ClientInfo& clientInfo);
 		void OnDataReceived(const Walnut::ClientInfo& clientInfo, const Walnut::Buffer buffer);
+
+		void StreamChunks();
+		void ResolvePlayerMovement(float ts);
+		void SendPlayerPosition(uint32_t clientID, const glm::vec3& position);
+
+		void RunTerrainBenchmark(std::string_view args);
+		void PrintCacheStats();
 	private:
 		HeadlessConsole m_Console;
 		Walnut::Server m_Server{ 8192 };
 
 		struct PlayerData 
 		{
-			glm::vec2 Position;
-			glm::vec2 Velocity;
+			glm::vec3 Position;
+			glm::vec3 Velocity;
+		};
+
+		// Latest position a client asked for, applied against the world on the next tick
+		struct MovementRequest
+		{
+			glm::vec3 Position;
+			float Elapsed = 0.0f; // time since the last resolved request
+			bool Pending = false;
 		};
 
 		std::mutex m_PlayerDataMutex;
 		std::map<uint32_t, PlayerData> m_PlayerData;
+		std::map<uint32_t, MovementRequest> m_MovementRequests;
+
+		World m_World;
+		ChunkCache m_ChunkCache{ m_World, { .SpillDirectory = "Cache/Server" } };
+		ChunkGenerator m_ChunkGenerator;
+		std::vector<std::unique_ptr<Chunk>> m_GeneratedChunks;
+		std::vector<glm::vec3> m_StreamingPositions;
+
+		MovementBatch m_MovementBatch;
+		std::vector<uint32_t> m_MovementBatchIDs;
+		std::vector<std::pair<uint32_t, glm::vec3>> m_PositionCorrections;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,59 @@
+project "Cubed-Tests"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++20"
+   targetdir "bin/%{cfg.buildcfg}"
+   staticruntime "off"
+
+   -- Behaviour tests for the code that needs neither a window nor a GPU: the
+   -- world (lighting, collision, the chunk cache) and the renderer's free list.
+   -- They are compiled straight in, so this only depends on glm; running the
+   -- executable runs every test and it exits non-zero if any check failed.
+   files
+   {
+      "Source/**.h",
+      "Source/**.cpp",
+
+      "../Cubed-Common/Source/World/**.h",
+      "../Cubed-Common/Source/World/**.cpp",
+
+      "../Cubed-Client/Source/Renderer/FreeListAllocator.h",
+      "../Cubed-Client/Source/Renderer/FreeListAllocator.cpp"
+   }
+
+   includedirs
+   {
+      "Source",
+      "../Cubed-Common/Source",
+      "../Cubed-Client/Source",
+
+      "../Walnut/vendor/glm"
+   }
+
+   targetdir ("../bin/" .. outputdir .. "/%{prj.name}")
+   objdir ("../bin-int/" .. outputdir .. "/%{prj.name}")
+
+   filter "system:windows"
+      systemversion "latest"
+      defines { "WL_PLATFORM_WINDOWS" }
+
+   filter "system:linux"
+      defines { "WL_PLATFORM_LINUX" }
+      links { "pthread" }
+
+   filter "configurations:Debug"
+      defines { "WL_DEBUG" }
+      runtime "Debug"
+      symbols "On"
+
+   filter "configurations:Release"
+      defines { "WL_RELEASE" }
+      runtime "Release"
+      optimize "On"
+      symbols "On"
+
+   filter "configurations:Dist"
+      defines { "WL_DIST" }
+      runtime "Release"
+      optimize "On"
+      symbols "Off"
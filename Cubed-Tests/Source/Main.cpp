@@ -0,0 +1,45 @@
+#include "Test.h"
+
+#include <cstdio>
+
+namespace Cubed::Tests {
+
+	static int s_Failures = 0;
+
+	std::vector<TestCase>& GetTests()
+	{
+		static std::vector<TestCase> s_Tests;
+		return s_Tests;
+	}
+
+	bool Register(const char* name, TestFunc func)
+	{
+		GetTests().push_back({ name, func });
+		return true;
+	}
+
+	void Fail(const char* file, int line, const char* expression)
+	{
+		std::printf("  %s(%d): CHECK(%s) failed\n", file, line, expression);
+		s_Failures++;
+	}
+
+}
+
+int main()
+{
+	using namespace Cubed::Tests;
+
+	int failedTests = 0;
+	for (const TestCase& test : GetTests())
+	{
+		const int failuresBefore = s_Failures;
+		test.Func();
+		const bool passed = s_Failures == failuresBefore;
+		std::printf("[%s] %s\n", passed ? " OK " : "FAIL", test.Name);
+		failedTests += passed ? 0 : 1;
+	}
+
+	std::printf("%zu tests, %d failed\n", GetTests().size(), failedTests);
+	return failedTests == 0 ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+#include "../Test.h"
+
+#include "Renderer/FreeListAllocator.h"
+
+namespace Cubed {
+
+	TEST_CASE(FreeListAllocator_FreedNeighboursCoalesce)
+	{
+		FreeListAllocator allocator;
+		allocator.Reset(100);
+
+		uint64_t a, b, c;
+		CHECK(allocator.Allocate(30, 1, a) && a == 0);
+		CHECK(allocator.Allocate(30, 1, b) && b == 30);
+		CHECK(allocator.Allocate(40, 1, c) && c == 60);
+		CHECK(allocator.GetFreeSpace() == 0);
+		CHECK(allocator.GetFreeBlockCount() == 0);
+
+		uint64_t d;
+		CHECK(!allocator.Allocate(1, 1, d));
+
+		allocator.Free(a, 30);
+		allocator.Free(c, 40);
+		CHECK(allocator.GetFreeBlockCount() == 2);
+		CHECK(allocator.GetLargestFreeBlock() == 40);
+
+		// The middle one joins both sides back into one block
+		allocator.Free(b, 30);
+		CHECK(allocator.GetFreeBlockCount() == 1);
+		CHECK(allocator.GetLargestFreeBlock() == 100);
+		CHECK(allocator.GetUsedSpace() == 0);
+	}
+
+	TEST_CASE(FreeListAllocator_AlignmentPaddingStaysFree)
+	{
+		FreeListAllocator allocator;
+		allocator.Reset(256);
+
+		uint64_t a, b;
+		CHECK(allocator.Allocate(3, 1, a) && a == 0);
+		CHECK(allocator.Allocate(16, 64, b) && b == 64);
+		CHECK(allocator.GetUsedSpace() == 19);
+
+		// [3, 64) was padding and can still be handed out
+		uint64_t c;
+		CHECK(allocator.Allocate(61, 1, c) && c == 3);
+	}
+
+	TEST_CASE(FreeListAllocator_PicksTheBestFit)
+	{
+		FreeListAllocator allocator;
+		allocator.Reset(100);
+
+		// Leave holes of 20 at 0 and of 8 at 40
+		uint64_t offsets[4];
+		CHECK(allocator.Allocate(20, 1, offsets[0]));
+		CHECK(allocator.Allocate(20, 1, offsets[1]));
+		CHECK(allocator.Allocate(8, 1, offsets[2]));
+		CHECK(allocator.Allocate(52, 1, offsets[3]));
+		allocator.Free(offsets[0], 20);
+		allocator.Free(offsets[2], 8);
+
+		uint64_t offset;
+		CHECK(allocator.Allocate(6, 1, offset) && offset == 40);
+		CHECK(allocator.Allocate(20, 1, offset) && offset == 0);
+	}
+
+	TEST_CASE(FreeListAllocator_GrowExtendsTheLastFreeBlock)
+	{
+		FreeListAllocator allocator;
+		allocator.Reset(64);
+
+		uint64_t a, b;
+		CHECK(allocator.Allocate(48, 1, a));
+		CHECK(!allocator.Allocate(32, 1, b));
+
+		allocator.Grow(128);
+		CHECK(allocator.GetCapacity() == 128);
+		CHECK(allocator.GetFreeBlockCount() == 1);
+		CHECK(allocator.Allocate(32, 1, b) && b == 48);
+
+		// Shrinking is not a thing
+		allocator.Grow(16);
+		CHECK(allocator.GetCapacity() == 128);
+	}
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+
+namespace Cubed::Tests {
+
+	using TestFunc = void(*)();
+
+	struct TestCase
+	{
+		const char* Name;
+		TestFunc Func;
+	};
+
+	std::vector<TestCase>& GetTests();
+	bool Register(const char* name, TestFunc func);
+	void Fail(const char* file, int line, const char* expression);
+
+}
+
+//
+// TEST_CASE(Name) { ... } defines a test that Main.cpp runs. CHECK records a
+// failure and carries on, so one run reports everything that is wrong.
+//
+#define TEST_CASE(name) \
+	static void name(); \
+	static const bool name##_Registered = ::Cubed::Tests::Register(#name, &name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) ::Cubed::Tests::Fail(__FILE__, __LINE__, #expression); } while (0)
@@ -0,0 +1,126 @@
+#include "../Test.h"
+
+#include "World/ChunkCache.h"
+#include "World/TerrainGenerator.h"
+
+#include <cstring>
+
+namespace Cubed {
+
+	namespace {
+
+		std::unique_ptr<Chunk> GenerateChunk(ChunkCoord coord)
+		{
+			static const TerrainGenerator s_Terrain;
+			auto chunk = std::make_unique<Chunk>(coord);
+			s_Terrain.Generate(*chunk);
+			// Some light to carry along, it is stored next to the blocks
+			for (int i = 0; i < CHUNK_VOLUME; i += 7)
+				chunk->GetLight()[i] = (uint8_t)(i * 31);
+			return chunk;
+		}
+
+		bool SameContents(const Chunk& a, const Chunk& b)
+		{
+			return std::memcmp(a.GetBlocks(), b.GetBlocks(), CHUNK_VOLUME) == 0
+				&& std::memcmp(a.GetLight(), b.GetLight(), CHUNK_VOLUME) == 0;
+		}
+
+	}
+
+	TEST_CASE(ChunkCache_CompressRoundTrips)
+	{
+		std::unique_ptr<Chunk> chunk = GenerateChunk({ 3, -2 });
+
+		std::vector<uint8_t> data;
+		ChunkCache::Compress(*chunk, data);
+		CHECK(data.size() < 2 * (size_t)CHUNK_VOLUME);
+
+		Chunk restored({ 3, -2 });
+		CHECK(ChunkCache::Decompress(data.data(), data.size(), restored));
+		CHECK(SameContents(*chunk, restored));
+	}
+
+	TEST_CASE(ChunkCache_DecompressRejectsBadData)
+	{
+		std::unique_ptr<Chunk> chunk = GenerateChunk({ 0, 0 });
+		std::vector<uint8_t> data;
+		ChunkCache::Compress(*chunk, data);
+
+		Chunk restored({ 0, 0 });
+		CHECK(!ChunkCache::Decompress(data.data(), data.size() - 2, restored));   // too short
+		CHECK(!ChunkCache::Decompress(data.data(), data.size() - 1, restored));   // half a run
+
+		std::vector<uint8_t> longer = data;
+		longer.insert(longer.end(), { 0, 0 });
+		CHECK(!ChunkCache::Decompress(longer.data(), longer.size(), restored));   // too long
+
+		std::vector<uint8_t> badBlock = data;
+		badBlock[1] = (uint8_t)Block::Count;
+		CHECK(!ChunkCache::Decompress(badBlock.data(), badBlock.size(), restored));
+	}
+
+	TEST_CASE(ChunkCache_EvictedChunksComeBackIntact)
+	{
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "CubedTests-ChunkCache";
+		std::filesystem::remove_all(directory);
+
+		// Room for one resident chunk and one spilled one; the rest goes to disk
+		World world;
+		ChunkCacheSettings settings;
+		settings.ResidentBudget = sizeof(Chunk);
+		settings.SpillDirectory = directory;
+		settings.PinRadius = 0;
+		{
+			std::vector<uint8_t> data;
+			ChunkCache::Compress(*GenerateChunk({ 0, 0 }), data);
+			settings.SpillBudget = data.size() + data.size() / 2;
+		}
+		ChunkCache cache(world, settings);
+
+		const std::vector<glm::vec3> farAway = { glm::vec3(100000.0f, 0.0f, 100000.0f) };
+		for (int x = 0; x < 4; ++x)
+		{
+			CHECK(!cache.Acquire({ x, 0 }));
+			cache.Insert(GenerateChunk({ x, 0 }));
+			cache.Trim(farAway);
+		}
+		CHECK(world.GetChunkCount() == 1);
+		CHECK(cache.GetStats().DiskWrites > 0);
+
+		for (int x = 0; x < 4; ++x)
+		{
+			CHECK(cache.Acquire({ x, 0 }));
+			const Chunk* chunk = world.GetChunk({ x, 0 });
+			CHECK(chunk && SameContents(*chunk, *GenerateChunk({ x, 0 })));
+			cache.Trim(farAway);
+		}
+		CHECK(cache.GetStats().Restores == 4);
+		CHECK(cache.GetStats().Misses == 4);
+		CHECK(cache.GetStats().DiskReads > 0);
+
+		std::filesystem::remove_all(directory);
+	}
+
+	TEST_CASE(ChunkCache_MissesAreForgottenOutsideTheStreamingRadius)
+	{
+		World world;
+		ChunkCache cache(world, { .PinRadius = 2 });
+
+		// Counted once while it is being generated
+		CHECK(!cache.Acquire({ 10, 10 }));
+		CHECK(!cache.Acquire({ 10, 10 }));
+		CHECK(cache.GetStats().Misses == 1);
+
+		// Still streamed in around the player, still the same miss
+		cache.Trim({ glm::vec3(10.5f * CHUNK_SIZE, 0.0f, 10.5f * CHUNK_SIZE) });
+		CHECK(!cache.Acquire({ 10, 10 }));
+		CHECK(cache.GetStats().Misses == 1);
+
+		// The player left before it arrived: forgotten, so asking again is a new miss
+		cache.Trim({ glm::vec3(0.0f) });
+		CHECK(!cache.Acquire({ 10, 10 }));
+		CHECK(cache.GetStats().Misses == 2);
+	}
+
+}
@@ -0,0 +1,125 @@
+#include "../Test.h"
+
+#include "World/LightEngine.h"
+#include "World/TerrainGenerator.h"
+
+#include <cstring>
+#include <random>
+
+namespace Cubed {
+
+	namespace {
+
+		constexpr int kRadius = 2;   // the test world is (2 * kRadius + 1)^2 chunks
+
+		void GenerateWorld(World& world, LightEngine& light)
+		{
+			TerrainGenerator terrain;
+			for (int z = -kRadius; z <= kRadius; ++z)
+			{
+				for (int x = -kRadius; x <= kRadius; ++x)
+				{
+					auto chunk = std::make_unique<Chunk>(ChunkCoord{ x, z });
+					terrain.Generate(*chunk);
+					world.AddChunk(std::move(chunk));
+					light.LightChunk({ x, z });
+				}
+			}
+		}
+
+		// Same blocks as 'source', lit from scratch one chunk at a time
+		void Relight(const World& source, World& world, LightEngine& light)
+		{
+			for (int z = -kRadius; z <= kRadius; ++z)
+			{
+				for (int x = -kRadius; x <= kRadius; ++x)
+				{
+					auto chunk = std::make_unique<Chunk>(ChunkCoord{ x, z });
+					std::memcpy(chunk->GetBlocks(), source.GetChunk({ x, z })->GetBlocks(), CHUNK_VOLUME);
+					world.AddChunk(std::move(chunk));
+					light.LightChunk({ x, z });
+				}
+			}
+		}
+
+		int CountLightMismatches(const World& a, const World& b)
+		{
+			int mismatches = 0;
+			for (int z = -kRadius; z <= kRadius; ++z)
+			{
+				for (int x = -kRadius; x <= kRadius; ++x)
+				{
+					const uint8_t* lightA = a.GetChunk({ x, z })->GetLight();
+					const uint8_t* lightB = b.GetChunk({ x, z })->GetLight();
+					for (int i = 0; i < CHUNK_VOLUME; ++i)
+						mismatches += lightA[i] != lightB[i];
+				}
+			}
+			return mismatches;
+		}
+
+	}
+
+	// Incremental edits have to end up exactly where a full relight of the result would
+	TEST_CASE(LightEngine_IncrementalEditsMatchFullRelight)
+	{
+		World world;
+		LightEngine light(world);
+		GenerateWorld(world, light);
+
+		// Edits near the surface, where sky and block light both change
+		TerrainGenerator terrain;
+		std::mt19937 random(1234);
+		std::uniform_int_distribution<int> horizontal(-kRadius * CHUNK_SIZE, (kRadius + 1) * CHUNK_SIZE - 1);
+		std::uniform_int_distribution<int> depth(-4, 4);
+		std::uniform_int_distribution<int> kind(0, 3);
+		for (int edit = 0; edit < 500; ++edit)
+		{
+			const int x = horizontal(random), z = horizontal(random);
+			const int y = std::clamp(terrain.GetHeight(x, z) + depth(random), 0, CHUNK_HEIGHT - 1);
+
+			static constexpr Block kBlocks[4] = { Block::Air, Block::Stone, Block::Glowstone, Block::Leaves };
+			light.SetBlock({ x, y, z }, kBlocks[kind(random)]);
+		}
+
+		World reference;
+		LightEngine referenceLight(reference);
+		Relight(world, reference, referenceLight);
+
+		CHECK(CountLightMismatches(world, reference) == 0);
+	}
+
+	TEST_CASE(LightEngine_RemovingAnEmitterClearsItsLight)
+	{
+		World world;
+		LightEngine light(world);
+		GenerateWorld(world, light);
+
+		// Deep underground, where there is no sky light to mix in
+		const glm::ivec3 position{ 3, 5, 3 };
+		light.SetBlock(position + glm::ivec3(1, 0, 0), Block::Air);
+		light.SetBlock(position, Block::Glowstone);
+		const uint8_t emission = GetBlockInfo(Block::Glowstone).Emission;
+		CHECK(light.GetLight(LightChannel::Block, position + glm::ivec3(1, 0, 0)) == emission - 1);
+
+		light.SetBlock(position, Block::Stone);
+		CHECK(light.GetLight(LightChannel::Block, position + glm::ivec3(1, 0, 0)) == 0);
+	}
+
+	TEST_CASE(LightEngine_SkyLightFallsWithoutFalloff)
+	{
+		World world;
+		LightEngine light(world);
+		world.AddChunk(std::make_unique<Chunk>(ChunkCoord{ 0, 0 }));
+		light.LightChunk({ 0, 0 });
+
+		for (int y = 0; y < CHUNK_HEIGHT; ++y)
+			CHECK(light.GetLight(LightChannel::Sky, { 5, y, 5 }) == MAX_LIGHT_LEVEL);
+
+		// A roof shades the column below it
+		light.SetBlock({ 5, 64, 5 }, Block::Stone);
+		CHECK(light.GetLight(LightChannel::Sky, { 5, 65, 5 }) == MAX_LIGHT_LEVEL);
+		CHECK(light.GetLight(LightChannel::Sky, { 5, 63, 5 }) == MAX_LIGHT_LEVEL - 1);
+	}
+
+}
@@ -0,0 +1,130 @@
+#include "../Test.h"
+
+#include "World/VoxelQuery.h"
+
+#include <cmath>
+
+namespace Cubed {
+
+	namespace {
+
+		constexpr int kFloorY = 10;   // top of the floor is at y = kFloorY + 1
+		const glm::vec3 kHalfExtents{ 0.45f, 0.45f, 0.45f };
+
+		// Empty chunks from (firstX, 0) to (lastX, 0) with a stone floor
+		void AddFlatChunks(World& world, int firstX, int lastX)
+		{
+			for (int chunkX = firstX; chunkX <= lastX; ++chunkX)
+			{
+				auto chunk = std::make_unique<Chunk>(ChunkCoord{ chunkX, 0 });
+				for (int z = 0; z < CHUNK_SIZE; ++z)
+					for (int x = 0; x < CHUNK_SIZE; ++x)
+						chunk->SetBlock(x, kFloorY, z, Block::Stone);
+				world.AddChunk(std::move(chunk));
+			}
+		}
+
+		bool Near(float a, float b) { return std::abs(a - b) < 1e-3f; }
+
+	}
+
+	TEST_CASE(VoxelQuery_FallingLandsOnTheFloor)
+	{
+		World world;
+		AddFlatChunks(world, 0, 0);
+
+		MoveResult result = VoxelQuery::MoveAndSlide(world, { 8.5f, 20.0f, 8.5f }, kHalfExtents, { 0.0f, -30.0f, 0.0f });
+		CHECK(Near(result.Position.y, kFloorY + 1 + kHalfExtents.y));
+		CHECK((result.Flags & MovementFlags_CollidedY) != 0);
+		CHECK((result.Flags & MovementFlags_Grounded) != 0);
+	}
+
+	TEST_CASE(VoxelQuery_WallStopsOneAxisAndSlidesAlongTheOther)
+	{
+		World world;
+		AddFlatChunks(world, 0, 0);
+		for (int y = kFloorY + 1; y < kFloorY + 4; ++y)
+			for (int z = 0; z < CHUNK_SIZE; ++z)
+				world.SetBlock({ 10, y, z }, Block::Stone);
+
+		const glm::vec3 start{ 8.5f, kFloorY + 1 + kHalfExtents.y, 4.5f };
+		MoveResult result = VoxelQuery::MoveAndSlide(world, start, kHalfExtents, { 3.0f, 0.0f, 2.0f });
+		CHECK(Near(result.Position.x, 10.0f - kHalfExtents.x));
+		CHECK(Near(result.Position.z, 6.5f));
+		CHECK((result.Flags & MovementFlags_CollidedX) != 0);
+		CHECK((result.Flags & MovementFlags_CollidedZ) == 0);
+	}
+
+	TEST_CASE(VoxelQuery_UnloadedChunksAreSolid)
+	{
+		World world;
+		AddFlatChunks(world, 0, 0);
+
+		// Chunk 1 isn't loaded, the box stops at the border
+		const glm::vec3 start{ 14.5f, kFloorY + 1 + kHalfExtents.y, 8.5f };
+		MoveResult result = VoxelQuery::MoveAndSlide(world, start, kHalfExtents, { 4.0f, 0.0f, 0.0f });
+		CHECK(Near(result.Position.x, CHUNK_SIZE - kHalfExtents.x));
+		CHECK((result.Flags & MovementFlags_CollidedX) != 0);
+	}
+
+	TEST_CASE(VoxelQuery_LongSweepStopsWhereTheCheckStopped)
+	{
+		// 20 chunks of open space, more than the 256 cells one sweep walks
+		World world;
+		AddFlatChunks(world, 0, 19);
+
+		const glm::vec3 start{ 0.5f, kFloorY + 1 + kHalfExtents.y, 8.5f };
+		MoveResult result = VoxelQuery::MoveAndSlide(world, start, kHalfExtents, { 300.0f, 0.0f, 0.0f });
+		CHECK(result.Position.x > start.x + 200.0f);
+		CHECK(result.Position.x < start.x + 300.0f);
+
+		MoveResult back = VoxelQuery::MoveAndSlide(world, { 319.5f, start.y, start.z }, kHalfExtents, { -300.0f, 0.0f, 0.0f });
+		CHECK(back.Position.x < 319.5f - 200.0f);
+		CHECK(back.Position.x > 319.5f - 300.0f);
+	}
+
+	TEST_CASE(VoxelQuery_BatchClampsToMaxDistance)
+	{
+		World world;
+		AddFlatChunks(world, 0, 0);
+
+		MovementBatch batch;
+		batch.Resize(2);
+		for (size_t i = 0; i < 2; ++i)
+		{
+			batch.PositionX[i] = 4.5f;
+			batch.PositionY[i] = kFloorY + 1 + kHalfExtents.y;
+			batch.PositionZ[i] = 4.5f;
+			batch.DeltaX[i] = 0.0f;
+			batch.DeltaY[i] = 0.0f;
+			batch.DeltaZ[i] = 0.0f;
+		}
+		batch.DeltaX[0] = 6.0f;
+		batch.MaxDistance[0] = 2.0f;
+		batch.DeltaZ[1] = 1.0f;
+		batch.MaxDistance[1] = 2.0f;
+
+		VoxelQuery::ResolveMovementBatch(world, batch, kHalfExtents);
+		CHECK(Near(batch.PositionX[0], 6.5f));
+		CHECK((batch.Flags[0] & MovementFlags_Clamped) != 0);
+		CHECK(Near(batch.PositionZ[1], 5.5f));
+		CHECK(batch.Flags[1] == MovementFlags_None);
+	}
+
+	TEST_CASE(VoxelQuery_RaycastHitsTheFirstSolidBlock)
+	{
+		World world;
+		AddFlatChunks(world, 0, 0);
+
+		RaycastHit hit = VoxelQuery::Raycast(world, { 4.5f, 15.5f, 4.5f }, { 0.0f, -1.0f, 0.0f }, 20.0f);
+		CHECK(hit.Hit);
+		CHECK(hit.Type == Block::Stone);
+		CHECK(hit.BlockPosition == glm::ivec3(4, kFloorY, 4));
+		CHECK(hit.Normal == glm::ivec3(0, 1, 0));
+		CHECK(Near(hit.Distance, 15.5f - (kFloorY + 1)));
+
+		RaycastHit miss = VoxelQuery::Raycast(world, { 4.5f, 15.5f, 4.5f }, { 0.0f, -1.0f, 0.0f }, 2.0f);
+		CHECK(!miss.Hit);
+	}
+
+}
@@ -1,5 +1,5 @@
 #!/bin/bash
 
 pushd ..
-Walnut/vendor/bin/premake/Linux/premake5 --cc=clang --file=Build-Headless.lua gmake2
+Walnut/vendor/bin/premake/Linux/premake5 --cc=clang --file=Build-Server.lua gmake2
 popd
\ No newline at end of file